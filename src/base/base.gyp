@@ -45,6 +45,7 @@
         'run_level.cc',
         'scheduler.cc',
         'stopwatch.cc',
+        'trace_file_writer.cc',
         'unnamed_event.cc',
       ],
       'dependencies': [
@@ -111,6 +112,7 @@
         'system_util.cc',
         'text_normalizer.cc',
         'thread.cc',
+        'trace.cc',
         'util.cc',
         'version.cc',
         'win_util.cc',
@@ -83,6 +83,8 @@
         'cpu_stats_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
+        'trace_file_writer_test.cc',
+        'trace_test.cc',
         'unnamed_event_test.cc',
       ],
       'conditions': [
@@ -112,6 +114,7 @@
         '../testing/testing.gyp:gtest_main',
         'base.gyp:base',
         'clock_mock',
+        'scheduler_stub',
       ],
       'variables': {
         'test_size': 'small',
@@ -219,6 +219,16 @@ string ConfigFileStream::GetFileName(const string &filename) {
   return "";
 }
 
+string ConfigFileStream::GetFileName(const string &filename,
+                                     const string &user_profile_directory) {
+  if (!user_profile_directory.empty() &&
+      Util::StartsWith(filename, kUserPrefix)) {
+    return FileUtil::JoinPath(user_profile_directory,
+                              RemovePrefix(kUserPrefix, filename));
+  }
+  return GetFileName(filename);
+}
+
 void ConfigFileStream::ClearOnMemoryFiles() {
   Singleton<OnMemoryFileMap>::get()->clear();
 }
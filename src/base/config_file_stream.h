@@ -97,6 +97,11 @@ class ConfigFileStream {
   // if prefix is system:// or memory:// return "";
   static string GetFileName(const string &filename);
 
+  // The same as above, but user:// is expanded into |user_profile_directory|
+  // unless it is empty.
+  static string GetFileName(const string &filename,
+                            const string &user_profile_directory);
+
   // Clear all memory:// files.  This is a utility method for testing.
   static void ClearOnMemoryFiles();
 
@@ -108,6 +108,16 @@ TEST_F(ConfigFileStreamTest, OnMemoryFiles) {
   }
 }
 
+TEST_F(ConfigFileStreamTest, GetFileNameInUserProfileDirectory) {
+  const string kDir = FileUtil::JoinPath(FLAGS_test_tmpdir, "user1");
+  EXPECT_EQ(FileUtil::JoinPath(kDir, "a.db"),
+            ConfigFileStream::GetFileName("user://a.db", kDir));
+  EXPECT_EQ(ConfigFileStream::GetFileName("user://a.db"),
+            ConfigFileStream::GetFileName("user://a.db", ""));
+  EXPECT_TRUE(ConfigFileStream::GetFileName("memory://a.db", kDir).empty());
+  EXPECT_TRUE(ConfigFileStream::GetFileName("system://a.db", kDir).empty());
+}
+
 TEST_F(ConfigFileStreamTest, AtomicUpdate) {
   const string prefixed_filename = "user://atomic_update_test";
   const string filename = ConfigFileStream::GetFileName(prefixed_filename);
@@ -40,6 +40,7 @@
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <cstdint>
 #include <cstring>
 
 #include "base/port.h"
@@ -298,4 +299,22 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) {
 
 #undef MOZC_HAVE_MLOCK
 
+#if defined(OS_WIN) || defined(OS_NACL) || defined(MOZC_USE_PEPPER_FILE_IO)
+bool Mmap::MaybePrefetch(const void *addr, size_t len) {
+  return false;
+}
+#else  // OS_WIN || OS_NACL || MOZC_USE_PEPPER_FILE_IO
+bool Mmap::MaybePrefetch(const void *addr, size_t len) {
+  if (len == 0) {
+    return true;
+  }
+  // madvise() requires a page aligned address.
+  const uintptr_t page_size = ::sysconf(_SC_PAGESIZE);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin & ~(page_size - 1);
+  return madvise(reinterpret_cast<void *>(aligned_begin),
+                 begin + len - aligned_begin, MADV_WILLNEED) == 0;
+}
+#endif  // OS_WIN || OS_NACL || MOZC_USE_PEPPER_FILE_IO
+
 }  // namespace mozc
@@ -48,6 +48,11 @@ class Mmap : public MmapSyncInterface {
   bool Open(const char *filename, const char *mode = "r");
   void Close();
 
+  // Hints the kernel that [addr, addr + len) will be accessed soon so that
+  // the pages are read ahead asynchronously instead of being faulted in one
+  // by one on first access.  Returns false where it is not supported.
+  static bool MaybePrefetch(const void *addr, size_t len);
+
   // Following mlock/munlock related functions work based on target environment.
   // In Android, Native Client, and Windows, we don't implement mlock, so these
   // functions returns false and -1. For other target platforms, these functions
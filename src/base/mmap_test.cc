@@ -97,6 +97,25 @@ TEST(MmapTest, MmapTest) {
   }
 }
 
+TEST(MmapTest, MaybePrefetch) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.db");
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    ofs << string(3 * 4096 + 10, 'a');
+  }
+  {
+    Mmap mmap;
+    ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+    // Ranges don't need to be page aligned.  The result depends on the
+    // platform, but the content must be intact.
+    Mmap::MaybePrefetch(mmap.begin() + 10, mmap.size() - 10);
+    Mmap::MaybePrefetch(mmap.begin() + 4097, 1);
+    Mmap::MaybePrefetch(mmap.begin(), 0);
+    EXPECT_EQ('a', mmap[4097]);
+  }
+  FileUtil::Unlink(filename);
+}
+
 TEST(MmapTest, MaybeMLockTest) {
   const size_t data_len = 32;
   std::unique_ptr<void, void (*)(void*)> addr(malloc(data_len), &free);
@@ -36,6 +36,7 @@
 #endif
 
 #include <atomic>
+#include <thread>  // NOLINT
 
 #include "base/port.h"
 
@@ -267,10 +268,15 @@ void CallOnce(once_t *once, void (*func)()) {
   if (once == nullptr || func == nullptr) {
     return;
   }
+  // Avoid the read-modify-write below, which takes the cache line
+  // exclusively, once |func| has completed.
+  if (once->load(std::memory_order_acquire) == ONCE_DONE) {
+    return;
+  }
   int expected_state = ONCE_INIT;
   if (once->compare_exchange_strong(expected_state, ONCE_RUNNING)) {
     (*func)();
-    *once = ONCE_DONE;
+    once->store(ONCE_DONE, std::memory_order_release);
     return;
   }
   // If the above compare_exchange_strong() returns false, it stores the value
@@ -280,11 +286,15 @@ void CallOnce(once_t *once, void (*func)()) {
   }
   // Here's the case where expected_state == ONCE_RUNNING, indicating that
   // another thread is calling func.  Wait for it to complete.
-  while (*once == ONCE_RUNNING) {
+  while (once->load(std::memory_order_acquire) == ONCE_RUNNING) {
 #ifdef OS_WIN
     ::YieldProcessor();
+#else  // OS_WIN
+    // |func| may take long, e.g., loading data, so give the CPU to other
+    // threads instead of spinning.
+    std::this_thread::yield();
 #endif  // OS_WIN
-  }  // Busy loop
+  }
 }
 
 void ResetOnce(once_t *once) {
@@ -35,13 +35,15 @@
 #include <cstdlib>
 #endif  // OS_WIN
 
+#include <atomic>
+
 #include "base/mutex.h"
 
 namespace mozc {
 namespace {
 
 const size_t kMaxFinalizersSize = 256;
-size_t g_finalizers_size = 0;
+std::atomic<size_t> g_finalizers_size(0);
 
 SingletonFinalizer::FinalizerFunc g_finalizers[kMaxFinalizersSize];
 
@@ -66,21 +68,21 @@ void ExitWithError() {
 }  // namespace
 
 void SingletonFinalizer::AddFinalizer(FinalizerFunc func) {
+  // Different classes can be instantiated at the same time, e.g., when the
+  // engine components are built in parallel, so each call reserves its own
+  // slot.
+  const size_t index = g_finalizers_size.fetch_add(1);
   // When g_finalizers_size is equal to kMaxFinalizersSize,
   // SingletonFinalizer::Finalize is called already.
-  if (g_finalizers_size >= kMaxFinalizersSize) {
+  if (index >= kMaxFinalizersSize) {
     ExitWithError();
   }
-  // This part is not thread safe.
-  // When two different classes are instantiated at the same time,
-  // this code will raise an exception.
-  g_finalizers[g_finalizers_size++] = func;
+  g_finalizers[index] = func;
 }
 
 void SingletonFinalizer::Finalize() {
-  // This part is not thread safe.
-  // When two different classes are instantiated at the same time,
-  // this code will raise an exception.
+  // This part is not thread safe.  Finalize() must be called after all the
+  // threads using singletons are stopped.
   for (int i = static_cast<int>(g_finalizers_size) - 1; i >= 0; --i) {
     (*g_finalizers[i])();
   }
@@ -30,6 +30,8 @@
 #ifndef MOZC_BASE_SINGLETON_H_
 #define MOZC_BASE_SINGLETON_H_
 
+#include <atomic>
+
 #include "base/mutex.h"
 
 namespace mozc {
@@ -57,35 +59,41 @@ class SingletonFinalizer {
 // class Foo {}
 //
 // Foo *instance = mozc::Singleton<Foo>::get();
+//
+// Once the instance is created, get() is an inlined acquire load, so it is
+// cheap enough to be called on hot paths and from many threads.
 template <typename T>
 class Singleton {
  public:
   static T *get() {
+    T *instance = instance_.load(std::memory_order_acquire);
+    if (instance != nullptr) {
+      return instance;
+    }
     CallOnce(&once_, &Singleton<T>::Init);
-    return instance_;
+    return instance_.load(std::memory_order_acquire);
   }
 
  private:
   static void Init() {
     SingletonFinalizer::AddFinalizer(&Singleton<T>::Delete);
-    instance_ = new T;
+    instance_.store(new T, std::memory_order_release);
   }
 
   static void Delete() {
-    delete instance_;
-    instance_ = NULL;
+    delete instance_.exchange(nullptr, std::memory_order_acq_rel);
     ResetOnce(&once_);
   }
 
   static once_t once_;
-  static T *instance_;
+  static std::atomic<T *> instance_;
 };
 
 template <typename T>
 once_t Singleton<T>::once_ = MOZC_ONCE_INIT;
 
 template <typename T>
-T* Singleton<T>::instance_ = NULL;
+std::atomic<T *> Singleton<T>::instance_(nullptr);
 }  // namespace mozc
 
 #endif  // MOZC_BASE_SINGLETON_H_
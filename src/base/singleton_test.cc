@@ -28,6 +28,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdlib.h>
+
+#include <atomic>
+
 #include "base/singleton.h"
 #include "base/thread.h"
 #include "base/util.h"
@@ -55,6 +58,36 @@ class ThreadInstance {
   }
 };
 
+std::atomic<int> g_typed_counter(0);
+
+template <int N>
+class TypedInstance {
+ public:
+  TypedInstance() {
+    ++g_typed_counter;
+  }
+};
+
+template <int N>
+class TypedThreadTest : public Thread {
+ public:
+  TypedThreadTest() : instance_(nullptr) {}
+
+  void Run() override {
+    // Many threads call get() for different types at the same time.
+    for (int i = 0; i < 1000; ++i) {
+      instance_ = Singleton<TypedInstance<N>>::get();
+    }
+  }
+
+  TypedInstance<N> *get() const {
+    return instance_;
+  }
+
+ private:
+  TypedInstance<N> *instance_;
+};
+
 class ThreadTest : public Thread {
  public:
   void Run() {
@@ -110,4 +143,27 @@ TEST(SingletonTest, ThreadTest) {
   EXPECT_EQ(test1.get(), test2.get());
   EXPECT_EQ(test2.get(), test3.get());
 }
+
+TEST(SingletonTest, DifferentTypesInParallel) {
+  TypedThreadTest<0> test0a, test0b;
+  TypedThreadTest<1> test1a, test1b;
+  TypedThreadTest<2> test2a, test2b;
+  TypedThreadTest<3> test3a, test3b;
+  Thread *threads[] = {
+    &test0a, &test0b, &test1a, &test1b, &test2a, &test2b, &test3a, &test3b,
+  };
+  for (Thread *thread : threads) {
+    thread->Start("TypedThreadTest");
+  }
+  for (Thread *thread : threads) {
+    thread->Join();
+  }
+
+  EXPECT_EQ(4, g_typed_counter);
+  EXPECT_EQ(test0a.get(), test0b.get());
+  EXPECT_EQ(test1a.get(), test1b.get());
+  EXPECT_EQ(test2a.get(), test2b.get());
+  EXPECT_EQ(test3a.get(), test3b.get());
+  EXPECT_EQ(Singleton<TypedInstance<2>>::get(), test2a.get());
+}
 }  // namespace mozc
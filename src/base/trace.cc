@@ -0,0 +1,196 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/trace.h"
+
+#ifdef OS_WIN
+#include <windows.h>
+#else  // OS_WIN
+#include <pthread.h>
+#endif  // OS_WIN
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/clock.h"
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace {
+
+class TraceBuffer {
+ public:
+  TraceBuffer() {}
+
+  void Add(const Trace::Event &event) {
+    scoped_lock lock(&mutex_);
+    if (events_.size() >= Trace::kMaxEvents) {
+      return;
+    }
+    events_.push_back(event);
+  }
+
+  void Take(std::vector<Trace::Event> *events) {
+    events->clear();
+    scoped_lock lock(&mutex_);
+    events->swap(events_);
+  }
+
+ private:
+  Mutex mutex_;
+  std::vector<Trace::Event> events_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBuffer);
+};
+
+// Holds the innermost ScopedTraceCommand of each thread.
+class CurrentTraceCommand {
+ public:
+#ifdef OS_WIN
+  CurrentTraceCommand() : index_(::TlsAlloc()) {
+    CHECK_NE(TLS_OUT_OF_INDEXES, index_);
+  }
+  const ScopedTraceCommand *Get() const {
+    return static_cast<const ScopedTraceCommand *>(::TlsGetValue(index_));
+  }
+  void Set(const ScopedTraceCommand *command) {
+    ::TlsSetValue(index_, const_cast<ScopedTraceCommand *>(command));
+  }
+#else  // OS_WIN
+  CurrentTraceCommand() {
+    CHECK_EQ(0, pthread_key_create(&key_, nullptr));
+  }
+  const ScopedTraceCommand *Get() const {
+    return static_cast<const ScopedTraceCommand *>(pthread_getspecific(key_));
+  }
+  void Set(const ScopedTraceCommand *command) {
+    pthread_setspecific(key_, command);
+  }
+#endif  // OS_WIN
+
+ private:
+#ifdef OS_WIN
+  DWORD index_;
+#else  // OS_WIN
+  pthread_key_t key_;
+#endif  // OS_WIN
+
+  DISALLOW_COPY_AND_ASSIGN(CurrentTraceCommand);
+};
+
+uint32 GetCurrentThreadIdForTrace() {
+#ifdef OS_WIN
+  return ::GetCurrentThreadId();
+#else  // OS_WIN
+  // pthread_t is an integer or a pointer depending on the platform.
+  const pthread_t self = pthread_self();
+  uint64 id = 0;
+  memcpy(&id, &self, std::min(sizeof(id), sizeof(self)));
+  return static_cast<uint32>(id ^ (id >> 32));
+#endif  // OS_WIN
+}
+
+}  // namespace
+
+std::atomic<bool> Trace::enabled_(false);
+
+void Trace::SetEnabled(bool enabled) {
+  if (!enabled_.exchange(enabled, std::memory_order_relaxed) || enabled) {
+    return;
+  }
+  // Nobody takes the events while tracing is disabled, e.g., the spans of a
+  // background suggestion completed after the last command.
+  std::vector<Event> events;
+  Singleton<TraceBuffer>::get()->Take(&events);
+}
+
+uint64 Trace::GetCurrentTimeUsec() {
+  const uint64 frequency = Clock::GetFrequency();
+  const uint64 ticks = Clock::GetTicks();
+  // Avoid overflow of |ticks| * 1000000.
+  return (ticks / frequency) * 1000000 +
+         (ticks % frequency) * 1000000 / frequency;
+}
+
+uint64 Trace::GetCurrentCommandId() {
+  const ScopedTraceCommand *command =
+      Singleton<CurrentTraceCommand>::get()->Get();
+  return command ? command->command_id() : 0;
+}
+
+void Trace::AddEvent(const char *name, uint64 begin_usec,
+                     uint64 duration_usec) {
+  const Event event = {name, begin_usec, duration_usec,
+                       GetCurrentThreadIdForTrace(), GetCurrentCommandId()};
+  Singleton<TraceBuffer>::get()->Add(event);
+}
+
+void Trace::TakeEvents(std::vector<Event> *events) {
+  DCHECK(events);
+  Singleton<TraceBuffer>::get()->Take(events);
+}
+
+void Trace::AppendJson(const std::vector<Event> &events, string *output) {
+  DCHECK(output);
+  for (size_t i = 0; i < events.size(); ++i) {
+    const Event &event = events[i];
+    output->append("{\"name\":\"");
+    for (const char *p = event.name; *p != '\0'; ++p) {
+      if (*p == '"' || *p == '\\') {
+        output->push_back('\\');
+      }
+      output->push_back(*p);
+    }
+    output->append(Util::StringPrintf(
+        "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu",
+        event.thread_id, static_cast<unsigned long long>(event.begin_usec),
+        static_cast<unsigned long long>(event.duration_usec)));
+    if (event.command_id != 0) {
+      output->append(Util::StringPrintf(
+          ",\"args\":{\"command\":%llu}",
+          static_cast<unsigned long long>(event.command_id)));
+    }
+    output->append("},\n");
+  }
+}
+
+ScopedTraceCommand::ScopedTraceCommand(uint64 command_id)
+    : command_id_(command_id),
+      previous_(Singleton<CurrentTraceCommand>::get()->Get()) {
+  Singleton<CurrentTraceCommand>::get()->Set(this);
+}
+
+ScopedTraceCommand::~ScopedTraceCommand() {
+  Singleton<CurrentTraceCommand>::get()->Set(previous_);
+}
+
+}  // namespace mozc
@@ -0,0 +1,153 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Lightweight tracing of nested processing spans for latency analysis.  The
+// recorded spans are exported in the trace event format, which can be loaded
+// by chrome://tracing or other trace viewers.
+//
+// Usage:
+//   void Foo() {
+//     MOZC_TRACE_SPAN("Foo");
+//     ...  // The span lasts until the end of this scope.
+//   }
+//
+// Recording is disabled by default and toggled at runtime by
+// Trace::SetEnabled().  A disabled span costs one relaxed atomic load.  Define
+// MOZC_DISABLE_TRACE to compile out all the spans.
+
+#ifndef MOZC_BASE_TRACE_H_
+#define MOZC_BASE_TRACE_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+class Trace {
+ public:
+  // A completed span.  |name| must be a string literal.
+  struct Event {
+    const char *name;
+    uint64 begin_usec;
+    uint64 duration_usec;
+    uint32 thread_id;
+    // The command being processed by the thread, or 0.  See
+    // ScopedTraceCommand.
+    uint64 command_id;
+  };
+
+  // The maximum number of events kept in the buffer.  Events recorded after
+  // the buffer gets full are dropped until TakeEvents() is called.
+  static const size_t kMaxEvents = 65536;
+
+  // Disabling tracing discards the events not taken yet.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the current time in microseconds from an arbitrary origin.
+  static uint64 GetCurrentTimeUsec();
+
+  // Returns the command being processed by the current thread, or 0.
+  static uint64 GetCurrentCommandId();
+
+  // Records a completed span.  Usually called by ScopedTraceSpan.
+  static void AddEvent(const char *name, uint64 begin_usec,
+                       uint64 duration_usec);
+
+  // Moves the recorded events to |events| and clears the buffer.
+  static void TakeEvents(std::vector<Event> *events);
+
+  // Appends |events| to |output| as comma-terminated JSON objects of complete
+  // ("X") trace events.  The command ID is exported in "args".  A sequence of
+  // them is a valid trace file in the JSON array format once prefixed with
+  // '[', and the closing bracket is optional, so that a trace file can be
+  // appended command by command.  See TraceFileWriter.
+  static void AppendJson(const std::vector<Event> &events, string *output);
+
+ private:
+  static std::atomic<bool> enabled_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(Trace);
+};
+
+// Attributes the spans recorded by the current thread until the destruction to
+// the command |command_id|.  Work started by a command on another thread, e.g.,
+// a background suggestion, should take over the ID of the command.
+class ScopedTraceCommand {
+ public:
+  explicit ScopedTraceCommand(uint64 command_id);
+  ~ScopedTraceCommand();
+
+  uint64 command_id() const { return command_id_; }
+
+ private:
+  const uint64 command_id_;
+  const ScopedTraceCommand *const previous_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceCommand);
+};
+
+// Records a span from the construction to the destruction when tracing is
+// enabled at the construction.
+class ScopedTraceSpan {
+ public:
+  explicit ScopedTraceSpan(const char *name)
+      : name_(Trace::IsEnabled() ? name : nullptr),
+        begin_usec_(name_ ? Trace::GetCurrentTimeUsec() : 0) {}
+  ~ScopedTraceSpan() {
+    if (name_) {
+      Trace::AddEvent(name_, begin_usec_,
+                      Trace::GetCurrentTimeUsec() - begin_usec_);
+    }
+  }
+
+ private:
+  const char *name_;
+  const uint64 begin_usec_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceSpan);
+};
+
+}  // namespace mozc
+
+#ifdef MOZC_DISABLE_TRACE
+#define MOZC_TRACE_SPAN(name)
+#else  // MOZC_DISABLE_TRACE
+#define MOZC_TRACE_SPAN_CONCAT_INTERNAL(x, y) x##y
+#define MOZC_TRACE_SPAN_CONCAT(x, y) MOZC_TRACE_SPAN_CONCAT_INTERNAL(x, y)
+#define MOZC_TRACE_SPAN(name) \
+  ::mozc::ScopedTraceSpan MOZC_TRACE_SPAN_CONCAT(trace_span_, __LINE__)(name)
+#endif  // MOZC_DISABLE_TRACE
+
+#endif  // MOZC_BASE_TRACE_H_
@@ -0,0 +1,136 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace_file_writer.h"
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/scheduler.h"
+
+namespace mozc {
+namespace {
+
+const char kRotatedFileSuffix[] = ".1";
+
+int64 GetFileSize(const string &filename) {
+  InputFileStream ifs(filename.c_str(), std::ios::binary);
+  if (!ifs) {
+    return 0;
+  }
+  ifs.seekg(0, std::ios::end);
+  const std::streamoff size = ifs.tellg();
+  return size < 0 ? 0 : static_cast<int64>(size);
+}
+
+}  // namespace
+
+TraceFileWriter::TraceFileWriter(const string &filename, size_t max_file_size,
+                                 uint32 flush_interval_msec)
+    : filename_(filename),
+      max_file_size_(max_file_size),
+      job_name_("TraceFileWriter:" + filename),
+      num_dropped_events_(0),
+      file_size_(-1) {
+  Scheduler::AddJob(Scheduler::JobSetting(
+      job_name_,
+      flush_interval_msec,  // default interval
+      flush_interval_msec,  // max interval
+      flush_interval_msec,  // delay start
+      0,                    // random delay
+      &TraceFileWriter::FlushCallback,
+      this));
+}
+
+TraceFileWriter::~TraceFileWriter() {
+  Scheduler::RemoveJob(job_name_);
+  Flush();
+}
+
+void TraceFileWriter::Add(const std::vector<Trace::Event> &events) {
+  scoped_lock l(&pending_mutex_);
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (pending_events_.size() >= kMaxPendingEvents) {
+      num_dropped_events_ += events.size() - i;
+      return;
+    }
+    pending_events_.push_back(events[i]);
+  }
+}
+
+size_t TraceFileWriter::num_dropped_events() const {
+  scoped_lock l(&pending_mutex_);
+  return num_dropped_events_;
+}
+
+bool TraceFileWriter::Flush() {
+  std::vector<Trace::Event> events;
+  {
+    scoped_lock l(&pending_mutex_);
+    events.swap(pending_events_);
+  }
+  if (events.empty()) {
+    return true;
+  }
+  string json;
+  Trace::AppendJson(events, &json);
+
+  scoped_lock l(&file_mutex_);
+  if (file_size_ < 0) {
+    file_size_ = GetFileSize(filename_);
+  }
+  if (file_size_ > 0 && file_size_ + json.size() > max_file_size_) {
+    const string rotated_filename = filename_ + kRotatedFileSuffix;
+    if (!FileUtil::AtomicRename(filename_, rotated_filename)) {
+      LOG(ERROR) << "Cannot rotate trace file: " << filename_;
+      FileUtil::Unlink(filename_);
+    }
+    file_size_ = 0;
+  }
+  if (file_size_ == 0) {
+    json.insert(0, "[\n");
+  }
+
+  OutputFileStream ofs(filename_.c_str(), std::ios::out | std::ios::app);
+  if (!ofs) {
+    LOG(ERROR) << "Cannot open trace file: " << filename_;
+    return false;
+  }
+  ofs << json;
+  file_size_ += json.size();
+  return ofs.good();
+}
+
+// static
+bool TraceFileWriter::FlushCallback(void *data) {
+  return static_cast<TraceFileWriter *>(data)->Flush();
+}
+
+}  // namespace mozc
@@ -0,0 +1,88 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Writes trace events to a file off the thread recording them.  Add() only
+// queues the events, and a scheduler job appends them to the file
+// periodically.  The file is rotated to "<filename>.1" when it would exceed
+// |max_file_size|, so at most two files of the size are kept.
+
+#ifndef MOZC_BASE_TRACE_FILE_WRITER_H_
+#define MOZC_BASE_TRACE_FILE_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/trace.h"
+
+namespace mozc {
+
+class TraceFileWriter {
+ public:
+  // The maximum number of events queued between flushes.  Events added while
+  // the queue is full are dropped.
+  static const size_t kMaxPendingEvents = Trace::kMaxEvents;
+
+  TraceFileWriter(const string &filename, size_t max_file_size,
+                  uint32 flush_interval_msec);
+  // Writes the queued events.
+  ~TraceFileWriter();
+
+  void Add(const std::vector<Trace::Event> &events);
+
+  // Writes the queued events to the file.  Called by the scheduler job.
+  bool Flush();
+
+  const string &filename() const { return filename_; }
+  size_t num_dropped_events() const;
+
+ private:
+  static bool FlushCallback(void *data);
+
+  const string filename_;
+  const size_t max_file_size_;
+  const string job_name_;
+
+  mutable Mutex pending_mutex_;
+  std::vector<Trace::Event> pending_events_;
+  size_t num_dropped_events_;
+
+  // Serializes the writes to the file.
+  Mutex file_mutex_;
+  // The size of the file, or -1 if it is not known yet.
+  int64 file_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceFileWriter);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_TRACE_FILE_WRITER_H_
@@ -0,0 +1,137 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace_file_writer.h"
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/scheduler.h"
+#include "base/scheduler_stub.h"
+#include "base/util.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+const uint32 kFlushIntervalMsec = 1000;
+
+string ReadFile(const string &filename) {
+  InputFileStream ifs(filename.c_str());
+  return string((std::istreambuf_iterator<char>(ifs)),
+                std::istreambuf_iterator<char>());
+}
+
+std::vector<Trace::Event> CreateEvents(size_t size) {
+  std::vector<Trace::Event> events(size);
+  for (size_t i = 0; i < size; ++i) {
+    events[i].name = "Foo";
+    events[i].begin_usec = i;
+    events[i].duration_usec = 1;
+    events[i].thread_id = 1;
+    events[i].command_id = 1;
+  }
+  return events;
+}
+
+class TraceFileWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Scheduler::SetSchedulerHandler(&scheduler_stub_);
+    filename_ = FileUtil::JoinPath(FLAGS_test_tmpdir, "trace_writer.json");
+    FileUtil::Unlink(filename_);
+    FileUtil::Unlink(filename_ + ".1");
+  }
+
+  void TearDown() override {
+    FileUtil::Unlink(filename_);
+    FileUtil::Unlink(filename_ + ".1");
+    Scheduler::SetSchedulerHandler(nullptr);
+  }
+
+  SchedulerStub scheduler_stub_;
+  string filename_;
+};
+
+TEST_F(TraceFileWriterTest, WritesInBackground) {
+  TraceFileWriter writer(filename_, 1 << 20, kFlushIntervalMsec);
+  writer.Add(CreateEvents(2));
+  // Add() doesn't touch the file.
+  EXPECT_FALSE(FileUtil::FileExists(filename_));
+
+  scheduler_stub_.PutClockForward(kFlushIntervalMsec);
+  string expected;
+  Trace::AppendJson(CreateEvents(2), &expected);
+  EXPECT_EQ("[\n" + expected, ReadFile(filename_));
+
+  writer.Add(CreateEvents(1));
+  scheduler_stub_.PutClockForward(kFlushIntervalMsec);
+  Trace::AppendJson(CreateEvents(1), &expected);
+  EXPECT_EQ("[\n" + expected, ReadFile(filename_));
+}
+
+TEST_F(TraceFileWriterTest, FlushOnDestruction) {
+  {
+    TraceFileWriter writer(filename_, 1 << 20, kFlushIntervalMsec);
+    writer.Add(CreateEvents(1));
+  }
+  string expected;
+  Trace::AppendJson(CreateEvents(1), &expected);
+  EXPECT_EQ("[\n" + expected, ReadFile(filename_));
+}
+
+TEST_F(TraceFileWriterTest, Rotation) {
+  string json;
+  Trace::AppendJson(CreateEvents(10), &json);
+  const size_t kMaxFileSize = json.size() * 2;
+  TraceFileWriter writer(filename_, kMaxFileSize, kFlushIntervalMsec);
+  for (int i = 0; i < 10; ++i) {
+    writer.Add(CreateEvents(10));
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_GE(kMaxFileSize, ReadFile(filename_).size());
+  }
+  // Each file starts a JSON array.
+  EXPECT_TRUE(Util::StartsWith(ReadFile(filename_), "[\n"));
+  EXPECT_TRUE(Util::StartsWith(ReadFile(filename_ + ".1"), "[\n"));
+}
+
+TEST_F(TraceFileWriterTest, DropsEventsWhenQueueIsFull) {
+  TraceFileWriter writer(filename_, 1 << 30, kFlushIntervalMsec);
+  writer.Add(CreateEvents(TraceFileWriter::kMaxPendingEvents - 1));
+  writer.Add(CreateEvents(3));
+  EXPECT_EQ(2, writer.num_dropped_events());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,169 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/trace.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class TraceTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock_mock_.reset(new ClockMock(0, 0));
+    // 1MHz (Accuracy = 1us)
+    clock_mock_->SetFrequency(1000000uLL);
+    Clock::SetClockForUnitTest(clock_mock_.get());
+    std::vector<Trace::Event> events;
+    Trace::TakeEvents(&events);
+  }
+
+  void TearDown() override {
+    Trace::SetEnabled(false);
+    Clock::SetClockForUnitTest(nullptr);
+  }
+
+  std::unique_ptr<ClockMock> clock_mock_;
+};
+
+void Inner(ClockMock *clock) {
+  MOZC_TRACE_SPAN("Inner");
+  clock->PutClockForwardByTicks(10);
+}
+
+void Outer(ClockMock *clock) {
+  MOZC_TRACE_SPAN("Outer");
+  clock->PutClockForwardByTicks(5);
+  Inner(clock);
+  clock->PutClockForwardByTicks(5);
+}
+
+TEST_F(TraceTest, Disabled) {
+  Outer(clock_mock_.get());
+  std::vector<Trace::Event> events;
+  Trace::TakeEvents(&events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST_F(TraceTest, NestedSpans) {
+  Trace::SetEnabled(true);
+  Outer(clock_mock_.get());
+  std::vector<Trace::Event> events;
+  Trace::TakeEvents(&events);
+  ASSERT_EQ(2, events.size());
+
+  // Spans are recorded when they end.
+  EXPECT_STREQ("Inner", events[0].name);
+  EXPECT_EQ(5, events[0].begin_usec);
+  EXPECT_EQ(10, events[0].duration_usec);
+  EXPECT_STREQ("Outer", events[1].name);
+  EXPECT_EQ(0, events[1].begin_usec);
+  EXPECT_EQ(20, events[1].duration_usec);
+  EXPECT_EQ(events[0].thread_id, events[1].thread_id);
+
+  // The buffer is cleared.
+  Trace::TakeEvents(&events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST_F(TraceTest, DisablingDiscardsEvents) {
+  Trace::SetEnabled(true);
+  Outer(clock_mock_.get());
+  Trace::SetEnabled(false);
+  std::vector<Trace::Event> events;
+  Trace::TakeEvents(&events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST_F(TraceTest, CommandId) {
+  Trace::SetEnabled(true);
+  EXPECT_EQ(0, Trace::GetCurrentCommandId());
+  {
+    const ScopedTraceCommand command(3);
+    EXPECT_EQ(3, Trace::GetCurrentCommandId());
+    Inner(clock_mock_.get());
+    {
+      // Work on another thread takes over the command.
+      uint64 command_id = 0;
+      std::thread thread([&command_id]() {
+        const ScopedTraceCommand command(4);
+        command_id = Trace::GetCurrentCommandId();
+        MOZC_TRACE_SPAN("Background");
+      });
+      thread.join();
+      EXPECT_EQ(4, command_id);
+    }
+    EXPECT_EQ(3, Trace::GetCurrentCommandId());
+  }
+  EXPECT_EQ(0, Trace::GetCurrentCommandId());
+  Inner(clock_mock_.get());
+
+  std::vector<Trace::Event> events;
+  Trace::TakeEvents(&events);
+  ASSERT_EQ(3, events.size());
+  EXPECT_STREQ("Inner", events[0].name);
+  EXPECT_EQ(3, events[0].command_id);
+  EXPECT_STREQ("Background", events[1].name);
+  EXPECT_EQ(4, events[1].command_id);
+  EXPECT_STREQ("Inner", events[2].name);
+  EXPECT_EQ(0, events[2].command_id);
+}
+
+TEST_F(TraceTest, AppendJson) {
+  std::vector<Trace::Event> events(2);
+  events[0].name = "Foo";
+  events[0].begin_usec = 100;
+  events[0].duration_usec = 20;
+  events[0].thread_id = 7;
+  events[1].name = "\"Bar\\";
+  events[1].begin_usec = 90;
+  events[1].duration_usec = 40;
+  events[1].thread_id = 7;
+  events[1].command_id = 12;
+
+  string json;
+  Trace::AppendJson(events, &json);
+  EXPECT_EQ(
+      "{\"name\":\"Foo\",\"ph\":\"X\",\"pid\":1,\"tid\":7,"
+      "\"ts\":100,\"dur\":20},\n"
+      "{\"name\":\"\\\"Bar\\\\\",\"ph\":\"X\",\"pid\":1,\"tid\":7,"
+      "\"ts\":90,\"dur\":40,\"args\":{\"command\":12}},\n",
+      json);
+}
+
+}  // namespace
+}  // namespace mozc
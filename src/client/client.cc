@@ -346,10 +346,13 @@ bool Client::EnsureCallCommand(commands::Input *input,
   }
 
   InitInput(input);
+  candidates_delta_decoder_.FillInput(input);
   output->set_id(0);
 
   if (!CallAndCheckVersion(*input, output)) {  // server is not running
     LOG(ERROR) << "Call command failed";
+    // The server may have sent the output which is lost.
+    candidates_delta_decoder_.Reset();
   } else if (output->id() != input->id()) {   // invalid ID
     LOG(ERROR) << "Session id is void. re-issue session id";
     server_status_ = SERVER_INVALID_SESSION;
@@ -366,6 +369,7 @@ bool Client::EnsureCallCommand(commands::Input *input,
       // playback the history to restore the previous state.
       PlaybackHistory();
       InitInput(input);
+      candidates_delta_decoder_.FillInput(input);
 #ifdef DEBUG
       // The debug binary dumps query of death at the first trial.
       history_inputs_.push_back(*input);
@@ -390,6 +394,11 @@ bool Client::EnsureCallCommand(commands::Input *input,
     }
   }
 
+  if (!candidates_delta_decoder_.Decode(output)) {
+    LOG(ERROR) << "Cannot restore the candidates of the output";
+    return false;
+  }
+
   PushHistory(*input, *output);
   return true;
 }
@@ -423,6 +432,7 @@ void Client::set_client_capability(const commands::Capability &capability) {
 
 bool Client::CreateSession() {
   id_ = 0;
+  candidates_delta_decoder_.Reset();
   commands::Input input;
   input.set_type(commands::Input::CREATE_SESSION);
 
@@ -624,9 +634,8 @@ bool Client::Call(const commands::Input &input,
     return false;
   }
 
-  // Serialize
-  string request;
-  input.SerializeToString(&request);
+  // Serialize into the buffer reused across the calls.
+  input.SerializeToString(&request_);
 
   // Call IPC
   std::unique_ptr<IPCClientInterface> client(
@@ -673,7 +682,7 @@ bool Client::Call(const commands::Input &input,
   // http://b/2126375
   // TODO(taku): Investigate the error in detail.
   size_t size = kResultBufferSize;
-  if (!client->Call(request.data(), request.size(),
+  if (!client->Call(request_.data(), request_.size(),
                     result_.get(), &size, timeout_)) {
     LOG(ERROR) << "Call failure";
     //               << input.DebugString();
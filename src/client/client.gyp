@@ -45,6 +45,7 @@
         '../ipc/ipc.gyp:ipc',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
+        '../session/session_base.gyp:candidates_delta',
       ],
       'export_dependent_settings': [
         '../protocol/protocol.gyp:commands_proto',
@@ -39,6 +39,7 @@
 #include "base/port.h"
 #include "client/client_interface.h"
 #include "protocol/commands.pb.h"
+#include "session/candidates_delta.h"
 #include "testing/base/public/gunit_prod.h"
 // for FRIEND_TEST()
 
@@ -245,6 +246,8 @@ class Client : public ClientInterface {
   IPCClientFactoryInterface *client_factory_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<char[]> result_;
+  // Serialized request.  Kept to reuse the buffer.
+  string request_;
   std::unique_ptr<config::Config> preferences_;
   int timeout_;
   ServerStatus server_status_;
@@ -255,6 +258,9 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+  // Restores the candidate fields omitted by the server when
+  // client_capability_ enables delta_candidates.
+  CandidatesDeltaDecoder candidates_delta_decoder_;
 };
 
 }  // namespace client
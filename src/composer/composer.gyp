@@ -40,6 +40,7 @@
       'sources': [
         'composer.cc',
         'internal/char_chunk.cc',
+        'internal/compiled_table.cc',
         'internal/composition.cc',
         'internal/composition_input.cc',
         'internal/converter.cc',
@@ -59,6 +60,8 @@
         '../protocol/protocol.gyp:config_proto',
         '../protobuf/protobuf.gyp:protobuf',
         '../protocol/protocol.gyp:commands_proto',
+        '../storage/louds/louds.gyp:louds_trie',
+        '../storage/louds/louds.gyp:louds_trie_builder',
         '../transliteration/transliteration.gyp:transliteration',
       ],
     },
@@ -35,6 +35,7 @@
       'sources': [
         'composer_test.cc',
         'internal/char_chunk_test.cc',
+        'internal/compiled_table_test.cc',
         'internal/composition_input_test.cc',
         'internal/composition_test.cc',
         'internal/converter_test.cc',
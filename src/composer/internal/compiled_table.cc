@@ -0,0 +1,229 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "composer/internal/compiled_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "composer/table.h"
+#include "storage/louds/louds_trie_builder.h"
+
+namespace mozc {
+namespace composer {
+namespace {
+
+// Image format (all integers are 32 bit in host byte order):
+//   [magic][flags][number of rules][trie image size][string array size]
+//   [trie image, padded to 4 byte boundary]
+//   [string array: input, result and pending of each rule in id order]
+//   [attributes of each rule in id order]
+const uint32 kMagic = 0x4354434D;  // "MCTC"
+const uint32 kCaseSensitiveFlag = 1;
+const size_t kHeaderSize = 5 * sizeof(uint32);
+
+// Composition tables have a few thousands of nodes at most, so all the
+// select results of the trie are cached; the sizes are clamped by the actual
+// number of bits.
+const size_t kTrieSelectCacheSize = 1 << 16;
+
+size_t Align4(size_t size) {
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+void AppendUint32(uint32 value, string *image) {
+  image->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+uint32 ReadUint32(const char *ptr) {
+  uint32 value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+CompiledTable::CompiledTable()
+    : attributes_(nullptr), attributes_size_(0), case_sensitive_(false) {}
+
+CompiledTable::~CompiledTable() = default;
+
+// static
+bool CompiledTable::Build(const std::vector<const Entry *> &entries,
+                          bool case_sensitive,
+                          string *image) {
+  DCHECK(image);
+  storage::louds::LoudsTrieBuilder builder;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i]->input().empty()) {
+      return false;
+    }
+    builder.Add(entries[i]->input());
+  }
+  builder.Build();
+
+  std::vector<StringPiece> strings(3 * entries.size());
+  std::vector<uint32> attributes(entries.size());
+  std::vector<bool> assigned(entries.size(), false);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const int id = builder.GetId(entries[i]->input());
+    if (id < 0 || static_cast<size_t>(id) >= entries.size() || assigned[id]) {
+      return false;
+    }
+    assigned[id] = true;
+    strings[3 * id] = entries[i]->input();
+    strings[3 * id + 1] = entries[i]->result();
+    strings[3 * id + 2] = entries[i]->pending();
+    attributes[id] = entries[i]->attributes();
+  }
+
+  std::unique_ptr<uint32[]> buffer;
+  const StringPiece string_array =
+      SerializedStringArray::SerializeToBuffer(strings, &buffer);
+  const string &trie_image = builder.image();
+
+  image->clear();
+  AppendUint32(kMagic, image);
+  AppendUint32(case_sensitive ? kCaseSensitiveFlag : 0, image);
+  AppendUint32(entries.size(), image);
+  AppendUint32(trie_image.size(), image);
+  AppendUint32(string_array.size(), image);
+  image->append(trie_image);
+  image->resize(Align4(image->size()), '\0');
+  image->append(string_array.data(), string_array.size());
+  image->append(reinterpret_cast<const char *>(attributes.data()),
+                attributes.size() * sizeof(uint32));
+  return true;
+}
+
+bool CompiledTable::Open(StringPiece image) {
+  if (image.size() < kHeaderSize ||
+      reinterpret_cast<uintptr_t>(image.data()) % 4 != 0 ||
+      ReadUint32(image.data()) != kMagic) {
+    LOG(ERROR) << "Broken compiled table image";
+    return false;
+  }
+  const uint32 flags = ReadUint32(image.data() + 4);
+  const size_t num_rules = ReadUint32(image.data() + 8);
+  const size_t trie_size = ReadUint32(image.data() + 12);
+  const size_t string_array_size = ReadUint32(image.data() + 16);
+
+  const size_t trie_offset = kHeaderSize;
+  const size_t string_array_offset = Align4(trie_offset + trie_size);
+  const size_t attributes_offset = string_array_offset + string_array_size;
+  if (attributes_offset + num_rules * sizeof(uint32) != image.size()) {
+    LOG(ERROR) << "Invalid compiled table image size: " << image.size();
+    return false;
+  }
+  if (!strings_.Init(image.substr(string_array_offset, string_array_size)) ||
+      strings_.size() != 3 * num_rules) {
+    LOG(ERROR) << "Invalid string array in compiled table image";
+    return false;
+  }
+  if (!trie_.Open(
+          reinterpret_cast<const uint8 *>(image.data() + trie_offset),
+          0, 0, kTrieSelectCacheSize, kTrieSelectCacheSize, 0)) {
+    LOG(ERROR) << "Invalid trie in compiled table image";
+    return false;
+  }
+  attributes_ =
+      reinterpret_cast<const uint32 *>(image.data() + attributes_offset);
+  attributes_size_ = num_rules;
+  case_sensitive_ = (flags & kCaseSensitiveFlag) != 0;
+  return true;
+}
+
+int CompiledTable::LookUp(StringPiece key) const {
+  return trie_.ExactSearch(key);
+}
+
+int CompiledTable::LookUpPrefix(StringPiece key,
+                                size_t *key_length,
+                                bool *fixed) const {
+  DCHECK(key_length);
+  DCHECK(fixed);
+  // Walks the trie as deep as possible by whole characters.  A partially
+  // matched character is not consumed, like the character based Trie.
+  Node node;  // Root
+  size_t pos = 0;
+  while (pos < key.size()) {
+    const size_t char_length =
+        std::min<size_t>(Util::OneCharLen(key.data() + pos), key.size() - pos);
+    Node next = node;
+    if (!trie_.Traverse(key.substr(pos, char_length), &next)) {
+      break;
+    }
+    node = next;
+    pos += char_length;
+  }
+
+  *key_length = pos;
+  if (storage::louds::Louds::IsRoot(node) || !trie_.IsTerminalNode(node)) {
+    *fixed = true;
+    return -1;
+  }
+  *fixed = !trie_.IsValidNode(trie_.MoveToFirstChild(node));
+  return trie_.GetKeyIdOfTerminalNode(node);
+}
+
+void CompiledTable::LookUpPredictiveAll(StringPiece key,
+                                        std::vector<int> *ids) const {
+  DCHECK(ids);
+  Node node;  // Root
+  if (!trie_.Traverse(key, &node)) {
+    return;
+  }
+  CollectTerminals(node, ids);
+}
+
+bool CompiledTable::HasSubTrie(StringPiece key) const {
+  if (key.empty()) {
+    return false;
+  }
+  Node node;  // Root
+  return trie_.Traverse(key, &node);
+}
+
+void CompiledTable::CollectTerminals(Node node, std::vector<int> *ids) const {
+  // Children are ordered by their labels, so the ids are collected in the
+  // lexicographical order of the keys as Trie::LookUpPredictiveAll does.
+  if (!storage::louds::Louds::IsRoot(node) && trie_.IsTerminalNode(node)) {
+    ids->push_back(trie_.GetKeyIdOfTerminalNode(node));
+  }
+  for (trie_.MoveToFirstChild(&node); trie_.IsValidNode(node);
+       trie_.MoveToNextSibling(&node)) {
+    CollectTerminals(node, ids);
+  }
+}
+
+}  // namespace composer
+}  // namespace mozc
@@ -0,0 +1,105 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Immutable, LOUDS trie based representation of a composition Table.
+//
+// The image built by CompiledTable::Build() does not contain any pointer,
+// so it can be generated offline, embedded or mmapped, and opened without
+// parsing the TSV rules.  The lookups implement the same semantics as
+// Trie<const Entry *> used by Table, with keys matched by whole UTF-8
+// characters.
+
+#ifndef MOZC_COMPOSER_INTERNAL_COMPILED_TABLE_H_
+#define MOZC_COMPOSER_INTERNAL_COMPILED_TABLE_H_
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/serialized_string_array.h"
+#include "base/string_piece.h"
+#include "storage/louds/louds_trie.h"
+
+namespace mozc {
+namespace composer {
+
+class Entry;
+
+class CompiledTable {
+ public:
+  CompiledTable();
+  ~CompiledTable();
+
+  // Builds the image of |entries| into |image|.  The input of each entry is
+  // used as its key.  Returns false if an entry has an empty input or if the
+  // inputs are not unique, as they cannot be represented in the trie.
+  static bool Build(const std::vector<const Entry *> &entries,
+                    bool case_sensitive,
+                    string *image);
+
+  // Opens the image built by Build().  The image must be aligned at 4 byte
+  // boundary and must outlive this object.
+  bool Open(StringPiece image);
+
+  // Returns the number of rules.  Rule ids are in [0, size()).
+  size_t size() const { return attributes_size_; }
+
+  bool case_sensitive() const { return case_sensitive_; }
+
+  // Accessors to the rule of |id|.
+  StringPiece input(int id) const { return strings_[3 * id]; }
+  StringPiece result(int id) const { return strings_[3 * id + 1]; }
+  StringPiece pending(int id) const { return strings_[3 * id + 2]; }
+  uint32 attributes(int id) const { return attributes_[id]; }
+
+  // The following methods return rule ids, or -1 if not found.  See
+  // base/trie.h for the semantics.
+  int LookUp(StringPiece key) const;
+  int LookUpPrefix(StringPiece key, size_t *key_length, bool *fixed) const;
+  void LookUpPredictiveAll(StringPiece key, std::vector<int> *ids) const;
+  bool HasSubTrie(StringPiece key) const;
+
+ private:
+  typedef storage::louds::LoudsTrie::Node Node;
+
+  void CollectTerminals(Node node, std::vector<int> *ids) const;
+
+  storage::louds::LoudsTrie trie_;
+  SerializedStringArray strings_;
+  const uint32 *attributes_;
+  size_t attributes_size_;
+  bool case_sensitive_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledTable);
+};
+
+}  // namespace composer
+}  // namespace mozc
+
+#endif  // MOZC_COMPOSER_INTERNAL_COMPILED_TABLE_H_
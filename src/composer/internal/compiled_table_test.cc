@@ -0,0 +1,205 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "composer/internal/compiled_table.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "composer/table.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace composer {
+namespace {
+
+class CompiledTableTest : public ::testing::Test {
+ protected:
+  void AddEntry(const string &input, const string &result,
+                const string &pending, TableAttributes attributes) {
+    entries_.emplace_back(new Entry(input, result, pending, attributes));
+  }
+
+  bool Build(bool case_sensitive) {
+    std::vector<const Entry *> entries;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      entries.push_back(entries_[i].get());
+    }
+    return CompiledTable::Build(entries, case_sensitive, &image_);
+  }
+
+  std::vector<std::unique_ptr<Entry>> entries_;
+  string image_;
+};
+
+TEST_F(CompiledTableTest, LookUp) {
+  AddEntry("a", "あ", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("ka", "か", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("kk", "っ", "k", NO_TABLE_ATTRIBUTE);
+  AddEntry("n", "ん", "", NEW_CHUNK | END_CHUNK);
+  AddEntry("か゛", "が", "", NO_TABLE_ATTRIBUTE);
+  ASSERT_TRUE(Build(true));
+
+  CompiledTable table;
+  ASSERT_TRUE(table.Open(image_));
+  EXPECT_TRUE(table.case_sensitive());
+  EXPECT_EQ(5, table.size());
+
+  int id = table.LookUp("kk");
+  ASSERT_LE(0, id);
+  EXPECT_EQ("kk", table.input(id));
+  EXPECT_EQ("っ", table.result(id));
+  EXPECT_EQ("k", table.pending(id));
+  EXPECT_EQ(NO_TABLE_ATTRIBUTE, table.attributes(id));
+
+  id = table.LookUp("n");
+  ASSERT_LE(0, id);
+  EXPECT_EQ(NEW_CHUNK | END_CHUNK, table.attributes(id));
+
+  EXPECT_EQ(-1, table.LookUp("k"));
+  EXPECT_EQ(-1, table.LookUp("kaa"));
+  EXPECT_EQ(-1, table.LookUp(""));
+
+  EXPECT_FALSE(table.HasSubTrie(""));
+  EXPECT_TRUE(table.HasSubTrie("k"));
+  EXPECT_TRUE(table.HasSubTrie("か"));
+  EXPECT_FALSE(table.HasSubTrie("kaa"));
+}
+
+TEST_F(CompiledTableTest, LookUpPrefix) {
+  AddEntry("a", "あ", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("n", "ん", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("na", "な", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("kya", "きゃ", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("か゛", "が", "", NO_TABLE_ATTRIBUTE);
+  // "か" and "が" share the first two bytes in UTF-8.
+  AddEntry("が", "が", "", NO_TABLE_ATTRIBUTE);
+  ASSERT_TRUE(Build(false));
+
+  CompiledTable table;
+  ASSERT_TRUE(table.Open(image_));
+  EXPECT_FALSE(table.case_sensitive());
+
+  size_t key_length = 0;
+  bool fixed = false;
+  int id = table.LookUpPrefix("ab", &key_length, &fixed);
+  ASSERT_LE(0, id);
+  EXPECT_EQ("a", table.input(id));
+  EXPECT_EQ(1, key_length);
+  EXPECT_TRUE(fixed);
+
+  id = table.LookUpPrefix("nk", &key_length, &fixed);
+  ASSERT_LE(0, id);
+  EXPECT_EQ("n", table.input(id));
+  EXPECT_EQ(1, key_length);
+  EXPECT_FALSE(fixed);
+
+  // Does not fall back to a shorter rule.
+  EXPECT_EQ(-1, table.LookUpPrefix("kyu", &key_length, &fixed));
+  EXPECT_EQ(2, key_length);
+  EXPECT_TRUE(fixed);
+
+  EXPECT_EQ(-1, table.LookUpPrefix("z", &key_length, &fixed));
+  EXPECT_EQ(0, key_length);
+  EXPECT_TRUE(fixed);
+
+  // "き" is not consumed even though its first bytes match "か".
+  EXPECT_EQ(-1, table.LookUpPrefix("き", &key_length, &fixed));
+  EXPECT_EQ(0, key_length);
+  EXPECT_TRUE(fixed);
+
+  EXPECT_EQ(-1, table.LookUpPrefix("かき", &key_length, &fixed));
+  EXPECT_EQ(3, key_length);
+  EXPECT_TRUE(fixed);
+
+  id = table.LookUpPrefix("が", &key_length, &fixed);
+  ASSERT_LE(0, id);
+  EXPECT_EQ("が", table.input(id));
+  EXPECT_EQ(3, key_length);
+  EXPECT_TRUE(fixed);
+}
+
+TEST_F(CompiledTableTest, LookUpPredictiveAll) {
+  AddEntry("nya", "にゃ", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("n", "ん", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("na", "な", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("nn", "ん", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("a", "あ", "", NO_TABLE_ATTRIBUTE);
+  ASSERT_TRUE(Build(false));
+
+  CompiledTable table;
+  ASSERT_TRUE(table.Open(image_));
+
+  std::vector<int> ids;
+  table.LookUpPredictiveAll("n", &ids);
+  std::vector<string> inputs;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    inputs.push_back(table.input(ids[i]).as_string());
+  }
+  const std::vector<string> expected = {"n", "na", "nn", "nya"};
+  EXPECT_EQ(expected, inputs);
+
+  ids.clear();
+  table.LookUpPredictiveAll("x", &ids);
+  EXPECT_TRUE(ids.empty());
+
+  ids.clear();
+  table.LookUpPredictiveAll("", &ids);
+  EXPECT_EQ(5, ids.size());
+}
+
+TEST_F(CompiledTableTest, InvalidRules) {
+  AddEntry("a", "あ", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("", "い", "", NO_TABLE_ATTRIBUTE);
+  EXPECT_FALSE(Build(false));
+
+  entries_.clear();
+  AddEntry("a", "あ", "", NO_TABLE_ATTRIBUTE);
+  AddEntry("a", "い", "", NO_TABLE_ATTRIBUTE);
+  EXPECT_FALSE(Build(false));
+}
+
+TEST_F(CompiledTableTest, InvalidImage) {
+  AddEntry("a", "あ", "", NO_TABLE_ATTRIBUTE);
+  ASSERT_TRUE(Build(false));
+
+  CompiledTable table;
+  EXPECT_FALSE(table.Open(""));
+  EXPECT_FALSE(table.Open(StringPiece(image_.data(), image_.size() - 4)));
+  string broken = image_;
+  broken[0] = '\0';
+  EXPECT_FALSE(table.Open(broken));
+  EXPECT_TRUE(table.Open(image_));
+}
+
+}  // namespace
+}  // namespace composer
+}  // namespace mozc
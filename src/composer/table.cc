@@ -45,6 +45,7 @@
 #include "base/port.h"
 #include "base/trie.h"
 #include "base/util.h"
+#include "composer/internal/compiled_table.h"
 #include "composer/internal/typing_model.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -313,6 +314,7 @@ const Entry *Table::AddRuleWithAttributes(const string &escaped_input,
                                           const string &output,
                                           const string &escaped_pending,
                                           const TableAttributes attributes) {
+  Decompile();
   if (attributes & NEW_CHUNK) {
     // TODO(komatsu): Make a new trie tree for checking the new chunk
     // attribute rather than reusing the conversion trie.
@@ -371,6 +373,7 @@ void Table::DeleteRule(const string &input) {
   //     - This method is not used.
   //     - This method has no tests.
   //     - This method is private scope.
+  Decompile();
   const Entry *old_entry;
   if (entries_->LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
@@ -391,6 +394,48 @@ bool Table::LoadFromFile(const char *filepath) {
   return LoadFromStream(ifs.get());
 }
 
+bool Table::Compile() {
+  if (compiled_table_) {
+    return true;
+  }
+  const std::vector<const Entry *> entries(entry_set_.begin(),
+                                           entry_set_.end());
+  if (!CompiledTable::Build(entries, case_sensitive_,
+                            &compiled_image_)) {
+    LOG(WARNING) << "The rules cannot be compiled";
+    compiled_image_.clear();
+    return false;
+  }
+  std::unique_ptr<CompiledTable> compiled_table(new CompiledTable);
+  if (!compiled_table->Open(compiled_image_)) {
+    compiled_image_.clear();
+    return false;
+  }
+
+  compiled_entries_.assign(compiled_table->size(), nullptr);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const int id = compiled_table->LookUp(entries[i]->input());
+    DCHECK_GE(id, 0);
+    compiled_entries_[id] = entries[i];
+  }
+  compiled_table_ = std::move(compiled_table);
+  entries_.reset(new EntryTrie);
+  return true;
+}
+
+void Table::Decompile() {
+  if (!compiled_table_) {
+    return;
+  }
+  for (EntrySet::const_iterator it = entry_set_.begin();
+       it != entry_set_.end(); ++it) {
+    entries_->AddEntry((*it)->input(), *it);
+  }
+  compiled_table_.reset();
+  compiled_entries_.clear();
+  compiled_image_.clear();
+}
+
 const TypingModel* Table::typing_model() const {
   return typing_model_.get();
 }
@@ -450,41 +495,54 @@ bool Table::LoadFromStream(std::istream *is) {
   return true;
 }
 
-const Entry *Table::LookUp(const string &input) const {
-  const Entry *entry = NULL;
+const string &Table::NormalizeInput(const string &input,
+                                    string *buffer) const {
   if (case_sensitive_) {
-    entries_->LookUp(input, &entry);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUp(normalized_input, &entry);
+    return input;
+  }
+  *buffer = input;
+  Util::LowerString(buffer);
+  return *buffer;
+}
+
+const Entry *Table::LookUp(const string &input) const {
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (compiled_table_) {
+    return GetCompiledEntry(compiled_table_->LookUp(key));
   }
+  const Entry *entry = NULL;
+  entries_->LookUp(key, &entry);
   return entry;
 }
 
 const Entry *Table::LookUpPrefix(const string &input,
                                  size_t *key_length,
                                  bool *fixed) const {
-  const Entry *entry = NULL;
-  if (case_sensitive_) {
-    entries_->LookUpPrefix(input, &entry, key_length, fixed);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUpPrefix(normalized_input, &entry, key_length, fixed);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (compiled_table_) {
+    return GetCompiledEntry(
+        compiled_table_->LookUpPrefix(key, key_length, fixed));
   }
+  const Entry *entry = NULL;
+  entries_->LookUpPrefix(key, &entry, key_length, fixed);
   return entry;
 }
 
 void Table::LookUpPredictiveAll(const string &input,
                                 std::vector<const Entry *> *results) const {
-  if (case_sensitive_) {
-    entries_->LookUpPredictiveAll(input, results);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUpPredictiveAll(normalized_input, results);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (compiled_table_) {
+    std::vector<int> ids;
+    compiled_table_->LookUpPredictiveAll(key, &ids);
+    for (size_t i = 0; i < ids.size(); ++i) {
+      results->push_back(compiled_entries_[ids[i]]);
+    }
+    return;
   }
+  entries_->LookUpPredictiveAll(key, results);
 }
 
 bool Table::HasNewChunkEntry(const string &input) const {
@@ -504,13 +562,12 @@ bool Table::HasNewChunkEntry(const string &input) const {
 }
 
 bool Table::HasSubRules(const string &input) const {
-  if (case_sensitive_) {
-    return entries_->HasSubTrie(input);
-  } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    return entries_->HasSubTrie(normalized_input);
+  string buffer;
+  const string &key = NormalizeInput(input, &buffer);
+  if (compiled_table_) {
+    return compiled_table_->HasSubTrie(key);
   }
+  return entries_->HasSubTrie(key);
 }
 
 void Table::DeleteEntry(const Entry *entry) {
@@ -644,23 +701,48 @@ const Table *TableManager::GetTable(
     if (update_custom_roman_table) {
       // Delete the previous table to update the table.
       table_map_.erase(iterator);
+      for (auto it = compiled_table_map_.begin();
+           it != compiled_table_map_.end();) {
+        if (it->second.use_count() == 1) {
+          it = compiled_table_map_.erase(it);
+        } else {
+          ++it;
+        }
+      }
     } else {
       return iterator->second.get();
     }
   }
 
-  std::unique_ptr<Table> table(new Table());
+  std::shared_ptr<Table> table(new Table());
   if (!table->InitializeWithRequestAndConfig(request, config, data_manager)) {
     return nullptr;
   }
-
-  const Table* ret = table.get();
-  table_map_[hash] = std::move(table);
-  return ret;
+  if (!table->Compile()) {
+    table_map_[hash] = table;
+    return table.get();
+  }
+
+  // Many combinations of the request and the config result in the same
+  // rules, e.g. the punctuation and symbol methods are ignored by the
+  // special romanji tables.  Share the table among them.
+  const uint64 fingerprint = Hash::FingerprintWithSeed(
+      table->compiled_image(), request.special_romanji_table());
+  const auto range = compiled_table_map_.equal_range(fingerprint);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->compiled_image() == table->compiled_image()) {
+      table_map_[hash] = it->second;
+      return it->second.get();
+    }
+  }
+  compiled_table_map_.emplace(fingerprint, table);
+  table_map_[hash] = table;
+  return table.get();
 }
 
 void TableManager::ClearCaches() {
   table_map_.clear();
+  compiled_table_map_.clear();
 }
 
 }  // namespace composer
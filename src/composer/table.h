@@ -39,6 +39,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "base/trie.h"
 #include "data_manager/data_manager_interface.h"
 
@@ -56,6 +57,7 @@ class Config;
 }  // namespace config
 namespace composer {
 
+class CompiledTable;
 class TypingModel;
 
 // This is a bitmap representing Entry's additional attributes.
@@ -122,6 +124,17 @@ class Table {
   bool LoadFromString(const string &str);
   bool LoadFromFile(const char *filepath);
 
+  // Compiles the rules into an immutable LOUDS trie, and routes the lookups
+  // to it.  The editable trie is released, and is rebuilt when a rule is
+  // added or deleted later.  Returns false if the rules cannot be compiled
+  // (e.g. a rule has an empty input); the table then keeps using the
+  // editable trie.
+  bool Compile();
+
+  // Returns the image of the compiled rules, or an empty image if the table
+  // is not compiled.
+  StringPiece compiled_image() const { return compiled_image_; }
+
   const Entry *LookUp(const string &input) const;
   const Entry *LookUpPrefix(const string &input,
                             size_t *key_length,
@@ -155,11 +168,29 @@ class Table {
   void DeleteEntry(const Entry *entry);
   void ResetEntrySet();
 
+  // Drops the compiled trie and rebuilds the editable trie from the entries.
+  void Decompile();
+
+  // Returns |input| as is if the table is case sensitive.  Otherwise returns
+  // the lower cased |input| stored in |buffer|.
+  const string &NormalizeInput(const string &input, string *buffer) const;
+  const Entry *GetCompiledEntry(int id) const {
+    return id < 0 ? nullptr : compiled_entries_[id];
+  }
+
   typedef Trie<const Entry*> EntryTrie;
   std::unique_ptr<EntryTrie> entries_;
   typedef std::set<const Entry*> EntrySet;
   EntrySet entry_set_;
 
+  // Compiled rules, which take over the lookups from |entries_| while they
+  // are available.
+  std::unique_ptr<CompiledTable> compiled_table_;
+  // Entries of |compiled_table_| indexed by the rule id.
+  std::vector<const Entry *> compiled_entries_;
+  // Image of |compiled_table_|.
+  string compiled_image_;
+
   // If false, input alphabet characters are normalized to lower
   // characters.  The default value is false.
   bool case_sensitive_;
@@ -176,6 +207,8 @@ class TableManager {
   ~TableManager();
   // Return Table for the request and the config
   // TableManager has ownership of the return value;
+  // The returned table is compiled, and requests and configs which end up
+  // with the same rules share the same table.
   const Table *GetTable(const commands::Request &request,
                         const config::Config &config,
                         const DataManagerInterface &data_manager);
@@ -189,7 +222,10 @@ class TableManager {
   //  config::Config::PreeditMethod
   //  config::Config::PunctuationMethod
   //  config::Config::SymbolMethod
-  std::map<uint32, std::unique_ptr<const Table>> table_map_;
+  std::map<uint32, std::shared_ptr<const Table>> table_map_;
+  // Compiled tables keyed by the fingerprint of the compiled image and the
+  // special romanji table, which determines the typing model.
+  std::multimap<uint64, std::shared_ptr<const Table>> compiled_table_map_;
   // Fingerprint for Config::custom_roman_table;
   uint32 custom_roman_table_fingerprint_;
 };
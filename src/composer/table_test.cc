@@ -978,6 +978,78 @@ TEST_F(TableTest, SpecialKeys) {
   }
 }
 
+TEST_F(TableTest, CompiledTable) {
+  Table table;
+  ASSERT_TRUE(table.LoadFromFile("system://romanji-hiragana.tsv"));
+  ASSERT_TRUE(table.LoadFromFile("system://kana.tsv"));
+  table.AddRuleWithAttributes("{!}", "", "", NEW_CHUNK);
+  Table compiled_table;
+  ASSERT_TRUE(compiled_table.LoadFromFile("system://romanji-hiragana.tsv"));
+  ASSERT_TRUE(compiled_table.LoadFromFile("system://kana.tsv"));
+  compiled_table.AddRuleWithAttributes("{!}", "", "", NEW_CHUNK);
+  EXPECT_TRUE(compiled_table.compiled_image().empty());
+  ASSERT_TRUE(compiled_table.Compile());
+  EXPECT_FALSE(compiled_table.compiled_image().empty());
+
+  const char *kInputs[] = {
+    "", "a", "k", "ka", "kk", "kka", "ky", "kyu", "kyx", "n", "nn", "nk",
+    "xtu", "tsu", "q", "Ka", "KA", "-", ",", "z/", "\t", "\tn", "\x0F!\x0E",
+    "か", "か゛", "き", "う゛", "ｶ", "漢字",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    const string input = kInputs[i];
+    for (const Table *target : {&compiled_table}) {
+      const Entry *expected = table.LookUp(input);
+      const Entry *actual = target->LookUp(input);
+      ASSERT_EQ(expected == nullptr, actual == nullptr) << input;
+      if (expected != nullptr) {
+        EXPECT_EQ(expected->input(), actual->input());
+        EXPECT_EQ(expected->result(), actual->result());
+        EXPECT_EQ(expected->pending(), actual->pending());
+        EXPECT_EQ(expected->attributes(), actual->attributes());
+      }
+
+      size_t expected_length = 0, actual_length = 0;
+      bool expected_fixed = false, actual_fixed = false;
+      expected = table.LookUpPrefix(input, &expected_length, &expected_fixed);
+      actual = target->LookUpPrefix(input, &actual_length, &actual_fixed);
+      ASSERT_EQ(expected == nullptr, actual == nullptr) << input;
+      if (expected != nullptr) {
+        EXPECT_EQ(expected->input(), actual->input());
+      }
+      EXPECT_EQ(expected_length, actual_length) << input;
+      EXPECT_EQ(expected_fixed, actual_fixed) << input;
+
+      std::vector<const Entry *> expected_entries, actual_entries;
+      table.LookUpPredictiveAll(input, &expected_entries);
+      target->LookUpPredictiveAll(input, &actual_entries);
+      ASSERT_EQ(expected_entries.size(), actual_entries.size()) << input;
+      for (size_t j = 0; j < expected_entries.size(); ++j) {
+        EXPECT_EQ(expected_entries[j]->input(), actual_entries[j]->input());
+      }
+
+      EXPECT_EQ(table.HasSubRules(input), target->HasSubRules(input));
+      EXPECT_EQ(table.HasNewChunkEntry(input),
+                target->HasNewChunkEntry(input));
+    }
+  }
+
+  // Adding a rule switches the table back to the editable trie.
+  compiled_table.AddRule("kk", "[KK]", "");
+  EXPECT_TRUE(compiled_table.compiled_image().empty());
+  EXPECT_EQ("[KK]", GetResult(compiled_table, "kk"));
+  EXPECT_EQ("か", GetResult(compiled_table, "ka"));
+  EXPECT_TRUE(compiled_table.Compile());
+  EXPECT_EQ("[KK]", GetResult(compiled_table, "kk"));
+
+  // Rules with an empty input cannot be compiled.
+  Table empty_input_table;
+  empty_input_table.AddRule("", "x", "");
+  empty_input_table.AddRule("a", "あ", "");
+  EXPECT_FALSE(empty_input_table.Compile());
+  EXPECT_EQ("あ", GetResult(empty_input_table, "a"));
+}
+
 TEST_F(TableTest, TableManager) {
   TableManager table_manager;
   std::set<const Table*> table_set;
@@ -1029,12 +1101,18 @@ TEST_F(TableTest, TableManager) {
           EXPECT_TRUE(table != NULL);
           EXPECT_TRUE(table_manager.GetTable(request, config,
                                              mock_data_manager_) == table);
-          EXPECT_TRUE(table_set.find(table) == table_set.end());
+          EXPECT_FALSE(table->compiled_image().empty());
           table_set.insert(table);
         }
       }
     }
   }
+  // Tables with the same rules are shared.  The default table has a
+  // distinct rule set for each combination of the punctuation and symbol
+  // methods, and the special tables ignore the config.
+  EXPECT_EQ(arraysize(punctuation_method) * arraysize(symbol_method) +
+                arraysize(special_romanji_table) - 1,
+            table_set.size());
 
   {
     // b/6788850.
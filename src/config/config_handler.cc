@@ -34,6 +34,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/config_file_stream.h"
@@ -87,6 +88,7 @@ class ConfigHandlerImpl {
   }
   virtual ~ConfigHandlerImpl() {}
   bool GetConfig(Config *config) const;
+  std::shared_ptr<const Config> GetSharedConfig() const;
   const Config &DefaultConfig() const;
   bool GetStoredConfig(Config *config) const;
   bool SetConfig(const Config &config);
@@ -104,8 +106,9 @@ class ConfigHandlerImpl {
   string filename_;
   Config stored_config_;
   Config imposed_config_;
-  // equals to config_.MergeFrom(imposed_config_)
-  Config merged_config_;
+  // Equals to stored_config_.MergeFrom(imposed_config_).  Replaced as a whole
+  // under |mutex_| and read with std::atomic_load() without |mutex_|.
+  std::shared_ptr<const Config> merged_config_;
   Config default_config_;
   mutable Mutex mutex_;
 };
@@ -116,11 +119,14 @@ ConfigHandlerImpl *GetConfigHandlerImpl() {
 
 // return current Config
 bool ConfigHandlerImpl::GetConfig(Config *config) const {
-  scoped_lock lock(&mutex_);
-  config->CopyFrom(merged_config_);
+  config->CopyFrom(*GetSharedConfig());
   return true;
 }
 
+std::shared_ptr<const Config> ConfigHandlerImpl::GetSharedConfig() const {
+  return std::atomic_load(&merged_config_);
+}
+
 const Config &ConfigHandlerImpl::DefaultConfig() const {
   return default_config_;
 }
@@ -167,8 +173,10 @@ bool ConfigHandlerImpl::SetConfigInternal(const Config &config) {
 }
 
 void ConfigHandlerImpl::UpdateMergedConfig() {
-  merged_config_.CopyFrom(stored_config_);
-  merged_config_.MergeFrom(imposed_config_);
+  std::shared_ptr<Config> merged_config(new Config(stored_config_));
+  merged_config->MergeFrom(imposed_config_);
+  std::atomic_store(&merged_config_,
+                    std::shared_ptr<const Config>(std::move(merged_config)));
 }
 
 bool ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -248,6 +256,10 @@ bool ConfigHandler::GetConfig(Config *config) {
   return GetConfigHandlerImpl()->GetConfig(config);
 }
 
+std::shared_ptr<const Config> ConfigHandler::GetSharedConfig() {
+  return GetConfigHandlerImpl()->GetSharedConfig();
+}
+
 // Returns Stored Config
 bool ConfigHandler::GetStoredConfig(Config *config) {
   return GetConfigHandlerImpl()->GetStoredConfig(config);
@@ -32,6 +32,7 @@
 #ifndef MOZC_CONFIG_CONFIG_HANDLER_H_
 #define MOZC_CONFIG_CONFIG_HANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "base/port.h"
@@ -50,6 +51,15 @@ class ConfigHandler {
   // Returns current config.
   static bool GetConfig(Config *config);
 
+  // Returns an immutable snapshot of the current config.  The snapshot is
+  // replaced with std::atomic_store() whenever the config changes, so this
+  // neither takes the handler's mutex nor copies the config.  It is not
+  // lock-free, though: libstdc++ implements std::atomic_load() of shared_ptr
+  // with a small pool of mutexes, held only to copy the pointer and bump the
+  // reference count.  A returned snapshot is never modified; call this method
+  // again to observe later updates.
+  static std::shared_ptr<const Config> GetSharedConfig();
+
   // Returns stored config.
   // If imposed config is not set, the result is the same as GetConfig().
   static bool GetStoredConfig(Config *config);
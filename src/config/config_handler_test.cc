@@ -351,6 +351,41 @@ TEST_F(ConfigHandlerTest, GetDefaultConfig) {
 #endif  // OS_ANDROID && CHANNEL_DEV
 }
 
+TEST_F(ConfigHandlerTest, SharedConfigIsSnapshot) {
+  const string config_file = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                                "mozc_config_test_tmp");
+  FileUtil::Unlink(config_file);
+  ScopedSetConfigFileName scoped_config_file_name(config_file);
+
+  Config input;
+  input.set_incognito_mode(false);
+  ASSERT_TRUE(ConfigHandler::SetConfig(input));
+  const std::shared_ptr<const Config> old_config =
+      ConfigHandler::GetSharedConfig();
+  ASSERT_NE(nullptr, old_config.get());
+  EXPECT_FALSE(old_config->incognito_mode());
+  // Without any update the same snapshot is returned.
+  EXPECT_EQ(old_config.get(), ConfigHandler::GetSharedConfig().get());
+
+  input.set_incognito_mode(true);
+  ASSERT_TRUE(ConfigHandler::SetConfig(input));
+  // The old snapshot is kept intact while the new one reflects the update.
+  EXPECT_FALSE(old_config->incognito_mode());
+  EXPECT_TRUE(ConfigHandler::GetSharedConfig()->incognito_mode());
+
+  Config imposed;
+  imposed.set_incognito_mode(false);
+  ConfigHandler::SetImposedConfig(imposed);
+  EXPECT_FALSE(ConfigHandler::GetSharedConfig()->incognito_mode());
+
+  // GetConfig() returns a copy of the shared snapshot.
+  Config output;
+  ConfigHandler::GetConfig(&output);
+  EXPECT_EQ(ConfigHandler::GetSharedConfig()->SerializeAsString(),
+            output.SerializeAsString());
+  ConfigHandler::SetImposedConfig(Config());
+}
+
 TEST_F(ConfigHandlerTest, DefaultConfig) {
   Config config;
   ConfigHandler::GetDefaultConfig(&config);
@@ -527,6 +562,89 @@ TEST_F(ConfigHandlerTest, ConcurrentAccess) {
   }
 }
 
+// Reads the shared snapshots while the config is being updated.  A snapshot
+// must stay intact while it is held, even after it is replaced.
+class GetSharedConfigThread final : public Thread {
+ public:
+  explicit GetSharedConfigThread(
+      const mozc_hash_set<string> &character_form_rules_set)
+      : quitting_(false),
+        character_form_rules_set_(character_form_rules_set) {
+  }
+
+  ~GetSharedConfigThread() override {
+    quitting_ = true;
+    Join();
+  }
+
+ protected:
+  void Run() override {
+    while (!quitting_) {
+      const std::shared_ptr<const Config> config =
+          ConfigHandler::GetSharedConfig();
+      const string rules = ExtractCharacterFormRules(*config);
+      EXPECT_NE(character_form_rules_set_.end(),
+                character_form_rules_set_.find(rules));
+      Util::Sleep(0);
+      EXPECT_EQ(rules, ExtractCharacterFormRules(*config));
+    }
+  }
+
+ private:
+  std::atomic<bool> quitting_;
+  const mozc_hash_set<string> character_form_rules_set_;
+};
+
+TEST_F(ConfigHandlerTest, ConcurrentSharedConfigAccess) {
+  std::vector<Config> configs;
+  {
+    Config config;
+    ConfigHandler::GetDefaultConfig(&config);
+    configs.push_back(config);
+  }
+  {
+    Config config;
+    ConfigHandler::GetDefaultConfig(&config);
+    config.clear_character_form_rules();
+    auto *rule = config.add_character_form_rules();
+    rule->set_group("0");
+    rule->set_preedit_character_form(Config::HALF_WIDTH);
+    rule->set_conversion_character_form(Config::HALF_WIDTH);
+    configs.push_back(config);
+  }
+  mozc_hash_set<string> character_form_rules_set;
+  for (const auto &config : configs) {
+    character_form_rules_set.insert(ExtractCharacterFormRules(config));
+  }
+
+  const uint32 kTestDurationMSec = 250;  // 250 msec
+  const size_t kNumSetThread = 2;
+  const size_t kNumGetThread = 4;
+  {
+    std::vector<std::unique_ptr<SetConfigThread>> set_threads;
+    for (size_t i = 0; i < kNumSetThread; ++i) {
+      set_threads.emplace_back(std::unique_ptr<SetConfigThread>(
+          new SetConfigThread(configs)));
+    }
+    std::vector<std::unique_ptr<GetSharedConfigThread>> get_threads;
+    for (size_t i = 0; i < kNumGetThread; ++i) {
+      get_threads.emplace_back(std::unique_ptr<GetSharedConfigThread>(
+          new GetSharedConfigThread(character_form_rules_set)));
+    }
+    for (size_t i = 0; i < set_threads.size(); ++i) {
+      set_threads[i]->Start(
+          Util::StringPrintf("SetConfigThread%d", static_cast<int>(i)));
+    }
+    for (size_t i = 0; i < get_threads.size(); ++i) {
+      get_threads[i]->Start(
+          Util::StringPrintf("GetSharedConfigThread%d", static_cast<int>(i)));
+    }
+    Util::Sleep(kTestDurationMSec);
+    set_threads.clear();
+    get_threads.clear();
+  }
+}
+
 }  // namespace
 }  // namespace config
 }  // namespace mozc
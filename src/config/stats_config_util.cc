@@ -234,9 +234,8 @@ class AndroidStatsConfigUtilImpl : public StatsConfigUtilInterface {
   virtual ~AndroidStatsConfigUtilImpl() {
   }
   virtual bool IsEnabled() {
-    Config config;
-    ConfigHandler::GetConfig(&config);
-    return config.general_config().upload_usage_stats();
+    return ConfigHandler::GetSharedConfig()->general_config()
+        .upload_usage_stats();
   }
   virtual bool SetEnabled(bool val) {
     // TODO(horo): Implement this.
@@ -256,9 +255,8 @@ class NaclStatsConfigUtilImpl : public StatsConfigUtilInterface {
   virtual ~NaclStatsConfigUtilImpl() {
   }
   virtual bool IsEnabled() {
-    Config config;
-    ConfigHandler::GetConfig(&config);
-    return config.general_config().upload_usage_stats();
+    return ConfigHandler::GetSharedConfig()->general_config()
+        .upload_usage_stats();
   }
   virtual bool SetEnabled(bool val) {
     return false;
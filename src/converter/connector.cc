@@ -31,6 +31,7 @@
 
 #include <algorithm>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
@@ -39,6 +40,10 @@
 
 using mozc::storage::louds::SimpleSuccinctBitVectorIndex;
 
+DEFINE_bool(dense_connector, false,
+            "Decodes the connection matrix into a flat array at startup for "
+            "faster transition cost lookups at the cost of memory.");
+
 namespace mozc {
 namespace {
 
@@ -59,6 +64,10 @@ inline uint32 EncodeKey(uint16 rid, uint16 lid) {
   return (static_cast<uint32>(rid) << 16) | lid;
 }
 
+inline uint64 EncodeCacheEntry(uint32 key, int value) {
+  return (static_cast<uint64>(key) << 32) | static_cast<uint32>(value);
+}
+
 }  // namespace
 
 class Connector::Row {
@@ -119,23 +128,30 @@ Connector *Connector::CreateFromDataManager(
   const char *connection_data = nullptr;
   size_t connection_data_size = 0;
   data_manager.GetConnectorData(&connection_data, &connection_data_size);
-  return new Connector(connection_data, connection_data_size, kCacheSize);
+  return new Connector(connection_data, connection_data_size, kCacheSize,
+                       FLAGS_dense_connector);
 }
 
 Connector::Connector(const char *connection_data,
                      size_t connection_size,
                      int cache_size)
+    : Connector(connection_data, connection_size, cache_size, false) {}
+
+Connector::Connector(const char *connection_data,
+                     size_t connection_size,
+                     int cache_size,
+                     bool use_dense_matrix)
     : default_cost_(nullptr),
       cache_size_(cache_size),
       cache_hash_mask_(cache_size - 1),
-      cache_key_(new uint32[cache_size]),
-      cache_value_(new int[cache_size]) {
+      cache_(new std::atomic<uint64>[cache_size]) {
   const uint16 *ptr = reinterpret_cast<const uint16 *>(connection_data);
   CHECK_EQ(kConnectorMagicNumber, ptr[0]);
   resolution_ = ptr[1];
   const uint16 rsize = ptr[2];
   const uint16 lsize = ptr[3];
   CHECK_EQ(rsize, lsize) << "The connector matrix should be square.";
+  lsize_ = lsize;
   default_cost_ = ptr + 4;
 
   // Calculate the row's beginning position. Note that it should be aligned to
@@ -176,6 +192,20 @@ Connector::Connector(const char *connection_data,
   // Check if the cache_size is the power of 2 and clear cache.
   DCHECK_EQ(0, cache_size & (cache_size - 1));
   ClearCache();
+
+  // The costs of 1-byte data are multiplied by the resolution, which doesn't
+  // fit in uint16 for kInvalidCost.
+  if (use_dense_matrix && use_1byte_value) {
+    LOG(WARNING) << "The dense matrix is not supported for 1-byte costs";
+  } else if (use_dense_matrix) {
+    dense_costs_.reset(new uint16[static_cast<size_t>(rsize) * lsize]);
+    uint16 *dest = dense_costs_.get();
+    for (uint16 rid = 0; rid < rsize; ++rid) {
+      for (uint16 lid = 0; lid < lsize; ++lid) {
+        *dest++ = LookupCost(rid, lid);
+      }
+    }
+  }
 }
 
 Connector::~Connector() {
@@ -184,14 +214,18 @@ Connector::~Connector() {
 
 
 int Connector::GetTransitionCost(uint16 rid, uint16 lid) const {
+  if (dense_costs_) {
+    return dense_costs_[static_cast<size_t>(rid) * lsize_ + lid];
+  }
   const uint32 index = EncodeKey(rid, lid);
   const uint32 bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  const uint64 entry = cache_[bucket].load(std::memory_order_relaxed);
+  if (static_cast<uint32>(entry >> 32) == index) {
+    return static_cast<int32>(static_cast<uint32>(entry));
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  cache_[bucket].store(EncodeCacheEntry(index, value),
+                       std::memory_order_relaxed);
   return value;
 }
 
@@ -200,7 +234,10 @@ int Connector::GetResolution() const {
 }
 
 void Connector::ClearCache() {
-  std::fill(cache_key_.get(), cache_key_.get() + cache_size_, kInvalidCacheKey);
+  for (int i = 0; i < cache_size_; ++i) {
+    cache_[i].store(EncodeCacheEntry(kInvalidCacheKey, 0),
+                    std::memory_order_relaxed);
+  }
 }
 
 int Connector::LookupCost(uint16 rid, uint16 lid) const {
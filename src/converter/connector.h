@@ -30,6 +30,7 @@
 #ifndef MOZC_CONVERTER_CONNECTOR_H_
 #define MOZC_CONVERTER_CONNECTOR_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -48,6 +49,14 @@ class Connector {
 
   Connector(const char *connection_data, size_t connection_size,
             int cache_size);
+
+  // If |use_dense_matrix| is true, the whole matrix is decoded into a flat
+  // array of rsize * lsize costs so that GetTransitionCost() is a single
+  // array access instead of a cache probe and a succinct row lookup.  It
+  // costs 2 * rsize * lsize bytes, e.g. about 15MB for the OSS data set.
+  // Ignored for the data with 1-byte costs, i.e., GetResolution() != 1.
+  Connector(const char *connection_data, size_t connection_size,
+            int cache_size, bool use_dense_matrix);
   ~Connector();
 
   int GetTransitionCost(uint16 rid, uint16 lid) const;
@@ -63,11 +72,15 @@ class Connector {
   std::vector<Row *> rows_;
   const uint16 *default_cost_;
   int resolution_;
+  uint16 lsize_;
+  std::unique_ptr<uint16[]> dense_costs_;
 
   const int cache_size_;
   const uint32 cache_hash_mask_;
-  mutable std::unique_ptr<uint32[]> cache_key_;
-  mutable std::unique_ptr<int[]> cache_value_;
+  // Each cache entry packs the key into the upper 32 bits and the cost into the
+  // lower 32 bits, so that a lookup always sees a consistent pair even when
+  // the connector is shared by engines running on different threads.
+  mutable std::unique_ptr<std::atomic<uint64>[]> cache_;
 
   DISALLOW_COPY_AND_ASSIGN(Connector);
 };
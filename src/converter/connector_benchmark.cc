@@ -0,0 +1,186 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Viterbi throughput benchmark of Connector.
+//
+// Runs the min-cost relaxation of the Viterbi search over random lattices,
+// i.e., for each node, the minimum of the cost of every node ending right
+// before it plus the transition cost, with the cache and with the dense
+// matrix.  Reports the time per transition cost lookup, the lattices per
+// second and the time to create the connector with the dense matrix.  The
+// node ids are uniform over the matrix, or drawn from a small set with
+// --hot_ids, which is closer to real lattices where a few POS dominate.  The
+// connection data of the mock data set is used unless --connection_data is
+// given.  The dense matrix is not used for the data with 1-byte costs, so
+// both modes should be the same for them.
+//
+// Usage:
+//   connector_benchmark --connection_data=<gen dir>/connection.data
+//       --lattices=200 --hot_ids=200
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "converter/connector.h"
+#include "data_manager/testing/mock_data_manager.h"
+
+DEFINE_string(connection_data, "",
+              "Path to a connection data file, e.g., connection.data "
+              "generated for the OSS data set.  The connection data of the "
+              "mock data set is used if empty.");
+DEFINE_int32(lattices, 200, "Number of lattices for each mode.");
+DEFINE_int32(positions, 64, "Number of positions in a lattice.");
+DEFINE_int32(nodes, 40, "Number of nodes beginning at each position.");
+DEFINE_int32(hot_ids, 0,
+             "If positive, the node ids are drawn from this number of ids.  "
+             "Otherwise they are uniform over the matrix.");
+DEFINE_int32(random_seed, 0, "Random seed for the lattices.");
+
+namespace mozc {
+namespace {
+
+struct Node {
+  uint16 lid;
+  uint16 rid;
+};
+
+// Nodes of a lattice.  |nodes[i]| begin at position i and end at i + 1.
+typedef std::vector<std::vector<Node>> Lattice;
+
+std::vector<Lattice> MakeLattices(int num_ids) {
+  Util::SetRandomSeed(FLAGS_random_seed);
+  std::vector<uint16> ids;
+  if (FLAGS_hot_ids > 0) {
+    for (int i = 0; i < FLAGS_hot_ids; ++i) {
+      ids.push_back(Util::Random(num_ids));
+    }
+  }
+  auto random_id = [&ids, num_ids]() -> uint16 {
+    return ids.empty() ? Util::Random(num_ids) : ids[Util::Random(ids.size())];
+  };
+  std::vector<Lattice> lattices(FLAGS_lattices);
+  for (Lattice &lattice : lattices) {
+    lattice.resize(FLAGS_positions);
+    for (std::vector<Node> &nodes : lattice) {
+      nodes.resize(FLAGS_nodes);
+      for (Node &node : nodes) {
+        node.lid = random_id();
+        node.rid = random_id();
+      }
+    }
+  }
+  return lattices;
+}
+
+// Returns the minimum cost of the paths through the lattice so that the
+// compiler cannot drop the lookups.
+int Viterbi(const Connector &connector, const Lattice &lattice) {
+  std::vector<int> prev_costs(lattice[0].size(), 0);
+  std::vector<int> costs;
+  for (size_t pos = 1; pos < lattice.size(); ++pos) {
+    const std::vector<Node> &prev_nodes = lattice[pos - 1];
+    costs.assign(lattice[pos].size(), kint32max);
+    for (size_t i = 0; i < lattice[pos].size(); ++i) {
+      const uint16 lid = lattice[pos][i].lid;
+      for (size_t j = 0; j < prev_nodes.size(); ++j) {
+        const int cost =
+            prev_costs[j] + connector.GetTransitionCost(prev_nodes[j].rid, lid);
+        costs[i] = std::min(costs[i], cost);
+      }
+    }
+    prev_costs.swap(costs);
+  }
+  return *std::min_element(prev_costs.begin(), prev_costs.end());
+}
+
+void RunViterbi(const char *name, const Connector &connector,
+                const std::vector<Lattice> &lattices) {
+  // Warms up the cache and the pages of the matrix.
+  int64 checksum = Viterbi(connector, lattices[0]);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (const Lattice &lattice : lattices) {
+    checksum += Viterbi(connector, lattice);
+  }
+  const double elapsed_us = stopwatch.GetElapsedMicroseconds();
+  const double lookups = static_cast<double>(lattices.size()) *
+                         (FLAGS_positions - 1) * FLAGS_nodes * FLAGS_nodes;
+  std::cout << name << ": " << elapsed_us * 1000 / lookups
+            << " ns/lookup, " << lattices.size() * 1000000.0 / elapsed_us
+            << " lattices/s (checksum " << checksum << ")" << std::endl;
+}
+
+int Run() {
+  const char *data = nullptr;
+  size_t size = 0;
+  testing::MockDataManager data_manager;
+  Mmap mmap;
+  if (FLAGS_connection_data.empty()) {
+    data_manager.GetConnectorData(&data, &size);
+  } else {
+    CHECK(mmap.Open(FLAGS_connection_data.c_str()))
+        << "Failed to open " << FLAGS_connection_data;
+    data = mmap.begin();
+    size = mmap.size();
+  }
+  // The number of ids is the third field of the header.  See
+  // data_manager/gen_connection_data.py.
+  const int num_ids = reinterpret_cast<const uint16 *>(data)[2];
+  const std::vector<Lattice> lattices = MakeLattices(num_ids);
+
+  Connector cached(data, size, 1024, false);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  Connector dense(data, size, 1024, true);
+  const double creation_ms = stopwatch.GetElapsedMicroseconds() / 1000.0;
+
+  std::cout << "ids: " << num_ids << "\nresolution: " << cached.GetResolution()
+            << "\nlattices: " << lattices.size() << " x " << FLAGS_positions
+            << " positions x " << FLAGS_nodes << " nodes\nhot ids: "
+            << FLAGS_hot_ids << "\nDense connector creation: " << creation_ms
+            << " ms" << std::endl;
+  RunViterbi("Cache", cached, lattices);
+  RunViterbi("Dense", dense, lattices);
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  return mozc::Run();
+}
@@ -50,27 +50,36 @@ struct ConnectionDataEntry {
 
 #ifndef OS_NACL
 // Disabled on NaCl since it uses a mock file system.
-TEST(ConnectorTest, CompareWithRawData) {
-  const string path = testing::GetSourceFileOrDie({
-      "data_manager", "testing", "connection.data"});
-  Mmap cmmap;
-  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
-  std::unique_ptr<Connector> connector(
-      new Connector(cmmap.begin(), cmmap.size(), 256));
-  ASSERT_EQ(1, connector->GetResolution());
+class ConnectorTest : public ::testing::TestWithParam<bool> {};
 
+// Reads the costs of the mock data set.  The ids from |pos_size| are the
+// special POS, which are not in the text.
+void ReadRawData(std::vector<ConnectionDataEntry> *data, size_t *pos_size) {
   const string connection_text_path = testing::GetSourceFileOrDie({
       "data_manager", "testing", "connection_single_column.txt"});
-  std::vector<ConnectionDataEntry> data;
   for (ConnectionFileReader reader(connection_text_path);
        !reader.done(); reader.Next()) {
     ConnectionDataEntry entry;
     entry.rid = reader.rid_of_left_node();
     entry.lid = reader.lid_of_right_node();
     entry.cost = reader.cost();
-    data.push_back(entry);
+    data->push_back(entry);
+    *pos_size = reader.left_size();
   }
+}
 
+TEST_P(ConnectorTest, CompareWithRawData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256, GetParam()));
+  ASSERT_EQ(1, connector->GetResolution());
+
+  std::vector<ConnectionDataEntry> data;
+  size_t pos_size = 0;
+  ReadRawData(&data, &pos_size);
   for (int trial = 0; trial < 3; ++trial) {
     // Lookup in random order for a few times.
     std::random_shuffle(data.begin(), data.end());
@@ -84,6 +93,49 @@ TEST(ConnectorTest, CompareWithRawData) {
     }
   }
 }
+
+TEST_P(ConnectorTest, CompareWithRawDataFor1ByteCost) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection_1byte.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256, GetParam()));
+  const int resolution = connector->GetResolution();
+  ASSERT_LT(1, resolution);
+  const int invalid_cost = Connector::kInvalidCost;
+
+  std::vector<ConnectionDataEntry> data;
+  size_t pos_size = 0;
+  ReadRawData(&data, &pos_size);
+  for (int trial = 0; trial < 3; ++trial) {
+    // Lookup in random order for a few times.
+    std::random_shuffle(data.begin(), data.end());
+    for (size_t i = 0; i < data.size(); ++i) {
+      // The costs are rounded down to a multiple of the resolution, except for
+      // the most frequent cost of each row, which is stored as is.  Invalid
+      // costs stay invalid.
+      for (int lookup = 0; lookup < 2; ++lookup) {
+        const int actual =
+            connector->GetTransitionCost(data[i].rid, data[i].lid);
+        if (data[i].cost == invalid_cost) {
+          EXPECT_LE(invalid_cost, actual);
+        } else {
+          EXPECT_LE(actual, data[i].cost);
+          EXPECT_LT(data[i].cost - resolution, actual);
+        }
+      }
+    }
+  }
+
+  // The transitions to a special POS are invalid except from BOS.  They are
+  // stored as the invalid 1-byte cost, which is scaled by the resolution.
+  for (uint16 rid = 1; rid < pos_size; ++rid) {
+    EXPECT_LE(invalid_cost, connector->GetTransitionCost(rid, pos_size));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(DenseMatrix, ConnectorTest, ::testing::Bool());
 #endif  // !OS_NACL
 
 }  // namespace
@@ -37,6 +37,7 @@
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/port.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/immutable_converter_interface.h"
@@ -210,7 +211,8 @@ bool TryNormalizingKeyAsMathExpression(StringPiece s, string *key) {
 
 ConverterImpl::ConverterImpl() : pos_matcher_(NULL),
                                  immutable_converter_(NULL),
-                                 general_noun_id_(kuint16max) {
+                                 general_noun_id_(kuint16max),
+                                 learning_enabled_(true) {
 }
 
 ConverterImpl::~ConverterImpl() {}
@@ -231,6 +233,7 @@ void ConverterImpl::Init(const POSMatcher *pos_matcher,
 
 bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
+  MOZC_TRACE_SPAN("ConverterImpl::StartConversion");
   if (!request.has_composer()) {
     LOG(ERROR) << "Request doesn't have composer";
     return false;
@@ -377,6 +380,10 @@ bool ConverterImpl::Predict(const ConversionRequest &request,
 
   segments->set_request_type(request_type);
   predictor_->PredictForRequest(request, segments);
+  if (request.IsCanceled()) {
+    // The caller discards the result.  Skip the rewriters.
+    return false;
+  }
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
   if (request_type == Segments::PARTIAL_SUGGESTION ||
@@ -399,6 +406,7 @@ bool ConverterImpl::Predict(const ConversionRequest &request,
 
 bool ConverterImpl::StartPredictionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
+  MOZC_TRACE_SPAN("ConverterImpl::StartPrediction");
   if (!request.has_composer()) {
     LOG(ERROR) << "Composer is NULL";
     return false;
@@ -423,6 +431,7 @@ bool ConverterImpl::StartSuggestion(Segments *segments,
 
 bool ConverterImpl::StartSuggestionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
+  MOZC_TRACE_SPAN("ConverterImpl::StartSuggestion");
   DCHECK(request.has_composer());
   string prediction_key;
   request.composer().GetQueryForPrediction(&prediction_key);
@@ -494,8 +503,10 @@ bool ConverterImpl::FinishConversion(const ConversionRequest &request,
   }
 
   segments->clear_revert_entries();
-  rewriter_->Finish(request, segments);
-  predictor_->Finish(request, segments);
+  if (learning_enabled_) {
+    rewriter_->Finish(request, segments);
+    predictor_->Finish(request, segments);
+  }
 
   // Remove the front segments except for some segments which will be
   // used as history segments.
@@ -530,7 +541,9 @@ bool ConverterImpl::RevertConversion(Segments *segments) const {
   if (segments->revert_entries_size() == 0) {
     return true;
   }
-  predictor_->Revert(segments);
+  if (learning_enabled_) {
+    predictor_->Revert(segments);
+  }
   segments->clear_revert_entries();
   return true;
 }
@@ -59,6 +59,10 @@ class ConverterImpl : public ConverterInterface {
             RewriterInterface *rewriter,
             ImmutableConverterInterface *immutable_converter);
 
+  // Stops passing committed and reverted conversions to the predictor and the
+  // rewriter, so that the user data of this converter is no longer updated.
+  void DisableLearning() { learning_enabled_ = false; }
+
   bool Predict(const ConversionRequest &request,
                const string &key,
                const Segments::RequestType request_type,
@@ -179,6 +183,7 @@ class ConverterImpl : public ConverterInterface {
   std::unique_ptr<RewriterInterface> rewriter_;
   const ImmutableConverterInterface *immutable_converter_;
   uint16 general_noun_id_;
+  bool learning_enabled_;
 };
 
 }  // namespace mozc
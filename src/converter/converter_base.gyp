@@ -83,6 +83,7 @@
         '../base/base.gyp:base',
         '../dictionary/dictionary_base.gyp:pos_matcher',
         '../prediction/prediction_base.gyp:suggestion_filter',
+        '../request/request.gyp:conversion_request',
         '../transliteration/transliteration.gyp:transliteration',
         'connector',
         'lattice',
@@ -115,6 +116,7 @@
       'sources': [
         'immutable_converter.cc',
         'key_corrector.cc',
+        'prefix_lookup_cache.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -125,6 +127,7 @@
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../rewriter/rewriter_base.gyp:gen_rewriter_files#host',
+        '../storage/storage.gyp:storage',
         'connector',
         'immutable_converter_interface',
         'segmenter',
@@ -44,13 +44,16 @@
         'key_corrector_test.cc',
         'lattice_test.cc',
         'nbest_generator_test.cc',
+        'prefix_lookup_cache_test.cc',
         'segments_test.cc',
       ],
       'dependencies': [
+        '../base/base_test.gyp:clock_mock',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:config_handler',
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
         '../dictionary/dictionary.gyp:dictionary_mock',
+        '../dictionary/dictionary.gyp:dictionary_test_util',
         '../dictionary/dictionary.gyp:suffix_dictionary',
         '../dictionary/dictionary_base.gyp:user_dictionary',
         '../dictionary/dictionary_base.gyp:user_pos',
@@ -104,6 +107,7 @@
         '../data_manager/data_manager.gyp:connection_file_reader',
         '../data_manager/testing/mock_data_manager.gyp:gen_separate_connection_data_for_mock#host',
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
+        '../data_manager/testing/mock_data_manager_test.gyp:gen_1byte_connection_data_for_test#host',
         '../data_manager/testing/mock_data_manager_test.gyp:install_test_connection_txt',
         '../testing/testing.gyp:gtest_main',
         '../testing/testing.gyp:mozctest',
@@ -113,6 +117,19 @@
         'test_size': 'large',
       },
     },
+    {
+      # Viterbi throughput benchmark of Connector.  Not run as a test.
+      'target_name': 'connector_benchmark',
+      'type': 'executable',
+      'sources': [
+        'connector_benchmark.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
+        'converter_base.gyp:connector',
+      ],
+    },
     {
       'target_name': 'pos_id_printer_test',
       'type': 'executable',
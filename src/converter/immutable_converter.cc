@@ -41,6 +41,7 @@
 #include "base/port.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
@@ -50,6 +51,7 @@
 #include "converter/node.h"
 #include "converter/node_allocator.h"
 #include "converter/node_list_builder.h"
+#include "converter/prefix_lookup_cache.h"
 #include "converter/segmenter.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
@@ -304,6 +306,10 @@ ImmutableConverterImpl::ImmutableConverterImpl(
   DCHECK(suggestion_filter_);
 }
 
+void ImmutableConverterImpl::EnableLookupCache(size_t max_entries) {
+  lookup_cache_.reset(new PrefixLookupCache(max_entries));
+}
+
 void ImmutableConverterImpl::ExpandCandidates(
     const string &original_key, NBestGenerator *nbest, Segment *segment,
     Segments::RequestType request_type, size_t expand_size) const {
@@ -784,17 +790,29 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos,
       result_node = builder.result();
       lattice->SetCacheInfo(begin_pos, len);
     } else {
-      // When cache feature is not used, look up normally
+      // When cache feature is not used, look up normally.  The lattice is
+      // rebuilt for every conversion, e.g., when resizing segments, so the
+      // lookups are shared across conversions through |lookup_cache_|.
       BaseNodeListBuilder builder(
           lattice->node_allocator(),
           lattice->node_allocator()->max_nodes_size());
-      dictionary_->LookupPrefix(StringPiece(begin, len), request, &builder);
+      LookupPrefix(StringPiece(begin, len), request, &builder);
       result_node = builder.result();
     }
   }
   return AddCharacterTypeBasedNodes(begin, end, lattice, result_node);
 }
 
+void ImmutableConverterImpl::LookupPrefix(
+    StringPiece key, const ConversionRequest &request,
+    DictionaryInterface::Callback *callback) const {
+  if (lookup_cache_) {
+    lookup_cache_->LookupPrefix(*dictionary_, key, request, callback);
+  } else {
+    dictionary_->LookupPrefix(key, request, callback);
+  }
+}
+
 Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(
     const char *begin, const char *end, Lattice *lattice, Node *nodes) const {
 
@@ -926,10 +944,59 @@ inline void ViterbiInternal(
     rnode->cost = best_cost + rnode->wcost;
   }
 }
+
+// Same as ViterbiInternal() but connects every rnode to the lnode of the
+// minimum cost regardless of the transition cost.  This takes O(L + R) time
+// instead of O(L * R) for L lnodes and R rnodes, and is used after the
+// deadline of the request.
+inline void ApproximateViterbiInternal(
+    const Connector &connector, size_t pos, size_t right_boundary,
+    Lattice *lattice) {
+  Node *best_lnode = NULL;
+  for (Node *lnode = lattice->end_nodes(pos);
+       lnode != NULL; lnode = lnode->enext) {
+    if (lnode->prev != NULL &&
+        (best_lnode == NULL || lnode->cost < best_lnode->cost)) {
+      best_lnode = lnode;
+    }
+  }
+
+  for (Node *rnode = lattice->begin_nodes(pos);
+       rnode != NULL; rnode = rnode->bnext) {
+    if (rnode->end_pos > right_boundary) {
+      rnode->prev = NULL;
+      continue;
+    }
+    Node *prev = best_lnode;
+    if (rnode->constrained_prev != NULL) {
+      prev = rnode->constrained_prev->prev == NULL ?
+          NULL : rnode->constrained_prev;
+    }
+    rnode->prev = prev;
+    if (prev != NULL) {
+      rnode->cost = prev->cost + rnode->wcost +
+          connector.GetTransitionCost(prev->rid, rnode->lid);
+    }
+  }
+}
+
+// Runs ViterbiInternal() at |pos|, or ApproximateViterbiInternal() once the
+// deadline of |request| has passed.
+inline void ViterbiInternalForRequest(
+    const ConversionRequest &request, const Connector &connector, size_t pos,
+    size_t right_boundary, Lattice *lattice) {
+  if (request.IsDeadlineExceeded()) {
+    ApproximateViterbiInternal(connector, pos, right_boundary, lattice);
+  } else {
+    ViterbiInternal(connector, pos, right_boundary, lattice);
+  }
+}
 }  // namespace
 
 bool ImmutableConverterImpl::Viterbi(
-    const Segments &segments, Lattice *lattice) const {
+    const ConversionRequest &request, const Segments &segments,
+    Lattice *lattice) const {
+  MOZC_TRACE_SPAN("ImmutableConverterImpl::Viterbi");
   const string &key = lattice->key();
 
   // Process BOS.
@@ -968,7 +1035,8 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
     for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternalForRequest(
+          request, *connector_, pos, right_boundary, lattice);
     }
     left_boundary = right_boundary;
   }
@@ -979,7 +1047,8 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(i).key().size();
     for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      ViterbiInternalForRequest(
+          request, *connector_, pos, right_boundary, lattice);
     }
     left_boundary = right_boundary;
   }
@@ -1299,6 +1368,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
 bool ImmutableConverterImpl::MakeLattice(
     const ConversionRequest &request,
     Segments *segments, Lattice *lattice) const {
+  MOZC_TRACE_SPAN("ImmutableConverterImpl::MakeLattice");
   if (segments == NULL) {
     LOG(ERROR) << "Segments is NULL";
     return false;
@@ -1391,7 +1461,7 @@ bool ImmutableConverterImpl::MakeLattice(
   }
 
   // Predictive real time conversion
-  if (is_prediction) {
+  if (is_prediction && !request.IsDeadlineExceeded()) {
     MakeLatticeNodesForPredictiveNodes(*segments, request, lattice);
   }
 
@@ -1586,6 +1656,13 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
        segments.request_type() == Segments::PREDICTION);
   for (size_t pos = history_key.size(); pos < key.size(); ++pos) {
     if (lattice->end_nodes(pos) != NULL) {
+      if (request.IsDeadlineExceeded()) {
+        // Out of time.  Only character type based nodes are added to the rest
+        // of the key, which keeps the lattice connected with little cost.
+        lattice->Insert(pos, AddCharacterTypeBasedNodes(
+            key.data() + pos, key.data() + key.size(), lattice, NULL));
+        continue;
+      }
       Node *rnode =
           Lookup(pos, key.size(), request, is_reverse, is_prediction, lattice);
       // If history key is NOT empty and user input seems to starts with
@@ -1663,6 +1740,7 @@ void ImmutableConverterImpl::Resegment(
 
 // Single segment conversion results should be set to |segments|.
 void ImmutableConverterImpl::InsertFirstSegmentToCandidates(
+    const ConversionRequest &request,
     Segments *segments,
     const Lattice &lattice,
     const std::vector<uint16> &group,
@@ -1670,7 +1748,7 @@ void ImmutableConverterImpl::InsertFirstSegmentToCandidates(
     FilterType filter_type) const {
   const size_t only_first_segment_candidate_pos =
       segments->conversion_segment(0).candidates_size();
-  InsertCandidates(segments, lattice, group,
+  InsertCandidates(request, segments, lattice, group,
                    max_candidates_size,
                    ONLY_FIRST_SEGMENT,
                    filter_type);
@@ -1792,6 +1870,7 @@ Segment *ImmutableConverterImpl::GetInsertTargetSegment(
 }
 
 void ImmutableConverterImpl::InsertCandidates(
+    const ConversionRequest &request,
     Segments *segments,
     const Lattice &lattice,
     const std::vector<uint16> &group,
@@ -1814,6 +1893,7 @@ void ImmutableConverterImpl::InsertCandidates(
   NBestGenerator nbest_generator(
       suppression_dictionary_, segmenter_, connector_, pos_matcher_,
       &lattice, suggestion_filter_, (filter_type == DESKTOP));
+  nbest_generator.set_conversion_request(&request);
 
   string original_key;
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
@@ -1892,7 +1972,7 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
       const size_t single_segment_candidates_size =
           ((max_candidates_size > kOnlyFirstSegmentCandidateSize) ?
            max_candidates_size - kOnlyFirstSegmentCandidateSize : 1);
-      InsertCandidates(segments, lattice, group,
+      InsertCandidates(request, segments, lattice, group,
                        single_segment_candidates_size, SINGLE_SEGMENT,
                        filter_type);
 
@@ -1910,11 +1990,12 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
           std::min(max_candidates_size, single_segment_candidates_size +
                                             kOnlyFirstSegmentCandidateSize);
       InsertFirstSegmentToCandidates(
-          segments, lattice, group, only_first_segment_candidates_size,
-          filter_type);
+          request, segments, lattice, group,
+          only_first_segment_candidates_size, filter_type);
     } else {
       InsertCandidates(
-          segments, lattice, group, max_candidates_size, SINGLE_SEGMENT,
+          request, segments, lattice, group, max_candidates_size,
+          SINGLE_SEGMENT,
           filter_type);
     }
   } else {
@@ -1934,7 +2015,7 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
     const size_t old_conversion_segments_size =
         segments->conversion_segments_size();
     InsertCandidates(
-        segments, lattice, group, max_candidates_size, MULTI_SEGMENTS,
+        request, segments, lattice, group, max_candidates_size, MULTI_SEGMENTS,
         filter_type);
     if (old_conversion_segments_size > 0) {
       segments->erase_segments(segments->history_segments_size(),
@@ -1977,7 +2058,7 @@ bool ImmutableConverterImpl::ConvertForRequest(
       return false;
     }
   } else {
-    if (!Viterbi(*segments, lattice)) {
+    if (!Viterbi(request, *segments, lattice)) {
       LOG(WARNING) << "viterbi failed";
       return false;
     }
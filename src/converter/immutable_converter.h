@@ -30,13 +30,16 @@
 #ifndef MOZC_CONVERTER_IMMUTABLE_CONVERTER_H_
 #define MOZC_CONVERTER_IMMUTABLE_CONVERTER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "converter/connector.h"
 #include "converter/immutable_converter_interface.h"
 #include "converter/node.h"
+#include "converter/prefix_lookup_cache.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
@@ -70,6 +73,17 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   virtual bool ConvertForRequest(
       const ConversionRequest &request, Segments *segments) const;
 
+  // Caches the results of dictionary prefix lookups for conversion, for at
+  // most |max_entries| keys across conversions.  Lookups for prediction are
+  // incremental and already cached in the lattice.  The dictionary must
+  // change its generation whenever its contents change (see
+  // DictionaryInterface::GetGeneration()).  Must be called before the first
+  // conversion.
+  void EnableLookupCache(size_t max_entries);
+
+  // Returns the lookup cache, or nullptr if it is not enabled.
+  const PrefixLookupCache *lookup_cache() const { return lookup_cache_.get(); }
+
  private:
   FRIEND_TEST(ImmutableConverterTest, AddPredictiveNodes);
   FRIEND_TEST(ImmutableConverterTest, DummyCandidatesCost);
@@ -108,6 +122,8 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                Lattice *lattice) const;
   Node *AddCharacterTypeBasedNodes(const char *begin, const char *end,
                                    Lattice *lattice, Node *nodes) const;
+  void LookupPrefix(StringPiece key, const ConversionRequest &request,
+                    dictionary::DictionaryInterface::Callback *callback) const;
 
   void Resegment(const Segments &segments,
                  const string &history_key, const string &conversion_key,
@@ -137,7 +153,10 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   void ApplyPrefixSuffixPenalty(const string &conversion_key,
                                 Lattice *lattice) const;
 
-  bool Viterbi(const Segments &segments, Lattice *lattice) const;
+  // Once the deadline of |request| passes, the rest of the lattice connects
+  // each node to the cheapest preceding node ignoring the transition cost.
+  bool Viterbi(const ConversionRequest &request, const Segments &segments,
+               Lattice *lattice) const;
 
   bool PredictionViterbi(const Segments &segments, Lattice *lattice) const;
   void PredictionViterbiInternal(
@@ -147,13 +166,17 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
 
   // Inserts first segment from conversion result to candidates.
   // Costs will be modified using the existing candidates.
-  void InsertFirstSegmentToCandidates(Segments *segments,
+  void InsertFirstSegmentToCandidates(const ConversionRequest &request,
+                                      Segments *segments,
                                       const Lattice &lattice,
                                       const std::vector<uint16> &group,
                                       size_t max_candidates_size,
                                       FilterType filter_type) const;
 
-  void InsertCandidates(Segments *segments,
+  // Stops expanding the N-best candidates once the deadline of |request|
+  // passes.  Each segment still gets the Viterbi best candidate.
+  void InsertCandidates(const ConversionRequest &request,
+                        Segments *segments,
                         const Lattice &lattice,
                         const std::vector<uint16> &group,
                         size_t max_candidates_size,
@@ -209,6 +232,8 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   // Cache for transition cost.
   const int32 last_to_first_name_transition_cost_;
 
+  std::unique_ptr<PrefixLookupCache> lookup_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(ImmutableConverterImpl);
 };
 
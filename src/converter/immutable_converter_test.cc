@@ -29,19 +29,25 @@
 
 #include "converter/immutable_converter.h"
 
+#include <limits>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/string_piece.h"
 #include "base/system_util.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
 #include "converter/lattice.h"
+#include "converter/prefix_lookup_cache.h"
 #include "converter/segmenter.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
@@ -53,12 +59,16 @@
 #include "dictionary/suppression_dictionary.h"
 #include "dictionary/system/system_dictionary.h"
 #include "dictionary/system/value_dictionary.h"
+#include "dictionary/user_dictionary.h"
 #include "dictionary/user_dictionary_stub.h"
+#include "dictionary/user_pos.h"
 #include "prediction/suggestion_filter.h"
 #include "protocol/commands.pb.h"
+#include "protocol/user_dictionary_storage.pb.h"
 #include "request/conversion_request.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
+#include "testing/base/public/mozctest.h"
 
 namespace mozc {
 namespace {
@@ -70,7 +80,9 @@ using dictionary::PosGroup;
 using dictionary::SuffixDictionary;
 using dictionary::SuppressionDictionary;
 using dictionary::SystemDictionary;
+using dictionary::UserDictionary;
 using dictionary::UserDictionaryStub;
+using dictionary::UserPOS;
 using dictionary::ValueDictionary;
 
 void SetCandidate(const string &key, const string &value, Segment *segment) {
@@ -88,10 +100,14 @@ class MockDataAndImmutableConverter {
   // Initializes data and immutable converter with given dictionaries. If
   // nullptr is passed, the default mock dictionary is used. This class owns the
   // first argument dictionary but doesn't the second because the same
-  // dictionary may be passed to the arguments.
+  // dictionary may be passed to the arguments.  If |user_dictionary_storage|
+  // is given, the default dictionary looks up its entries as the user
+  // dictionary.
   explicit MockDataAndImmutableConverter(
       const DictionaryInterface *dictionary = nullptr,
-      const DictionaryInterface *suffix_dictionary = nullptr) {
+      const DictionaryInterface *suffix_dictionary = nullptr,
+      const user_dictionary::UserDictionaryStorage *user_dictionary_storage =
+          nullptr) {
     data_manager_.reset(new testing::MockDataManager);
 
     pos_matcher_.Set(data_manager_->GetPOSMatcherData());
@@ -108,10 +124,22 @@ class MockDataAndImmutableConverter {
                                              &dictionary_size);
       SystemDictionary *sysdic =
           SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+      DictionaryInterface *user_dictionary = &user_dictionary_stub_;
+      if (user_dictionary_storage) {
+        user_dictionary_.reset(new UserDictionary(
+            UserPOS::CreateFromDataManager(*data_manager_),
+            pos_matcher_,
+            suppression_dictionary_.get()));
+        // Wait for the reload from the file started by the constructor so
+        // that it doesn't overwrite the entries loaded below.
+        user_dictionary_->WaitForReloader();
+        user_dictionary_->Load(*user_dictionary_storage);
+        user_dictionary = user_dictionary_.get();
+      }
       dictionary_.reset(new DictionaryImpl(
           sysdic,  // DictionaryImpl takes the ownership
           new ValueDictionary(pos_matcher_, &sysdic->value_trie()),
-          &user_dictionary_stub_,
+          user_dictionary,
           suppression_dictionary_.get(),
           &pos_matcher_));
     }
@@ -164,7 +192,8 @@ class MockDataAndImmutableConverter {
 
  private:
   std::unique_ptr<const DataManagerInterface> data_manager_;
-  std::unique_ptr<const SuppressionDictionary> suppression_dictionary_;
+  std::unique_ptr<SuppressionDictionary> suppression_dictionary_;
+  std::unique_ptr<UserDictionary> user_dictionary_;
   std::unique_ptr<const Connector> connector_;
   std::unique_ptr<const Segmenter> segmenter_;
   std::unique_ptr<const DictionaryInterface> suffix_dictionary_;
@@ -405,7 +434,7 @@ TEST(ImmutableConverterTest, NotConnectedTest) {
 
   std::vector<uint16> group;
   converter->MakeGroup(segments, &group);
-  converter->Viterbi(segments, &lattice);
+  converter->Viterbi(request, segments, &lattice);
 
   // Intentionally segmented position - 1
   const size_t pos = strlen("しょうめ");
@@ -548,4 +577,285 @@ TEST(ImmutableConverterTest, AutoPartialSuggestionForSingleSegment) {
   }
 }
 
+namespace {
+
+// A long key without any obvious segment boundary, which makes the lattice
+// large.  It is kept within the maximum key length of the converter.
+string MakeAdversarialKey() {
+  string key;
+  for (int i = 0; i < 30; ++i) {
+    key.append("きしゃのきしゃがきし");
+  }
+  return key;
+}
+
+string GetConvertedKey(const Segments &segments) {
+  string key;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    key.append(segments.conversion_segment(i).key());
+  }
+  return key;
+}
+
+// Fills |storage| with a dictionary in which every short substring of
+// MakeAdversarialKey() has |values_per_key| words, so that every position of
+// the key adds thousands of nodes to the lattice.
+void MakeLargeUserDictionary(
+    int values_per_key, user_dictionary::UserDictionaryStorage *storage) {
+  const string kPattern = "きしゃのきしゃがきし";
+  std::vector<string> chars;
+  Util::SplitStringToUtf8Chars(kPattern, &chars);
+  std::set<string> keys;
+  for (size_t begin = 0; begin < chars.size(); ++begin) {
+    string key;
+    for (size_t len = 1; len <= 4; ++len) {
+      key.append(chars[(begin + len - 1) % chars.size()]);
+      keys.insert(key);
+    }
+  }
+  user_dictionary::UserDictionary *dictionary = storage->add_dictionaries();
+  for (const string &key : keys) {
+    for (int i = 0; i < values_per_key; ++i) {
+      user_dictionary::UserDictionary::Entry *entry =
+          dictionary->add_entries();
+      entry->set_key(key);
+      entry->set_value(key + std::to_string(i));
+      entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    }
+  }
+}
+
+// Converts |key| with the time budget and returns the elapsed time.
+// |budget_usec| == 0 means no deadline.
+int64 ConvertAndMeasureUsec(ImmutableConverterImpl *converter,
+                            Segments::RequestType request_type,
+                            const string &key, uint64 budget_usec,
+                            Segments *segments, bool *degraded) {
+  ConversionRequest request;
+  request.set_time_budget_usec(budget_usec);
+  segments->Clear();
+  segments->set_request_type(request_type);
+  segments->set_max_prediction_candidates_size(100);
+  segments->add_segment()->set_key(key);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  EXPECT_TRUE(converter->ConvertForRequest(request, segments));
+  stopwatch.Stop();
+  *degraded = request.degraded();
+  return stopwatch.GetElapsedMicroseconds();
+}
+
+// Checks that the conversion under the budget of a tenth of the unbounded
+// conversion time finishes in less than half of it, and that the result still
+// covers the key with at least one candidate per segment.
+void ExpectDeadlineBoundsLatency(ImmutableConverterImpl *converter,
+                                 Segments::RequestType request_type,
+                                 const string &key) {
+  Segments segments;
+  bool degraded = false;
+  const int64 unbounded_usec = ConvertAndMeasureUsec(
+      converter, request_type, key, 0, &segments, &degraded);
+  EXPECT_FALSE(degraded);
+  // The input has to be expensive enough for the comparison to mean
+  // something on fast machines.
+  ASSERT_LE(10000, unbounded_usec) << "The input is not adversarial enough";
+
+  const int64 budget_usec = unbounded_usec / 10;
+  const int64 bounded_usec = ConvertAndMeasureUsec(
+      converter, request_type, key, budget_usec, &segments, &degraded);
+  EXPECT_TRUE(degraded);
+  EXPECT_LT(bounded_usec, unbounded_usec / 2)
+      << "unbounded: " << unbounded_usec << "us, budget: " << budget_usec
+      << "us";
+  ASSERT_LT(0, segments.conversion_segments_size());
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    EXPECT_LT(0, segments.conversion_segment(i).candidates_size());
+  }
+  EXPECT_EQ(key, GetConvertedKey(segments));
+}
+
+}  // namespace
+
+TEST(ImmutableConverterTest, ConvertAfterDeadline) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  ClockMock clock_mock(0, 0);
+  clock_mock.SetFrequency(1000000uLL);
+  clock_mock.SetTicks(1000);
+  Clock::SetClockForUnitTest(&clock_mock);
+
+  const string key = MakeAdversarialKey();
+  const Segments::RequestType kRequestTypes[] = {
+    Segments::CONVERSION,
+    Segments::PREDICTION,
+  };
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    ConversionRequest request;
+    request.set_time_budget_usec(1000);
+    clock_mock.PutClockForwardByTicks(1000);
+    ASSERT_TRUE(request.IsDeadlineExceeded());
+
+    Segments segments;
+    segments.set_request_type(kRequestTypes[i]);
+    segments.set_max_prediction_candidates_size(10);
+    segments.add_segment()->set_key(key);
+    EXPECT_TRUE(converter->ConvertForRequest(request, &segments));
+    EXPECT_TRUE(request.degraded());
+
+    // The best result so far still covers the whole key.
+    ASSERT_LT(0, segments.conversion_segments_size());
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      EXPECT_LT(0, segments.conversion_segment(j).candidates_size());
+    }
+    EXPECT_EQ(key, GetConvertedKey(segments));
+  }
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST(ImmutableConverterTest, ConvertWithinDeadline) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  ClockMock clock_mock(0, 0);
+  clock_mock.SetFrequency(1000000uLL);
+  clock_mock.SetTicks(1000);
+  Clock::SetClockForUnitTest(&clock_mock);
+
+  const string kKey = "わたしのなまえはなかのです";
+  Segments expected;
+  {
+    const ConversionRequest request;
+    expected.set_request_type(Segments::CONVERSION);
+    expected.add_segment()->set_key(kKey);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &expected));
+  }
+
+  // The mock clock does not advance, so the result is the same as the one
+  // without deadline.
+  ConversionRequest request;
+  request.set_time_budget_usec(1000);
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  segments.add_segment()->set_key(kKey);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  EXPECT_FALSE(request.degraded());
+  ASSERT_EQ(expected.conversion_segments_size(),
+            segments.conversion_segments_size());
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &expected_segment = expected.conversion_segment(i);
+    const Segment &segment = segments.conversion_segment(i);
+    ASSERT_EQ(expected_segment.candidates_size(), segment.candidates_size());
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      EXPECT_EQ(expected_segment.candidate(j).value,
+                segment.candidate(j).value);
+    }
+  }
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST(ImmutableConverterTest, LargeTimeBudgetDoesNotOverflow) {
+  // A nanosecond clock, with which budget_usec * frequency overflows beyond
+  // about five hours.
+  ClockMock clock_mock(0, 0);
+  clock_mock.SetFrequency(1000000000uLL);
+  clock_mock.SetTicks(1000);
+  Clock::SetClockForUnitTest(&clock_mock);
+
+  {
+    ConversionRequest request;
+    request.set_time_budget_usec(1500);
+    clock_mock.PutClockForwardByTicks(1499999);
+    EXPECT_FALSE(request.IsDeadlineExceeded());
+    clock_mock.PutClockForwardByTicks(1);
+    EXPECT_TRUE(request.IsDeadlineExceeded());
+  }
+  {
+    ConversionRequest request;
+    request.set_time_budget_usec(24uLL * 3600 * 1000000);  // A day.
+    clock_mock.PutClockForwardByTicks(3600uLL * 1000000000);  // An hour.
+    EXPECT_FALSE(request.IsDeadlineExceeded());
+  }
+  {
+    ConversionRequest request;
+    request.set_time_budget_usec(std::numeric_limits<uint64>::max());
+    clock_mock.PutClockForwardByTicks(3600uLL * 1000000000);
+    EXPECT_FALSE(request.IsDeadlineExceeded());
+  }
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST(ImmutableConverterTest, DeadlineBoundsLatency) {
+  const testing::ScopedTmpUserProfileDirectory scoped_profile_dir;
+
+  // Long unsegmented kana.
+  {
+    std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+        new MockDataAndImmutableConverter);
+    ExpectDeadlineBoundsLatency(data_and_converter->GetConverter(),
+                                Segments::CONVERSION, MakeAdversarialKey());
+  }
+
+  // A large user dictionary matching every position of the key, both for
+  // conversion and for prediction, which also aggregates the predictive
+  // nodes.
+  user_dictionary::UserDictionaryStorage storage;
+  MakeLargeUserDictionary(200, &storage);
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter(nullptr, nullptr, &storage));
+  ExpectDeadlineBoundsLatency(data_and_converter->GetConverter(),
+                              Segments::CONVERSION, MakeAdversarialKey());
+  ExpectDeadlineBoundsLatency(data_and_converter->GetConverter(),
+                              Segments::PREDICTION, MakeAdversarialKey());
+}
+
+TEST(ImmutableConverterTest, LookupCache) {
+  const string kKey = "わたしのなまえはなかのです";
+  Segments expected;
+  {
+    std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+        new MockDataAndImmutableConverter);
+    expected.set_request_type(Segments::CONVERSION);
+    expected.add_segment()->set_key(kKey);
+    ASSERT_TRUE(data_and_converter->GetConverter()->Convert(&expected));
+  }
+
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  EXPECT_EQ(nullptr, converter->lookup_cache());
+  converter->EnableLookupCache(100);
+  const PrefixLookupCache *cache = converter->lookup_cache();
+  ASSERT_NE(nullptr, cache);
+
+  // The second conversion replays the lookups of the first one.
+  for (int i = 0; i < 2; ++i) {
+    Segments segments;
+    segments.set_request_type(Segments::CONVERSION);
+    segments.add_segment()->set_key(kKey);
+    ASSERT_TRUE(converter->Convert(&segments));
+    ASSERT_EQ(expected.conversion_segments_size(),
+              segments.conversion_segments_size());
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      const Segment &expected_segment = expected.conversion_segment(j);
+      const Segment &segment = segments.conversion_segment(j);
+      ASSERT_EQ(expected_segment.candidates_size(), segment.candidates_size());
+      for (size_t k = 0; k < segment.candidates_size(); ++k) {
+        EXPECT_EQ(expected_segment.candidate(k).value,
+                  segment.candidate(k).value);
+        EXPECT_EQ(expected_segment.candidate(k).cost,
+                  segment.candidate(k).cost);
+      }
+    }
+    if (i == 0) {
+      EXPECT_EQ(0, cache->hit_count());
+      EXPECT_LT(0, cache->miss_count());
+    } else {
+      EXPECT_EQ(cache->miss_count(), cache->hit_count());
+    }
+  }
+}
+
 }  // namespace mozc
@@ -42,6 +42,7 @@
 #include "converter/segmenter.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
+#include "request/conversion_request.h"
 
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::SuppressionDictionary;
@@ -52,6 +53,10 @@ namespace {
 const int kFreeListSize = 512;
 const int kCostDiff = 3453;   // log prob of 1/1000
 
+// The deadline is checked every this number of trials, as reading the clock
+// costs more than a trial.
+const int kDeadlineCheckInterval = 16;
+
 }  // namespace
 
 using converter::CandidateFilter;
@@ -116,12 +121,14 @@ NBestGenerator::NBestGenerator(const SuppressionDictionary *suppression_dic,
     : suppression_dictionary_(suppression_dic),
       segmenter_(segmenter), connector_(connector), pos_matcher_(pos_matcher),
       lattice_(lattice),
+      request_(NULL),
       begin_node_(NULL), end_node_(NULL),
       freelist_(kFreeListSize),
       filter_(new CandidateFilter(
           suppression_dic, pos_matcher, suggestion_filter,
           apply_suggestion_filter_for_exact_match)),
       viterbi_result_checked_(false),
+      has_candidate_(false),
       check_mode_(STRICT),
       boundary_checker_(NULL) {
   DCHECK(suppression_dictionary_);
@@ -144,6 +151,7 @@ void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
   freelist_.Free();
   filter_->Reset();
   viterbi_result_checked_ = false;
+  has_candidate_ = false;
   check_mode_ = mode;
 
   begin_node_ = begin_node;
@@ -317,6 +325,7 @@ bool NBestGenerator::Next(const string &original_key,
     // Viterbi-best path.
     switch (InsertTopResult(original_key, candidate, request_type)) {
       case CandidateFilter::GOOD_CANDIDATE:
+        has_candidate_ = true;
         return true;
       case CandidateFilter::STOP_ENUMERATION:
         return false;
@@ -343,6 +352,15 @@ bool NBestGenerator::Next(const string &original_key,
       return false;
     }
 
+    // The Viterbi best result may have been filtered out, so the enumeration
+    // goes on until the segment gets at least one candidate.
+    if (has_candidate_ && request_ != NULL &&
+        num_trials % kDeadlineCheckInterval == 0 &&
+        request_->IsDeadlineExceeded()) {
+      VLOG(2) << "deadline exceeded: " << num_trials;
+      return false;
+    }
+
     // reached to the goal.
     if (rnode->end_pos == begin_node_->end_pos) {
       nodes_.clear();
@@ -361,6 +379,7 @@ bool NBestGenerator::Next(const string &original_key,
 
       switch (filter_result) {
         case CandidateFilter::GOOD_CANDIDATE:
+          has_candidate_ = true;
           return true;
         case CandidateFilter::STOP_ENUMERATION:
           return false;
@@ -44,6 +44,7 @@
 namespace mozc {
 
 class Connector;
+class ConversionRequest;
 class Lattice;
 class Segmenter;
 class SuggestionFilter;
@@ -94,6 +95,13 @@ class NBestGenerator {
   void Reset(const Node *begin_node, const Node *end_node,
              const BoundaryCheckMode mode);
 
+  // Sets the request whose deadline bounds the enumeration.  Once the deadline
+  // passes, Next() returns false, but only after it has returned at least one
+  // candidate since Reset().  Not owned.
+  void set_conversion_request(const ConversionRequest *request) {
+    request_ = request;
+  }
+
   // Iterator:
   // Can obtain N-best results by calling Next() in sequence.
   bool Next(const string &original_key,
@@ -176,6 +184,7 @@ class NBestGenerator {
   const Connector *connector_;
   const dictionary::POSMatcher *pos_matcher_;
   const Lattice *lattice_;
+  const ConversionRequest *request_;
 
   const Node *begin_node_;
   const Node *end_node_;
@@ -185,6 +194,8 @@ class NBestGenerator {
   std::vector<const Node *> nodes_;
   std::unique_ptr<converter::CandidateFilter> filter_;
   bool viterbi_result_checked_;
+  // True if Next() has returned a candidate since Reset().
+  bool has_candidate_;
   BoundaryCheckMode check_mode_;
 
   BoundaryChecker boundary_checker_;
@@ -217,7 +217,7 @@ TEST_F(NBestGeneratorTest, MultiSegmentConnectionTest) {
 
   std::vector<uint16> group;
   converter->MakeGroup(segments, &group);
-  converter->Viterbi(segments, &lattice);
+  converter->Viterbi(request, segments, &lattice);
 
   std::unique_ptr<NBestGenerator> nbest_generator(
       data_and_converter->CreateNBestGenerator(&lattice));
@@ -274,7 +274,7 @@ TEST_F(NBestGeneratorTest, SingleSegmentConnectionTest) {
 
   std::vector<uint16> group;
   converter->MakeGroup(segments, &group);
-  converter->Viterbi(segments, &lattice);
+  converter->Viterbi(request, segments, &lattice);
 
   std::unique_ptr<NBestGenerator> nbest_generator(
       data_and_converter->CreateNBestGenerator(&lattice));
@@ -329,7 +329,7 @@ TEST_F(NBestGeneratorTest, InnerSegmentBoundary) {
 
   std::vector<uint16> group;
   converter->MakeGroup(segments, &group);
-  converter->Viterbi(segments, &lattice);
+  converter->Viterbi(request, segments, &lattice);
 
   std::unique_ptr<NBestGenerator> nbest_generator(
       data_and_converter->CreateNBestGenerator(&lattice));
@@ -34,6 +34,7 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "converter/node.h"
+#include "dictionary/dictionary_token.h"
 
 namespace mozc {
 
@@ -69,10 +70,17 @@ class NodeAllocator {
     return node_count_;
   }
 
+  // Returns a token reused by dictionary lookups for the nodes allocated by
+  // this instance.  See DictionaryInterface::Callback::GetTokenBuffer().
+  dictionary::Token *mutable_token_buffer() {
+    return &token_buffer_;
+  }
+
  private:
   FreeList<Node> node_freelist_;
   size_t max_nodes_size_;
   size_t node_count_;
+  dictionary::Token token_buffer_;
 
   DISALLOW_COPY_AND_ASSIGN(NodeAllocator);
 };
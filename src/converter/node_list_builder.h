@@ -68,6 +68,13 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
   }
 
+  // Lets dictionaries decode tokens into the buffer owned by the allocator,
+  // which lives across the lookups for a lattice.  Tokens are copied only
+  // into the nodes created from them.
+  virtual dictionary::Token *GetTokenBuffer() {
+    return allocator_->mutable_token_buffer();
+  }
+
   int limit() const { return limit_; }
   int penalty() const { return penalty_; }
   Node *result() const { return result_; }
@@ -0,0 +1,245 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/prefix_lookup_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "protocol/config.pb.h"
+
+namespace mozc {
+
+using dictionary::DictionaryInterface;
+using dictionary::Token;
+
+namespace {
+
+// Returns the key of the cache, which consists of the request flags affecting
+// lookup results followed by |key|.
+string GetCacheKey(StringPiece key, const ConversionRequest &request) {
+  const config::Config &config = request.config();
+  char flags = 0;
+  if (request.IsKanaModifierInsensitiveConversion()) {
+    flags |= 0x01;
+  }
+  if (config.use_spelling_correction()) {
+    flags |= 0x02;
+  }
+  if (config.use_zip_code_conversion()) {
+    flags |= 0x04;
+  }
+  if (config.use_t13n_conversion()) {
+    flags |= 0x08;
+  }
+  if (config.incognito_mode()) {
+    flags |= 0x10;
+  }
+  string cache_key;
+  cache_key.reserve(key.size() + 1);
+  cache_key.push_back(flags);
+  key.AppendToString(&cache_key);
+  return cache_key;
+}
+
+}  // namespace
+
+// Collects all the tokens found by a prefix lookup.
+class PrefixLookupCache::EntryCollector : public DictionaryInterface::Callback {
+ public:
+  EntryCollector() : entries_(new Entries), is_expanded_(false) {}
+
+  ResultType OnActualKey(StringPiece key, StringPiece actual_key,
+                         bool is_expanded) override {
+    is_expanded_ = is_expanded;
+    return TRAVERSE_CONTINUE;
+  }
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    Entry entry;
+    entry.key_length = key.size();
+    entry.actual_key_length = token.key.size();
+    entry.value_length = token.value.size();
+    entry.is_expanded = is_expanded_;
+    entry.attributes = token.attributes;
+    entry.offset = entries_->strings.size();
+    entry.cost = token.cost;
+    entry.lid = token.lid;
+    entry.rid = token.rid;
+    entries_->entries.push_back(entry);
+    entries_->strings.append(token.key);
+    entries_->strings.append(token.value);
+    return TRAVERSE_CONTINUE;
+  }
+
+  // Lets dictionaries reuse the buffer of this collector.
+  Token *GetTokenBuffer() override { return &token_buffer_; }
+
+  std::shared_ptr<const Entries> entries() const { return entries_; }
+
+ private:
+  std::shared_ptr<Entries> entries_;
+  bool is_expanded_;
+  Token token_buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(EntryCollector);
+};
+
+PrefixLookupCache::PrefixLookupCache(size_t max_entries)
+    : cache_(max_entries), generation_(0), hit_count_(0), miss_count_(0) {}
+
+PrefixLookupCache::~PrefixLookupCache() {}
+
+void PrefixLookupCache::LookupPrefix(const DictionaryInterface &dictionary,
+                                     StringPiece key,
+                                     const ConversionRequest &request,
+                                     DictionaryInterface::Callback *callback) {
+  const string cache_key = GetCacheKey(key, request);
+  // The generation is taken before the lookup so that the result of a lookup
+  // racing with an update is discarded.
+  const uint64 generation = dictionary.GetGeneration();
+  std::shared_ptr<const Entries> entries = Lookup(cache_key, generation);
+  if (!entries) {
+    EntryCollector collector;
+    dictionary.LookupPrefix(key, request, &collector);
+    entries = collector.entries();
+    Insert(cache_key, generation, entries);
+  }
+
+  Token default_token;
+  Token *token = callback->GetTokenBuffer();
+  if (token == nullptr) {
+    token = &default_token;
+  }
+  // The rest of the tokens for the same pair of keys are skipped.
+  const Entry *skipped = nullptr;
+  for (const Entry &entry : entries->entries) {
+    const StringPiece prefix = key.substr(0, entry.key_length);
+    const StringPiece actual_key(entries->strings.data() + entry.offset,
+                                 entry.actual_key_length);
+    if (skipped != nullptr) {
+      if (skipped->key_length == entry.key_length &&
+          StringPiece(entries->strings.data() + skipped->offset,
+                      skipped->actual_key_length) == actual_key) {
+        continue;
+      }
+      skipped = nullptr;
+    }
+    switch (callback->OnKey(prefix)) {
+      case DictionaryInterface::Callback::TRAVERSE_DONE:
+        return;
+      case DictionaryInterface::Callback::TRAVERSE_CONTINUE:
+        break;
+      default:
+        continue;
+    }
+    switch (callback->OnActualKey(prefix, actual_key, entry.is_expanded)) {
+      case DictionaryInterface::Callback::TRAVERSE_DONE:
+        return;
+      case DictionaryInterface::Callback::TRAVERSE_CONTINUE:
+        break;
+      default:
+        continue;
+    }
+    actual_key.CopyToString(&token->key);
+    token->value.assign(entries->strings.data() + entry.offset +
+                            entry.actual_key_length,
+                        entry.value_length);
+    token->cost = entry.cost;
+    token->lid = entry.lid;
+    token->rid = entry.rid;
+    token->attributes = entry.attributes;
+    switch (callback->OnToken(prefix, actual_key, *token)) {
+      case DictionaryInterface::Callback::TRAVERSE_DONE:
+        return;
+      case DictionaryInterface::Callback::TRAVERSE_CONTINUE:
+        break;
+      default:
+        skipped = &entry;
+        break;
+    }
+  }
+}
+
+void PrefixLookupCache::Clear() {
+  scoped_lock l(&mutex_);
+  ClearInternal();
+}
+
+size_t PrefixLookupCache::hit_count() const {
+  scoped_lock l(&mutex_);
+  return hit_count_;
+}
+
+size_t PrefixLookupCache::miss_count() const {
+  scoped_lock l(&mutex_);
+  return miss_count_;
+}
+
+std::shared_ptr<const PrefixLookupCache::Entries> PrefixLookupCache::Lookup(
+    const string &cache_key, uint64 generation) {
+  scoped_lock l(&mutex_);
+  if (generation != generation_) {
+    VLOG(1) << "Dictionary is updated; clearing the prefix lookup cache";
+    ClearInternal();
+    generation_ = generation;
+  }
+  const std::shared_ptr<const Entries> *entries = cache_.Lookup(cache_key);
+  if (entries == nullptr) {
+    ++miss_count_;
+    return nullptr;
+  }
+  ++hit_count_;
+  return *entries;
+}
+
+void PrefixLookupCache::Insert(const string &cache_key, uint64 generation,
+                               std::shared_ptr<const Entries> entries) {
+  scoped_lock l(&mutex_);
+  if (generation != generation_) {
+    return;
+  }
+  cache_.Insert(cache_key, std::move(entries));
+}
+
+void PrefixLookupCache::ClearInternal() {
+  // LRUCache keeps the values of erased elements, so release them here.
+  for (auto *element = cache_.MutableHead(); element != nullptr;
+       element = element->next) {
+    element->value.reset();
+  }
+  cache_.Clear();
+}
+
+}  // namespace mozc
@@ -0,0 +1,119 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Cache of dictionary prefix lookups shared by the conversions of an engine.
+
+#ifndef MOZC_CONVERTER_PREFIX_LOOKUP_CACHE_H_
+#define MOZC_CONVERTER_PREFIX_LOOKUP_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
+#include "request/conversion_request.h"
+#include "storage/lru_cache.h"
+
+namespace mozc {
+
+// Keeps the decoded results of DictionaryInterface::LookupPrefix() for
+// recently looked up keys.  Different sessions and repeated conversions of the
+// same input, e.g., resizing segments, look up the same key substrings again
+// and again; replaying the cached tokens saves decoding them from the
+// dictionaries.  All methods are thread-safe.
+//
+// The results are tagged with the generation of the dictionary (see
+// DictionaryInterface::GetGeneration()), and all of them are discarded when
+// the generation changes.
+class PrefixLookupCache {
+ public:
+  explicit PrefixLookupCache(size_t max_entries);
+  ~PrefixLookupCache();
+
+  // Runs dictionary.LookupPrefix(key, request, callback).  The tokens are
+  // passed to the callback in the same order as the dictionary does, but
+  // OnKey() and OnActualKey() are called back for each token, and
+  // TRAVERSE_CULL is handled as TRAVERSE_NEXT_KEY.  The whole result of the
+  // dictionary is cached regardless of what the callback returns.
+  void LookupPrefix(const dictionary::DictionaryInterface &dictionary,
+                    StringPiece key,
+                    const ConversionRequest &request,
+                    dictionary::DictionaryInterface::Callback *callback);
+
+  // Discards all the cached results.
+  void Clear();
+
+  size_t hit_count() const;
+  size_t miss_count() const;
+
+ private:
+  // Tokens found by a lookup.  The keys and values of the tokens are stored in
+  // one string to keep the entries compact.
+  struct Entry {
+    uint16 key_length;  // Length of the prefix of the lookup key.
+    uint16 actual_key_length;
+    uint16 value_length;
+    bool is_expanded;
+    dictionary::Token::AttributesBitfield attributes;
+    uint32 offset;  // Offset of the actual key, followed by the value.
+    int32 cost;
+    uint16 lid;
+    uint16 rid;
+  };
+  struct Entries {
+    std::vector<Entry> entries;
+    string strings;
+  };
+
+  class EntryCollector;
+
+  // Returns the cached entries for |cache_key|, or nullptr if there is none.
+  std::shared_ptr<const Entries> Lookup(const string &cache_key,
+                                        uint64 generation);
+  void Insert(const string &cache_key, uint64 generation,
+              std::shared_ptr<const Entries> entries);
+  void ClearInternal();
+
+  mutable Mutex mutex_;
+  storage::LRUCache<string, std::shared_ptr<const Entries>> cache_;
+  uint64 generation_;
+  size_t hit_count_;
+  size_t miss_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrefixLookupCache);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_PREFIX_LOOKUP_CACHE_H_
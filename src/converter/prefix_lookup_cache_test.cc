@@ -0,0 +1,240 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/prefix_lookup_cache.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_mock.h"
+#include "dictionary/dictionary_test_util.h"
+#include "dictionary/dictionary_token.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+using dictionary::CollectTokenCallback;
+using dictionary::DictionaryInterface;
+using dictionary::DictionaryMock;
+using dictionary::Token;
+
+// Counts prefix lookups and reports the generation set by tests.
+class CountingDictionary : public DictionaryMock {
+ public:
+  CountingDictionary() : generation_(0), lookup_count_(0) {}
+
+  void LookupPrefix(StringPiece key,
+                    const ConversionRequest &conversion_request,
+                    Callback *callback) const override {
+    ++lookup_count_;
+    DictionaryMock::LookupPrefix(key, conversion_request, callback);
+  }
+
+  uint64 GetGeneration() const override { return generation_; }
+
+  void set_generation(uint64 generation) { generation_ = generation; }
+  int lookup_count() const { return lookup_count_; }
+
+ private:
+  uint64 generation_;
+  mutable int lookup_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingDictionary);
+};
+
+// Skips the keys shorter than the given length and stops after the given
+// number of tokens.
+class LimitedCollectTokenCallback : public CollectTokenCallback {
+ public:
+  LimitedCollectTokenCallback(size_t min_key_length, size_t limit)
+      : min_key_length_(min_key_length), limit_(limit) {}
+
+  ResultType OnKey(StringPiece key) override {
+    return key.size() < min_key_length_ ? TRAVERSE_NEXT_KEY
+                                         : TRAVERSE_CONTINUE;
+  }
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    CollectTokenCallback::OnToken(key, actual_key, token);
+    return tokens().size() < limit_ ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
+  }
+
+ private:
+  const size_t min_key_length_;
+  const size_t limit_;
+};
+
+class PrefixLookupCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dictionary_.AddLookupPrefix("か", "か", "蚊", Token::NONE);
+    dictionary_.AddLookupPrefix("か", "か", "課", Token::NONE);
+    dictionary_.AddLookupPrefix("かい", "かい", "会", Token::NONE);
+    dictionary_.AddLookupPrefix("かいぎ", "かいぎ", "会議", Token::NONE);
+    convreq_.set_request(&request_);
+    convreq_.set_config(&config_);
+  }
+
+  // Returns the values of the tokens looked up through |cache|.
+  std::vector<string> Lookup(PrefixLookupCache *cache, const string &key,
+                             DictionaryInterface::Callback *callback) {
+    cache->LookupPrefix(dictionary_, key, convreq_, callback);
+    return GetValues(*static_cast<CollectTokenCallback *>(callback));
+  }
+
+  static std::vector<string> GetValues(const CollectTokenCallback &callback) {
+    std::vector<string> values;
+    for (const Token &token : callback.tokens()) {
+      values.push_back(token.value);
+    }
+    return values;
+  }
+
+  CountingDictionary dictionary_;
+  commands::Request request_;
+  config::Config config_;
+  ConversionRequest convreq_;
+};
+
+TEST_F(PrefixLookupCacheTest, ReplaysCachedTokens) {
+  PrefixLookupCache cache(10);
+  CollectTokenCallback expected;
+  dictionary_.LookupPrefix("かいぎ", convreq_, &expected);
+  ASSERT_EQ(1, dictionary_.lookup_count());
+
+  for (int i = 0; i < 3; ++i) {
+    CollectTokenCallback actual;
+    cache.LookupPrefix(dictionary_, "かいぎ", convreq_, &actual);
+    ASSERT_EQ(expected.tokens().size(), actual.tokens().size());
+    for (size_t j = 0; j < expected.tokens().size(); ++j) {
+      EXPECT_TOKEN_EQ(expected.tokens()[j], actual.tokens()[j]);
+    }
+  }
+  EXPECT_EQ(2, dictionary_.lookup_count());
+  EXPECT_EQ(2, cache.hit_count());
+  EXPECT_EQ(1, cache.miss_count());
+}
+
+TEST_F(PrefixLookupCacheTest, HonorsCallbackResults) {
+  PrefixLookupCache cache(10);
+  {
+    CollectTokenCallback callback;
+    cache.LookupPrefix(dictionary_, "かいぎ", convreq_, &callback);
+  }
+  {
+    // Keys shorter than "かい" are skipped.
+    LimitedCollectTokenCallback callback(strlen("かい"), 10);
+    const std::vector<string> expected = {"会", "会議"};
+    EXPECT_EQ(expected, Lookup(&cache, "かいぎ", &callback));
+  }
+  {
+    LimitedCollectTokenCallback callback(0, 3);
+    const std::vector<string> expected = {"蚊", "課", "会"};
+    EXPECT_EQ(expected, Lookup(&cache, "かいぎ", &callback));
+  }
+  EXPECT_EQ(1, dictionary_.lookup_count());
+}
+
+TEST_F(PrefixLookupCacheTest, KeysAreDistinguishedByRequest) {
+  PrefixLookupCache cache(10);
+  CollectTokenCallback callback;
+  cache.LookupPrefix(dictionary_, "かい", convreq_, &callback);
+  cache.LookupPrefix(dictionary_, "かいぎ", convreq_, &callback);
+  EXPECT_EQ(2, dictionary_.lookup_count());
+
+  config_.set_use_spelling_correction(!config_.use_spelling_correction());
+  cache.LookupPrefix(dictionary_, "かい", convreq_, &callback);
+  EXPECT_EQ(3, dictionary_.lookup_count());
+
+  request_.set_kana_modifier_insensitive_conversion(true);
+  config_.set_use_kana_modifier_insensitive_conversion(true);
+  cache.LookupPrefix(dictionary_, "かい", convreq_, &callback);
+  EXPECT_EQ(4, dictionary_.lookup_count());
+
+  cache.LookupPrefix(dictionary_, "かい", convreq_, &callback);
+  EXPECT_EQ(4, dictionary_.lookup_count());
+}
+
+TEST_F(PrefixLookupCacheTest, InvalidatedByGeneration) {
+  PrefixLookupCache cache(10);
+  {
+    CollectTokenCallback callback;
+    const std::vector<string> expected = {"蚊", "課", "会"};
+    EXPECT_EQ(expected, Lookup(&cache, "かい", &callback));
+  }
+
+  dictionary_.AddLookupPrefix("かい", "かい", "貝", Token::NONE);
+  {
+    // The stale result is returned while the generation stays the same.
+    CollectTokenCallback callback;
+    const std::vector<string> expected = {"蚊", "課", "会"};
+    EXPECT_EQ(expected, Lookup(&cache, "かい", &callback));
+  }
+
+  dictionary_.set_generation(1);
+  {
+    CollectTokenCallback callback;
+    const std::vector<string> expected = {"蚊", "課", "会", "貝"};
+    EXPECT_EQ(expected, Lookup(&cache, "かい", &callback));
+  }
+  EXPECT_EQ(2, dictionary_.lookup_count());
+}
+
+TEST_F(PrefixLookupCacheTest, EvictsLeastRecentlyUsedKeys) {
+  PrefixLookupCache cache(2);
+  CollectTokenCallback callback;
+  cache.LookupPrefix(dictionary_, "か", convreq_, &callback);
+  cache.LookupPrefix(dictionary_, "かい", convreq_, &callback);
+  cache.LookupPrefix(dictionary_, "か", convreq_, &callback);
+  cache.LookupPrefix(dictionary_, "かいぎ", convreq_, &callback);
+  EXPECT_EQ(3, dictionary_.lookup_count());
+
+  // "かい" is evicted.
+  cache.LookupPrefix(dictionary_, "か", convreq_, &callback);
+  EXPECT_EQ(3, dictionary_.lookup_count());
+  cache.LookupPrefix(dictionary_, "かい", convreq_, &callback);
+  EXPECT_EQ(4, dictionary_.lookup_count());
+
+  cache.Clear();
+  cache.LookupPrefix(dictionary_, "か", convreq_, &callback);
+  EXPECT_EQ(5, dictionary_.lookup_count());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -54,6 +54,7 @@
       '<(platform_data_dir)/dictionary09.txt',
       '<(platform_data_dir)/reading_correction.tsv',
     ],
+    'build_reverse_lookup_index': 'false',
     # Hex-escaped string of "\xEFMOZC\r\n"
     'magic_number': "\\xEF\\x4D\\x4F\\x5A\\x43\\x0D\\x0A",
     'mozc_data_varname': 'kCrosMozcDataSet',
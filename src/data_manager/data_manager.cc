@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <ostream>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/serialized_string_array.h"
 #include "base/stl_util.h"
@@ -41,6 +42,10 @@
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/segmenter_data.pb.h"
 
+DEFINE_bool(prefetch_data_set, false,
+            "Reads ahead the sections of the data set file used by every "
+            "conversion when the file is mapped.");
+
 namespace mozc {
 namespace {
 
@@ -385,7 +390,27 @@ DataManager::Status DataManager::InitFromFile(const string &path,
     return Status::MMAP_FAILURE;
   }
   const StringPiece data(mmap_.begin(), mmap_.size());
-  return InitFromArray(data, magic);
+  const Status status = InitFromArray(data, magic);
+  if (status != Status::OK) {
+    return status;
+  }
+  if (FLAGS_prefetch_data_set) {
+    PrefetchHotSections();
+  }
+  return Status::OK;
+}
+
+void DataManager::PrefetchHotSections() const {
+  const StringPiece sections[] = {
+      dictionary_data_, connection_data_, boundary_data_, segmenter_ltable_,
+      segmenter_rtable_, segmenter_bitarray_,
+  };
+  for (const StringPiece &section : sections) {
+    if (!Mmap::MaybePrefetch(section.data(), section.size())) {
+      VLOG(1) << "Prefetching is not supported";
+      return;
+    }
+  }
 }
 
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
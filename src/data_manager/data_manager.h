@@ -73,9 +73,17 @@ class DataManager : public DataManagerInterface {
 
   // The same as above InitFromArray() but the data is loaded using mmap, which
   // is owned in this instance.
+  // The sections used by the first conversion are prefetched if
+  // --prefetch_data_set is set.
   Status InitFromFile(const string &path);
   Status InitFromFile(const string &path, StringPiece magic);
 
+  // Hints the kernel to read ahead the sections that every conversion uses,
+  // i.e., the system dictionary, the connection matrix and the segmenter
+  // tables, so that the first conversion doesn't fault them in page by page.
+  // See engine/first_conversion_benchmark.cc for the effect.
+  void PrefetchHotSections() const;
+
   // The same as above InitFromArray() but only parses data set for user pos
   // manager.  For mozc runtime modules, use InitFromArray() because this method
   // is only for build tools, e.g., rewriter/dictionary_generator.cc (some build
@@ -44,6 +44,7 @@
     'dictionary_files': [
       '<(platform_data_dir)/dictionary.txt',
     ],
+    'build_reverse_lookup_index': 'false',
     'magic_number': '\\x4D\\x4F\\x43\\x4B',  # MOCK
     'mozc_data_varname': 'kMockMozcDataSet',
     'out_mozc_data': 'mock_mozc.data',
@@ -60,6 +60,50 @@
         },
       ],
     },
+    {
+      # Connection data with 1-byte costs, which the mock data set doesn't
+      # use, for converter/connector_test.cc.
+      'target_name': 'gen_1byte_connection_data_for_test',
+      'type': 'none',
+      'toolsets': ['host'],
+      'dependencies': [
+        'mock_data_manager.gyp:gen_connection_single_column_txt_for_mock#host',
+      ],
+      'actions': [
+        {
+          'action_name': 'gen_1byte_connection_data_for_test',
+          'variables': {
+            'text_connection_file': '<(gen_out_dir)/connection_single_column.txt',
+            'id_file': '../../data/test/dictionary/id.def',
+            'special_pos_file': '../../data/rules/special_pos.def',
+          },
+          'inputs': [
+            '<(text_connection_file)',
+            '<(id_file)',
+            '<(special_pos_file)',
+          ],
+          'outputs': [
+            '<(gen_out_dir)/connection_1byte.data',
+          ],
+          'action': [
+            'python', '../../data_manager/gen_connection_data.py',
+            '--text_connection_file',
+            '<(text_connection_file)',
+            '--id_file',
+            '<(id_file)',
+            '--special_pos_file',
+            '<(special_pos_file)',
+            '--binary_output_file',
+            '<@(_outputs)',
+            '--target_compiler',
+            '<(compiler_target)',
+            '--use_1byte_cost',
+            'true',
+          ],
+          'message': 'Generating <(gen_out_dir)/connection_1byte.data',
+        },
+      ],
+    },
     {
       'target_name': 'install_test_connection_txt',
       'type': 'none',
@@ -175,6 +175,8 @@
         '../config/config.gyp:config_handler',
         '../protocol/protocol.gyp:config_proto',
         '../protocol/protocol.gyp:user_dictionary_storage_proto',
+        '../storage/louds/louds.gyp:louds_trie',
+        '../storage/louds/louds.gyp:louds_trie_builder',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'gen_pos_map#host',
         'pos_matcher',
@@ -29,7 +29,9 @@
 
 #include "dictionary/dictionary_impl.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/string_piece.h"
@@ -49,21 +51,44 @@ DictionaryImpl::DictionaryImpl(
     DictionaryInterface *user_dictionary,
     const SuppressionDictionary *suppression_dictionary,
     const POSMatcher *pos_matcher)
+    : DictionaryImpl(system_dictionary, value_dictionary, user_dictionary,
+                     suppression_dictionary, pos_matcher, true) {}
+
+DictionaryImpl::DictionaryImpl(
+    const DictionaryInterface *system_dictionary,
+    const DictionaryInterface *value_dictionary,
+    DictionaryInterface *user_dictionary,
+    const SuppressionDictionary *suppression_dictionary,
+    const POSMatcher *pos_matcher,
+    bool own_dictionaries)
     : pos_matcher_(pos_matcher),
-      system_dictionary_(system_dictionary),
-      value_dictionary_(value_dictionary),
       user_dictionary_(user_dictionary),
       suppression_dictionary_(suppression_dictionary) {
   CHECK(pos_matcher_);
-  CHECK(system_dictionary_.get());
-  CHECK(value_dictionary_.get());
+  CHECK(system_dictionary);
+  CHECK(value_dictionary);
   CHECK(user_dictionary_);
   CHECK(suppression_dictionary_);
-  dics_.push_back(system_dictionary_.get());
-  dics_.push_back(value_dictionary_.get());
+  if (own_dictionaries) {
+    system_dictionary_.reset(system_dictionary);
+    value_dictionary_.reset(value_dictionary);
+  }
+  dics_.push_back(system_dictionary);
+  dics_.push_back(value_dictionary);
   dics_.push_back(user_dictionary_);
 }
 
+DictionaryImpl *DictionaryImpl::CreateWithSharedDictionaries(
+    const DictionaryInterface *system_dictionary,
+    const DictionaryInterface *value_dictionary,
+    DictionaryInterface *user_dictionary,
+    const SuppressionDictionary *suppression_dictionary,
+    const POSMatcher *pos_matcher) {
+  return new DictionaryImpl(system_dictionary, value_dictionary,
+                            user_dictionary, suppression_dictionary,
+                            pos_matcher, false);
+}
+
 DictionaryImpl::~DictionaryImpl() {
   dics_.clear();
 }
@@ -133,6 +158,10 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
     return callback_->OnToken(key, actual_key, token);
   }
 
+  virtual Token *GetTokenBuffer() {
+    return callback_->GetTokenBuffer();
+  }
+
  private:
   const bool use_spelling_correction_;
   const bool use_zip_code_conversion_;
@@ -163,6 +192,31 @@ void DictionaryImpl::LookupPredictive(
   }
 }
 
+void DictionaryImpl::LookupPredictiveBatch(
+    const std::vector<string> &keys,
+    const ConversionRequest &conversion_request,
+    const std::vector<Callback *> &callbacks) const {
+  DCHECK_EQ(keys.size(), callbacks.size());
+  std::vector<std::unique_ptr<CallbackWithFilter>> callbacks_with_filter;
+  std::vector<Callback *> filtered_callbacks;
+  callbacks_with_filter.reserve(callbacks.size());
+  filtered_callbacks.reserve(callbacks.size());
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    callbacks_with_filter.emplace_back(new CallbackWithFilter(
+        conversion_request.config().use_spelling_correction(),
+        conversion_request.config().use_zip_code_conversion(),
+        conversion_request.config().use_t13n_conversion(),
+        pos_matcher_,
+        suppression_dictionary_,
+        callbacks[i]));
+    filtered_callbacks.push_back(callbacks_with_filter.back().get());
+  }
+  for (size_t i = 0; i < dics_.size(); ++i) {
+    dics_[i]->LookupPredictiveBatch(keys, conversion_request,
+                                    filtered_callbacks);
+  }
+}
+
 void DictionaryImpl::LookupPrefix(
     StringPiece key,
     const ConversionRequest &conversion_request,
@@ -232,6 +286,15 @@ bool DictionaryImpl::Reload() {
   return user_dictionary_->Reload();
 }
 
+uint64 DictionaryImpl::GetGeneration() const {
+  // The suppression dictionary is updated together with the user dictionary.
+  uint64 generation = 0;
+  for (size_t i = 0; i < dics_.size(); ++i) {
+    generation += dics_[i]->GetGeneration();
+  }
+  return generation;
+}
+
 void DictionaryImpl::PopulateReverseLookupCache(StringPiece str) const {
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->PopulateReverseLookupCache(str);
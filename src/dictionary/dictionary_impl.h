@@ -59,6 +59,17 @@ class DictionaryImpl : public DictionaryInterface {
                  const SuppressionDictionary *suppression_dictionary,
                  const POSMatcher *pos_matcher);
 
+  // Same as the above constructor but the system and value dictionaries are
+  // not owned by the returned instance.  This is used to share read-only
+  // dictionaries among multiple instances that have different user
+  // dictionaries.
+  static DictionaryImpl *CreateWithSharedDictionaries(
+      const DictionaryInterface *system_dictionary,
+      const DictionaryInterface *value_dictionary,
+      DictionaryInterface *user_dictionary,
+      const SuppressionDictionary *suppression_dictionary,
+      const POSMatcher *pos_matcher);
+
   virtual ~DictionaryImpl();
 
   virtual bool HasKey(StringPiece key) const;
@@ -66,6 +77,10 @@ class DictionaryImpl : public DictionaryInterface {
   virtual void LookupPredictive(StringPiece key,
                                 const ConversionRequest &conversion_request,
                                 Callback *callback) const;
+  virtual void LookupPredictiveBatch(
+      const std::vector<string> &keys,
+      const ConversionRequest &conversion_request,
+      const std::vector<Callback *> &callbacks) const;
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &conversion_request,
                             Callback *callback) const;
@@ -82,6 +97,7 @@ class DictionaryImpl : public DictionaryInterface {
                              const ConversionRequest &conversion_request,
                              string *comment) const;
   virtual bool Reload();
+  virtual uint64 GetGeneration() const;
   virtual void PopulateReverseLookupCache(StringPiece str) const;
   virtual void ClearReverseLookupCache() const;
 
@@ -93,10 +109,18 @@ class DictionaryImpl : public DictionaryInterface {
     EXACT,
   };
 
+  DictionaryImpl(const DictionaryInterface *system_dictionary,
+                 const DictionaryInterface *value_dictionary,
+                 DictionaryInterface *user_dictionary,
+                 const SuppressionDictionary *suppression_dictionary,
+                 const POSMatcher *pos_matcher,
+                 bool own_dictionaries);
+
   // Used to check POS IDs.
   const POSMatcher *pos_matcher_;
 
-  // Main three dictionaries.
+  // Main three dictionaries.  The system and value dictionaries are null if
+  // they are shared with other instances.
   std::unique_ptr<const DictionaryInterface> system_dictionary_;
   std::unique_ptr<const DictionaryInterface> value_dictionary_;
   DictionaryInterface *user_dictionary_;
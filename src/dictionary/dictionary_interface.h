@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/logging.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "dictionary/dictionary_token.h"
@@ -97,13 +98,25 @@ class DictionaryInterface {
       return TRAVERSE_CONTINUE;
     }
 
-    // Called back when a token is decoded.
+    // Called back when a token is decoded.  The token is valid only during
+    // the call; dictionaries may decode the next token into the same
+    // instance, so copy it if it needs to be kept.
     virtual ResultType OnToken(StringPiece key,
                                StringPiece expanded_key,
                                const Token &token_info) {
       return TRAVERSE_CONTINUE;
     }
 
+    // Returns a token into which dictionaries may decode the tokens passed to
+    // OnToken().  A callback used for many lookups in a row can return a
+    // long-lived instance so that the key and value buffers are reused across
+    // lookups instead of being allocated for each of them.  The instance must
+    // not be touched during the traversal.  Returns nullptr by default, in
+    // which case dictionaries use their own buffer.
+    virtual Token *GetTokenBuffer() {
+      return nullptr;
+    }
+
    protected:
     Callback() {}
   };
@@ -120,6 +133,20 @@ class DictionaryInterface {
                                 const ConversionRequest &conversion_request,
                                 Callback *callback) const = 0;
 
+  // Looks up |keys| predictively at once.  The result is equivalent to
+  // calling LookupPredictive(keys[i], conversion_request, callbacks[i]) for
+  // each i in order, but implementations can share the traversal among keys
+  // having common prefixes, e.g., type-corrected variants of the same input.
+  virtual void LookupPredictiveBatch(
+      const std::vector<string> &keys,
+      const ConversionRequest &conversion_request,
+      const std::vector<Callback *> &callbacks) const {
+    DCHECK_EQ(keys.size(), callbacks.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      LookupPredictive(keys[i], conversion_request, callbacks[i]);
+    }
+  }
+
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &conversion_request,
                             Callback *callback) const = 0;
@@ -153,6 +180,12 @@ class DictionaryInterface {
   // Reload dictionary data from local disk.
   virtual bool Reload() { return true; }
 
+  // Returns a number that changes whenever lookup results may change, e.g.,
+  // when a user dictionary is edited or reloaded.  Lookup results can be
+  // reused while the number stays the same.  Dictionaries whose contents
+  // never change return 0.
+  virtual uint64 GetGeneration() const { return 0; }
+
  protected:
   // Do not allow instantiation
   DictionaryInterface() {}
@@ -99,6 +99,25 @@
         'test_size': 'small',
       },
     },
+    {
+      # Lookup benchmark of UserDictionary.  Not run as a test.
+      'target_name': 'user_dictionary_benchmark',
+      'type': 'executable',
+      'sources': [
+        'user_dictionary_benchmark.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
+        '../protocol/protocol.gyp:user_dictionary_storage_proto',
+        '../request/request.gyp:conversion_request',
+        '../testing/testing.gyp:googletest_lib',
+        'dictionary_base.gyp:pos_matcher',
+        'dictionary_base.gyp:suppression_dictionary',
+        'dictionary_base.gyp:user_dictionary',
+        'dictionary_base.gyp:user_pos',
+      ],
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'dictionary_all_test',
@@ -42,16 +42,23 @@
 #include "base/flags.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/singleton.h"
 #include "base/util.h"
 #include "data_manager/data_manager.h"
 #include "dictionary/dictionary_token.h"
+#include "dictionary/file/codec_factory.h"
 #include "dictionary/pos_matcher.h"
+#include "dictionary/system/aligned_codec.h"
+#include "dictionary/system/codec_interface.h"
 #include "dictionary/system/system_dictionary_builder.h"
 #include "dictionary/text_dictionary_loader.h"
 
 DEFINE_string(input, "", "space separated input text files");
 DEFINE_string(user_pos_manager_data, "", "user pos manager data");
 DEFINE_string(output, "", "output binary file");
+DEFINE_bool(use_aligned_codec, false,
+            "Encode tokens with SystemDictionaryAlignedCodec, which decodes "
+            "faster but makes the dictionary larger.");
 
 namespace mozc {
 namespace {
@@ -113,7 +120,12 @@ int main(int argc, char **argv) {
   mozc::dictionary::TextDictionaryLoader loader(pos_matcher);
   loader.Load(system_dictionary_input, reading_correction_input);
 
-  mozc::dictionary::SystemDictionaryBuilder builder;
+  const mozc::dictionary::SystemDictionaryCodecInterface *codec =
+      FLAGS_use_aligned_codec ?
+      mozc::Singleton<mozc::dictionary::SystemDictionaryAlignedCodec>::get() :
+      mozc::dictionary::SystemDictionaryCodecFactory::GetCodec();
+  mozc::dictionary::SystemDictionaryBuilder builder(
+      codec, mozc::dictionary::DictionaryFileCodecFactory::GetCodec());
   builder.BuildFromTokens(loader.tokens());
 
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
@@ -0,0 +1,523 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/system/aligned_codec.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/words_info.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+//// Constants for section name ////
+const char kTokensSectionName[] = "at";
+
+//// Constants for key ////
+// Hiragana, middle dot and prolonged sound mark are swapped with control
+// codes and alphabets.  See EncodeDecodeKeyImpl() in codec.cc.
+const uint8 kKeyHiraganaUtf8Lead = 0xe3;
+
+//// Constants for value ////
+// The layout is the same as SystemDictionaryCodec.  See EncodeValue() in
+// codec.cc for the details.
+const uint8 kValueCharMarkAscii = 0xfc;
+const uint8 kValueCharMarkXX00 = 0xfd;
+const uint8 kValueCharMarkOtherUCS2 = 0xfe;
+const uint8 kValueCharMarkUCS4 = 0xff;
+const uint8 kValueCharMarkUCS4Middle0 = 0x80;
+const uint8 kValueCharMarkUCS4Right0 = 0x40;
+const uint8 kValueCharMarkUCS4LeftMask = 0x1f;
+const int kValueKanjiOffset = 0x01;
+const int kValueHiraganaOffset = 0x4b;
+const int kValueKatakanaOffset = 0x9f;
+
+//// Token layout ////
+// Each token starts with a flags byte followed by byte-aligned little endian
+// fields, in this order:
+//   POS:   1 byte (frequent POS), 2 bytes (lid == rid), 4 bytes (lid, rid)
+//          or nothing (same as the previous token)
+//   Cost:  1 byte (upper 8 bits of small cost) or 2 bytes
+//   Value: 3 bytes (id in value trie) or nothing
+// The flags byte:
+// 7 kLastTokenFlag
+// 6  kSpellingCorrectionFlag
+// 5   <pos encoding(high)>
+// 4    <pos encoding(low)>
+// 3     <value encoding(high)>
+// 2      <value encoding(low)>
+// 1       kSmallCostFlag
+// 0        <reserved(unused)>
+// The first token can't have the same POS and value as the previous token, so
+// its flags byte never becomes the termination flag 0xff.
+const uint8 kTokenTerminationFlag = 0xff;
+const uint8 kLastTokenFlag = 0x80;
+const uint8 kSpellingCorrectionFlag = 0x40;
+const int kPosTypeShift = 4;
+const uint8 kFrequentPosType = 0x00;
+const uint8 kMonoPosType = 0x01;
+const uint8 kFullPosType = 0x02;
+const uint8 kSameAsPrevPosType = 0x03;
+const int kValueTypeShift = 2;
+const uint8 kNormalValueType = 0x00;
+const uint8 kAsIsHiraganaValueType = 0x01;
+const uint8 kAsIsKatakanaValueType = 0x02;
+const uint8 kSameAsPrevValueType = 0x03;
+const uint8 kSmallCostFlag = 0x02;
+
+// Sizes of the POS and value fields indexed by their types.
+const int kPosFieldSize[] = {1, 2, 4, 0};
+const int kValueFieldSize[] = {3, 0, 0, 0};
+const TokenInfo::PosType kPosTypes[] = {
+  TokenInfo::FREQUENT_POS, TokenInfo::DEFAULT_POS, TokenInfo::DEFAULT_POS,
+  TokenInfo::SAME_AS_PREV_POS,
+};
+const TokenInfo::ValueType kValueTypes[] = {
+  TokenInfo::DEFAULT_VALUE, TokenInfo::AS_IS_HIRAGANA,
+  TokenInfo::AS_IS_KATAKANA, TokenInfo::SAME_AS_PREV_VALUE,
+};
+
+const uint16 kPosMax = 0xffff;
+const int kCostMax = 0x7fff;
+const uint32 kValueTrieIdMax = 0xffffff;
+
+inline int GetPosType(uint8 flags) {
+  return (flags >> kPosTypeShift) & 0x03;
+}
+
+inline int GetValueType(uint8 flags) {
+  return (flags >> kValueTypeShift) & 0x03;
+}
+
+// Returns the offset of the cost field and the value field.
+inline int GetCostOffset(uint8 flags) {
+  return 1 + kPosFieldSize[GetPosType(flags)];
+}
+
+inline int GetValueOffset(uint8 flags) {
+  return GetCostOffset(flags) + ((flags & kSmallCostFlag) ? 1 : 2);
+}
+
+inline int GetTokenSize(uint8 flags) {
+  return GetValueOffset(flags) + kValueFieldSize[GetValueType(flags)];
+}
+
+inline uint16 ReadUint16(const uint8 *ptr) {
+  return ptr[0] | (ptr[1] << 8);
+}
+
+inline uint32 ReadUint24(const uint8 *ptr) {
+  return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16);
+}
+
+inline void AppendUint16(uint16 value, string *output) {
+  output->push_back(value & 0xff);
+  output->push_back(value >> 8);
+}
+
+// Returns the number of bytes of the UTF-8 sequence starting with |lead|.
+inline int GetUtf8Length(uint8 lead) {
+  if (lead < 0xe0) {
+    return 2;
+  }
+  return lead < 0xf0 ? 3 : 4;
+}
+
+// Returns the byte which a hiragana, middle dot or prolonged sound mark in
+// |utf8| is swapped with in encoded keys, or 0 for other characters.
+inline uint8 GetSwappedKeyByte(const uint8 *utf8) {
+  if (utf8[0] != kKeyHiraganaUtf8Lead) {
+    return 0;
+  }
+  const uint32 c = 0x3000 | ((utf8[1] & 0x3f) << 6) | (utf8[2] & 0x3f);
+  if (c >= 0x3041 && c <= 0x305f) {
+    return c - (0x3041 - 0x0001);
+  }
+  if (c >= 0x3060 && c <= 0x3095) {
+    return c - (0x3060 - 0x0040);
+  }
+  if (c >= 0x30fb && c <= 0x30fc) {
+    return c - (0x30fb - 0x0076);
+  }
+  return 0;
+}
+
+}  // namespace
+
+SystemDictionaryAlignedCodec::SystemDictionaryAlignedCodec() {
+  memset(key_table_, 0, sizeof(key_table_));
+  memset(key_length_delta_table_, 0, sizeof(key_length_delta_table_));
+  for (uint32 b = 0x01; b < 0x80; ++b) {
+    uint32 c = b;
+    if (b <= 0x1f) {
+      c = b + (0x3041 - 0x0001);
+    } else if (b >= 0x40 && b <= 0x75) {
+      c = b + (0x3060 - 0x0040);
+    } else if (b >= 0x76 && b <= 0x77) {
+      c = b + (0x30fb - 0x0076);
+    }
+    char buf[7];
+    key_table_[b].length = Util::UCS4ToUTF8(c, buf);
+    memcpy(key_table_[b].bytes, buf, key_table_[b].length);
+    key_length_delta_table_[b] = key_table_[b].length - 1;
+  }
+
+  memset(value_table_, 0, sizeof(value_table_));
+  for (uint32 b = kValueKanjiOffset; b < kValueHiraganaOffset; ++b) {
+    // U+4E00 + ((b - 1) << 8) + the second byte, which is always 3 bytes in
+    // UTF-8.  The second byte only affects the lower 8 bits.
+    const uint32 base = 0x4e00 + ((b - kValueKanjiOffset) << 8);
+    value_table_[b].bytes[0] = 0xe0 | (base >> 12);
+    value_table_[b].bytes[1] = 0x80 | ((base >> 6) & 0x3c);
+  }
+  for (uint32 b = kValueHiraganaOffset; b < kValueCharMarkAscii; ++b) {
+    const uint32 c = (b < kValueKatakanaOffset) ?
+        0x3041 + b - kValueHiraganaOffset :
+        0x30a1 + b - kValueKatakanaOffset;
+    char buf[7];
+    value_table_[b].length = Util::UCS4ToUTF8(c, buf);
+    DCHECK_EQ(3, value_table_[b].length);
+    memcpy(value_table_[b].bytes, buf, 3);
+  }
+}
+
+SystemDictionaryAlignedCodec::~SystemDictionaryAlignedCodec() {}
+
+const string SystemDictionaryAlignedCodec::GetSectionNameForTokens() const {
+  return kTokensSectionName;
+}
+
+void SystemDictionaryAlignedCodec::DecodeKey(
+    const StringPiece src, string *dst) const {
+  DCHECK(dst);
+  // Each byte is decoded into 3 bytes at most.
+  const size_t dst_offset = dst->size();
+  dst->resize(dst_offset + src.size() * 3);
+  char *const begin = &(*dst)[dst_offset];
+  char *out = begin;
+  const uint8 *p = reinterpret_cast<const uint8 *>(src.data());
+  const uint8 *const end = p + src.size();
+  while (p < end) {
+    if (*p < 0x80) {
+      const CharEntry &entry = key_table_[*p];
+      memcpy(out, entry.bytes, 3);
+      out += entry.length;
+      ++p;
+      continue;
+    }
+    int length = GetUtf8Length(*p);
+    if (length > end - p) {
+      length = end - p;
+    }
+    const uint8 swapped = (length == 3) ? GetSwappedKeyByte(p) : 0;
+    if (swapped != 0) {
+      *out++ = swapped;
+    } else {
+      memcpy(out, p, length);
+      out += length;
+    }
+    p += length;
+  }
+  dst->resize(dst_offset + (out - begin));
+}
+
+size_t SystemDictionaryAlignedCodec::GetDecodedKeyLength(
+    const StringPiece src) const {
+  size_t size = src.size();
+  const uint8 *p = reinterpret_cast<const uint8 *>(src.data());
+  const uint8 *const end = p + src.size();
+  while (p < end) {
+    if (*p < 0x80) {
+      size += key_length_delta_table_[*p];
+      ++p;
+      continue;
+    }
+    const int length = GetUtf8Length(*p);
+    if (length == 3 && end - p >= 3 && GetSwappedKeyByte(p) != 0) {
+      size -= 2;
+    }
+    p += length;
+  }
+  return size;
+}
+
+void SystemDictionaryAlignedCodec::DecodeValue(
+    const StringPiece src, string *dst) const {
+  DCHECK(dst);
+  // Each byte is decoded into 3 bytes at most, and Util::UCS4ToUTF8() writes
+  // a trailing NUL.
+  const size_t dst_offset = dst->size();
+  dst->resize(dst_offset + src.size() * 3 + 1);
+  char *const begin = &(*dst)[dst_offset];
+  char *out = begin;
+  const uint8 *p = reinterpret_cast<const uint8 *>(src.data());
+  const uint8 *const end = p + src.size();
+  while (p < end) {
+    const uint8 lead = p[0];
+    const CharEntry &entry = value_table_[lead];
+    if (entry.length != 0) {
+      // Hiragana and katakana.
+      memcpy(out, entry.bytes, 3);
+      out += 3;
+      p += 1;
+      continue;
+    }
+    if (lead >= kValueKanjiOffset && lead < kValueHiraganaOffset) {
+      // Frequent kanji.
+      out[0] = entry.bytes[0];
+      out[1] = entry.bytes[1] | (p[1] >> 6);
+      out[2] = 0x80 | (p[1] & 0x3f);
+      out += 3;
+      p += 2;
+      continue;
+    }
+    char32 c = 0;
+    switch (lead) {
+      case kValueCharMarkAscii:
+        c = p[1];
+        p += 2;
+        break;
+      case kValueCharMarkXX00:
+        c = p[1] << 8;
+        p += 2;
+        break;
+      case kValueCharMarkOtherUCS2:
+        c = (p[1] << 8) | p[2];
+        p += 3;
+        break;
+      case kValueCharMarkUCS4: {
+        c = (p[1] & kValueCharMarkUCS4LeftMask) << 16;
+        int pos = 2;
+        if (!(p[1] & kValueCharMarkUCS4Middle0)) {
+          c |= p[pos++] << 8;
+        }
+        if (!(p[1] & kValueCharMarkUCS4Right0)) {
+          c |= p[pos++];
+        }
+        p += pos;
+        break;
+      }
+      default:
+        VLOG(1) << "should never come here";
+        p += 1;
+        break;
+    }
+    out += Util::UCS4ToUTF8(c, out);
+  }
+  dst->resize(dst_offset + (out - begin));
+}
+
+uint8 SystemDictionaryAlignedCodec::GetTokensTerminationFlag() const {
+  return kTokenTerminationFlag;
+}
+
+void SystemDictionaryAlignedCodec::EncodeTokens(
+    const std::vector<TokenInfo> &tokens, string *output) const {
+  DCHECK(output);
+  output->clear();
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    EncodeToken(tokens, i, output);
+  }
+  CHECK(static_cast<uint8>((*output)[0]) != GetTokensTerminationFlag());
+}
+
+void SystemDictionaryAlignedCodec::EncodeToken(
+    const std::vector<TokenInfo> &tokens, int index, string *output) const {
+  CHECK_LT(index, tokens.size());
+  const TokenInfo &token_info = tokens[index];
+  const Token *token = token_info.token;
+  CHECK(token);
+  if (token->lid > kPosMax || token->rid > kPosMax) {
+    // We can use LOG(FATAL) here, as this code runs in dictionary_builder.
+    LOG(FATAL) << "Too large pos id: lid " << token->lid
+               << ", rid " << token->rid;
+  }
+  CHECK_LE(token->cost, kCostMax) << "Assuming cost is within 15bits.";
+
+  uint8 pos_type = kFullPosType;
+  if (token_info.pos_type == TokenInfo::FREQUENT_POS) {
+    pos_type = kFrequentPosType;
+  } else if (token_info.pos_type == TokenInfo::SAME_AS_PREV_POS) {
+    CHECK_GT(index, 0) << "First token cannot become the SameAsPrevPos.";
+    pos_type = kSameAsPrevPosType;
+  } else if (token->lid == token->rid) {
+    pos_type = kMonoPosType;
+  }
+
+  uint8 value_type = kNormalValueType;
+  if (token_info.value_type == TokenInfo::SAME_AS_PREV_VALUE) {
+    CHECK_GT(index, 0) << "First token cannot become the SameAsPrevValue.";
+    value_type = kSameAsPrevValueType;
+  } else if (token_info.value_type == TokenInfo::AS_IS_HIRAGANA) {
+    value_type = kAsIsHiraganaValueType;
+  } else if (token_info.value_type == TokenInfo::AS_IS_KATAKANA) {
+    value_type = kAsIsKatakanaValueType;
+  }
+
+  uint8 flags = (pos_type << kPosTypeShift) | (value_type << kValueTypeShift);
+  if (index + 1 == tokens.size()) {
+    flags |= kLastTokenFlag;
+  }
+  if (token->attributes & Token::SPELLING_CORRECTION) {
+    flags |= kSpellingCorrectionFlag;
+  }
+  const bool small_cost =
+      (token_info.cost_type == TokenInfo::CAN_USE_SMALL_ENCODING);
+  if (small_cost) {
+    flags |= kSmallCostFlag;
+  }
+
+  const size_t token_begin = output->size();
+  output->push_back(flags);
+
+  switch (pos_type) {
+    case kFrequentPosType: {
+      const int id = token_info.id_in_frequent_pos_map;
+      CHECK_GE(id, 0);
+      CHECK_LE(id, 0xff);
+      output->push_back(id);
+      break;
+    }
+    case kMonoPosType: {
+      AppendUint16(token->lid, output);
+      break;
+    }
+    case kFullPosType: {
+      AppendUint16(token->lid, output);
+      AppendUint16(token->rid, output);
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (small_cost) {
+    output->push_back(token->cost >> 8);
+  } else {
+    AppendUint16(token->cost, output);
+  }
+
+  if (value_type == kNormalValueType) {
+    const uint32 id = token_info.id_in_value_trie;
+    if (id > kValueTrieIdMax) {
+      // We can use LOG(FATAL) here.
+      LOG(FATAL) << "Too large word trie (should be less than 2^24)\t" << id;
+    }
+    output->push_back(id & 0xff);
+    output->push_back((id >> 8) & 0xff);
+    output->push_back((id >> 16) & 0xff);
+  }
+  DCHECK_EQ(GetTokenSize(flags), output->size() - token_begin);
+}
+
+void SystemDictionaryAlignedCodec::DecodeTokens(
+    const uint8 *ptr, std::vector<TokenInfo> *tokens) const {
+  DCHECK(tokens);
+  int offset = 0;
+  while (true) {
+    int read_bytes = 0;
+    Token *token = new Token();
+    tokens->push_back(TokenInfo(token));
+    if (!DecodeToken(ptr + offset, &(tokens->back()), &read_bytes)) {
+      break;
+    }
+    DCHECK_GT(read_bytes, 0);
+    offset += read_bytes;
+  }
+}
+
+bool SystemDictionaryAlignedCodec::DecodeToken(
+    const uint8 *ptr, TokenInfo *token_info, int *read_bytes) const {
+  DCHECK(ptr);
+  DCHECK(token_info);
+  DCHECK(read_bytes);
+
+  const uint8 flags = ptr[0];
+  Token *token = token_info->token;
+  token->attributes = (flags & kSpellingCorrectionFlag) ?
+      Token::SPELLING_CORRECTION : Token::NONE;
+
+  const int pos_type = GetPosType(flags);
+  token_info->pos_type = kPosTypes[pos_type];
+  const uint8 *p = ptr + 1;
+  switch (pos_type) {
+    case kFrequentPosType:
+      token_info->id_in_frequent_pos_map = p[0];
+      break;
+    case kMonoPosType:
+      token->lid = token->rid = ReadUint16(p);
+      break;
+    case kFullPosType:
+      token->lid = ReadUint16(p);
+      token->rid = ReadUint16(p + 2);
+      break;
+    default:
+      break;
+  }
+  p += kPosFieldSize[pos_type];
+
+  if (flags & kSmallCostFlag) {
+    token->cost = p[0] << 8;
+    p += 1;
+  } else {
+    token->cost = ReadUint16(p);
+    p += 2;
+  }
+
+  const int value_type = GetValueType(flags);
+  token_info->value_type = kValueTypes[value_type];
+  if (value_type == kNormalValueType) {
+    token_info->id_in_value_trie = ReadUint24(p);
+    p += 3;
+  }
+
+  *read_bytes = p - ptr;
+  return !(flags & kLastTokenFlag);
+}
+
+bool SystemDictionaryAlignedCodec::ReadTokenForReverseLookup(
+    const uint8 *ptr, int *value_id, int *read_bytes) const {
+  DCHECK(ptr);
+  DCHECK(value_id);
+  DCHECK(read_bytes);
+  const uint8 flags = ptr[0];
+  *value_id = (GetValueType(flags) == kNormalValueType) ?
+      ReadUint24(ptr + GetValueOffset(flags)) : -1;
+  *read_bytes = GetTokenSize(flags);
+  return !(flags & kLastTokenFlag);
+}
+
+}  // namespace dictionary
+}  // namespace mozc
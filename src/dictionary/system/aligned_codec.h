@@ -0,0 +1,116 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// System dictionary codec whose token and string decoders are designed for
+// decoding speed rather than for size.
+
+#ifndef MOZC_DICTIONARY_SYSTEM_ALIGNED_CODEC_H_
+#define MOZC_DICTIONARY_SYSTEM_ALIGNED_CODEC_H_
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "dictionary/system/codec.h"
+
+namespace mozc {
+namespace dictionary {
+
+// A codec which encodes tokens into byte-aligned fields whose sizes are
+// determined by the flags byte alone, and which decodes keys and values with
+// per-byte lookup tables.  Key and value strings are encoded in the same
+// format as SystemDictionaryCodec, so only the token section differs.  The
+// token section has its own name, so SystemDictionary can tell which codec a
+// dictionary was built with.
+//
+// Compared with SystemDictionaryCodec, tokens take about one more byte each
+// because the value id and the POS ids are no longer packed into spare bits.
+class SystemDictionaryAlignedCodec : public SystemDictionaryCodec {
+ public:
+  SystemDictionaryAlignedCodec();
+  virtual ~SystemDictionaryAlignedCodec();
+
+  // Return section name for tokens array
+  virtual const string GetSectionNameForTokens() const;
+
+  // Decompress key string
+  virtual void DecodeKey(const StringPiece src, string *dst) const;
+
+  // Returns the length of decoded key string.
+  virtual size_t GetDecodedKeyLength(const StringPiece src) const;
+
+  // Decompress value string
+  virtual void DecodeValue(const StringPiece src, string *dst) const;
+
+  // Compress tokens
+  virtual void EncodeTokens(
+      const std::vector<TokenInfo> &tokens, string *output) const;
+
+  // Decompress tokens
+  virtual void DecodeTokens(const uint8 *ptr,
+                            std::vector<TokenInfo> *tokens) const;
+
+  // Decompress a token.
+  virtual bool DecodeToken(
+      const uint8 *ptr, TokenInfo *token_info, int *read_bytes) const;
+
+  // Read a token for reverse lookup
+  virtual bool ReadTokenForReverseLookup(
+      const uint8 *ptr, int *value_id, int *read_bytes) const;
+
+  virtual uint8 GetTokensTerminationFlag() const;
+
+ private:
+  // UTF-8 of the character represented by a byte.  |length| is 0 if the byte
+  // isn't decoded by the table alone.
+  struct CharEntry {
+    uint8 length;
+    char bytes[3];
+  };
+
+  void EncodeToken(
+      const std::vector<TokenInfo> &tokens, int index, string *output) const;
+
+  // Indexed by a byte of encoded keys below 0x80.
+  CharEntry key_table_[0x80];
+  // Difference of the decoded length from the encoded length for each byte
+  // of encoded keys below 0x80.
+  int8 key_length_delta_table_[0x80];
+  // Indexed by the first byte of encoded value characters.  For kanji, only
+  // the first two bytes are stored, which are completed by the second byte.
+  CharEntry value_table_[0x100];
+
+  DISALLOW_COPY_AND_ASSIGN(SystemDictionaryAlignedCodec);
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_SYSTEM_ALIGNED_CODEC_H_
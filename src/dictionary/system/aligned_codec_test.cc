@@ -0,0 +1,238 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/system/aligned_codec.h"
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/util.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/codec.h"
+#include "dictionary/system/words_info.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+class SystemDictionaryAlignedCodecTest : public ::testing::Test {
+ protected:
+  virtual void TearDown() {
+    ClearTokens(&source_tokens_);
+    ClearTokens(&decoded_tokens_);
+  }
+
+  static void ClearTokens(std::vector<TokenInfo> *tokens) {
+    for (size_t i = 0; i < tokens->size(); ++i) {
+      delete (*tokens)[i].token;
+    }
+    tokens->clear();
+  }
+
+  // Adds |size| tokens with random fields.
+  void InitRandomTokens(int size) {
+    for (int i = 0; i < size; ++i) {
+      TokenInfo token_info(new Token());
+      Token *token = token_info.token;
+      switch (Util::Random(i == 0 ? 3 : 4)) {
+        case 0:
+          token_info.pos_type = TokenInfo::FREQUENT_POS;
+          token_info.id_in_frequent_pos_map = Util::Random(256);
+          break;
+        case 1:
+          token->lid = token->rid = Util::Random(0x10000);
+          break;
+        case 2:
+          token->lid = Util::Random(0x10000);
+          token->rid = Util::Random(0x10000);
+          break;
+        default:
+          token_info.pos_type = TokenInfo::SAME_AS_PREV_POS;
+          break;
+      }
+      token->cost = Util::Random(0x8000);
+      if (Util::Random(2) == 0) {
+        token_info.cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
+      }
+      switch (Util::Random(i == 0 ? 3 : 4)) {
+        case 0:
+          token_info.value_type = TokenInfo::DEFAULT_VALUE;
+          token_info.id_in_value_trie = Util::Random(0x1000000);
+          break;
+        case 1:
+          token_info.value_type = TokenInfo::AS_IS_HIRAGANA;
+          break;
+        case 2:
+          token_info.value_type = TokenInfo::AS_IS_KATAKANA;
+          break;
+        default:
+          token_info.value_type = TokenInfo::SAME_AS_PREV_VALUE;
+          break;
+      }
+      if (Util::Random(2) == 0) {
+        token->attributes = Token::SPELLING_CORRECTION;
+      }
+      source_tokens_.push_back(token_info);
+    }
+  }
+
+  void CheckDecoded() const {
+    ASSERT_EQ(source_tokens_.size(), decoded_tokens_.size());
+    for (size_t i = 0; i < source_tokens_.size(); ++i) {
+      const TokenInfo &source = source_tokens_[i];
+      const TokenInfo &decoded = decoded_tokens_[i];
+      EXPECT_EQ(source.token->attributes, decoded.token->attributes);
+      EXPECT_EQ(source.pos_type, decoded.pos_type);
+      if (source.pos_type == TokenInfo::DEFAULT_POS) {
+        EXPECT_EQ(source.token->lid, decoded.token->lid);
+        EXPECT_EQ(source.token->rid, decoded.token->rid);
+      } else if (source.pos_type == TokenInfo::FREQUENT_POS) {
+        EXPECT_EQ(source.id_in_frequent_pos_map,
+                  decoded.id_in_frequent_pos_map);
+      }
+      if (source.cost_type == TokenInfo::CAN_USE_SMALL_ENCODING) {
+        // Same precision as SystemDictionaryCodec.
+        EXPECT_EQ(source.token->cost & 0xff00, decoded.token->cost);
+      } else {
+        EXPECT_EQ(source.token->cost, decoded.token->cost);
+      }
+      EXPECT_EQ(source.value_type, decoded.value_type);
+      if (source.value_type == TokenInfo::DEFAULT_VALUE) {
+        EXPECT_EQ(source.id_in_value_trie, decoded.id_in_value_trie);
+      }
+    }
+  }
+
+  SystemDictionaryCodec default_codec_;
+  SystemDictionaryAlignedCodec codec_;
+  std::vector<TokenInfo> source_tokens_;
+  std::vector<TokenInfo> decoded_tokens_;
+};
+
+TEST_F(SystemDictionaryAlignedCodecTest, SectionNames) {
+  // Only the token section differs from SystemDictionaryCodec.
+  EXPECT_EQ(default_codec_.GetSectionNameForKey(),
+            codec_.GetSectionNameForKey());
+  EXPECT_EQ(default_codec_.GetSectionNameForValue(),
+            codec_.GetSectionNameForValue());
+  EXPECT_EQ(default_codec_.GetSectionNameForPos(),
+            codec_.GetSectionNameForPos());
+  EXPECT_NE(default_codec_.GetSectionNameForTokens(),
+            codec_.GetSectionNameForTokens());
+}
+
+TEST_F(SystemDictionaryAlignedCodecTest, KeyCodec) {
+  for (char32 c = 0x01; c <= 0x10ffff; ++c) {
+    string original;
+    Util::UCS4ToUTF8(c, &original);
+    string encoded;
+    codec_.EncodeKey(original, &encoded);
+    string decoded;
+    codec_.DecodeKey(encoded, &decoded);
+    ASSERT_EQ(original, decoded) << "failed at: " << static_cast<uint32>(c);
+    ASSERT_EQ(default_codec_.GetDecodedKeyLength(encoded),
+              codec_.GetDecodedKeyLength(encoded))
+        << "failed at: " << static_cast<uint32>(c);
+  }
+
+  const string original = "きゃっと・かふぇー0-9abcXYZ";
+  string encoded;
+  codec_.EncodeKey(original, &encoded);
+  EXPECT_EQ(original.size(), codec_.GetDecodedKeyLength(encoded));
+  // Decoded key is appended.
+  string decoded = "prefix";
+  codec_.DecodeKey(encoded, &decoded);
+  EXPECT_EQ("prefix" + original, decoded);
+}
+
+TEST_F(SystemDictionaryAlignedCodecTest, ValueCodec) {
+  for (char32 c = 0x01; c <= 0x10ffff; ++c) {
+    string original;
+    Util::UCS4ToUTF8(c, &original);
+    string encoded;
+    codec_.EncodeValue(original, &encoded);
+    string decoded;
+    codec_.DecodeValue(encoded, &decoded);
+    ASSERT_EQ(original, decoded) << "failed at: " << static_cast<uint32>(c);
+  }
+
+  const string original = "漢字とカタカナ、ascii、\xF0\xA0\x80\x8B";
+  string encoded;
+  codec_.EncodeValue(original, &encoded);
+  string decoded = "prefix";
+  codec_.DecodeValue(encoded, &decoded);
+  EXPECT_EQ("prefix" + original, decoded);
+}
+
+TEST_F(SystemDictionaryAlignedCodecTest, TokenCodec) {
+  Util::SetRandomSeed(0);
+  for (int trial = 0; trial < 100; ++trial) {
+    ClearTokens(&source_tokens_);
+    ClearTokens(&decoded_tokens_);
+    InitRandomTokens(1 + Util::Random(50));
+    string encoded;
+    codec_.EncodeTokens(source_tokens_, &encoded);
+    ASSERT_NE(codec_.GetTokensTerminationFlag(),
+              static_cast<uint8>(encoded[0]));
+    codec_.DecodeTokens(reinterpret_cast<const uint8 *>(encoded.data()),
+                        &decoded_tokens_);
+    CheckDecoded();
+
+    // Reads the same tokens for reverse lookup.
+    size_t read_num = 0;
+    int offset = 0;
+    while (true) {
+      int read_bytes = 0;
+      int value_id = -1;
+      const bool has_next = codec_.ReadTokenForReverseLookup(
+          reinterpret_cast<const uint8 *>(encoded.data()) + offset,
+          &value_id, &read_bytes);
+      ASSERT_LT(read_num, source_tokens_.size());
+      const TokenInfo &source = source_tokens_[read_num];
+      if (source.value_type == TokenInfo::DEFAULT_VALUE) {
+        EXPECT_EQ(source.id_in_value_trie, value_id);
+      } else {
+        EXPECT_EQ(-1, value_id);
+      }
+      offset += read_bytes;
+      ++read_num;
+      if (!has_next) {
+        break;
+      }
+    }
+    EXPECT_EQ(source_tokens_.size(), read_num);
+    EXPECT_EQ(encoded.size(), offset);
+  }
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
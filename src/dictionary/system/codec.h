@@ -58,6 +58,9 @@ class SystemDictionaryCodec : public SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   virtual const string GetSectionNameForPos() const;
 
+  // Return section name for reverse lookup index
+  virtual const string GetSectionNameForReverseLookupIndex() const;
+
   // Compresses key string into small bytes.
   virtual void EncodeKey(const StringPiece src, string *dst) const;
 
@@ -59,11 +59,13 @@
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
+#include "base/singleton.h"
 #include "base/string_piece.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_factory.h"
 #include "dictionary/file/dictionary_file.h"
+#include "dictionary/system/aligned_codec.h"
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/token_decode_iterator.h"
 #include "dictionary/system/words_info.h"
@@ -178,6 +180,54 @@ inline const uint8 *GetTokenArrayPtr(const BitVectorBasedArray &token_array,
   return reinterpret_cast<const uint8*>(token_array.Get(key_id, &length));
 }
 
+// Reads |num_bits| (at most 32) bits at |bit_offset| of the bit stream of
+// |size| bytes, where every integer is stored from its LSB.
+inline uint32 ReadPackedBits(const uint8 *data, size_t size,
+                             uint64 bit_offset, int num_bits) {
+  const size_t pos = bit_offset / 8;
+  const int shift = bit_offset % 8;
+  uint64 bits = 0;
+  if (pos + sizeof(bits) <= size) {
+    // Assumes little endian as the other sections of the dictionary do.
+    memcpy(&bits, data + pos, sizeof(bits));
+  } else {
+    const int num_bytes = (shift + num_bits + 7) / 8;
+    for (int i = 0; i < num_bytes; ++i) {
+      bits |= static_cast<uint64>(data[pos + i]) << (8 * i);
+    }
+  }
+  return static_cast<uint32>((bits >> shift) &
+                             ((static_cast<uint64>(1) << num_bits) - 1));
+}
+
+// Returns the codec that |file| was built with.  Dictionaries built with
+// SystemDictionaryAlignedCodec are told from its token section.  Falls back to
+// |default_codec| if neither codec's token section is found.
+const SystemDictionaryCodecInterface *DetectCodec(
+    const DictionaryFile &file,
+    const SystemDictionaryCodecInterface *default_codec) {
+  int len = 0;
+  if (file.GetSection(default_codec->GetSectionNameForTokens(), &len) !=
+      nullptr) {
+    return default_codec;
+  }
+  const SystemDictionaryCodecInterface *aligned_codec =
+      Singleton<SystemDictionaryAlignedCodec>::get();
+  if (file.GetSection(aligned_codec->GetSectionNameForTokens(), &len) !=
+      nullptr) {
+    return aligned_codec;
+  }
+  return default_codec;
+}
+
+// Returns the token buffer provided by |callback|, or |default_buffer| if the
+// callback doesn't provide one.
+inline Token *GetTokenBuffer(DictionaryInterface::Callback *callback,
+                             Token *default_buffer) {
+  Token *buffer = callback->GetTokenBuffer();
+  return buffer != nullptr ? buffer : default_buffer;
+}
+
 // Iterator for scanning token array.
 // This iterator does not return actual token info but returns
 // id data and the position only.
@@ -457,6 +507,9 @@ SystemDictionary::Builder &SystemDictionary::Builder::SetCodec(
 }
 
 SystemDictionary *SystemDictionary::Builder::Build() {
+  // When the codec is not specified, it's detected from the dictionary file
+  // after opening it.
+  const bool detect_codec = (spec_->codec == nullptr);
   if (spec_->codec == nullptr) {
     spec_->codec = SystemDictionaryCodecFactory::GetCodec();
   }
@@ -492,6 +545,10 @@ SystemDictionary *SystemDictionary::Builder::Build() {
       return nullptr;
   }
 
+  if (detect_codec) {
+    instance->codec_ = DetectCodec(*instance->dictionary_file_, spec_->codec);
+  }
+
   if (!instance->OpenDictionaryFile(
           (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0)) {
     LOG(ERROR) << "Failed to create system dictionary";
@@ -506,7 +563,15 @@ SystemDictionary::SystemDictionary(
     const DictionaryFileCodecInterface *file_codec)
     : frequent_pos_(nullptr),
       codec_(codec),
-      dictionary_file_(new DictionaryFile(file_codec)) {}
+      dictionary_file_(new DictionaryFile(file_codec)),
+      reverse_lookup_index_size_(0),
+      reverse_lookup_num_entries_(0),
+      reverse_lookup_num_keys_(0),
+      reverse_lookup_bits_(nullptr),
+      reverse_lookup_bits_size_(0),
+      reverse_lookup_begin_bits_(0),
+      reverse_lookup_key_id_bits_(0),
+      reverse_lookup_key_ids_offset_(0) {}
 
 SystemDictionary::~SystemDictionary() {}
 
@@ -550,13 +615,77 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     return false;
   }
 
-  if (enable_reverse_lookup_index) {
+  if (!OpenReverseLookupIndexImage()) {
+    // The index is optional; the lookup scans the tokens without it.
+    LOG(WARNING) << "ignores broken reverse lookup index section";
+  }
+
+  if (enable_reverse_lookup_index && reverse_lookup_bits_ == nullptr) {
     InitReverseLookupIndex();
   }
 
   return true;
 }
 
+bool SystemDictionary::OpenReverseLookupIndexImage() {
+  int len = 0;
+  const char *image = dictionary_file_->GetSection(
+      codec_->GetSectionNameForReverseLookupIndex(), &len);
+  if (image == nullptr) {
+    // Dictionary images built without the index are still valid.
+    return true;
+  }
+  // See SystemDictionaryBuilder::BuildReverseLookupIndex() for the layout.
+  uint32 header[4];
+  if (len < static_cast<int>(sizeof(header))) {
+    return false;
+  }
+  memcpy(header, image, sizeof(header));
+  const uint32 num_value_ids = header[0];
+  const uint32 num_entries = header[1];
+  const uint32 begin_bits = header[2];
+  const uint32 key_id_bits = header[3];
+  if (begin_bits == 0 || begin_bits > 32 ||
+      key_id_bits == 0 || key_id_bits > 32) {
+    return false;
+  }
+  const uint64 key_ids_offset =
+      (static_cast<uint64>(num_value_ids) + 1) * begin_bits;
+  const uint64 num_bits =
+      key_ids_offset + static_cast<uint64>(num_entries) * key_id_bits;
+  if (static_cast<uint64>(len) - sizeof(header) != (num_bits + 7) / 8) {
+    return false;
+  }
+  // Only the header is checked here, so that opening the dictionary doesn't
+  // read the whole section.  The begin positions and key ids are checked when
+  // they are looked up.
+  reverse_lookup_index_size_ = num_value_ids;
+  reverse_lookup_num_entries_ = num_entries;
+  reverse_lookup_num_keys_ = key_trie_.GetNumKeys();
+  reverse_lookup_bits_ = reinterpret_cast<const uint8 *>(image) +
+                         sizeof(header);
+  reverse_lookup_bits_size_ = len - sizeof(header);
+  reverse_lookup_begin_bits_ = begin_bits;
+  reverse_lookup_key_id_bits_ = key_id_bits;
+  reverse_lookup_key_ids_offset_ = key_ids_offset;
+  return true;
+}
+
+uint32 SystemDictionary::GetReverseLookupBegin(uint32 value_id) const {
+  return ReadPackedBits(reverse_lookup_bits_, reverse_lookup_bits_size_,
+                        static_cast<uint64>(value_id) *
+                            reverse_lookup_begin_bits_,
+                        reverse_lookup_begin_bits_);
+}
+
+uint32 SystemDictionary::GetReverseLookupKeyId(uint32 index) const {
+  return ReadPackedBits(reverse_lookup_bits_, reverse_lookup_bits_size_,
+                        reverse_lookup_key_ids_offset_ +
+                            static_cast<uint64>(index) *
+                                reverse_lookup_key_id_bits_,
+                        reverse_lookup_key_id_bits_);
+}
+
 void SystemDictionary::InitReverseLookupIndex() {
   if (reverse_lookup_index_ != nullptr) {
     return;
@@ -621,38 +750,73 @@ bool SystemDictionary::HasValue(StringPiece value) const {
   return false;
 }
 
-void SystemDictionary::CollectPredictiveNodesInBfsOrder(
-    StringPiece encoded_key,
+void SystemDictionary::CollectPredictiveStartStates(
+    const std::vector<string> &encoded_keys,
     const KeyExpansionTable &table,
+    const LoudsTrie::Node &node,
+    size_t key_pos,
+    const std::vector<std::pair<size_t, bool>> &key_states,
+    std::vector<std::vector<PredictiveLookupSearchState>> *start_states)
+    const {
+  // |key_states| holds the indices of |encoded_keys| reaching |node| and
+  // whether each of them is expanded on the way.  Keys ending at |node| start
+  // their predictive search from here; the others go down to the children.
+  std::vector<std::pair<size_t, bool>> remaining_key_states;
+  for (size_t i = 0; i < key_states.size(); ++i) {
+    const size_t index = key_states[i].first;
+    if (encoded_keys[index].size() == key_pos) {
+      (*start_states)[index].push_back(
+          PredictiveLookupSearchState(node, key_pos, key_states[i].second));
+    } else {
+      remaining_key_states.push_back(key_states[i]);
+    }
+  }
+  if (remaining_key_states.empty()) {
+    return;
+  }
+
+  // Children are visited in the order of siblings so that the start states
+  // for each key are collected in the same order as BFS.
+  std::vector<std::pair<size_t, bool>> child_key_states;
+  LoudsTrie::Node child = node;
+  for (key_trie_.MoveToFirstChild(&child);
+       key_trie_.IsValidNode(child);
+       key_trie_.MoveToNextSibling(&child)) {
+    const char c = key_trie_.GetEdgeLabelToParentNode(child);
+    child_key_states.clear();
+    for (size_t i = 0; i < remaining_key_states.size(); ++i) {
+      const char target_char =
+          encoded_keys[remaining_key_states[i].first][key_pos];
+      if (!table.ExpandKey(target_char).IsHit(c)) {
+        continue;
+      }
+      child_key_states.push_back(std::make_pair(
+          remaining_key_states[i].first,
+          remaining_key_states[i].second || c != target_char));
+    }
+    if (!child_key_states.empty()) {
+      CollectPredictiveStartStates(encoded_keys, table, child, key_pos + 1,
+                                   child_key_states, start_states);
+    }
+  }
+}
+
+void SystemDictionary::CollectPredictiveNodesInBfsOrder(
+    const std::vector<PredictiveLookupSearchState> &start_states,
     size_t limit,
     std::vector<PredictiveLookupSearchState> *result) const {
+  if (start_states.empty()) {
+    return;
+  }
   std::queue<PredictiveLookupSearchState> queue;
-  queue.push(PredictiveLookupSearchState(LoudsTrie::Node(), 0, false));
+  for (size_t i = 0; i < start_states.size(); ++i) {
+    queue.push(start_states[i]);
+  }
   do {
     PredictiveLookupSearchState state = queue.front();
     queue.pop();
 
-    // Update traversal state for |encoded_key| and its expanded keys.
-    if (state.key_pos < encoded_key.size()) {
-      const char target_char = encoded_key[state.key_pos];
-      const ExpandedKey &chars = table.ExpandKey(target_char);
-
-      for (key_trie_.MoveToFirstChild(&state.node);
-           key_trie_.IsValidNode(state.node);
-           key_trie_.MoveToNextSibling(&state.node)) {
-        const char c = key_trie_.GetEdgeLabelToParentNode(state.node);
-        if (!chars.IsHit(c)) {
-          continue;
-        }
-        const bool is_expanded = state.is_expanded || c != target_char;
-        queue.push(PredictiveLookupSearchState(state.node,
-                                               state.key_pos + 1,
-                                               is_expanded));
-      }
-      continue;
-    }
-
-    // Collect prediction keys (state.key_pos >= encoded_key.size()).
+    // Collect prediction keys.
     if (key_trie_.IsTerminalNode(state.node)) {
       result->push_back(state);
     }
@@ -693,15 +857,32 @@ void SystemDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
+  LookupPredictiveBatch(std::vector<string>(1, key.as_string()),
+                        conversion_request,
+                        std::vector<Callback *>(1, callback));
+}
+
+void SystemDictionary::LookupPredictiveBatch(
+    const std::vector<string> &keys,
+    const ConversionRequest &conversion_request,
+    const std::vector<Callback *> &callbacks) const {
+  DCHECK_EQ(keys.size(), callbacks.size());
+
   // Do nothing for empty key, although looking up all the entries with empty
   // string seems natural.
-  if (key.empty()) {
-    return;
+  std::vector<string> encoded_keys(keys.size());
+  std::vector<std::pair<size_t, bool>> key_states;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i].empty()) {
+      continue;
+    }
+    codec_->EncodeKey(keys[i], &encoded_keys[i]);
+    if (encoded_keys[i].size() > LoudsTrie::kMaxDepth) {
+      continue;
+    }
+    key_states.push_back(std::make_pair(i, false));
   }
-
-  string encoded_key;
-  codec_->EncodeKey(key, &encoded_key);
-  if (encoded_key.size() > LoudsTrie::kMaxDepth) {
+  if (key_states.empty()) {
     return;
   }
 
@@ -709,6 +890,13 @@ void SystemDictionary::LookupPredictive(
       conversion_request.IsKanaModifierInsensitiveConversion() ?
       hiragana_expansion_table_ : KeyExpansionTable::GetDefaultInstance();
 
+  // Traverses the key trie once for all the keys to find the nodes from which
+  // the predictive search of each key starts.
+  std::vector<std::vector<PredictiveLookupSearchState>> start_states(
+      keys.size());
+  CollectPredictiveStartStates(encoded_keys, table, LoudsTrie::Node(), 0,
+                               key_states, &start_states);
+
   // TODO(noriyukit): Lookup limit should be implemented at caller side by using
   // callback mechanism.  This hard-coding limits the capability and generality
   // of dictionary module.  CollectPredictiveNodesInBfsOrder() and the following
@@ -716,15 +904,27 @@ void SystemDictionary::LookupPredictive(
   const size_t kLookupLimit = 64;
   std::vector<PredictiveLookupSearchState> result;
   result.reserve(kLookupLimit);
-  CollectPredictiveNodesInBfsOrder(encoded_key, table, kLookupLimit, &result);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    result.clear();
+    CollectPredictiveNodesInBfsOrder(start_states[i], kLookupLimit, &result);
+    RunPredictiveCallback(keys[i], encoded_keys[i], result, callbacks[i]);
+  }
+}
 
+void SystemDictionary::RunPredictiveCallback(
+    StringPiece key,
+    StringPiece encoded_key,
+    const std::vector<PredictiveLookupSearchState> &nodes,
+    Callback *callback) const {
   // Reused buffer and instances inside the following loop.
   char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
   string decoded_key, actual_key_str;
+  Token default_token_buffer;
+  Token *token_buffer = GetTokenBuffer(callback, &default_token_buffer);
   decoded_key.reserve(key.size() * 2);
   actual_key_str.reserve(key.size() * 2);
-  for (size_t i = 0; i < result.size(); ++i) {
-    const PredictiveLookupSearchState &state = result[i];
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const PredictiveLookupSearchState &state = nodes[i];
 
     // Computes the actual key.  For example:
     // key = "くー"
@@ -775,7 +975,8 @@ void SystemDictionary::LookupPredictive(
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
     for (TokenDecodeIterator iter(codec_, value_trie_,
                                   frequent_pos_, actual_key,
-                                  GetTokenArrayPtr(token_array_, key_id));
+                                  GetTokenArrayPtr(token_array_, key_id),
+                                  token_buffer);
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
       const Callback::ResultType result =
@@ -818,6 +1019,8 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
                              DictionaryInterface::Callback *callback,
                              Func token_filter) {
   typedef DictionaryInterface::Callback Callback;
+  Token default_token_buffer;
+  Token *token_buffer = GetTokenBuffer(callback, &default_token_buffer);
   LoudsTrie::Node node;
   for (StringPiece::size_type i = 0; i < encoded_key.size(); ) {
     if (!key_trie.MoveToChildByLabel(encoded_key[i], &node)) {
@@ -852,7 +1055,8 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
 
     const int key_id = key_trie.GetKeyIdOfTerminalNode(node);
     for (TokenDecodeIterator iter(codec, value_trie, frequent_pos, prefix,
-                                  GetTokenArrayPtr(token_array, key_id));
+                                  GetTokenArrayPtr(token_array, key_id),
+                                  token_buffer);
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
       if (!token_filter(token_info)) {
@@ -916,6 +1120,9 @@ class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
 //   actual_prefix:
 //     A reused string for decoded actual key.  This is just for performance
 //     purpose.
+//   token_buffer:
+//     A reused token into which tokens are decoded.  This is also just for
+//     performance purpose.
 DictionaryInterface::Callback::ResultType
 SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     const char *key,
@@ -926,7 +1133,8 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     StringPiece::size_type key_pos,
     bool is_expanded,
     char *actual_key_buffer,
-    string *actual_prefix) const {
+    string *actual_prefix,
+    Token *token_buffer) const {
   // This do-block handles a terminal node and callback.  do-block is used to
   // break the block and continue to the subsequent traversal phase.
   do {
@@ -960,7 +1168,8 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(node);
     for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
                                   *actual_prefix,
-                                  GetTokenArrayPtr(token_array_, key_id));
+                                  GetTokenArrayPtr(token_array_, key_id),
+                                  token_buffer);
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
       result = callback->OnToken(prefix, *actual_prefix, *token_info.token);
@@ -990,7 +1199,7 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     const Callback::ResultType result = LookupPrefixWithKeyExpansionImpl(
         key, encoded_key, table, callback, node, key_pos + 1,
         is_expanded || c != current_char,
-        actual_key_buffer, actual_prefix);
+        actual_key_buffer, actual_prefix, token_buffer);
     if (result == Callback::TRAVERSE_DONE) {
       return Callback::TRAVERSE_DONE;
     }
@@ -1016,10 +1225,11 @@ void SystemDictionary::LookupPrefix(
   char actual_key_buffer[LoudsTrie::kMaxDepth + 1];
   string actual_prefix;
   actual_prefix.reserve(key.size() * 3);
-  LookupPrefixWithKeyExpansionImpl(key.data(), encoded_key,
-                                   hiragana_expansion_table_, callback,
-                                   LoudsTrie::Node(), 0, false,
-                                   actual_key_buffer, &actual_prefix);
+  Token default_token_buffer;
+  LookupPrefixWithKeyExpansionImpl(
+      key.data(), encoded_key, hiragana_expansion_table_, callback,
+      LoudsTrie::Node(), 0, false, actual_key_buffer, &actual_prefix,
+      GetTokenBuffer(callback, &default_token_buffer));
 }
 
 void SystemDictionary::LookupExact(
@@ -1082,7 +1292,7 @@ inline void AddKeyIdsOfAllPrefixes(const LoudsTrie &trie, StringPiece key,
 }  // namespace
 
 void SystemDictionary::PopulateReverseLookupCache(StringPiece str) const {
-  if (reverse_lookup_index_ != nullptr) {
+  if (reverse_lookup_bits_ != nullptr || reverse_lookup_index_ != nullptr) {
     // We don't need to prepare cache for the current reverse conversion,
     // as we have already built the index for reverse lookup.
     return;
@@ -1160,6 +1370,11 @@ void SystemDictionary::RegisterReverseLookupTokensForValue(
   std::set<int> id_set;
   AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
 
+  if (reverse_lookup_bits_ != nullptr &&
+      RegisterReverseLookupResultsFromImage(id_set, callback)) {
+    return;
+  }
+
   ReverseLookupCache *results = nullptr;
   ReverseLookupCache non_cached_results;
   if (reverse_lookup_index_ != nullptr) {
@@ -1198,7 +1413,6 @@ void SystemDictionary::RegisterReverseLookupResults(
     const ReverseLookupCache &cache,
     Callback *callback) const {
   const uint8 *encoded_tokens_ptr = GetTokenArrayPtr(token_array_, 0);
-  char buffer[LoudsTrie::kMaxDepth + 1];
   for (std::set<int>::const_iterator set_itr = id_set.begin();
        set_itr != id_set.end();
        ++set_itr) {
@@ -1209,27 +1423,80 @@ void SystemDictionary::RegisterReverseLookupResults(
          result_itr != range.second;
          ++result_itr) {
       const ReverseLookupResult &reverse_result = result_itr->second;
+      RegisterReverseLookupTokensForKey(
+          value_id, reverse_result.id_in_key_trie,
+          encoded_tokens_ptr + reverse_result.tokens_offset, callback);
+    }
+  }
+}
 
-      const StringPiece encoded_key =
-          key_trie_.RestoreKeyString(reverse_result.id_in_key_trie, buffer);
-      string tokens_key;
-      codec_->DecodeKey(encoded_key, &tokens_key);
-      if (callback->OnKey(tokens_key) != Callback::TRAVERSE_CONTINUE) {
-        continue;
-      }
-      for (TokenDecodeIterator iter(
-               codec_, value_trie_, frequent_pos_, tokens_key,
-               encoded_tokens_ptr  + reverse_result.tokens_offset);
-           !iter.Done(); iter.Next()) {
-        const TokenInfo &token_info = iter.Get();
-        if (token_info.token->attributes & Token::SPELLING_CORRECTION ||
-            token_info.id_in_value_trie != value_id) {
-          continue;
-        }
-        callback->OnToken(tokens_key, tokens_key, *token_info.token);
+bool SystemDictionary::RegisterReverseLookupResultsFromImage(
+    const std::set<int> &id_set, Callback *callback) const {
+  DCHECK(reverse_lookup_bits_);
+  // Checks the entries of all the values before running the callback, so
+  // that the caller can fall back to scanning the tokens.
+  for (std::set<int>::const_iterator set_itr = id_set.begin();
+       set_itr != id_set.end();
+       ++set_itr) {
+    const int value_id = *set_itr;
+    if (value_id < 0 ||
+        static_cast<uint32>(value_id) >= reverse_lookup_index_size_) {
+      continue;
+    }
+    const uint32 begin = GetReverseLookupBegin(value_id);
+    const uint32 end = GetReverseLookupBegin(value_id + 1);
+    if (begin > end || end > reverse_lookup_num_entries_) {
+      LOG(ERROR) << "broken reverse lookup index for value " << value_id;
+      return false;
+    }
+    for (uint32 i = begin; i < end; ++i) {
+      if (GetReverseLookupKeyId(i) >= reverse_lookup_num_keys_) {
+        LOG(ERROR) << "broken reverse lookup index for value " << value_id;
+        return false;
       }
     }
   }
+
+  for (std::set<int>::const_iterator set_itr = id_set.begin();
+       set_itr != id_set.end();
+       ++set_itr) {
+    const int value_id = *set_itr;
+    if (value_id < 0 ||
+        static_cast<uint32>(value_id) >= reverse_lookup_index_size_) {
+      continue;
+    }
+    const uint32 end = GetReverseLookupBegin(value_id + 1);
+    for (uint32 i = GetReverseLookupBegin(value_id); i < end; ++i) {
+      const int id_in_key_trie = GetReverseLookupKeyId(i);
+      RegisterReverseLookupTokensForKey(
+          value_id, id_in_key_trie,
+          GetTokenArrayPtr(token_array_, id_in_key_trie), callback);
+    }
+  }
+  return true;
+}
+
+void SystemDictionary::RegisterReverseLookupTokensForKey(
+    int value_id, int id_in_key_trie, const uint8 *encoded_tokens,
+    Callback *callback) const {
+  char buffer[LoudsTrie::kMaxDepth + 1];
+  const StringPiece encoded_key =
+      key_trie_.RestoreKeyString(id_in_key_trie, buffer);
+  string tokens_key;
+  codec_->DecodeKey(encoded_key, &tokens_key);
+  if (callback->OnKey(tokens_key) != Callback::TRAVERSE_CONTINUE) {
+    return;
+  }
+  for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, tokens_key,
+                                encoded_tokens);
+       !iter.Done(); iter.Next()) {
+    const TokenInfo &token_info = iter.Get();
+    if (token_info.token->attributes & Token::SPELLING_CORRECTION ||
+        token_info.id_in_value_trie != value_id) {
+      continue;
+    }
+    callback->OnToken(tokens_key, tokens_key, *token_info.token);
+  }
 }
 
 }  // namespace dictionary
@@ -34,6 +34,7 @@
       'type': 'static_library',
       'toolsets': ['target', 'host'],
       'sources': [
+        'aligned_codec.cc',
         'codec.cc',
       ],
       'dependencies': [
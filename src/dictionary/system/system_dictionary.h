@@ -33,6 +33,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
@@ -60,6 +61,8 @@ class SystemDictionary : public DictionaryInterface {
     // If ENABLE_REVERSE_LOOKUP_INDEX is set, we will have the index in heap
     // from the id in value trie to the id in key trie.
     // That consumes more memory but we can perform reverse lookup more quickly.
+    // This option has no effect if the dictionary image already contains the
+    // reverse lookup index, which is used in place without any heap.
     ENABLE_REVERSE_LOOKUP_INDEX = 1,
   };
 
@@ -83,7 +86,8 @@ class SystemDictionary : public DictionaryInterface {
     Builder &SetOptions(Options options);
 
     // Sets codec (default: NULL)
-    // Uses default codec if this is NULL
+    // If this is NULL, uses the codec the dictionary was built with, i.e.,
+    // either the default codec or SystemDictionaryAlignedCodec.
     // Doesn't take the ownership of |codec|.
     Builder &SetCodec(const SystemDictionaryCodecInterface *codec);
 
@@ -108,6 +112,13 @@ class SystemDictionary : public DictionaryInterface {
                                 const ConversionRequest &converter_request,
                                 Callback *callback) const;
 
+  // Shares the traversal of the key trie among |keys| to find the nodes from
+  // which the predictive search of each key starts.
+  virtual void LookupPredictiveBatch(
+      const std::vector<string> &keys,
+      const ConversionRequest &converter_request,
+      const std::vector<Callback *> &callbacks) const;
+
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &converter_request,
                             Callback *callback) const;
@@ -140,6 +151,17 @@ class SystemDictionary : public DictionaryInterface {
   void RegisterReverseLookupResults(const std::set<int> &id_set,
                                     const ReverseLookupCache &cache,
                                     Callback *callback) const;
+  // Returns false without running |callback| if the index is broken for any
+  // value in |id_set|.
+  bool RegisterReverseLookupResultsFromImage(const std::set<int> &id_set,
+                                             Callback *callback) const;
+  void RegisterReverseLookupTokensForKey(int value_id,
+                                         int id_in_key_trie,
+                                         const uint8 *encoded_tokens,
+                                         Callback *callback) const;
+  bool OpenReverseLookupIndexImage();
+  uint32 GetReverseLookupBegin(uint32 value_id) const;
+  uint32 GetReverseLookupKeyId(uint32 index) const;
   void InitReverseLookupIndex();
 
   Callback::ResultType LookupPrefixWithKeyExpansionImpl(
@@ -151,14 +173,29 @@ class SystemDictionary : public DictionaryInterface {
       StringPiece::size_type key_pos,
       bool is_expanded,
       char *actual_key_buffer,
-      string *actual_prefix) const;
+      string *actual_prefix,
+      Token *token_buffer) const;
 
-  void CollectPredictiveNodesInBfsOrder(
-      StringPiece encoded_key,
+  void CollectPredictiveStartStates(
+      const std::vector<string> &encoded_keys,
       const KeyExpansionTable &table,
+      const storage::louds::LoudsTrie::Node &node,
+      size_t key_pos,
+      const std::vector<std::pair<size_t, bool>> &key_states,
+      std::vector<std::vector<PredictiveLookupSearchState>> *start_states)
+      const;
+
+  void CollectPredictiveNodesInBfsOrder(
+      const std::vector<PredictiveLookupSearchState> &start_states,
       size_t limit,
       std::vector<PredictiveLookupSearchState> *result) const;
 
+  void RunPredictiveCallback(
+      StringPiece key,
+      StringPiece encoded_key,
+      const std::vector<PredictiveLookupSearchState> &nodes,
+      Callback *callback) const;
+
   storage::louds::LoudsTrie key_trie_;
   storage::louds::LoudsTrie value_trie_;
   storage::louds::BitVectorBasedArray token_array_;
@@ -168,6 +205,18 @@ class SystemDictionary : public DictionaryInterface {
   std::unique_ptr<DictionaryFile> dictionary_file_;
   mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
+  // Reverse lookup index in the dictionary image.  The key ids for value id
+  // |i| are GetReverseLookupKeyId(j) for j in [GetReverseLookupBegin(i),
+  // GetReverseLookupBegin(i + 1)).  reverse_lookup_bits_ is null if the image
+  // has no index or its header is broken.
+  uint32 reverse_lookup_index_size_;
+  uint32 reverse_lookup_num_entries_;
+  uint32 reverse_lookup_num_keys_;
+  const uint8 *reverse_lookup_bits_;
+  size_t reverse_lookup_bits_size_;
+  int reverse_lookup_begin_bits_;
+  int reverse_lookup_key_id_bits_;
+  uint64 reverse_lookup_key_ids_offset_;
 
   DISALLOW_COPY_AND_ASSIGN(SystemDictionary);
 };
@@ -54,6 +54,8 @@ DEFINE_bool(preserve_intermediate_dictionary, false,
             "preserve inetemediate dictionary file.");
 DEFINE_int32(min_key_length_to_use_small_cost_encoding, 6,
              "minimum key length to use 1 byte cost encoding.");
+DEFINE_bool(build_reverse_lookup_index, false,
+            "embed the index for reverse lookup in the dictionary file.");
 
 namespace mozc {
 namespace dictionary {
@@ -85,6 +87,49 @@ void WriteSectionToFile(const DictionaryFileSection &section,
   ofs.write(section.ptr, section.len);
 }
 
+// Returns the number of bits to store the integers in [0, max_value], which is
+// at least 1.
+int GetNumBitsToStore(uint64 max_value) {
+  int num_bits = 1;
+  while (num_bits < 64 && (max_value >> num_bits) != 0) {
+    ++num_bits;
+  }
+  return num_bits;
+}
+
+// Appends integers of the given number of bits to a string from their LSB.
+class BitPacker {
+ public:
+  explicit BitPacker(string *image) : image_(image), bits_(0), num_bits_(0) {}
+
+  void Push(uint32 value, int num_bits) {
+    DCHECK_LE(num_bits, 32);
+    bits_ |= static_cast<uint64>(value) << num_bits_;
+    num_bits_ += num_bits;
+    while (num_bits_ >= 8) {
+      image_->push_back(static_cast<char>(bits_ & 0xFF));
+      bits_ >>= 8;
+      num_bits_ -= 8;
+    }
+  }
+
+  // Writes the remaining bits padded with 0.
+  void Flush() {
+    if (num_bits_ > 0) {
+      image_->push_back(static_cast<char>(bits_ & 0xFF));
+    }
+    bits_ = 0;
+    num_bits_ = 0;
+  }
+
+ private:
+  string *image_;
+  uint64 bits_;
+  int num_bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitPacker);
+};
+
 }  // namespace
 
 SystemDictionaryBuilder::SystemDictionaryBuilder()
@@ -164,6 +209,14 @@ void SystemDictionaryBuilder::WriteToStream(
     file_codec_->GetSectionName(codec_->GetSectionNameForPos()));
   sections.push_back(frequent_pos_section);
 
+  DictionaryFileSection reverse_lookup_index_section(
+    reverse_lookup_index_.data(), reverse_lookup_index_.size(),
+    file_codec_->GetSectionName(
+        codec_->GetSectionNameForReverseLookupIndex()));
+  if (!reverse_lookup_index_.empty()) {
+    sections.push_back(reverse_lookup_index_section);
+  }
+
   if (FLAGS_preserve_intermediate_dictionary &&
       !intermediate_output_file_base_path.empty()) {
     // Write out intermediate results to files.
@@ -173,6 +226,10 @@ void SystemDictionaryBuilder::WriteToStream(
     WriteSectionToFile(key_trie_section, basepath + ".key");
     WriteSectionToFile(token_array_section, basepath + ".tokens");
     WriteSectionToFile(frequent_pos_section, basepath + ".freq_pos");
+    if (!reverse_lookup_index_.empty()) {
+      WriteSectionToFile(reverse_lookup_index_section,
+                         basepath + ".reverse_lookup");
+    }
   }
 
   LOG(INFO) << "Start writing dictionary file.";
@@ -456,11 +513,35 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
+    std::vector<std::pair<uint32, uint32>> value_key_id_pairs;
     for (size_t i = 0; i < id_to_keyinfo_table.size(); ++i) {
       const KeyInfo &key_info = *id_to_keyinfo_table[i];
       string tokens_str;
       codec_->EncodeTokens(key_info.tokens, &tokens_str);
       token_array_builder_->Add(tokens_str);
+
+      // Reads the value ids back from the encoded tokens so that the index
+      // lists exactly the tokens found by scanning the token array.
+      const uint8 *ptr = reinterpret_cast<const uint8 *>(tokens_str.data());
+      for (size_t offset = 0; offset < tokens_str.size();) {
+        int value_id = -1;
+        int read_bytes = 0;
+        const bool has_next = codec_->ReadTokenForReverseLookup(
+            ptr + offset, &value_id, &read_bytes);
+        if (value_id != -1) {
+          value_key_id_pairs.push_back(
+              std::make_pair(static_cast<uint32>(value_id),
+                             static_cast<uint32>(i)));
+        }
+        if (!has_next) {
+          break;
+        }
+        offset += read_bytes;
+      }
+    }
+    if (FLAGS_build_reverse_lookup_index) {
+      BuildReverseLookupIndex(value_key_id_pairs,
+                              id_to_keyinfo_table.size());
     }
   }
 
@@ -468,5 +549,60 @@ void SystemDictionaryBuilder::BuildTokenArray(
   token_array_builder_->Build();
 }
 
+// The reverse lookup index maps an id in the value trie to the ids in the key
+// trie having a token with that value.  The section starts with four uint32:
+//   N: the number of ids in the value trie
+//   M: the number of key ids in the index
+//   B: the number of bits of a begin position
+//   K: the number of bits of a key id, ceil(log2(the number of keys))
+// followed by a bit stream of N + 1 begin positions of B bits each, which
+// increase monotonically from 0 to M, and M key ids of K bits each.  The key
+// ids for value id i are in [begin[i], begin[i + 1]).  Every integer is stored
+// from its LSB, and the stream is padded to a byte boundary.
+// Key ids for a value id appear once per token, in the order of the token
+// array, so that the dictionary can scan them in place from the image.
+void SystemDictionaryBuilder::BuildReverseLookupIndex(
+    const std::vector<std::pair<uint32, uint32>> &value_key_id_pairs,
+    size_t num_keys) {
+  uint32 num_value_ids = 0;
+  for (size_t i = 0; i < value_key_id_pairs.size(); ++i) {
+    num_value_ids = std::max(num_value_ids, value_key_id_pairs[i].first + 1);
+  }
+
+  std::vector<uint32> begin(num_value_ids + 1, 0);
+  for (size_t i = 0; i < value_key_id_pairs.size(); ++i) {
+    ++begin[value_key_id_pairs[i].first + 1];
+  }
+  for (size_t i = 0; i < num_value_ids; ++i) {
+    begin[i + 1] += begin[i];
+  }
+
+  // Counting sort, which keeps the key id order for each value id.
+  std::vector<uint32> key_ids(value_key_id_pairs.size());
+  std::vector<uint32> next(begin.begin(), begin.end() - 1);
+  for (size_t i = 0; i < value_key_id_pairs.size(); ++i) {
+    const uint32 value_id = value_key_id_pairs[i].first;
+    key_ids[next[value_id]++] = value_key_id_pairs[i].second;
+  }
+
+  const uint32 header[] = {
+    num_value_ids,
+    static_cast<uint32>(key_ids.size()),
+    static_cast<uint32>(GetNumBitsToStore(key_ids.size())),
+    static_cast<uint32>(
+        GetNumBitsToStore(num_keys == 0 ? 0 : num_keys - 1)),
+  };
+  reverse_lookup_index_.assign(reinterpret_cast<const char *>(header),
+                               sizeof(header));
+  BitPacker packer(&reverse_lookup_index_);
+  for (size_t i = 0; i < begin.size(); ++i) {
+    packer.Push(begin[i], header[2]);
+  }
+  for (size_t i = 0; i < key_ids.size(); ++i) {
+    packer.Push(key_ids[i], header[3]);
+  }
+  packer.Flush();
+}
+
 }  // namespace dictionary
 }  // namespace mozc
@@ -35,6 +35,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
@@ -89,6 +90,13 @@ class SystemDictionaryBuilder {
 
   void BuildTokenArray(const KeyInfoList &key_info_list);
 
+  // Builds the reverse lookup index from the pairs of
+  // (id in value trie, id in key trie) listed in the key id order.
+  // |num_keys| is the number of keys in the key trie.
+  void BuildReverseLookupIndex(
+      const std::vector<std::pair<uint32, uint32>> &value_key_id_pairs,
+      size_t num_keys);
+
   void SetIdForValue(KeyInfoList *key_info_list) const;
   void SetIdForKey(KeyInfoList *key_info_list) const;
   void SortTokenInfo(KeyInfoList *key_info_list) const;
@@ -105,6 +113,10 @@ class SystemDictionaryBuilder {
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32, int> frequent_pos_;
 
+  // Image of the reverse lookup index section.  See the comment of
+  // BuildReverseLookupIndex() in the .cc file for the layout.
+  string reverse_lookup_index_;
+
   const SystemDictionaryCodecInterface *codec_;
   const DictionaryFileCodecInterface *file_codec_;
 
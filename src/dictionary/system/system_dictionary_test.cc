@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -46,7 +47,11 @@
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_test_util.h"
 #include "dictionary/dictionary_token.h"
+#include "dictionary/file/codec_factory.h"
+#include "dictionary/file/codec_interface.h"
+#include "dictionary/file/section.h"
 #include "dictionary/pos_matcher.h"
+#include "dictionary/system/aligned_codec.h"
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/system_dictionary_builder.h"
 #include "dictionary/text_dictionary_loader.h"
@@ -62,6 +67,7 @@ DEFINE_int32(dictionary_test_size, 100000,
 DEFINE_int32(dictionary_reverse_lookup_test_size, 1000,
              "Number of tokens to run reverse lookup test.");
 DECLARE_int32(min_key_length_to_use_small_cost_encoding);
+DECLARE_bool(build_reverse_lookup_index);
 
 namespace mozc {
 namespace dictionary {
@@ -88,6 +94,8 @@ class SystemDictionaryTest : public ::testing::Test {
     original_flags_min_key_length_to_use_small_cost_encoding_ =
         FLAGS_min_key_length_to_use_small_cost_encoding;
     FLAGS_min_key_length_to_use_small_cost_encoding = kint32max;
+    original_flags_build_reverse_lookup_index_ =
+        FLAGS_build_reverse_lookup_index;
 
     request_.Clear();
     config::ConfigHandler::GetDefaultConfig(&config_);
@@ -96,6 +104,8 @@ class SystemDictionaryTest : public ::testing::Test {
   void TearDown() override {
     FLAGS_min_key_length_to_use_small_cost_encoding =
         original_flags_min_key_length_to_use_small_cost_encoding_;
+    FLAGS_build_reverse_lookup_index =
+        original_flags_build_reverse_lookup_index_;
 
     // This config initialization will be removed once ConversionRequest can
     // take config as an injected argument.
@@ -120,6 +130,7 @@ class SystemDictionaryTest : public ::testing::Test {
   commands::Request request_;
   const string dic_fn_;
   int original_flags_min_key_length_to_use_small_cost_encoding_;
+  bool original_flags_build_reverse_lookup_index_;
 };
 
 void SystemDictionaryTest::BuildSystemDictionary(
@@ -351,6 +362,65 @@ TEST_F(SystemDictionaryTest, LookupAllWords) {
   }
 }
 
+TEST_F(SystemDictionaryTest, AlignedCodec) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> default_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(default_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // The codec is detected from the dictionary file.
+  const SystemDictionaryAlignedCodec aligned_codec;
+  const string aligned_dic_fn =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "mozc_aligned.dic");
+  {
+    SystemDictionaryBuilder builder(&aligned_codec,
+                                    DictionaryFileCodecFactory::GetCodec());
+    std::vector<Token *> tokens(
+        source_tokens.begin(),
+        source_tokens.begin() +
+            std::min<size_t>(source_tokens.size(),
+                             FLAGS_dictionary_test_size));
+    builder.BuildFromTokens(tokens);
+    builder.WriteToFile(aligned_dic_fn);
+  }
+  unique_ptr<SystemDictionary> aligned_dic(
+      SystemDictionary::Builder(aligned_dic_fn).Build());
+  ASSERT_TRUE(aligned_dic.get() != NULL)
+      << "Failed to open dictionary source:" << aligned_dic_fn;
+
+  // Both dictionaries return the same tokens in the same order.
+  const size_t kNumKeys = std::min<size_t>(
+      source_tokens.size(), FLAGS_dictionary_reverse_lookup_test_size);
+  for (const bool kana_modifier_insensitive : {false, true}) {
+    request_.set_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    config_.set_use_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      const Token &token = *source_tokens[i];
+      SCOPED_TRACE(token.key);
+      CollectTokenCallback expected[4], actual[4];
+      default_dic->LookupPrefix(token.key, convreq_, &expected[0]);
+      aligned_dic->LookupPrefix(token.key, convreq_, &actual[0]);
+      default_dic->LookupPredictive(token.key, convreq_, &expected[1]);
+      aligned_dic->LookupPredictive(token.key, convreq_, &actual[1]);
+      default_dic->LookupExact(token.key, convreq_, &expected[2]);
+      aligned_dic->LookupExact(token.key, convreq_, &actual[2]);
+      default_dic->LookupReverse(token.value, convreq_, &expected[3]);
+      aligned_dic->LookupReverse(token.value, convreq_, &actual[3]);
+      for (size_t j = 0; j < arraysize(expected); ++j) {
+        ASSERT_EQ(expected[j].tokens().size(), actual[j].tokens().size());
+        for (size_t k = 0; k < expected[j].tokens().size(); ++k) {
+          EXPECT_TOKEN_EQ(expected[j].tokens()[k], actual[j].tokens()[k]);
+        }
+      }
+      EXPECT_TRUE(aligned_dic->HasValue(token.value));
+    }
+  }
+}
+
 TEST_F(SystemDictionaryTest, SimpleLookupPrefix) {
   const string k0 = "は";
   const string k1 = "はひふへほ";
@@ -617,6 +687,142 @@ TEST_F(SystemDictionaryTest, LookupPredictive_CutOffEmulatingBFS) {
   EXPECT_FALSE(callback.IsFound(tokens[1]));
 }
 
+TEST_F(SystemDictionaryTest, LookupPredictiveBatch) {
+  std::vector<Token *> tokens;
+  ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
+
+  tokens.push_back(CreateToken("がっこう", "学校"));
+  tokens.push_back(CreateToken("かっこう", "格好"));
+  tokens.push_back(CreateToken("かっこういい", "格好いい"));
+  tokens.push_back(CreateToken("かんこう", "観光"));
+  tokens.push_back(CreateToken("かんじ", "漢字"));
+  tokens.push_back(CreateToken("かんじょう", "感情"));
+  tokens.push_back(CreateToken("がんじつ", "元日"));
+  tokens.push_back(CreateToken("きんじょ", "近所"));
+  {
+    std::vector<Token *> source_tokens = tokens;
+    text_dict_->CollectTokens(&source_tokens);  // Load test data.
+    BuildSystemDictionary(source_tokens, 10000);
+  }
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+
+  // Keys sharing prefixes, a duplicated key, an empty key and a key not in
+  // the dictionary.
+  const std::vector<string> keys = {
+    "かん", "かつこう", "かんじ", "", "か", "かんじ", "きん", "ぬ",
+  };
+  for (const bool kana_modifier_insensitive : {false, true}) {
+    request_.set_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    config_.set_use_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+
+    std::vector<CollectTokenCallback> batch_callbacks(keys.size());
+    std::vector<DictionaryInterface::Callback *> callbacks;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      callbacks.push_back(&batch_callbacks[i]);
+    }
+    system_dic->LookupPredictiveBatch(keys, convreq_, callbacks);
+
+    // The batch lookup returns the same tokens in the same order as the
+    // lookup for each key.
+    for (size_t i = 0; i < keys.size(); ++i) {
+      SCOPED_TRACE(keys[i]);
+      CollectTokenCallback callback;
+      system_dic->LookupPredictive(keys[i], convreq_, &callback);
+      ASSERT_EQ(callback.tokens().size(), batch_callbacks[i].tokens().size());
+      for (size_t j = 0; j < callback.tokens().size(); ++j) {
+        EXPECT_TOKEN_EQ(callback.tokens()[j], batch_callbacks[i].tokens()[j]);
+      }
+    }
+    EXPECT_TRUE(batch_callbacks[3].tokens().empty());
+    EXPECT_TRUE(batch_callbacks[7].tokens().empty());
+  }
+}
+
+namespace {
+
+// Provides a token buffer and checks that every token is delivered in it.
+class TokenBufferCallback : public CollectTokenCallback {
+ public:
+  TokenBufferCallback() : all_in_buffer_(true) {}
+
+  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
+                             const Token &token) {
+    if (&token != &buffer_) {
+      all_in_buffer_ = false;
+    }
+    return CollectTokenCallback::OnToken(key, actual_key, token);
+  }
+
+  virtual Token *GetTokenBuffer() { return &buffer_; }
+
+  bool all_in_buffer() const { return all_in_buffer_; }
+
+ private:
+  Token buffer_;
+  bool all_in_buffer_;
+};
+
+}  // namespace
+
+TEST_F(SystemDictionaryTest, LookupWithTokenBuffer) {
+  std::vector<Token *> tokens;
+  ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
+
+  tokens.push_back(CreateToken("かっこう", "格好"));
+  tokens.push_back(CreateToken("かっこういい", "格好いい"));
+  tokens.push_back(CreateToken("かっこういい", "カッコイイ"));
+  tokens.push_back(CreateToken("がっこう", "学校"));
+  tokens.push_back(CreateToken("がっこう", "がっこう"));
+  tokens.push_back(CreateToken("がっこう", "ガッコウ"));
+  tokens.push_back(CreateToken("かっ", "括"));
+  {
+    std::vector<Token *> source_tokens = tokens;
+    text_dict_->CollectTokens(&source_tokens);  // Load test data.
+    BuildSystemDictionary(source_tokens, 10000);
+  }
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+
+  const char *kKeys[] = {"かっこういい", "がっこう", "かっ"};
+  for (const bool kana_modifier_insensitive : {false, true}) {
+    request_.set_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+    config_.set_use_kana_modifier_insensitive_conversion(
+        kana_modifier_insensitive);
+
+    // The same buffer is reused across lookups and the results are the same
+    // as the lookups without the buffer.
+    TokenBufferCallback buffer_callback;
+    for (size_t i = 0; i < arraysize(kKeys); ++i) {
+      SCOPED_TRACE(kKeys[i]);
+      for (int method = 0; method < 2; ++method) {
+        CollectTokenCallback callback;
+        buffer_callback.Clear();
+        if (method == 0) {
+          system_dic->LookupPrefix(kKeys[i], convreq_, &callback);
+          system_dic->LookupPrefix(kKeys[i], convreq_, &buffer_callback);
+        } else {
+          system_dic->LookupPredictive(kKeys[i], convreq_, &callback);
+          system_dic->LookupPredictive(kKeys[i], convreq_, &buffer_callback);
+        }
+        EXPECT_FALSE(callback.tokens().empty());
+        ASSERT_EQ(callback.tokens().size(), buffer_callback.tokens().size());
+        for (size_t j = 0; j < callback.tokens().size(); ++j) {
+          EXPECT_TOKEN_EQ(callback.tokens()[j], buffer_callback.tokens()[j]);
+        }
+      }
+    }
+    EXPECT_TRUE(buffer_callback.all_in_buffer());
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupExact) {
   std::vector<Token *> source_tokens;
 
@@ -786,6 +992,8 @@ TEST_F(SystemDictionaryTest, LookupReverse) {
 }
 
 TEST_F(SystemDictionaryTest, LookupReverseIndex) {
+  // Builds the image without the index so that the index is built in heap.
+  FLAGS_build_reverse_lookup_index = false;
   const std::vector<Token *> &source_tokens = text_dict_->tokens();
   BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
 
@@ -820,6 +1028,107 @@ TEST_F(SystemDictionaryTest, LookupReverseIndex) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupReverseIndexInImage) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  const string dic_fn_without_index = dic_fn_ + ".without_index";
+  FLAGS_build_reverse_lookup_index = false;
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  ASSERT_TRUE(FileUtil::AtomicRename(dic_fn_, dic_fn_without_index));
+  FLAGS_build_reverse_lookup_index = true;
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+
+  unique_ptr<SystemDictionary> system_dic_without_index(
+      SystemDictionary::Builder(dic_fn_without_index).Build());
+  ASSERT_TRUE(system_dic_without_index.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_without_index;
+  unique_ptr<SystemDictionary> system_dic_with_index(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic_with_index.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  std::vector<Token *>::const_iterator it;
+  int size = FLAGS_dictionary_reverse_lookup_test_size;
+  for (it = source_tokens.begin();
+       size > 0 && it != source_tokens.end(); ++it, --size) {
+    const Token &t = **it;
+    CollectTokenCallback callback1, callback2;
+    system_dic_without_index->LookupReverse(t.value, convreq_, &callback1);
+    system_dic_with_index->LookupReverse(t.value, convreq_, &callback2);
+
+    const std::vector<Token> &tokens1 = callback1.tokens();
+    const std::vector<Token> &tokens2 = callback2.tokens();
+    ASSERT_EQ(tokens1.size(), tokens2.size());
+    for (size_t i = 0; i < tokens1.size(); ++i) {
+      EXPECT_TOKEN_EQ(tokens1[i], tokens2[i]);
+    }
+  }
+  FileUtil::Unlink(dic_fn_without_index);
+}
+
+TEST_F(SystemDictionaryTest, BrokenReverseLookupIndexInImage) {
+  // Three keys with one token each make the index of 2-bit integers:
+  // the begin positions {0, 1, 2, 3} in the first byte after the header and
+  // the three key ids in the second byte.
+  unique_ptr<Token> t0(CreateToken("a", "A"));
+  unique_ptr<Token> t1(CreateToken("b", "B"));
+  unique_ptr<Token> t2(CreateToken("c", "C"));
+  std::vector<Token *> tokens;
+  tokens.push_back(t0.get());
+  tokens.push_back(t1.get());
+  tokens.push_back(t2.get());
+  FLAGS_build_reverse_lookup_index = true;
+  SystemDictionaryBuilder builder;
+  builder.BuildFromTokens(tokens);
+  std::ostringstream stream;
+  builder.WriteToStream("", &stream);
+  const string image = stream.str();
+
+  const DictionaryFileCodecInterface *file_codec =
+      DictionaryFileCodecFactory::GetCodec();
+  std::vector<DictionaryFileSection> sections;
+  ASSERT_TRUE(file_codec->ReadSections(image.data(), image.size(), &sections));
+  const string section_name = file_codec->GetSectionName(
+      SystemDictionaryCodecFactory::GetCodec()
+          ->GetSectionNameForReverseLookupIndex());
+  size_t offset = string::npos;
+  for (size_t i = 0; i < sections.size(); ++i) {
+    if (sections[i].name == section_name) {
+      ASSERT_EQ(4 * sizeof(uint32) + 2, sections[i].len);
+      offset = sections[i].ptr - image.data() + 4 * sizeof(uint32);
+    }
+  }
+  ASSERT_NE(string::npos, offset);
+  EXPECT_EQ('\xE4', image[offset]);
+
+  // A broken index doesn't fail the dictionary.  The lookup scans the tokens
+  // instead.
+  string broken_header_image = image;
+  // The width of the begin positions is 0.
+  broken_header_image[offset - 2 * sizeof(uint32)] = '\0';
+  string broken_begin_image = image;
+  // The begin positions {0, 2, 1, 3} are not monotonic.
+  broken_begin_image[offset] = '\xD8';
+  string broken_key_id_image = image;
+  // The key ids {3, 3, 3} are out of the key trie.
+  broken_key_id_image[offset + 1] = '\x3F';
+  const string *kImages[] = {
+      &image, &broken_header_image, &broken_begin_image, &broken_key_id_image,
+  };
+  for (size_t i = 0; i < arraysize(kImages); ++i) {
+    SCOPED_TRACE(i);
+    unique_ptr<SystemDictionary> system_dic(
+        SystemDictionary::Builder(kImages[i]->data(),
+                                  kImages[i]->size()).Build());
+    ASSERT_TRUE(system_dic.get() != NULL);
+    for (size_t j = 0; j < tokens.size(); ++j) {
+      CollectTokenCallback callback;
+      system_dic->LookupReverse(tokens[j]->value, convreq_, &callback);
+      ASSERT_EQ(1, callback.tokens().size());
+      EXPECT_EQ(tokens[j]->key, callback.tokens()[0].value);
+    }
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   const string kDoraemon = "ドラえもん";
 
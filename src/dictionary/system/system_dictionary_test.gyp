@@ -33,6 +33,7 @@
       'target_name': 'system_dictionary_codec_test',
       'type': 'executable',
       'sources': [
+        'aligned_codec_test.cc',
         'codec_test.cc',
       ],
       'dependencies': [
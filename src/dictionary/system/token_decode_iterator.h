@@ -51,6 +51,18 @@ class TokenDecodeIterator {
                       const uint32 *frequent_pos,
                       StringPiece key,
                       const uint8 *ptr);
+
+  // Decodes tokens into |token_buffer| instead of an iterator-local token.
+  // Passing the same buffer to the iterators created during one lookup lets
+  // the key and value strings keep their capacity across keys, so decoding
+  // doesn't allocate once the buffer has grown.  The buffer is overwritten for
+  // each token; callers that keep a token must copy it.
+  TokenDecodeIterator(const SystemDictionaryCodecInterface *codec,
+                      const storage::louds::LoudsTrie &value_trie,
+                      const uint32 *frequent_pos,
+                      StringPiece key,
+                      const uint8 *ptr,
+                      Token *token_buffer);
   ~TokenDecodeIterator() {}
 
   const TokenInfo& Get() const { return token_info_; }
@@ -77,14 +89,13 @@ class TokenDecodeIterator {
   const uint32 *frequent_pos_;
 
   const StringPiece key_;
-  // Katakana key will be lazily initialized.
-  string key_katakana_;
 
   State state_;
   const uint8 *ptr_;
 
   TokenInfo token_info_;
-  Token token_;
+  Token *token_;
+  Token owned_token_;
 
   DISALLOW_COPY_AND_ASSIGN(TokenDecodeIterator);
 };
@@ -103,8 +114,29 @@ inline TokenDecodeIterator::TokenDecodeIterator(
       key_(key),
       state_(HAS_NEXT),
       ptr_(ptr),
-      token_info_(nullptr) {
-  token_.key.assign(key.data(), key.size());
+      token_info_(nullptr),
+      token_(&owned_token_) {
+  token_->key.assign(key.data(), key.size());
+  NextInternal();
+}
+
+inline TokenDecodeIterator::TokenDecodeIterator(
+    const SystemDictionaryCodecInterface *codec,
+    const storage::louds::LoudsTrie &value_trie,
+    const uint32 *frequent_pos,
+    StringPiece key,
+    const uint8 *ptr,
+    Token *token_buffer)
+    : codec_(codec),
+      value_trie_(&value_trie),
+      frequent_pos_(frequent_pos),
+      key_(key),
+      state_(HAS_NEXT),
+      ptr_(ptr),
+      token_info_(nullptr),
+      token_(token_buffer) {
+  DCHECK(token_);
+  token_->key.assign(key.data(), key.size());
   NextInternal();
 }
 
@@ -121,7 +153,7 @@ inline void TokenDecodeIterator::NextInternal() {
   // Reset token_info with preserving some needed info in previous token.
   int prev_id_in_value_trie = token_info_.id_in_value_trie;
   token_info_.Clear();
-  token_info_.token = &token_;
+  token_info_.token = token_;
 
   // Do not clear key in token.
   token_info_.token->attributes = Token::NONE;
@@ -150,8 +182,8 @@ inline void TokenDecodeIterator::NextInternal() {
   // Fill remaining values.
   switch (token_info_.value_type) {
     case TokenInfo::DEFAULT_VALUE: {
-      token_.value.clear();
-      LookupValue(token_info_.id_in_value_trie, &token_.value);
+      token_->value.clear();
+      LookupValue(token_info_.id_in_value_trie, &token_->value);
       break;
     }
     case TokenInfo::SAME_AS_PREV_VALUE: {
@@ -161,14 +193,13 @@ inline void TokenDecodeIterator::NextInternal() {
       break;
     }
     case TokenInfo::AS_IS_HIRAGANA: {
-      token_.value = token_.key;
+      token_->value = token_->key;
       break;
     }
     case TokenInfo::AS_IS_KATAKANA: {
-      if (!key_.empty() && key_katakana_.empty()) {
-        Util::HiraganaToKatakana(key_, &key_katakana_);
-      }
-      token_.value = key_katakana_;
+      // Converts directly into the value buffer; HiraganaToKatakana() clears
+      // the output first.
+      Util::HiraganaToKatakana(key_, &token_->value);
       break;
     }
     default: {
@@ -178,14 +209,14 @@ inline void TokenDecodeIterator::NextInternal() {
   }
 
   if (token_info_.accent_encoding_type == TokenInfo::EMBEDDED_IN_TOKEN) {
-    token_.value.append(1, '_')
+    token_->value.append(1, '_')
                 .append(Util::StringPrintf("%d", token_info_.accent_type));
   }
 
   if (token_info_.pos_type == TokenInfo::FREQUENT_POS) {
     const uint32 pos = frequent_pos_[token_info_.id_in_frequent_pos_map];
-    token_.lid = pos >> 16;
-    token_.rid = pos & 0xffff;
+    token_->lid = pos >> 16;
+    token_->rid = pos & 0xffff;
   }
 }
 
@@ -31,9 +31,12 @@
 
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/compiler_specific.h"
 #include "base/file_util.h"
@@ -52,6 +55,8 @@
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
 #include "protocol/config.pb.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/louds_trie_builder.h"
 #include "usage_stats/usage_stats.h"
 
 namespace mozc {
@@ -85,6 +90,16 @@ struct OrderByKeyThenById {
   }
 };
 
+// The number of tokens from which prefix lookups walk a LOUDS trie over the
+// keys.  Below this, scanning the sorted tokens is faster; the trie is about 6
+// times slower on 1k tokens and about as fast on 30k tokens (see
+// user_dictionary_benchmark.cc).
+const size_t kMinTokensForKeyTrie = 30000;
+
+// The number of entries added incrementally after which the change log is
+// folded into the user dictionary file and the tokens are reloaded.
+const size_t kMaxIncrementalChanges = 64;
+
 class UserDictionaryFileManager {
  public:
   UserDictionaryFileManager() {}
@@ -121,22 +136,109 @@ void FillTokenFromUserPOSToken(const UserPOS::Token &user_pos_token,
 
 }  // namespace
 
+// Sorted token array plus, for large dictionaries, a LOUDS trie over its
+// distinct keys.  Each key ID of the trie maps to the range of tokens sharing
+// that key, so that prefix lookups cost O(|key|) trie steps instead of
+// scanning the array.  Exact lookups always use the binary search, which is
+// faster than the trie search even on 100k tokens.
+//
+// Entries added after Load() are kept as a small sorted overlay on top of the
+// immutable array, until the next Load() folds them in.
 class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
  public:
+  typedef std::pair<const_iterator, const_iterator> Range;
+
   TokensIndex(const UserPOSInterface *user_pos,
               SuppressionDictionary *suppression_dictionary)
       : user_pos_(user_pos),
-        suppression_dictionary_(suppression_dictionary) {}
+        suppression_dictionary_(suppression_dictionary),
+        auto_registered_dictionary_id_(0),
+        num_changes_(0) {}
 
   ~TokensIndex() {
     Clear();
   }
 
   void Clear() {
+    key_trie_.Close();
+    key_trie_image_.clear();
+    key_ranges_.clear();
+    STLDeleteElements(&added_tokens_);
+    dictionary_enabled_.clear();
+    auto_registered_dictionary_id_ = 0;
+    num_changes_ = 0;
     STLDeleteElements(this);
     clear();
   }
 
+  // Returns true if there's no token, including added ones.
+  bool IsEmpty() const {
+    return empty() && added_tokens_.empty();
+  }
+
+  // Calls |func| for each token whose key is a prefix of |key|; first for the
+  // loaded tokens in ascending key order, then for the added tokens.  Stops
+  // when |func| returns false.
+  template <typename Func>
+  void ForEachPrefixToken(StringPiece key, Func func) const {
+    if (!key_ranges_.empty()) {
+      storage::louds::LoudsTrie::Node node;
+      for (size_t i = 0; i < key.size(); ++i) {
+        if (!key_trie_.MoveToChildByLabel(key[i], &node)) {
+          break;
+        }
+        if (key_trie_.IsTerminalNode(node) &&
+            !ForEachToken(GetRange(key_trie_.GetKeyIdOfTerminalNode(node)),
+                          func)) {
+          return;
+        }
+      }
+    } else if (!key.empty()) {
+      // Scan the tokens from the first character of |key| up to |key|.
+      const StringPiece first_char =
+          key.substr(0, Util::OneCharLen(key.data()));
+      for (auto it = std::lower_bound(begin(), end(), first_char,
+                                      OrderByKey());
+           it != end() && StringPiece((*it)->key) <= key; ++it) {
+        const UserPOS::Token &token = **it;
+        if (Util::StartsWith(key, token.key) && !func(token)) {
+          return;
+        }
+      }
+    }
+    for (size_t i = 0; i < added_tokens_.size(); ++i) {
+      if (Util::StartsWith(key, added_tokens_[i]->key) &&
+          !func(*added_tokens_[i])) {
+        return;
+      }
+    }
+  }
+
+  // Calls |func| for each token whose key is exactly |key|.
+  template <typename Func>
+  void ForEachExactToken(StringPiece key, Func func) const {
+    if (!ForEachToken(std::equal_range(begin(), end(), key, OrderByKey()),
+                      func)) {
+      return;
+    }
+    ForEachToken(std::equal_range(added_tokens_.begin(), added_tokens_.end(),
+                                  key, OrderByKey()),
+                 func);
+  }
+
+  // Calls |func| for each token whose key starts with |key|.
+  template <typename Func>
+  void ForEachPredictiveToken(StringPiece key, Func func) const {
+    if (!ForEachToken(std::equal_range(begin(), end(), key,
+                                       OrderByKeyPrefix()),
+                      func)) {
+      return;
+    }
+    ForEachToken(std::equal_range(added_tokens_.begin(), added_tokens_.end(),
+                                  key, OrderByKeyPrefix()),
+                 func);
+  }
+
   void Load(const user_dictionary::UserDictionaryStorage &storage) {
     Clear();
     std::set<uint64> seen;
@@ -150,6 +252,11 @@ class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
     for (size_t i = 0; i < storage.dictionaries_size(); ++i) {
       const UserDictionaryStorage::UserDictionary &dic =
           storage.dictionaries(i);
+      dictionary_enabled_[dic.id()] = dic.enabled();
+      if (dic.name() ==
+          UserDictionaryStorage::auto_registered_dictionary_name()) {
+        auto_registered_dictionary_id_ = dic.id();
+      }
       if (!dic.enabled() || dic.entries_size() == 0) {
         continue;
       }
@@ -162,13 +269,8 @@ class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
           continue;
         }
 
-        string tmp, reading;
-        UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
-
-        // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
-        // because the normalization is user-visible.
-        // http://b/2480844
-        Util::NormalizeVoicedSoundMark(tmp, &reading);
+        string reading;
+        GetNormalizedReading(entry.key(), &reading);
 
         DCHECK_LE(0, entry.pos());
 MOZC_CLANG_PUSH_WARNING();
@@ -191,13 +293,9 @@ MOZC_CLANG_POP_WARNING();
         if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
           suppression_dictionary_->AddEntry(reading, entry.value());
         } else {
-          tokens.clear();
-          user_pos_->GetTokens(
-              reading, entry.value(),
-              UserDictionaryUtil::GetStringPosType(entry.pos()), &tokens);
+          GetTokens(entry, reading, &tokens);
           for (size_t k = 0; k < tokens.size(); ++k) {
             this->push_back(new UserPOS::Token(tokens[k]));
-            Util::StripWhiteSpaces(entry.comment(), &this->back()->comment);
           }
         }
       }
@@ -205,6 +303,7 @@ MOZC_CLANG_POP_WARNING();
 
     // Sort first by key and then by POS ID.
     std::sort(this->begin(), this->end(), OrderByKeyThenById());
+    BuildKeyTrie();
 
     suppression_dictionary_->UnLock();
 
@@ -214,15 +313,168 @@ MOZC_CLANG_POP_WARNING();
                                         static_cast<int>(this->size()));
   }
 
+  // Returns true if |dictionary_id| was loaded, and stores whether the
+  // dictionary is enabled in |enabled|.  0 stands for the auto registered
+  // dictionary, which is regarded as enabled until it is created.
+  bool FindDictionary(uint64 dictionary_id, bool *enabled) const {
+    if (dictionary_id == 0) {
+      if (auto_registered_dictionary_id_ == 0) {
+        *enabled = true;
+        return true;
+      }
+      dictionary_id = auto_registered_dictionary_id_;
+    }
+    const auto it = dictionary_enabled_.find(dictionary_id);
+    if (it == dictionary_enabled_.end()) {
+      return false;
+    }
+    *enabled = it->second;
+    return true;
+  }
+
+  // Adds the tokens of |entry| on top of the loaded ones.  The tokens which
+  // are already loaded or added are not added again.
+  void AddEntry(const UserDictionaryStorage::UserDictionaryEntry &entry) {
+    string reading;
+    GetNormalizedReading(entry.key(), &reading);
+    ++num_changes_;
+    if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+      suppression_dictionary_->Lock();
+      suppression_dictionary_->AddEntry(reading, entry.value());
+      suppression_dictionary_->UnLock();
+      return;
+    }
+    std::vector<UserPOS::Token> tokens;
+    GetTokens(entry, reading, &tokens);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      const UserPOS::Token &token = tokens[i];
+      if (Contains(*this, token) || Contains(added_tokens_, token)) {
+        continue;
+      }
+      added_tokens_.insert(
+          std::upper_bound(added_tokens_.begin(), added_tokens_.end(), &token,
+                           OrderByKeyThenById()),
+          new UserPOS::Token(token));
+    }
+  }
+
+  // Returns the number of entries added since Load().
+  size_t num_changes() const { return num_changes_; }
+
  private:
+  // Returns true if |tokens|, sorted by OrderByKeyThenById, has a token of
+  // the same key, value and POS as |token|.
+  static bool Contains(const std::vector<UserPOS::Token *> &tokens,
+                       const UserPOS::Token &token) {
+    for (auto range = std::equal_range(tokens.begin(), tokens.end(),
+                                       token.key, OrderByKey());
+         range.first != range.second; ++range.first) {
+      const UserPOS::Token &other = **range.first;
+      if (other.id == token.id && other.value == token.value) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void GetNormalizedReading(const string &key, string *reading) {
+    string tmp;
+    UserDictionaryUtil::NormalizeReading(key, &tmp);
+
+    // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
+    // because the normalization is user-visible.
+    // http://b/2480844
+    Util::NormalizeVoicedSoundMark(tmp, reading);
+  }
+
+  void GetTokens(const UserDictionaryStorage::UserDictionaryEntry &entry,
+                 const string &reading,
+                 std::vector<UserPOS::Token> *tokens) const {
+    tokens->clear();
+    user_pos_->GetTokens(
+        reading, entry.value(),
+        UserDictionaryUtil::GetStringPosType(entry.pos()), tokens);
+    for (size_t i = 0; i < tokens->size(); ++i) {
+      Util::StripWhiteSpaces(entry.comment(), &(*tokens)[i].comment);
+    }
+  }
+
+  // Calls |func| for the tokens in |range|.  Returns false if |func| returns
+  // false.
+  template <typename Func>
+  bool ForEachToken(Range range, Func func) const {
+    for (; range.first != range.second; ++range.first) {
+      if (!func(**range.first)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  Range GetRange(int key_id) const {
+    if (key_id < 0 || key_id >= key_ranges_.size()) {
+      return Range(end(), end());
+    }
+    const std::pair<uint32, uint32> &range = key_ranges_[key_id];
+    return Range(begin() + range.first, begin() + range.second);
+  }
+
+  // Builds |key_trie_| from the distinct keys of the sorted tokens, unless
+  // there are too few tokens to benefit from it.
+  void BuildKeyTrie() {
+    if (this->size() < kMinTokensForKeyTrie) {
+      return;
+    }
+    storage::louds::LoudsTrieBuilder builder;
+    std::vector<size_t> key_begins;
+    for (size_t i = 0; i < this->size(); ++i) {
+      if (i == 0 || (*this)[i]->key != (*this)[i - 1]->key) {
+        builder.Add((*this)[i]->key);
+        key_begins.push_back(i);
+      }
+    }
+    builder.Build();
+
+    key_ranges_.resize(key_begins.size());
+    for (size_t i = 0; i < key_begins.size(); ++i) {
+      const size_t key_end =
+          i + 1 < key_begins.size() ? key_begins[i + 1] : this->size();
+      const int key_id = builder.GetId((*this)[key_begins[i]]->key);
+      DCHECK_GE(key_id, 0);
+      DCHECK_LT(key_id, key_ranges_.size());
+      key_ranges_[key_id] = std::make_pair(static_cast<uint32>(key_begins[i]),
+                                           static_cast<uint32>(key_end));
+    }
+
+    key_trie_image_ = builder.image();
+    if (!key_trie_.Open(
+            reinterpret_cast<const uint8 *>(key_trie_image_.data()))) {
+      LOG(ERROR) << "Failed to open the key trie of user dictionary";
+      key_ranges_.clear();
+    }
+  }
+
   const UserPOSInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
+
+  // Image of |key_trie_|; the trie refers to this buffer.
+  string key_trie_image_;
+  storage::louds::LoudsTrie key_trie_;
+  // Token range [first, second) in this vector indexed by key ID.
+  std::vector<std::pair<uint32, uint32>> key_ranges_;
+
+  // Tokens added after Load(), sorted by OrderByKeyThenById.
+  std::vector<UserPOS::Token *> added_tokens_;
+  // Whether each loaded dictionary is enabled, keyed by dictionary ID.
+  std::map<uint64, bool> dictionary_enabled_;
+  uint64 auto_registered_dictionary_id_;
+  size_t num_changes_;
 };
 
 class UserDictionary::UserDictionaryReloader : public Thread {
  public:
   explicit UserDictionaryReloader(UserDictionary *dic)
-      : modified_at_(0), auto_register_mode_(false), dic_(dic) {
+      : modified_at_(0), dic_(dic) {
     DCHECK(dic_);
   }
 
@@ -230,16 +482,8 @@ class UserDictionary::UserDictionaryReloader : public Thread {
     Join();
   }
 
-  void StartAutoRegistration(const string &key,
-                             const string &value,
-                             user_dictionary::UserDictionary::PosType pos) {
-    {
-      scoped_lock l(&mutex_);
-      auto_register_mode_ = true;
-      key_ = key;
-      value_ = value;
-      pos_ = pos;
-    }
+  // Folds the change log into the user dictionary file and reloads it.
+  void StartCompaction() {
     Start("UserDictionaryReloader");
   }
 
@@ -248,8 +492,7 @@ class UserDictionary::UserDictionaryReloader : public Thread {
   bool MaybeStartReload() {
     FileTimeStamp modification_time;
     if (!FileUtil::GetModificationTime(
-        Singleton<UserDictionaryFileManager>::get()->GetFileName(),
-        &modification_time)) {
+        dic_->GetFileName(), &modification_time)) {
       // If the file doesn't exist, return doing nothing.
       // Therefore if the file is deleted after first reload,
       // second reload does nothing so the content loaded by first reload
@@ -265,41 +508,34 @@ class UserDictionary::UserDictionaryReloader : public Thread {
   }
 
   void Run() override {
-    std::unique_ptr<UserDictionaryStorage> storage(new UserDictionaryStorage(
-        Singleton<UserDictionaryFileManager>::get()->GetFileName()));
+    const string filename = dic_->GetFileName();
+    std::unique_ptr<UserDictionaryStorage> storage(
+        new UserDictionaryStorage(filename));
 
-    // Load from file
-    if (!storage->Load()) {
+    // Load from file.  The changes in the change log are applied too, which
+    // may exist without the file.
+    if (!storage->Load() && storage->num_pending_changes() == 0) {
       return;
     }
 
-    if (storage->ConvertSyncDictionariesToNormalDictionaries()) {
+    const bool converted =
+        storage->ConvertSyncDictionariesToNormalDictionaries();
+    if (converted) {
       LOG(INFO) << "Syncable dictionaries are converted to normal dictionaries";
-      if (storage->Lock()) {
-        storage->Save();
-        storage->UnLock();
-      }
     }
-
-    if (auto_register_mode_ &&
-        !storage->AddToAutoRegisteredDictionary(key_, value_, pos_)) {
-      LOG(ERROR) << "failed to execute AddToAutoRegisteredDictionary";
-      auto_register_mode_ = false;
-      return;
+    if ((converted || storage->num_pending_changes() > 0) && storage->Lock()) {
+      storage->Save();
+      storage->UnLock();
+      // Don't reload the file just saved by ourselves.
+      FileUtil::GetModificationTime(filename, &modified_at_);
     }
 
-    auto_register_mode_ = false;
     dic_->Load(*(storage.get()));
   }
 
  private:
   FileTimeStamp modified_at_;
-  Mutex mutex_;
-  bool auto_register_mode_;
   UserDictionary *dic_;
-  string key_;
-  string value_;
-  user_dictionary::UserDictionary::PosType pos_;
 
   DISALLOW_COPY_AND_ASSIGN(UserDictionaryReloader);
 };
@@ -307,13 +543,21 @@ class UserDictionary::UserDictionaryReloader : public Thread {
 UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
                                POSMatcher pos_matcher,
                                SuppressionDictionary *suppression_dictionary)
+    : UserDictionary(user_pos, pos_matcher, suppression_dictionary, "") {}
+
+UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
+                               POSMatcher pos_matcher,
+                               SuppressionDictionary *suppression_dictionary,
+                               const string &user_profile_directory)
     : ALLOW_THIS_IN_INITIALIZER_LIST(
           reloader_(new UserDictionaryReloader(this))),
       user_pos_(user_pos),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
       tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)),
-      mutex_(new ReaderWriterMutex) {
+      mutex_(new ReaderWriterMutex),
+      generation_(0),
+      user_profile_directory_(user_profile_directory) {
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
@@ -324,6 +568,14 @@ UserDictionary::~UserDictionary() {
   delete tokens_;
 }
 
+string UserDictionary::GetFileName() const {
+  if (user_profile_directory_.empty()) {
+    return Singleton<UserDictionaryFileManager>::get()->GetFileName();
+  }
+  return UserDictionaryUtil::GetUserDictionaryFileName(
+      user_profile_directory_);
+}
+
 bool UserDictionary::HasKey(StringPiece key) const {
   // TODO(noriyukit): Currently, we don't support HasKey() for user dictionary
   // because we need to search tokens linearly, which might be slow in extreme
@@ -349,25 +601,22 @@ void UserDictionary::LookupPredictive(
     VLOG(2) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens_->IsEmpty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
     return;
   }
 
-  // Find the starting point of iteration over dictionary contents.
   Token token;
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKeyPrefix());
-       range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
+  tokens_->ForEachPredictiveToken(
+      key, [&](const UserPOS::Token &user_pos_token) {
     switch (callback->OnKey(user_pos_token.key)) {
       case Callback::TRAVERSE_DONE:
-        return;
+        return false;
       case Callback::TRAVERSE_NEXT_KEY:
       case Callback::TRAVERSE_CULL:
-        continue;
+        return true;
       default:
         break;
     }
@@ -376,11 +625,9 @@ void UserDictionary::LookupPredictive(
     if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
       token.lid = token.rid = pos_matcher_.GetUnknownId();
     }
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
-        Callback::TRAVERSE_DONE) {
-      return;
-    }
-  }
+    return callback->OnToken(user_pos_token.key, user_pos_token.key, token) !=
+           Callback::TRAVERSE_DONE;
+  });
 }
 
 // UserDictionary doesn't support kana modifier insensitive lookup.
@@ -394,34 +641,25 @@ void UserDictionary::LookupPrefix(
     LOG(WARNING) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens_->IsEmpty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
     return;
   }
 
-  // Find the starting point for iteration over dictionary contents.
-  const StringPiece first_char = key.substr(0, Util::OneCharLen(key.data()));
+  // Walk down the key trie; each registered prefix of |key| yields the tokens
+  // sharing that prefix as their key, in ascending key order.
   Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
-    const UserPOS::Token &user_pos_token = **it;
-    if (user_pos_token.key > key) {
-      break;
-    }
+  tokens_->ForEachPrefixToken(key, [&](const UserPOS::Token &user_pos_token) {
     if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
-      continue;
-    }
-    if (!Util::StartsWith(key, user_pos_token.key)) {
-      continue;
+      return true;
     }
     switch (callback->OnKey(user_pos_token.key)) {
       case Callback::TRAVERSE_DONE:
-        return;
+        return false;
       case Callback::TRAVERSE_NEXT_KEY:
-        continue;
+        return true;
       case Callback::TRAVERSE_CULL:
         LOG(FATAL) << "UserDictionary doesn't support culling.";
         break;
@@ -431,14 +669,15 @@ void UserDictionary::LookupPrefix(
     FillTokenFromUserPOSToken(user_pos_token, &token);
     switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
       case Callback::TRAVERSE_DONE:
-        return;
+        return false;
       case Callback::TRAVERSE_CULL:
         LOG(FATAL) << "UserDictionary doesn't support culling.";
         break;
       default:
         break;
     }
-  }
+    return true;
+  });
 }
 
 void UserDictionary::LookupExact(
@@ -446,30 +685,26 @@ void UserDictionary::LookupExact(
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   scoped_reader_lock l(mutex_.get());
-  if (key.empty() || tokens_->empty() ||
+  if (key.empty() || tokens_->IsEmpty() ||
       conversion_request.config().incognito_mode()) {
     return;
   }
-  auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                OrderByKey());
-  if (range.first == range.second) {
-    return;
-  }
-  if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
-    return;
-  }
 
+  bool key_found = false;
   Token token;
-  for (; range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
+  tokens_->ForEachExactToken(key, [&](const UserPOS::Token &user_pos_token) {
+    if (!key_found) {
+      key_found = true;
+      if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
+        return false;
+      }
+    }
     if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
-      continue;
+      return true;
     }
     FillTokenFromUserPOSToken(user_pos_token, &token);
-    if (callback->OnToken(key, key, token) != Callback::TRAVERSE_CONTINUE) {
-      return;
-    }
-  }
+    return callback->OnToken(key, key, token) == Callback::TRAVERSE_CONTINUE;
+  });
 }
 
 void UserDictionary::LookupReverse(
@@ -486,21 +721,21 @@ bool UserDictionary::LookupComment(StringPiece key, StringPiece value,
   }
 
   scoped_reader_lock l(mutex_.get());
-  if (tokens_->empty()) {
+  if (tokens_->IsEmpty()) {
     return false;
   }
 
   // Set the comment that was found first.
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKey());
-       range.first != range.second; ++range.first) {
-    const UserPOS::Token &token = **range.first;
+  bool found = false;
+  tokens_->ForEachExactToken(key, [&](const UserPOS::Token &token) {
     if (token.value == value && !token.comment.empty()) {
       comment->assign(token.comment);
-      return true;
+      found = true;
+      return false;
     }
-  }
-  return false;
+    return true;
+  });
+  return found;
 }
 
 bool UserDictionary::Reload() {
@@ -513,10 +748,17 @@ bool UserDictionary::Reload() {
   // reloader.  When not started, need to unlock it here.
   if (!reloader_->MaybeStartReload()) {
     suppression_dictionary_->UnLock();
+    return true;
   }
+  // Suppression doesn't work until the reloader finishes.
+  ++generation_;
   return true;
 }
 
+uint64 UserDictionary::GetGeneration() const {
+  return generation_.load();
+}
+
 namespace {
 
 class FindValueCallback : public DictionaryInterface::Callback {
@@ -558,10 +800,57 @@ bool UserDictionary::AddToAutoRegisteredDictionary(
     return false;
   }
 
-  suppression_dictionary_->Lock();
-  DCHECK(suppression_dictionary_->IsLocked());
-  reloader_->StartAutoRegistration(key, value, pos);
+  UserDictionaryStorage::UserDictionaryChange change;
+  change.set_type(UserDictionaryStorage::UserDictionaryChange::ADD_ENTRY);
+  UserDictionaryStorage::UserDictionaryEntry *entry = change.mutable_entry();
+  entry->set_key(key);
+  entry->set_value(value);
+  entry->set_pos(pos);
+  entry->set_auto_registered(true);
+  return ApplyChange(change);
+}
+
+bool UserDictionary::ApplyChange(
+    const user_dictionary::UserDictionaryChange &change) {
+  DCHECK_EQ(UserDictionaryStorage::UserDictionaryChange::ADD_ENTRY,
+            change.type());
+  // The reloader may be folding the change log into the file.
+  if (reloader_->IsRunning()) {
+    return false;
+  }
+  if (!UserDictionaryUtil::IsValidEntry(*user_pos_, change.entry())) {
+    return false;
+  }
 
+  bool enabled = false;
+  {
+    scoped_reader_lock l(mutex_.get());
+    if (!tokens_->FindDictionary(change.dictionary_id(), &enabled)) {
+      LOG(ERROR) << "Unknown dictionary id: " << change.dictionary_id();
+      return false;
+    }
+  }
+
+  UserDictionaryStorage storage(GetFileName());
+  if (!storage.AppendChange(change)) {
+    LOG(ERROR) << "cannot append to the change log";
+    return false;
+  }
+
+  // Entries of disabled dictionaries are not visible.
+  bool needs_compaction = false;
+  if (enabled) {
+    scoped_writer_lock l(mutex_.get());
+    tokens_->AddEntry(change.entry());
+    needs_compaction = tokens_->num_changes() >= kMaxIncrementalChanges;
+    ++generation_;
+  }
+
+  if (needs_compaction) {
+    suppression_dictionary_->Lock();
+    DCHECK(suppression_dictionary_->IsLocked());
+    reloader_->StartCompaction();
+  }
   return true;
 }
 
@@ -576,6 +865,7 @@ void UserDictionary::Swap(TokensIndex *new_tokens) {
     scoped_writer_lock l(mutex_.get());
     tokens_ = new_tokens;
   }
+  ++generation_;
   delete old_tokens;
 }
 
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -53,6 +54,12 @@ class UserDictionary : public DictionaryInterface {
   UserDictionary(const UserPOSInterface *user_pos,
                  POSMatcher pos_matcher,
                  SuppressionDictionary *suppression_dictionary);
+  // The dictionary file is read from |user_profile_directory| instead of the
+  // user profile directory of the process unless it is empty.
+  UserDictionary(const UserPOSInterface *user_pos,
+                 POSMatcher pos_matcher,
+                 SuppressionDictionary *suppression_dictionary,
+                 const string &user_profile_directory);
   ~UserDictionary() override;
 
   bool HasKey(StringPiece key) const override;
@@ -87,13 +94,18 @@ class UserDictionary : public DictionaryInterface {
   // Reloads dictionary asynchronously
   bool Reload() override;
 
+  // Incremented whenever the entries or the suppression dictionary change.
+  uint64 GetGeneration() const override;
+
   // Waits until reloader finishes
   void WaitForReloader();
 
-  // Adds new word to auto registered dictionary and reload asynchronously.
-  // Note that this method will not guarantee that
-  // new word is added successfully, since the actual
-  // dictionary modification is done by other thread.
+  // Adds new word to auto registered dictionary without reloading the whole
+  // dictionary.  The word is visible to lookups on return, and is persisted by
+  // appending it to the change log of the dictionary file, which is folded
+  // into the file in the background after a number of additions.  Returns
+  // false if the word is already registered or the addition is rejected,
+  // e.g., while the dictionary is being reloaded.
   // Also, this method should be called by the main converter thread which
   // is executed synchronously with user input.
   bool AddToAutoRegisteredDictionary(
@@ -111,12 +123,21 @@ class UserDictionary : public DictionaryInterface {
   // Swaps internal tokens index to |new_tokens|.
   void Swap(TokensIndex *new_tokens);
 
+  // Persists |change|, which adds an entry, and applies it to the current
+  // tokens index.
+  bool ApplyChange(const user_dictionary::UserDictionaryChange &change);
+
+  // Returns the path of the user dictionary file.
+  string GetFileName() const;
+
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPOSInterface> user_pos_;
   const POSMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
   TokensIndex *tokens_;
   mutable std::unique_ptr<ReaderWriterMutex> mutex_;
+  std::atomic<uint64> generation_;
+  const string user_profile_directory_;
 
   friend class UserDictionaryTest;
   DISALLOW_COPY_AND_ASSIGN(UserDictionary);
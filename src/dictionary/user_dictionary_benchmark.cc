@@ -0,0 +1,257 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Lookup benchmark of UserDictionary.
+//
+// Loads user dictionaries of the given sizes with random hiragana readings of
+// 2 to 8 characters, and reports the loading time and the average latency of
+// LookupPrefix (a registered reading followed by the rest of the input, the
+// way the converter looks it up) and LookupExact calls.  Small dictionaries
+// are looked up by scanning the sorted tokens and large ones by walking a
+// LOUDS trie over the keys; see kMinTokensForKeyTrie in user_dictionary.cc.
+//
+// With --registration, also reports how long it takes for a word added by
+// AddToAutoRegisteredDictionary() to become visible, and compares it with
+// rewriting and reloading the dictionary file, which is how the word used to
+// become visible.
+//
+// Usage:
+//   user_dictionary_benchmark --sizes=1000,10000,100000 --lookups=200000
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/util.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/pos_matcher.h"
+#include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary.h"
+#include "dictionary/user_dictionary_storage.h"
+#include "dictionary/user_pos.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "request/conversion_request.h"
+#include "testing/base/public/googletest.h"
+
+DEFINE_string(sizes, "1000,3000,10000,30000,100000",
+              "Comma separated list of the numbers of entries.");
+DEFINE_int32(lookups, 200000, "Number of lookups for each size.");
+DEFINE_bool(registration, true,
+            "Also measures the latency of registering a word.");
+
+namespace mozc {
+namespace {
+
+using dictionary::DictionaryInterface;
+using dictionary::POSMatcher;
+using dictionary::SuppressionDictionary;
+using dictionary::Token;
+using dictionary::UserDictionary;
+using dictionary::UserPOS;
+
+class CountingCallback : public DictionaryInterface::Callback {
+ public:
+  CountingCallback() : num_tokens_(0) {}
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    ++num_tokens_;
+    return TRAVERSE_CONTINUE;
+  }
+
+  int num_tokens() const { return num_tokens_; }
+
+ private:
+  int num_tokens_;
+};
+
+// Returns random readings of "ぁ" to "ゖ".
+std::vector<string> GenerateKeys(int size) {
+  const char32 kFirstHiragana = 0x3041;
+  const int kNumHiragana = 86;
+  Util::SetRandomSeed(size);
+  std::vector<string> keys(size);
+  for (int i = 0; i < size; ++i) {
+    const int length = 2 + Util::Random(7);
+    for (int j = 0; j < length; ++j) {
+      Util::UCS4ToUTF8Append(kFirstHiragana + Util::Random(kNumHiragana),
+                             &keys[i]);
+    }
+  }
+  return keys;
+}
+
+void FillStorage(const std::vector<string> &keys,
+                 user_dictionary::UserDictionaryStorage *storage) {
+  user_dictionary::UserDictionary *user_dic = storage->add_dictionaries();
+  user_dic->set_id(1);
+  user_dic->set_name("benchmark");
+  for (size_t i = 0; i < keys.size(); ++i) {
+    user_dictionary::UserDictionary::Entry *entry = user_dic->add_entries();
+    entry->set_key(keys[i]);
+    entry->set_value("v" + std::to_string(i));
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+  }
+}
+
+void RunBenchmark(int size, UserDictionary *dic) {
+  const std::vector<string> keys = GenerateKeys(size);
+  {
+    user_dictionary::UserDictionaryStorage storage;
+    FillStorage(keys, &storage);
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    dic->Load(storage);
+    std::cout << "entries: " << size
+              << "\tload(ms): " << stopwatch.GetElapsedMilliseconds();
+  }
+
+  const ConversionRequest request;
+  int num_found = 0;
+  Stopwatch prefix_stopwatch;
+  Stopwatch exact_stopwatch;
+  for (int i = 0; i < FLAGS_lookups; ++i) {
+    const string &key = keys[i % keys.size()];
+    CountingCallback callback;
+    if (i % 2 == 0) {
+      prefix_stopwatch.Start();
+      dic->LookupPrefix(key + "かなにゅうりょく", request, &callback);
+      prefix_stopwatch.Stop();
+    } else {
+      exact_stopwatch.Start();
+      dic->LookupExact(key, request, &callback);
+      exact_stopwatch.Stop();
+    }
+    num_found += callback.num_tokens();
+  }
+  const int num_calls = FLAGS_lookups / 2;
+  std::cout << "\tprefix(us/call): "
+            << prefix_stopwatch.GetElapsedMicroseconds() / num_calls
+            << "\texact(us/call): "
+            << exact_stopwatch.GetElapsedMicroseconds() / num_calls
+            << "\ttokens found: " << num_found << std::endl;
+}
+
+// Registers words one by one to a dictionary file of |size| entries.
+void RunRegistrationBenchmark(int size,
+                              const testing::MockDataManager &data_manager) {
+  const string filename =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "user_dictionary_benchmark.db");
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
+  {
+    UserDictionaryStorage storage(filename);
+    FillStorage(GenerateKeys(size), &storage);
+    if (!storage.Lock() || !storage.Save()) {
+      LOG(ERROR) << "Cannot save " << filename;
+      return;
+    }
+    storage.UnLock();
+  }
+  UserDictionary::SetUserDictionaryName(filename);
+
+  SuppressionDictionary suppression_dictionary;
+  UserDictionary dic(UserPOS::CreateFromDataManager(data_manager),
+                     POSMatcher(data_manager.GetPOSMatcherData()),
+                     &suppression_dictionary);
+  dic.WaitForReloader();
+
+  // Fewer than the additions which trigger the compaction in background.
+  const int kNumWords = 10;
+  const ConversionRequest request;
+  Stopwatch add_stopwatch;
+  Stopwatch reload_stopwatch;
+  for (int i = 0; i < kNumWords; ++i) {
+    add_stopwatch.Start();
+    const bool added = dic.AddToAutoRegisteredDictionary(
+        "たんご" + std::to_string(i), "単語" + std::to_string(i), request,
+        user_dictionary::UserDictionary::NOUN);
+    add_stopwatch.Stop();
+    LOG_IF(ERROR, !added) << "Failed to register a word";
+
+    // What the registration used to do: rewrite the file and reload it.
+    reload_stopwatch.Start();
+    UserDictionaryStorage storage(filename);
+    if (storage.Load() && storage.Lock()) {
+      storage.Save();
+      storage.UnLock();
+      dic.Load(storage);
+    }
+    reload_stopwatch.Stop();
+  }
+  std::cout << "entries: " << size << "\tregister(ms/word): "
+            << add_stopwatch.GetElapsedMicroseconds() / kNumWords / 1000
+            << "\trewrite and reload(ms): "
+            << reload_stopwatch.GetElapsedMicroseconds() / kNumWords / 1000
+            << std::endl;
+
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
+}
+
+int Run() {
+  std::vector<string> sizes;
+  Util::SplitStringUsing(FLAGS_sizes, ",", &sizes);
+
+  const testing::MockDataManager data_manager;
+  SuppressionDictionary suppression_dictionary;
+  UserDictionary dic(UserPOS::CreateFromDataManager(data_manager),
+                     POSMatcher(data_manager.GetPOSMatcherData()),
+                     &suppression_dictionary);
+  // Wait for the reload called from the constructor.
+  dic.WaitForReloader();
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    RunBenchmark(std::stoi(sizes[i]), &dic);
+  }
+  if (FLAGS_registration) {
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      RunRegistrationBenchmark(std::stoi(sizes[i]), data_manager);
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  mozc::InitTestFlags();
+  // Never reads the user dictionary of the user.
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  return mozc::Run();
+}
@@ -30,6 +30,7 @@
 #include "dictionary/user_dictionary_storage.h"
 
 #include <algorithm>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -64,6 +65,16 @@ const char kAutoRegisteredDictionaryName[] = "自動登録単語";
 const char kDefaultSyncDictionaryName[] = "Sync Dictionary";
 const char *kDictionaryNameConvertedFromSyncableDictionary = "同期用辞書";
 
+// Each record of the change log is a serialized UserDictionaryChange prefixed
+// by its byte size in 32-bit little endian.
+const size_t kChangeLogRecordHeaderSize = 4;
+
+bool IsSameEntry(const user_dictionary::UserDictionary::Entry &lhs,
+                 const user_dictionary::UserDictionary::Entry &rhs) {
+  return lhs.key() == rhs.key() && lhs.value() == rhs.value() &&
+         lhs.pos() == rhs.pos();
+}
+
 }  // namespace
 
 using ::mozc::user_dictionary::UserDictionaryCommandStatus;
@@ -71,6 +82,7 @@ using ::mozc::user_dictionary::UserDictionaryCommandStatus;
 UserDictionaryStorage::UserDictionaryStorage(const string &file_name)
     : file_name_(file_name),
       locked_(false),
+      num_pending_changes_(0),
       last_error_type_(USER_DICTIONARY_STORAGE_NO_ERROR),
       local_mutex_(new Mutex),
       process_mutex_(new ProcessMutex(FileUtil::Basename(file_name).c_str())) {}
@@ -136,6 +148,11 @@ bool UserDictionaryStorage::Load() {
     result = false;
   }
 
+  // Changes applied here keep |last_error_type_| of the file loading.
+  const UserDictionaryStorageErrorType last_error_type = last_error_type_;
+  num_pending_changes_ = LoadChangeLog();
+  last_error_type_ = last_error_type;
+
   // Check dictionary id here. if id is 0, assign random ID.
   for (int i = 0; i < dictionaries_size(); ++i) {
     const UserDictionary &dict = dictionaries(i);
@@ -190,6 +207,14 @@ bool UserDictionaryStorage::Save() {
     return false;
   }
 
+  // The saved file contains all the changes in the change log.
+  const string change_log_file_name = change_log_filename();
+  if (FileUtil::FileExists(change_log_file_name) &&
+      !FileUtil::Unlink(change_log_file_name)) {
+    LOG(ERROR) << "cannot remove the change log: " << change_log_file_name;
+  }
+  num_pending_changes_ = 0;
+
   if (last_error_type_ == TOO_BIG_FILE_BYTES) {
     return false;
   }
@@ -197,6 +222,133 @@ bool UserDictionaryStorage::Save() {
   return true;
 }
 
+string UserDictionaryStorage::change_log_filename() const {
+  return file_name_ + ".log";
+}
+
+bool UserDictionaryStorage::AppendChange(const UserDictionaryChange &change) {
+  last_error_type_ = USER_DICTIONARY_STORAGE_NO_ERROR;
+
+  if (!Lock()) {
+    LOG(ERROR) << "cannot lock the user dictionary storage";
+    last_error_type_ = SYNC_FAILURE;
+    return false;
+  }
+
+  const uint32 size = change.ByteSize();
+  string record;
+  record.reserve(kChangeLogRecordHeaderSize + size);
+  for (size_t i = 0; i < kChangeLogRecordHeaderSize; ++i) {
+    record.push_back(static_cast<char>((size >> (8 * i)) & 0xFF));
+  }
+  change.AppendToString(&record);
+
+  const string change_log_file_name = change_log_filename();
+  {
+    OutputFileStream ofs(change_log_file_name.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::app);
+    if (ofs) {
+      ofs.write(record.data(), record.size());
+      ofs.flush();
+    }
+    if (!ofs) {
+      LOG(ERROR) << "cannot append to the change log: "
+                 << change_log_file_name;
+      last_error_type_ = SYNC_FAILURE;
+      UnLock();
+      return false;
+    }
+  }
+
+  UnLock();
+  return true;
+}
+
+bool UserDictionaryStorage::ApplyChange(const UserDictionaryChange &change) {
+  UserDictionary *dic = NULL;
+  if (change.has_dictionary_id()) {
+    dic = GetUserDictionary(change.dictionary_id());
+  } else {
+    dic = GetAutoRegisteredDictionary(
+        change.type() == UserDictionaryChange::ADD_ENTRY);
+  }
+  if (dic == NULL) {
+    if (last_error_type_ == USER_DICTIONARY_STORAGE_NO_ERROR) {
+      last_error_type_ = INVALID_DICTIONARY_ID;
+    }
+    return false;
+  }
+
+  // Changes may be applied more than once, e.g., when the log is replayed on
+  // top of the contents loaded from the previous log, so they are idempotent.
+  const UserDictionaryEntry &entry = change.entry();
+  switch (change.type()) {
+    case UserDictionaryChange::ADD_ENTRY:
+      for (int i = 0; i < dic->entries_size(); ++i) {
+        if (IsSameEntry(dic->entries(i), entry)) {
+          return true;
+        }
+      }
+      if (dic->entries_size() >= max_entry_size()) {
+        last_error_type_ = TOO_MANY_ENTRIES;
+        LOG(ERROR) << "too many entries";
+        return false;
+      }
+      dic->add_entries()->CopyFrom(entry);
+      return true;
+    case UserDictionaryChange::DELETE_ENTRY: {
+      // Deletes all the duplicates as they share the same tokens.
+      int size = 0;
+      for (int i = 0; i < dic->entries_size(); ++i) {
+        if (!IsSameEntry(dic->entries(i), entry)) {
+          dic->mutable_entries()->SwapElements(size++, i);
+        }
+      }
+      dic->mutable_entries()->DeleteSubrange(size, dic->entries_size() - size);
+      return true;
+    }
+    default:
+      LOG(ERROR) << "Unknown change type: " << change.type();
+      last_error_type_ = UNKNOWN_ERROR;
+      return false;
+  }
+}
+
+size_t UserDictionaryStorage::LoadChangeLog() {
+  const string change_log_file_name = change_log_filename();
+  InputFileStream ifs(change_log_file_name.c_str(), std::ios::binary);
+  if (!ifs) {
+    return 0;
+  }
+  const string log((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+
+  size_t num_changes = 0;
+  UserDictionaryChange change;
+  for (size_t pos = 0; pos + kChangeLogRecordHeaderSize <= log.size();) {
+    uint32 size = 0;
+    for (size_t i = 0; i < kChangeLogRecordHeaderSize; ++i) {
+      size |= static_cast<uint32>(static_cast<uint8>(log[pos + i])) << (8 * i);
+    }
+    pos += kChangeLogRecordHeaderSize;
+    if (size > log.size() - pos) {
+      // The last record was not completely written.
+      LOG(WARNING) << "Truncated record in " << change_log_file_name;
+      break;
+    }
+    if (!change.ParseFromArray(log.data() + pos, size)) {
+      LOG(ERROR) << "Broken record in " << change_log_file_name;
+      break;
+    }
+    pos += size;
+    if (!ApplyChange(change)) {
+      LOG(WARNING) << "Failed to apply a change in " << change_log_file_name;
+    }
+    ++num_changes;
+  }
+  return num_changes;
+}
+
 bool UserDictionaryStorage::Lock() {
   scoped_lock l(local_mutex_.get());
   locked_ = process_mutex_->Lock();
@@ -343,6 +495,27 @@ UserDictionaryStorage::GetLastError() const {
   return last_error_type_;
 }
 
+user_dictionary::UserDictionary *
+UserDictionaryStorage::GetAutoRegisteredDictionary(bool create) {
+  for (int i = 0; i < dictionaries_size(); ++i) {
+    if (dictionaries(i).name() == kAutoRegisteredDictionaryName) {
+      return mutable_dictionaries(i);
+    }
+  }
+  if (!create) {
+    return NULL;
+  }
+  if (UserDictionaryUtil::IsStorageFull(*this)) {
+    last_error_type_ = TOO_MANY_DICTIONARIES;
+    LOG(ERROR) << "too many dictionaries";
+    return NULL;
+  }
+  UserDictionary *dic = add_dictionaries();
+  dic->set_id(UserDictionaryUtil::CreateNewDictionaryId(*this));
+  dic->set_name(kAutoRegisteredDictionaryName);
+  return dic;
+}
+
 // Add new entry to the auto registered dictionary.
 bool UserDictionaryStorage::AddToAutoRegisteredDictionary(
     const string &key, const string &value, UserDictionary::PosType pos) {
@@ -351,29 +524,7 @@ bool UserDictionaryStorage::AddToAutoRegisteredDictionary(
     return false;
   }
 
-  int auto_index = -1;
-  for (int i = 0; i < dictionaries_size(); ++i) {
-    if (dictionaries(i).name() == kAutoRegisteredDictionaryName) {
-      auto_index = i;
-      break;
-    }
-  }
-
-  UserDictionary *dic = NULL;
-  if (auto_index == -1) {
-    if (UserDictionaryUtil::IsStorageFull(*this)) {
-      last_error_type_ = TOO_MANY_DICTIONARIES;
-      LOG(ERROR) << "too many dictionaries";
-      UnLock();
-      return false;
-    }
-    dic = add_dictionaries();
-    dic->set_id(UserDictionaryUtil::CreateNewDictionaryId(*this));
-    dic->set_name(kAutoRegisteredDictionaryName);
-  } else {
-    dic = mutable_dictionaries(auto_index);
-  }
-
+  UserDictionary *dic = GetAutoRegisteredDictionary(true);
   if (dic == NULL) {
     LOG(ERROR) << "cannot add a new dictionary.";
     UnLock();
@@ -517,4 +668,8 @@ string UserDictionaryStorage::default_sync_dictionary_name() {
   return string(kDefaultSyncDictionaryName);
 }
 
+string UserDictionaryStorage::auto_registered_dictionary_name() {
+  return string(kAutoRegisteredDictionaryName);
+}
+
 }  // namespace mozc
@@ -78,6 +78,7 @@ class UserDictionaryStorage : public user_dictionary::UserDictionaryStorage {
  public:
   typedef user_dictionary::UserDictionary UserDictionary;
   typedef user_dictionary::UserDictionary::Entry UserDictionaryEntry;
+  typedef user_dictionary::UserDictionaryChange UserDictionaryChange;
 
   enum UserDictionaryStorageErrorType {
     USER_DICTIONARY_STORAGE_NO_ERROR = 0,  // default
@@ -113,12 +114,29 @@ class UserDictionaryStorage : public user_dictionary::UserDictionaryStorage {
   //       Therefore if the file is deleted after first load(),
   //       second load() does nothing so the content loaded by first load()
   //       is kept as is.
+  // The changes recorded in the change log are applied after the file is
+  // loaded, even if the file itself doesn't exist.
   bool Load();
 
   // Serialzie user dictionary to local file.
   // Need to call Lock() the dictionary before calling Save().
+  // The change log is discarded as its changes are part of the saved file.
   bool Save();
 
+  // Appends |change| to the change log without rewriting the whole file.
+  // The change is not applied to this object; see ApplyChange().
+  bool AppendChange(const UserDictionaryChange &change);
+
+  // Applies |change| to this object.
+  bool ApplyChange(const UserDictionaryChange &change);
+
+  // Returns the number of changes applied from the change log by the last
+  // Load(), i.e., the changes which are not yet folded into the file.
+  size_t num_pending_changes() const { return num_pending_changes_; }
+
+  // Returns the file name of the change log.
+  string change_log_filename() const;
+
   // Lock the dictionary so that other processes/threads cannot
   // execute mutable operations on this dictionary.
   bool Lock();
@@ -181,6 +199,8 @@ class UserDictionaryStorage : public user_dictionary::UserDictionaryStorage {
 
   static string default_sync_dictionary_name();
 
+  static string auto_registered_dictionary_name();
+
  private:
   // Return true if this object can accept the given dictionary name.
   // This changes the internal state.
@@ -189,8 +209,16 @@ class UserDictionaryStorage : public user_dictionary::UserDictionaryStorage {
   // Load the data from file_name actually.
   bool LoadInternal();
 
+  // Applies the changes in the change log and returns the number of them.
+  size_t LoadChangeLog();
+
+  // Returns the auto registered dictionary.  When it doesn't exist, creates
+  // it if |create| is true, or returns NULL otherwise.
+  UserDictionary *GetAutoRegisteredDictionary(bool create);
+
   string file_name_;
   bool locked_;
+  size_t num_pending_changes_;
   UserDictionaryStorageErrorType last_error_type_;
   std::unique_ptr<Mutex> local_mutex_;
   std::unique_ptr<ProcessMutex> process_mutex_;
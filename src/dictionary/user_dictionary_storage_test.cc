@@ -467,6 +467,95 @@ TEST_F(UserDictionaryStorageTest, AddToAutoRegisteredDictionary) {
   }
 }
 
+TEST_F(UserDictionaryStorageTest, ChangeLog) {
+  const string change_log_file = GetUserDictionaryFile() + ".log";
+  FileUtil::Unlink(change_log_file);
+
+  uint64 id = 0;
+  {
+    UserDictionaryStorage storage(GetUserDictionaryFile());
+    EXPECT_TRUE(storage.CreateDictionary("test", &id));
+    UserDictionaryStorage::UserDictionaryEntry *entry =
+        storage.mutable_dictionaries(0)->add_entries();
+    entry->set_key("key0");
+    entry->set_value("value0");
+    entry->set_pos(UserDictionary::NOUN);
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_TRUE(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+  }
+
+  {
+    UserDictionaryStorage storage(GetUserDictionaryFile());
+    EXPECT_EQ(change_log_file, storage.change_log_filename());
+
+    UserDictionaryStorage::UserDictionaryChange change;
+    change.set_type(UserDictionaryStorage::UserDictionaryChange::ADD_ENTRY);
+    change.set_dictionary_id(id);
+    change.mutable_entry()->set_key("key1");
+    change.mutable_entry()->set_value("value1");
+    change.mutable_entry()->set_pos(UserDictionary::NOUN);
+    EXPECT_TRUE(storage.AppendChange(change));
+
+    change.set_type(UserDictionaryStorage::UserDictionaryChange::DELETE_ENTRY);
+    change.mutable_entry()->set_key("key0");
+    change.mutable_entry()->set_value("value0");
+    EXPECT_TRUE(storage.AppendChange(change));
+
+    // Without dictionary ID, the auto registered dictionary is updated.
+    change.set_type(UserDictionaryStorage::UserDictionaryChange::ADD_ENTRY);
+    change.clear_dictionary_id();
+    change.mutable_entry()->set_key("key2");
+    change.mutable_entry()->set_value("value2");
+    EXPECT_TRUE(storage.AppendChange(change));
+
+    // Changes are not applied to the storage itself.
+    EXPECT_EQ(0, storage.dictionaries_size());
+  }
+
+  // A truncated record at the end is ignored.
+  {
+    OutputFileStream ofs(change_log_file.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::app);
+    const char kTruncatedRecord[] = "\x10\x00\x00\x00" "ab";
+    ofs.write(kTruncatedRecord, 6);
+  }
+
+  {
+    UserDictionaryStorage storage(GetUserDictionaryFile());
+    EXPECT_TRUE(storage.Load());
+    EXPECT_EQ(3, storage.num_pending_changes());
+    ASSERT_EQ(2, storage.dictionaries_size());
+    ASSERT_EQ(1, storage.dictionaries(0).entries_size());
+    EXPECT_EQ("key1", storage.dictionaries(0).entries(0).key());
+    EXPECT_EQ(UserDictionaryStorage::auto_registered_dictionary_name(),
+              storage.dictionaries(1).name());
+    ASSERT_EQ(1, storage.dictionaries(1).entries_size());
+    EXPECT_EQ("key2", storage.dictionaries(1).entries(0).key());
+
+    // Changes are idempotent.
+    UserDictionaryStorage::UserDictionaryChange change;
+    change.set_type(UserDictionaryStorage::UserDictionaryChange::ADD_ENTRY);
+    change.mutable_entry()->CopyFrom(storage.dictionaries(1).entries(0));
+    EXPECT_TRUE(storage.ApplyChange(change));
+    EXPECT_EQ(1, storage.dictionaries(1).entries_size());
+
+    // Saving the file discards the log.
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_TRUE(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+    EXPECT_EQ(0, storage.num_pending_changes());
+    EXPECT_FALSE(FileUtil::FileExists(change_log_file));
+  }
+
+  {
+    UserDictionaryStorage storage(GetUserDictionaryFile());
+    EXPECT_TRUE(storage.Load());
+    EXPECT_EQ(0, storage.num_pending_changes());
+    EXPECT_EQ(2, storage.dictionaries_size());
+  }
+}
+
 TEST_F(UserDictionaryStorageTest, Export) {
   const int kDummyDictionaryId = 10;
   const string kPath = FileUtil::JoinPath(FLAGS_test_tmpdir, "exported_file");
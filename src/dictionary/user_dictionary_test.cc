@@ -526,6 +526,60 @@ TEST_F(UserDictionaryTest, TestLookupExact) {
   TestLookupPrefixHelper(nullptr, 0, "水雲", strlen("水雲"), *dic);
 }
 
+TEST_F(UserDictionaryTest, TestLookupOnLargeDictionary) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  // Keys "k0", "k1", ..., "k99999", so that every prefix of "k12345" longer
+  // than "k" is registered.  The dictionary is large enough for the lookups
+  // to walk the key trie.
+  const int kSize = 100000;
+  {
+    UserDictionaryStorage storage("");
+    UserDictionaryStorage::UserDictionary *user_dic =
+        storage.add_dictionaries();
+    for (int i = 0; i < kSize; ++i) {
+      UserDictionaryStorage::UserDictionaryEntry *entry =
+          user_dic->add_entries();
+      entry->set_key("k" + std::to_string(i));
+      entry->set_value("v" + std::to_string(i));
+      entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    }
+    dic->Load(storage);
+  }
+
+  const Entry kExpected0[] = {
+    { "k1", "v1", 100, 100 },
+    { "k12", "v12", 100, 100 },
+    { "k123", "v123", 100, 100 },
+    { "k1234", "v1234", 100, 100 },
+    { "k12345", "v12345", 100, 100 },
+  };
+  TestLookupPrefixHelper(kExpected0, arraysize(kExpected0),
+                         "k12345x", 7, *dic);
+
+  const Entry kExpected1[] = {
+    { "k99999", "v99999", 100, 100 },
+  };
+  TestLookupExactHelper(kExpected1, arraysize(kExpected1),
+                        "k99999", 6, *dic);
+  TestLookupExactHelper(nullptr, 0, "k100000", 7, *dic);
+  TestLookupPrefixHelper(nullptr, 0, "x12345", 6, *dic);
+  EXPECT_EQ("", LookupComment(*dic, "k100000", "v100000"));
+
+  // Prefix lookup results are delivered in ascending key order.
+  for (int i = 0; i < 1000; ++i) {
+    const string key = "k" + std::to_string(Util::Random(kSize));
+    EntryCollector collector;
+    dic->LookupPrefix(key, convreq_, &collector);
+    ASSERT_EQ(key.size() - 1, collector.entries().size()) << key;
+    for (size_t j = 0; j < collector.entries().size(); ++j) {
+      EXPECT_EQ(key.substr(0, j + 2), collector.entries()[j].key);
+    }
+  }
+}
+
 TEST_F(UserDictionaryTest, TestLookupExactWithSuggestionOnlyWords) {
   unique_ptr<UserDictionary> user_dic(CreateDictionary());
   user_dic->WaitForReloader();
@@ -648,6 +702,7 @@ TEST_F(UserDictionaryTest, AddToAutoRegisteredDictionary) {
   const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
                                              "add_to_auto_registered.db");
   FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
 
   // Create dictionary
   {
@@ -690,7 +745,9 @@ TEST_F(UserDictionaryTest, AddToAutoRegisteredDictionary) {
     }
   }
 
+  // The added entries may be kept in the change log as well.
   FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
 
   // Create dictionary
   {
@@ -728,6 +785,105 @@ TEST_F(UserDictionaryTest, AddToAutoRegisteredDictionary) {
   }
 }
 
+TEST_F(UserDictionaryTest, IncrementalUpdate) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                             "incremental_update.db");
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
+
+  {
+    UserDictionaryStorage storage(filename);
+    LoadFromString(kUserDictionary0, &storage);
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_TRUE(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+  }
+
+  UserDictionary::SetUserDictionaryName(filename);
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+
+  // Added words are visible without waiting for the reloader, and update the
+  // generation of the dictionary.
+  const uint64 generation = dic->GetGeneration();
+  EXPECT_TRUE(dic->AddToAutoRegisteredDictionary(
+      "smiles", "smiles", convreq_, user_dictionary::UserDictionary::NOUN));
+  EXPECT_NE(generation, dic->GetGeneration());
+  const Entry kExpected0[] = {
+    { "smiles", "smiles", 100, 100 },
+  };
+  TestLookupExactHelper(kExpected0, arraysize(kExpected0), "smiles", 6, *dic);
+  EXPECT_TRUE(dic->AddToAutoRegisteredDictionary(
+      "smiley", "smiley", convreq_, user_dictionary::UserDictionary::NOUN));
+  const Entry kExpected1[] = {
+    { "smile", "smile", 200, 200 },
+    { "smiles", "smiles", 100, 100 },
+  };
+  TestLookupPrefixHelper(kExpected1, arraysize(kExpected1), "smiles", 6, *dic);
+
+  // The additions are kept in the change log until the file is rewritten.
+  {
+    UserDictionaryStorage storage(filename);
+    EXPECT_TRUE(storage.Load());
+    EXPECT_EQ(2, storage.num_pending_changes());
+  }
+
+  // A new dictionary sees the same contents, folding the change log into the
+  // file.
+  dic.reset(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+  TestLookupPrefixHelper(kExpected1, arraysize(kExpected1), "smiles", 6, *dic);
+  TestLookupExactHelper(kExpected0, arraysize(kExpected0), "smiles", 6, *dic);
+  {
+    UserDictionaryStorage storage(filename);
+    EXPECT_TRUE(storage.Load());
+    EXPECT_EQ(0, storage.num_pending_changes());
+  }
+
+  FileUtil::Unlink(filename);
+}
+
+TEST_F(UserDictionaryTest, AddLoadedWordToAutoRegisteredDictionary) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                             "add_loaded_word.db");
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
+
+  // Suggestion-only words are not found by the check for the registered words
+  // in AddToAutoRegisteredDictionary(), which only looks up exact matches.
+  {
+    UserDictionaryStorage storage(filename);
+    uint64 id = 0;
+    EXPECT_TRUE(storage.CreateDictionary("test", &id));
+    UserDictionaryStorage::UserDictionaryEntry *entry =
+        storage.mutable_dictionaries(0)->add_entries();
+    entry->set_key("key");
+    entry->set_value("suggest_only");
+    entry->set_pos(user_dictionary::UserDictionary::SUGGESTION_ONLY);
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_TRUE(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+  }
+
+  UserDictionary::SetUserDictionaryName(filename);
+  unique_ptr<UserDictionary> dic(CreateDictionary());
+  dic->WaitForReloader();
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(dic->AddToAutoRegisteredDictionary(
+        "key", "suggest_only", convreq_,
+        user_dictionary::UserDictionary::SUGGESTION_ONLY));
+  }
+
+  // The loaded token is not duplicated.
+  EntryCollector collector;
+  dic->LookupPredictive("ke", convreq_, &collector);
+  ASSERT_EQ(1, collector.entries().size());
+  EXPECT_EQ("suggest_only", collector.entries()[0].value);
+
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(filename + ".log");
+}
+
 TEST_F(UserDictionaryTest, TestSuppressionDictionary) {
   unique_ptr<UserDictionary> user_dic(CreateDictionaryWithMockPos());
   user_dic->WaitForReloader();
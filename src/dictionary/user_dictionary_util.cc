@@ -211,6 +211,13 @@ string UserDictionaryUtil::GetUserDictionaryFileName() {
   return ConfigFileStream::GetFileName(kUserDictionaryFile);
 }
 
+// static
+string UserDictionaryUtil::GetUserDictionaryFileName(
+    const string &user_profile_directory) {
+  return ConfigFileStream::GetFileName(kUserDictionaryFile,
+                                       user_profile_directory);
+}
+
 // static
 bool UserDictionaryUtil::SanitizeEntry(
     user_dictionary::UserDictionary::Entry *entry) {
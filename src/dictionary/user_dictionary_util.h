@@ -127,6 +127,10 @@ class UserDictionaryUtil {
 
   // Returns the file name of UserDictionary.
   static string GetUserDictionaryFileName();
+  // The same as above, but the file is placed under |user_profile_directory|
+  // unless it is empty.
+  static string GetUserDictionaryFileName(
+      const string &user_profile_directory);
 
   // Returns the string representation of PosType, or NULL if the given
   // pos is invalid.
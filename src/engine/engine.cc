@@ -31,47 +31,87 @@
 
 #include <utility>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
-#include "converter/connector.h"
+#include "base/thread.h"
+#include "base/trace.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
 #include "converter/immutable_converter.h"
 #include "converter/immutable_converter_interface.h"
-#include "converter/segmenter.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/dictionary_impl.h"
 #include "dictionary/dictionary_interface.h"
-#include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
-#include "dictionary/suffix_dictionary.h"
 #include "dictionary/suppression_dictionary.h"
 #include "dictionary/system/system_dictionary.h"
-#include "dictionary/system/value_dictionary.h"
 #include "dictionary/user_dictionary.h"
 #include "dictionary/user_pos.h"
 #include "engine/engine_interface.h"
+#include "engine/shared_engine_data.h"
 #include "engine/user_data_manager_interface.h"
 #include "prediction/dictionary_predictor.h"
 #include "prediction/predictor.h"
 #include "prediction/predictor_interface.h"
-#include "prediction/suggestion_filter.h"
 #include "prediction/user_history_predictor.h"
 #include "rewriter/rewriter.h"
 #include "rewriter/rewriter_interface.h"
 
 using mozc::dictionary::DictionaryImpl;
-using mozc::dictionary::PosGroup;
-using mozc::dictionary::SuffixDictionary;
 using mozc::dictionary::SuppressionDictionary;
-using mozc::dictionary::SystemDictionary;
 using mozc::dictionary::UserDictionary;
 using mozc::dictionary::UserPOS;
-using mozc::dictionary::ValueDictionary;
+
+DEFINE_bool(fast_engine_startup, false,
+            "Shortens the engine startup by building independent components "
+            "in parallel and by deferring the rewriters built from the data "
+            "set until their first use.");
 
 namespace mozc {
 namespace {
 
+// The number of keys whose dictionary lookup results are cached.
+const size_t kLookupCacheSize = 1024;
+
+// Builds the rewriters, which are independent of the predictors.
+class RewriterBuilder : public Thread {
+ public:
+  RewriterBuilder(const ConverterInterface *parent_converter,
+                  const DataManagerInterface *data_manager,
+                  const dictionary::PosGroup *pos_group,
+                  const dictionary::DictionaryInterface *dictionary,
+                  const string &user_profile_directory,
+                  StartupProfile *profile)
+      : parent_converter_(parent_converter),
+        data_manager_(data_manager),
+        pos_group_(pos_group),
+        dictionary_(dictionary),
+        user_profile_directory_(user_profile_directory),
+        profile_(profile),
+        rewriter_(nullptr) {}
+
+  void Run() override {
+    StartupProfile::ScopedTimer timer(profile_, "Rewriter");
+    rewriter_ = new RewriterImpl(parent_converter_, data_manager_, pos_group_,
+                                 dictionary_, FLAGS_fast_engine_startup,
+                                 user_profile_directory_);
+  }
+
+  RewriterInterface *rewriter() const { return rewriter_; }
+
+ private:
+  const ConverterInterface *parent_converter_;
+  const DataManagerInterface *data_manager_;
+  const dictionary::PosGroup *pos_group_;
+  const dictionary::DictionaryInterface *dictionary_;
+  const string user_profile_directory_;
+  StartupProfile *profile_;
+  RewriterInterface *rewriter_;
+
+  DISALLOW_COPY_AND_ASSIGN(RewriterBuilder);
+};
+
 class UserDataManagerImpl final : public UserDataManagerInterface {
  public:
   explicit UserDataManagerImpl(PredictorInterface *predictor,
@@ -88,9 +128,13 @@ class UserDataManagerImpl final : public UserDataManagerInterface {
       const string &key, const string &value) override;
   bool Wait() override;
 
+  // Makes all the above methods but Wait() no-ops.
+  void Freeze() { frozen_ = true; }
+
  private:
   PredictorInterface *predictor_;
   RewriterInterface *rewriter_;
+  bool frozen_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(UserDataManagerImpl);
 };
@@ -98,6 +142,9 @@ class UserDataManagerImpl final : public UserDataManagerInterface {
 UserDataManagerImpl::~UserDataManagerImpl() {}
 
 bool UserDataManagerImpl::Sync() {
+  if (frozen_) {
+    return true;
+  }
   // TODO(noriyukit): In the current implementation, if rewriter_->Sync() fails,
   // predictor_->Sync() is never called. Check if we should call
   // predictor_->Sync() or not.
@@ -105,27 +152,42 @@ bool UserDataManagerImpl::Sync() {
 }
 
 bool UserDataManagerImpl::Reload() {
+  if (frozen_) {
+    return true;
+  }
   // TODO(noriyukit): The same TODO as Sync().
   return rewriter_->Reload() && predictor_->Reload();
 }
 
 bool UserDataManagerImpl::ClearUserHistory() {
+  if (frozen_) {
+    return false;
+  }
   rewriter_->Clear();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUserPrediction() {
+  if (frozen_) {
+    return false;
+  }
   predictor_->ClearAllHistory();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUnusedUserPrediction() {
+  if (frozen_) {
+    return false;
+  }
   predictor_->ClearUnusedHistory();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUserPredictionEntry(const string &key,
                                                    const string &value) {
+  if (frozen_) {
+    return false;
+  }
   return predictor_->ClearHistoryEntry(key, value);
 }
 
@@ -137,19 +199,41 @@ bool UserDataManagerImpl::Wait() {
 
 std::unique_ptr<Engine> Engine::CreateDesktopEngine(
     std::unique_ptr<const DataManagerInterface> data_manager) {
+  return CreateDesktopEngine(SharedEngineData::Create(std::move(data_manager)));
+}
+
+std::unique_ptr<Engine> Engine::CreateMobileEngine(
+    std::unique_ptr<const DataManagerInterface> data_manager) {
+  return CreateMobileEngine(SharedEngineData::Create(std::move(data_manager)));
+}
+
+std::unique_ptr<Engine> Engine::CreateDesktopEngine(
+    std::shared_ptr<const SharedEngineData> shared_data) {
+  return CreateDesktopEngine(std::move(shared_data), "");
+}
+
+std::unique_ptr<Engine> Engine::CreateMobileEngine(
+    std::shared_ptr<const SharedEngineData> shared_data) {
+  return CreateMobileEngine(std::move(shared_data), "");
+}
+
+std::unique_ptr<Engine> Engine::CreateDesktopEngine(
+    std::shared_ptr<const SharedEngineData> shared_data,
+    const string &user_profile_directory) {
   std::unique_ptr<Engine> engine(new Engine());
-  engine->Init(data_manager.release(),
+  engine->Init(std::move(shared_data),
                &DefaultPredictor::CreateDefaultPredictor,
-               false);
+               false, user_profile_directory);
   return engine;
 }
 
 std::unique_ptr<Engine> Engine::CreateMobileEngine(
-    std::unique_ptr<const DataManagerInterface> data_manager) {
+    std::shared_ptr<const SharedEngineData> shared_data,
+    const string &user_profile_directory) {
   std::unique_ptr<Engine> engine(new Engine());
-  engine->Init(data_manager.release(),
+  engine->Init(std::move(shared_data),
                &MobilePredictor::CreateMobilePredictor,
-               true);
+               true, user_profile_directory);
   return engine;
 }
 
@@ -159,77 +243,59 @@ Engine::~Engine() = default;
 // Since the composite predictor class differs on desktop and mobile, Init()
 // takes a function pointer to create an instance of predictor class.
 void Engine::Init(
-    const DataManagerInterface *data_manager,
+    std::shared_ptr<const SharedEngineData> shared_data,
     PredictorInterface *(*predictor_factory)(PredictorInterface *,
                                              PredictorInterface *),
-    bool enable_content_word_learning) {
-  CHECK(data_manager);
+    bool enable_content_word_learning,
+    const string &user_profile_directory) {
+  CHECK(shared_data);
   CHECK(predictor_factory);
 
+  const uint64 begin_usec = Trace::GetCurrentTimeUsec();
+  shared_data_ = std::move(shared_data);
+  const DataManagerInterface *data_manager = &shared_data_->data_manager();
+  const dictionary::POSMatcher *pos_matcher = &shared_data_->pos_matcher();
+
   suppression_dictionary_.reset(new SuppressionDictionary);
   CHECK(suppression_dictionary_.get());
 
-  pos_matcher_.reset(
-      new dictionary::POSMatcher(data_manager->GetPOSMatcherData()));
-
-  user_dictionary_.reset(
-      new UserDictionary(UserPOS::CreateFromDataManager(*data_manager),
-                         *pos_matcher_,
-                         suppression_dictionary_.get()));
-  CHECK(user_dictionary_.get());
-
-  const char *dictionary_data = NULL;
-  int dictionary_size = 0;
-  data_manager->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+  {
+    StartupProfile::ScopedTimer timer(&startup_profile_, "UserDictionary");
+    user_dictionary_.reset(
+        new UserDictionary(UserPOS::CreateFromDataManager(*data_manager),
+                           *pos_matcher,
+                           suppression_dictionary_.get(),
+                           user_profile_directory));
+    CHECK(user_dictionary_.get());
+  }
 
-  SystemDictionary *sysdic =
-      SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
-  dictionary_.reset(new DictionaryImpl(
-      sysdic,  // DictionaryImpl takes the ownership
-      new ValueDictionary(*pos_matcher_, &sysdic->value_trie()),
+  // The system and value dictionaries are owned by |shared_data_|.
+  dictionary_.reset(DictionaryImpl::CreateWithSharedDictionaries(
+      &shared_data_->system_dictionary(),
+      &shared_data_->value_dictionary(),
       user_dictionary_.get(),
       suppression_dictionary_.get(),
-      pos_matcher_.get()));
+      pos_matcher));
   CHECK(dictionary_.get());
 
-  StringPiece suffix_key_array_data, suffix_value_array_data;
-  const uint32 *token_array;
-  data_manager->GetSuffixDictionaryData(&suffix_key_array_data,
-                                        &suffix_value_array_data,
-                                        &token_array);
-  suffix_dictionary_.reset(new SuffixDictionary(suffix_key_array_data,
-                                                suffix_value_array_data,
-                                                token_array));
-  CHECK(suffix_dictionary_.get());
-
-  connector_.reset(Connector::CreateFromDataManager(*data_manager));
-  CHECK(connector_.get());
-
-  segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager));
-  CHECK(segmenter_.get());
-
-  pos_group_.reset(new PosGroup(data_manager->GetPosGroupData()));
-  CHECK(pos_group_.get());
-
   {
-    const char *data = NULL;
-    size_t size = 0;
-    data_manager->GetSuggestionFilterData(&data, &size);
-    CHECK(data);
-    suggestion_filter_.reset(new SuggestionFilter(data, size));
+    StartupProfile::ScopedTimer timer(&startup_profile_, "ImmutableConverter");
+    ImmutableConverterImpl *immutable_converter = new ImmutableConverterImpl(
+        dictionary_.get(),
+        &shared_data_->suffix_dictionary(),
+        suppression_dictionary_.get(),
+        &shared_data_->connector(),
+        &shared_data_->segmenter(),
+        pos_matcher,
+        &shared_data_->pos_group(),
+        &shared_data_->suggestion_filter());
+    CHECK(immutable_converter);
+    // Lookup results are shared by all the sessions of this engine.  The cache
+    // is invalidated when the user dictionary changes.
+    immutable_converter->EnableLookupCache(kLookupCacheSize);
+    immutable_converter_.reset(immutable_converter);
   }
 
-  immutable_converter_.reset(new ImmutableConverterImpl(
-      dictionary_.get(),
-      suffix_dictionary_.get(),
-      suppression_dictionary_.get(),
-      connector_.get(),
-      segmenter_.get(),
-      pos_matcher_.get(),
-      pos_group_.get(),
-      suggestion_filter_.get()));
-  CHECK(immutable_converter_.get());
-
   // Since predictor and rewriter require a pointer to a converter instace,
   // allocate it first without initialization. It is initialized at the end of
   // this method.
@@ -238,9 +304,22 @@ void Engine::Init(
   // and fix it!
   ConverterImpl *converter_impl = new ConverterImpl;
   converter_.reset(converter_impl);  // Involves cast to ConverterInterface*.
+  converter_impl_ = converter_impl;
   CHECK(converter_.get());
 
+  RewriterBuilder rewriter_builder(converter_impl, data_manager,
+                                   &shared_data_->pos_group(),
+                                   dictionary_.get(), user_profile_directory,
+                                   &startup_profile_);
+  if (FLAGS_fast_engine_startup) {
+    rewriter_builder.SetJoinable(true);
+    rewriter_builder.Start("RewriterBuilder");
+  } else {
+    rewriter_builder.Run();
+  }
+
   {
+    StartupProfile::ScopedTimer timer(&startup_profile_, "Predictor");
     // Create a predictor with three sub-predictors, dictionary predictor, user
     // history predictor, and extra predictor.
     PredictorInterface *dictionary_predictor =
@@ -248,18 +327,19 @@ void Engine::Init(
                                 converter_.get(),
                                 immutable_converter_.get(),
                                 dictionary_.get(),
-                                suffix_dictionary_.get(),
-                                connector_.get(),
-                                segmenter_.get(),
-                                pos_matcher_.get(),
-                                suggestion_filter_.get());
+                                &shared_data_->suffix_dictionary(),
+                                &shared_data_->connector(),
+                                &shared_data_->segmenter(),
+                                pos_matcher,
+                                &shared_data_->suggestion_filter());
     CHECK(dictionary_predictor);
 
     PredictorInterface *user_history_predictor =
         new UserHistoryPredictor(dictionary_.get(),
-                                 pos_matcher_.get(),
+                                 pos_matcher,
                                  suppression_dictionary_.get(),
-                                 enable_content_word_learning);
+                                 enable_content_word_learning,
+                                 user_profile_directory);
     CHECK(user_history_predictor);
 
     predictor_ = (*predictor_factory)(dictionary_predictor,
@@ -267,13 +347,13 @@ void Engine::Init(
     CHECK(predictor_);
   }
 
-  rewriter_ = new RewriterImpl(converter_impl,
-                               data_manager,
-                               pos_group_.get(),
-                               dictionary_.get());
+  if (FLAGS_fast_engine_startup) {
+    rewriter_builder.Join();
+  }
+  rewriter_ = rewriter_builder.rewriter();
   CHECK(rewriter_);
 
-  converter_impl->Init(pos_matcher_.get(),
+  converter_impl->Init(pos_matcher,
                        suppression_dictionary_.get(),
                        predictor_,
                        rewriter_,
@@ -281,7 +361,11 @@ void Engine::Init(
 
   user_data_manager_.reset(new UserDataManagerImpl(predictor_, rewriter_));
 
-  data_manager_.reset(data_manager);
+  startup_profile_.Add("Engine", Trace::GetCurrentTimeUsec() - begin_usec);
+  LOG(INFO) << "Engine startup profile"
+            << (FLAGS_fast_engine_startup ? " (fast startup)" : "") << ":\n"
+            << shared_data_->startup_profile().GetReport()
+            << startup_profile_.GetReport();
 }
 
 bool Engine::Reload() {
@@ -292,4 +376,10 @@ bool Engine::Reload() {
   return user_dictionary_->Reload();
 }
 
+void Engine::FreezeUserData() {
+  converter_impl_->DisableLearning();
+  // |user_data_manager_| is always created by Init().
+  static_cast<UserDataManagerImpl *>(user_data_manager_.get())->Freeze();
+}
+
 }  // namespace mozc
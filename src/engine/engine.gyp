@@ -52,6 +52,8 @@
       'sources': [
         '<(gen_out_dir)/../dictionary/pos_matcher.h',
         'engine.cc',
+        'shared_engine_data.cc',
+        'startup_profile.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
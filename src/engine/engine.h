@@ -35,22 +35,20 @@
 #include "base/port.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/dictionary_interface.h"
-#include "dictionary/pos_group.h"
 #include "engine/engine_interface.h"
+#include "engine/shared_engine_data.h"
+#include "engine/startup_profile.h"
 
 namespace mozc {
 
-class Connector;
+class ConverterImpl;
 class ConverterInterface;
 class ImmutableConverterInterface;
 class PredictorInterface;
 class RewriterInterface;
-class Segmenter;
-class SuggestionFilter;
 class UserDataManagerInterface;
 
 namespace dictionary {
-class POSMatcher;
 class UserDictionary;
 }  // namespace dictionary
 
@@ -88,6 +86,27 @@ class Engine : public EngineInterface {
         std::unique_ptr<const DataManagerType>(new DataManagerType()));
   }
 
+  // Creates an instance with desktop or mobile configuration on top of the
+  // read-only components in |shared_data|, which may be shared by other
+  // engines.  Only the learning components, e.g., user dictionary, user
+  // history predictor and rewriters, are allocated for each engine.
+  static std::unique_ptr<Engine> CreateDesktopEngine(
+      std::shared_ptr<const SharedEngineData> shared_data);
+  static std::unique_ptr<Engine> CreateMobileEngine(
+      std::shared_ptr<const SharedEngineData> shared_data);
+
+  // Same as above, but the learning components read and write their files in
+  // |user_profile_directory| instead of the user profile directory of the
+  // process, so that the engines of different users can share |shared_data|
+  // in one process without sharing what they learn.  An empty directory means
+  // the user profile directory of the process.
+  static std::unique_ptr<Engine> CreateDesktopEngine(
+      std::shared_ptr<const SharedEngineData> shared_data,
+      const string &user_profile_directory);
+  static std::unique_ptr<Engine> CreateMobileEngine(
+      std::shared_ptr<const SharedEngineData> shared_data,
+      const string &user_profile_directory);
+
   Engine();
   ~Engine() override;
 
@@ -103,34 +122,41 @@ class Engine : public EngineInterface {
     return user_data_manager_.get();
   }
 
+  void FreezeUserData() override;
+
   StringPiece GetDataVersion() const override {
-    return data_manager_->GetDataVersion();
+    return shared_data_->data_manager().GetDataVersion();
   }
 
   const DataManagerInterface *GetDataManager() const override {
-    return data_manager_.get();
+    return &shared_data_->data_manager();
   }
 
+  // Returns the read-only components used by this engine, which can be passed
+  // to the above factories to create another engine sharing them.
+  const std::shared_ptr<const SharedEngineData> &shared_data() const {
+    return shared_data_;
+  }
+
+  // Time spent on building each component owned by this engine.  See also
+  // SharedEngineData::startup_profile().
+  const StartupProfile &startup_profile() const { return startup_profile_; }
+
  private:
-  // Initializes the object by the given data manager and predictor factory
-  // function.  Predictor factory is used to select DefaultPredictor and
+  // Initializes the object by the given read-only components and predictor
+  // factory function.  Predictor factory is used to select DefaultPredictor and
   // MobilePredictor.
-  void Init(const DataManagerInterface *data_manager,
+  void Init(std::shared_ptr<const SharedEngineData> shared_data,
             PredictorInterface *(*predictor_factory)(PredictorInterface *,
                                                      PredictorInterface *),
-            bool enable_content_word_learning);
+            bool enable_content_word_learning,
+            const string &user_profile_directory);
 
-  std::unique_ptr<const DataManagerInterface> data_manager_;
-  std::unique_ptr<const dictionary::POSMatcher> pos_matcher_;
+  std::shared_ptr<const SharedEngineData> shared_data_;
   std::unique_ptr<dictionary::SuppressionDictionary> suppression_dictionary_;
-  std::unique_ptr<const Connector> connector_;
-  std::unique_ptr<const Segmenter> segmenter_;
   std::unique_ptr<dictionary::UserDictionary> user_dictionary_;
-  std::unique_ptr<dictionary::DictionaryInterface> suffix_dictionary_;
   std::unique_ptr<dictionary::DictionaryInterface> dictionary_;
-  std::unique_ptr<const dictionary::PosGroup> pos_group_;
   std::unique_ptr<ImmutableConverterInterface> immutable_converter_;
-  std::unique_ptr<const SuggestionFilter> suggestion_filter_;
 
   // TODO(noriyukit): Currently predictor and rewriter are created by this class
   // but owned by converter_. Since this class creates these two, it'd be better
@@ -138,8 +164,11 @@ class Engine : public EngineInterface {
   PredictorInterface *predictor_;
   RewriterInterface *rewriter_;
 
+  // The same instance as |converter_|.
+  ConverterImpl *converter_impl_;
   std::unique_ptr<ConverterInterface> converter_;
   std::unique_ptr<UserDataManagerInterface> user_data_manager_;
+  StartupProfile startup_profile_;
 
   DISALLOW_COPY_AND_ASSIGN(Engine);
 };
@@ -43,7 +43,8 @@ class EngineBuilder : public EngineBuilderInterface {
   ~EngineBuilder() override;
 
   // Implementation of EngineBuilderInterface.  PrepareAsync() is implemented
-  // using Thread.
+  // using Thread, which loads the data and builds the engine in background.
+  // Thus BuildFromPreparedData() only hands over the prebuilt engine.
   void PrepareAsync(const EngineReloadRequest &request,
                     EngineReloadResponse *response) override;
   bool HasResponse() const override;
@@ -60,6 +60,8 @@ class EngineBuilderInterface {
 
   // Builds an engine using the data requested by PrepareAsync().
   // May return nullptr if bad data was requested in PrepareAsync().
+  // Implementations are encouraged to build the engine in PrepareAsync() so
+  // that this method returns without blocking the caller.
   virtual std::unique_ptr<EngineInterface> BuildFromPreparedData() = 0;
 
   // Clears internal states to accept next request.
@@ -67,6 +67,11 @@ class EngineInterface {
   // Gets a user data manager.
   virtual UserDataManagerInterface *GetUserDataManager() = 0;
 
+  // Stops updating the user data of this engine in memory and on disk.  Called
+  // on an engine replaced by a newer one that loads the same user data, so
+  // that the retired engine never overwrites what its successor has saved.
+  virtual void FreezeUserData() {}
+
   // Gets the version of underlying data set.
   virtual StringPiece GetDataVersion() const = 0;
 
@@ -0,0 +1,266 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/engine.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif  // __GLIBC__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/util.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "engine/shared_engine_data.h"
+#include "engine/user_data_manager_interface.h"
+#include "prediction/predictor_interface.h"
+#include "prediction/user_history_predictor.h"
+#include "request/conversion_request.h"
+#include "testing/base/public/gunit.h"
+#include "testing/base/public/mozctest.h"
+
+DECLARE_bool(fast_engine_startup);
+
+namespace mozc {
+namespace {
+
+std::shared_ptr<const SharedEngineData> CreateMockSharedData() {
+  return SharedEngineData::Create(std::unique_ptr<const DataManagerInterface>(
+      new testing::MockDataManager()));
+}
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+#define MOZC_HAS_HEAP_USAGE
+// Returns the number of bytes currently allocated by malloc.
+size_t GetHeapUsage() {
+  return mallinfo2().uordblks;
+}
+#endif  // __GLIBC__ && __GLIBC_PREREQ(2, 33)
+
+class EngineTest : public ::testing::Test {
+ private:
+  const testing::ScopedTmpUserProfileDirectory scoped_profile_dir_;
+};
+
+TEST_F(EngineTest, EnginesShareReadOnlyData) {
+  std::shared_ptr<const SharedEngineData> shared_data = CreateMockSharedData();
+  std::unique_ptr<Engine> desktop_engine =
+      Engine::CreateDesktopEngine(shared_data);
+  std::unique_ptr<Engine> mobile_engine =
+      Engine::CreateMobileEngine(shared_data);
+  ASSERT_TRUE(desktop_engine);
+  ASSERT_TRUE(mobile_engine);
+
+  EXPECT_EQ(shared_data.get(), desktop_engine->shared_data().get());
+  EXPECT_EQ(shared_data.get(), mobile_engine->shared_data().get());
+  EXPECT_EQ(desktop_engine->GetDataManager(), mobile_engine->GetDataManager());
+  EXPECT_EQ(desktop_engine->GetDataVersion(),
+            mobile_engine->GetDataVersion());
+
+  // Learning components are owned by each engine.
+  EXPECT_NE(desktop_engine->GetUserDataManager(),
+            mobile_engine->GetUserDataManager());
+  EXPECT_NE(desktop_engine->GetSuppressionDictionary(),
+            mobile_engine->GetSuppressionDictionary());
+  EXPECT_EQ("DefaultPredictor",
+            desktop_engine->GetPredictor()->GetPredictorName());
+  EXPECT_EQ("MobilePredictor",
+            mobile_engine->GetPredictor()->GetPredictorName());
+
+  // The shared data outlives the engine that created it.
+  std::unique_ptr<Engine> engine =
+      Engine::CreateDesktopEngineHelper<testing::MockDataManager>();
+  std::shared_ptr<const SharedEngineData> data_of_engine =
+      engine->shared_data();
+  engine.reset();
+  engine = Engine::CreateDesktopEngine(data_of_engine);
+  EXPECT_EQ(data_of_engine.get(), engine->shared_data().get());
+}
+
+TEST_F(EngineTest, ConvertWithSharedData) {
+  std::shared_ptr<const SharedEngineData> shared_data = CreateMockSharedData();
+  std::vector<std::unique_ptr<Engine>> engines;
+  for (int i = 0; i < 3; ++i) {
+    engines.push_back(Engine::CreateDesktopEngine(shared_data));
+  }
+  for (const auto &engine : engines) {
+    Segments segments;
+    ASSERT_TRUE(engine->GetConverter()->StartConversion(
+        &segments, "わたしのなまえはなかのです"));
+    EXPECT_LT(0, segments.conversion_segments_size());
+  }
+}
+
+TEST_F(EngineTest, FastStartup) {
+  const char kKey[] = "わたしのなまえはなかのです";
+  std::unique_ptr<Engine> engine =
+      Engine::CreateDesktopEngine(CreateMockSharedData());
+  Segments expected;
+  ASSERT_TRUE(engine->GetConverter()->StartConversion(&expected, kKey));
+
+  const bool original_flag = FLAGS_fast_engine_startup;
+  FLAGS_fast_engine_startup = true;
+  std::shared_ptr<const SharedEngineData> shared_data = CreateMockSharedData();
+  engine = Engine::CreateDesktopEngine(shared_data);
+  FLAGS_fast_engine_startup = original_flag;
+
+  EXPECT_FALSE(shared_data->startup_profile().GetComponents().empty());
+  EXPECT_FALSE(engine->startup_profile().GetComponents().empty());
+
+  // Deferred components must not change the result.
+  Segments actual;
+  ASSERT_TRUE(engine->GetConverter()->StartConversion(&actual, kKey));
+  ASSERT_EQ(expected.conversion_segments_size(),
+            actual.conversion_segments_size());
+  for (size_t i = 0; i < expected.conversion_segments_size(); ++i) {
+    EXPECT_EQ(expected.conversion_segment(i).candidate(0).value,
+              actual.conversion_segment(i).candidate(0).value);
+  }
+}
+
+// Returns the number of entries in the user history of |user_profile_dir|.
+size_t GetUserHistorySize(const string &user_profile_dir) {
+  UserHistoryStorage storage(
+      UserHistoryPredictor::GetUserHistoryFileName(user_profile_dir));
+  if (!storage.Load()) {
+    return 0;
+  }
+  return storage.entries_size();
+}
+
+// Returns a directory for the learning data of |user| without user history.
+string CreateUserProfileDirectory(const string &user) {
+  const string dir = FileUtil::JoinPath(FLAGS_test_tmpdir, user);
+  if (!FileUtil::DirectoryExists(dir)) {
+    CHECK(FileUtil::CreateDirectory(dir));
+  }
+  FileUtil::Unlink(UserHistoryPredictor::GetUserHistoryFileName(dir));
+  return dir;
+}
+
+TEST_F(EngineTest, UserProfileDirectoryIsolatesLearning) {
+  std::shared_ptr<const SharedEngineData> shared_data = CreateMockSharedData();
+  const string dir1 = CreateUserProfileDirectory("user1");
+  const string dir2 = CreateUserProfileDirectory("user2");
+  std::unique_ptr<Engine> engine1 =
+      Engine::CreateDesktopEngine(shared_data, dir1);
+  std::unique_ptr<Engine> engine2 =
+      Engine::CreateDesktopEngine(shared_data, dir2);
+  // Wait for the user history to be loaded.
+  ASSERT_TRUE(engine1->GetUserDataManager()->Wait());
+  ASSERT_TRUE(engine2->GetUserDataManager()->Wait());
+
+  Segments segments;
+  ASSERT_TRUE(engine1->GetConverter()->StartConversion(
+      &segments, "わたしのなまえはなかのです"));
+  // Only the fixed segments are learned.
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    ASSERT_TRUE(engine1->GetConverter()->CommitSegmentValue(&segments, i, 0));
+  }
+  const ConversionRequest request;
+  ASSERT_TRUE(engine1->GetConverter()->FinishConversion(request, &segments));
+  for (Engine *engine : {engine1.get(), engine2.get()}) {
+    ASSERT_TRUE(engine->GetUserDataManager()->Sync());
+    ASSERT_TRUE(engine->GetUserDataManager()->Wait());
+  }
+
+  EXPECT_LT(0, GetUserHistorySize(dir1));
+  EXPECT_EQ(0, GetUserHistorySize(dir2));
+  // Nothing is written to the user profile directory of the process.
+  EXPECT_EQ(0, GetUserHistorySize(""));
+
+  // Clearing the history of one user doesn't affect the other.
+  ASSERT_TRUE(engine2->GetUserDataManager()->ClearUserPrediction());
+  ASSERT_TRUE(engine2->GetUserDataManager()->Wait());
+  engine1.reset();
+  EXPECT_LT(0, GetUserHistorySize(dir1));
+}
+
+#ifdef MOZC_HAS_HEAP_USAGE
+// Reports the heap usage of an additional user, i.e., an engine on the shared
+// read-only data with its own learning data.
+TEST_F(EngineTest, HeapUsagePerAdditionalUser) {
+  const int kNumUsers = 8;
+  std::shared_ptr<const SharedEngineData> shared_data = CreateMockSharedData();
+  std::vector<string> dirs;
+  for (int i = 0; i < kNumUsers; ++i) {
+    dirs.push_back(CreateUserProfileDirectory(Util::StringPrintf("u%d", i)));
+  }
+
+  std::vector<std::unique_ptr<Engine>> engines;
+  const size_t base = GetHeapUsage();
+  for (int i = 0; i < kNumUsers; ++i) {
+    engines.push_back(Engine::CreateDesktopEngine(shared_data, dirs[i]));
+    engines.back()->GetUserDataManager()->Wait();
+  }
+  const size_t bytes_per_user = (GetHeapUsage() - base) / kNumUsers;
+  LOG(INFO) << "Heap usage per additional user: " << bytes_per_user
+            << " bytes";
+  EXPECT_LT(0, bytes_per_user);
+}
+
+// Reports the heap usage of an additional engine with and without the shared
+// read-only data.
+TEST_F(EngineTest, HeapUsagePerAdditionalEngine) {
+  const int kNumEngines = 8;
+  std::vector<std::unique_ptr<Engine>> engines;
+
+  size_t base = GetHeapUsage();
+  for (int i = 0; i < kNumEngines; ++i) {
+    engines.push_back(
+        Engine::CreateDesktopEngineHelper<testing::MockDataManager>());
+  }
+  const size_t independent_bytes = (GetHeapUsage() - base) / kNumEngines;
+  engines.clear();
+
+  std::shared_ptr<const SharedEngineData> shared_data = CreateMockSharedData();
+  base = GetHeapUsage();
+  for (int i = 0; i < kNumEngines; ++i) {
+    engines.push_back(Engine::CreateDesktopEngine(shared_data));
+  }
+  const size_t shared_bytes = (GetHeapUsage() - base) / kNumEngines;
+
+  LOG(INFO) << "Heap usage per additional engine: "
+            << independent_bytes << " bytes without sharing, "
+            << shared_bytes << " bytes with shared data ("
+            << (independent_bytes - shared_bytes) << " bytes saved)";
+  EXPECT_LT(shared_bytes, independent_bytes);
+}
+#endif  // MOZC_HAS_HEAP_USAGE
+
+}  // namespace
+}  // namespace mozc
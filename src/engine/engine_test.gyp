@@ -44,6 +44,37 @@
         '../testing/testing.gyp:mozctest',
       ],
     },
+    {
+      'target_name': 'engine_test',
+      'type': 'executable',
+      'sources': [
+        'engine_test.cc',
+        'startup_profile_test.cc',
+      ],
+      'dependencies': [
+        '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
+        '../prediction/prediction.gyp:prediction',
+        'engine.gyp:engine',
+        '../testing/testing.gyp:gtest_main',
+        '../testing/testing.gyp:mozctest',
+      ],
+    },
+    {
+      # First conversion benchmark of the engine.  Not run as a test.
+      'target_name': 'first_conversion_benchmark',
+      'type': 'executable',
+      'sources': [
+        'first_conversion_benchmark.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../converter/converter_base.gyp:segments',
+        '../data_manager/data_manager_base.gyp:data_manager',
+        '../prediction/prediction.gyp:prediction',
+        '../testing/testing.gyp:googletest_lib',
+        'engine.gyp:engine',
+      ],
+    },
     {
       'target_name': 'install_engine_builder_test_src',
       'type': 'none',
@@ -62,6 +93,7 @@
       'type': 'none',
       'dependencies': [
         'engine_builder_test',
+        'engine_test',
       ],
     },
   ],
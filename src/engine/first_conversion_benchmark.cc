@@ -0,0 +1,231 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// First conversion benchmark of the engine created from a data set file.
+//
+// Drops the pages of the data set file from the page cache, which is what
+// the first conversion after the start under memory pressure sees, creates a
+// desktop engine from the file and converts the keys once.  Reports the
+// latency and the page faults of the engine creation, of the first
+// conversion, and of the conversions after that.  Compare the runs with and
+// without --prefetch_data_set for the effect of reading ahead the hot
+// sections.  Dropping the pages is supported only on Linux; elsewhere, and
+// with --noevict_page_cache, only the cost of the page table setup remains.
+//
+// Usage:
+//   first_conversion_benchmark
+//       --engine_data=data_manager/oss/mozc.data --iterations=10
+//       [--prefetch_data_set]
+
+#ifndef OS_WIN
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif  // OS_WIN
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/util.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "data_manager/data_manager.h"
+#include "engine/engine.h"
+#include "testing/base/public/googletest.h"
+
+DECLARE_bool(prefetch_data_set);
+
+DEFINE_string(engine_data, "", "Path to the data set file.");
+DEFINE_string(magic, "",
+              "Expected magic number of the data set file.  The magic number "
+              "of the OSS data set is used if empty.");
+DEFINE_string(keys,
+              "\xE3\x82\x8F\xE3\x81\x9F\xE3\x81\x97\xE3\x81\xAE\xE3\x81\xAA"
+              "\xE3\x81\xBE\xE3\x81\x88\xE3\x81\xAF\xE3\x81\xAA\xE3\x81\x8B"
+              "\xE3\x81\xAE\xE3\x81\xA7\xE3\x81\x99,"
+              "\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86\xE3\x81\xAF\xE3\x81\x84"
+              "\xE3\x81\x84\xE3\x81\xA6\xE3\x82\x93\xE3\x81\x8D",
+              "Comma separated list of the keys to convert.");
+DEFINE_int32(iterations, 10,
+             "Number of engine creations.  The best and the median of them "
+             "are reported.");
+DEFINE_bool(evict_page_cache, true,
+            "Drops the pages of the data set file from the page cache before "
+            "each engine creation.");
+
+namespace mozc {
+namespace {
+
+struct PageFaults {
+  int64 major;
+  int64 minor;
+};
+
+PageFaults GetPageFaults() {
+  PageFaults faults = {0, 0};
+#ifndef OS_WIN
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    faults.major = usage.ru_majflt;
+    faults.minor = usage.ru_minflt;
+  }
+#endif  // OS_WIN
+  return faults;
+}
+
+// Returns false if the pages cannot be dropped on this platform.
+bool EvictFromPageCache(const string &path) {
+#if defined(OS_LINUX) && !defined(OS_NACL)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Cannot open " << path;
+    return false;
+  }
+  const bool result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  ::close(fd);
+  return result;
+#else  // OS_LINUX && !OS_NACL
+  return false;
+#endif  // OS_LINUX && !OS_NACL
+}
+
+struct Sample {
+  double init_ms;
+  double first_ms;
+  double warm_ms;
+  PageFaults init_faults;
+  PageFaults first_faults;
+};
+
+double ConvertAll(const ConverterInterface &converter,
+                  const std::vector<string> &keys) {
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (const string &key : keys) {
+    Segments segments;
+    CHECK(converter.StartConversion(&segments, key)) << key;
+  }
+  return stopwatch.GetElapsedMicroseconds() / 1000.0;
+}
+
+Sample RunOnce(const std::vector<string> &keys) {
+  Sample sample;
+  const PageFaults before_init = GetPageFaults();
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  std::unique_ptr<DataManager> data_manager(new DataManager);
+  const DataManager::Status status =
+      FLAGS_magic.empty()
+          ? data_manager->InitFromFile(FLAGS_engine_data)
+          : data_manager->InitFromFile(FLAGS_engine_data, FLAGS_magic);
+  CHECK_EQ(DataManager::Status::OK, status) << FLAGS_engine_data;
+  std::unique_ptr<Engine> engine =
+      Engine::CreateDesktopEngine(std::move(data_manager));
+  sample.init_ms = stopwatch.GetElapsedMicroseconds() / 1000.0;
+  const PageFaults after_init = GetPageFaults();
+
+  sample.first_ms = ConvertAll(*engine->GetConverter(), keys);
+  const PageFaults after_first = GetPageFaults();
+  sample.warm_ms = ConvertAll(*engine->GetConverter(), keys);
+
+  sample.init_faults.major = after_init.major - before_init.major;
+  sample.init_faults.minor = after_init.minor - before_init.minor;
+  sample.first_faults.major = after_first.major - after_init.major;
+  sample.first_faults.minor = after_first.minor - after_init.minor;
+  return sample;
+}
+
+template <typename T>
+void Report(const char *name, std::vector<Sample> *samples, T Sample::*field) {
+  std::sort(samples->begin(), samples->end(),
+            [field](const Sample &a, const Sample &b) {
+              return a.*field < b.*field;
+            });
+  std::cout << name << ": best " << (*samples)[0].*field << " median "
+            << (*samples)[samples->size() / 2].*field << std::endl;
+}
+
+void ReportFaults(const char *name, const std::vector<Sample> &samples,
+                  PageFaults Sample::*field) {
+  int64 major = 0, minor = 0;
+  for (const Sample &sample : samples) {
+    major += (sample.*field).major;
+    minor += (sample.*field).minor;
+  }
+  const double size = samples.size();
+  std::cout << name << " page faults: major " << major / size << " minor "
+            << minor / size << " (average)" << std::endl;
+}
+
+int Run() {
+  CHECK(!FLAGS_engine_data.empty()) << "--engine_data is required";
+  std::vector<string> keys;
+  Util::SplitStringUsing(FLAGS_keys, ",", &keys);
+  CHECK(!keys.empty()) << "--keys is empty";
+
+  std::vector<Sample> samples;
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    if (FLAGS_evict_page_cache && !EvictFromPageCache(FLAGS_engine_data)) {
+      LOG(WARNING) << "The page cache cannot be dropped on this platform";
+      FLAGS_evict_page_cache = false;
+    }
+    samples.push_back(RunOnce(keys));
+  }
+
+  std::cout << "prefetch_data_set: "
+            << (FLAGS_prefetch_data_set ? "true" : "false")
+            << "\nevict_page_cache: "
+            << (FLAGS_evict_page_cache ? "true" : "false")
+            << "\niterations: " << samples.size()
+            << "\nkeys: " << keys.size() << std::endl;
+  ReportFaults("Engine creation", samples, &Sample::init_faults);
+  ReportFaults("First conversion", samples, &Sample::first_faults);
+  Report("Engine creation [ms]", &samples, &Sample::init_ms);
+  Report("First conversion [ms]", &samples, &Sample::first_ms);
+  Report("Warm conversion [ms]", &samples, &Sample::warm_ms);
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  mozc::InitTestFlags();
+  // Never touches the learning data of the user.
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  return mozc::Run();
+}
@@ -0,0 +1,169 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/shared_engine_data.h"
+
+#include <utility>
+
+#include "base/flags.h"
+#include "base/logging.h"
+#include "base/thread.h"
+#include "converter/connector.h"
+#include "converter/segmenter.h"
+#include "dictionary/pos_group.h"
+#include "dictionary/pos_matcher.h"
+#include "dictionary/suffix_dictionary.h"
+#include "dictionary/system/system_dictionary.h"
+#include "dictionary/system/value_dictionary.h"
+#include "prediction/suggestion_filter.h"
+
+DECLARE_bool(fast_engine_startup);
+
+namespace mozc {
+
+using dictionary::POSMatcher;
+using dictionary::PosGroup;
+using dictionary::SuffixDictionary;
+using dictionary::SystemDictionary;
+using dictionary::ValueDictionary;
+
+namespace {
+
+// Builds the system dictionary and the value dictionary, which take the
+// longest among the shared components.
+class SystemDictionaryLoader : public Thread {
+ public:
+  SystemDictionaryLoader(const DataManagerInterface *data_manager,
+                         const POSMatcher *pos_matcher,
+                         StartupProfile *profile)
+      : data_manager_(data_manager),
+        pos_matcher_(pos_matcher),
+        profile_(profile) {}
+
+  void Run() override {
+    StartupProfile::ScopedTimer timer(profile_, "SystemDictionary");
+    const char *dictionary_data = NULL;
+    int dictionary_size = 0;
+    data_manager_->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+    SystemDictionary *sysdic =
+        SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+    CHECK(sysdic);
+    system_dictionary_.reset(sysdic);
+    value_dictionary_.reset(
+        new ValueDictionary(*pos_matcher_, &sysdic->value_trie()));
+  }
+
+  std::unique_ptr<const SystemDictionary> *mutable_system_dictionary() {
+    return &system_dictionary_;
+  }
+  std::unique_ptr<const dictionary::DictionaryInterface> *
+  mutable_value_dictionary() {
+    return &value_dictionary_;
+  }
+
+ private:
+  const DataManagerInterface *data_manager_;
+  const POSMatcher *pos_matcher_;
+  StartupProfile *profile_;
+  std::unique_ptr<const SystemDictionary> system_dictionary_;
+  std::unique_ptr<const dictionary::DictionaryInterface> value_dictionary_;
+
+  DISALLOW_COPY_AND_ASSIGN(SystemDictionaryLoader);
+};
+
+}  // namespace
+
+SharedEngineData::SharedEngineData() = default;
+SharedEngineData::~SharedEngineData() = default;
+
+std::shared_ptr<const SharedEngineData> SharedEngineData::Create(
+    std::unique_ptr<const DataManagerInterface> data_manager) {
+  CHECK(data_manager);
+  std::shared_ptr<SharedEngineData> data(new SharedEngineData());
+  StartupProfile *profile = &data->startup_profile_;
+
+  data->pos_matcher_.reset(
+      new POSMatcher(data_manager->GetPOSMatcherData()));
+
+  // The other components do not depend on the system dictionary.
+  SystemDictionaryLoader loader(data_manager.get(), data->pos_matcher_.get(),
+                                profile);
+  if (FLAGS_fast_engine_startup) {
+    loader.SetJoinable(true);
+    loader.Start("SystemDictionaryLoader");
+  } else {
+    loader.Run();
+  }
+
+  {
+    StartupProfile::ScopedTimer timer(profile, "SuffixDictionary");
+    StringPiece suffix_key_array_data, suffix_value_array_data;
+    const uint32 *token_array;
+    data_manager->GetSuffixDictionaryData(&suffix_key_array_data,
+                                          &suffix_value_array_data,
+                                          &token_array);
+    data->suffix_dictionary_.reset(new SuffixDictionary(
+        suffix_key_array_data, suffix_value_array_data, token_array));
+  }
+
+  {
+    StartupProfile::ScopedTimer timer(profile, "Connector");
+    data->connector_.reset(Connector::CreateFromDataManager(*data_manager));
+    CHECK(data->connector_.get());
+  }
+
+  {
+    StartupProfile::ScopedTimer timer(profile, "Segmenter");
+    data->segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager));
+    CHECK(data->segmenter_.get());
+  }
+
+  data->pos_group_.reset(new PosGroup(data_manager->GetPosGroupData()));
+
+  {
+    StartupProfile::ScopedTimer timer(profile, "SuggestionFilter");
+    const char *filter_data = NULL;
+    size_t filter_size = 0;
+    data_manager->GetSuggestionFilterData(&filter_data, &filter_size);
+    CHECK(filter_data);
+    data->suggestion_filter_.reset(
+        new SuggestionFilter(filter_data, filter_size));
+  }
+
+  if (FLAGS_fast_engine_startup) {
+    loader.Join();
+  }
+  data->system_dictionary_ = std::move(*loader.mutable_system_dictionary());
+  data->value_dictionary_ = std::move(*loader.mutable_value_dictionary());
+
+  data->data_manager_ = std::move(data_manager);
+  return data;
+}
+
+}  // namespace mozc
@@ -0,0 +1,115 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_ENGINE_SHARED_ENGINE_DATA_H_
+#define MOZC_ENGINE_SHARED_ENGINE_DATA_H_
+
+#include <memory>
+
+#include "base/port.h"
+#include "data_manager/data_manager_interface.h"
+#include "engine/startup_profile.h"
+
+namespace mozc {
+
+class Connector;
+class Segmenter;
+class SuggestionFilter;
+
+namespace dictionary {
+class DictionaryInterface;
+class POSMatcher;
+class PosGroup;
+class SystemDictionary;
+}  // namespace dictionary
+
+// Read-only components built from a data set.  None of them holds user
+// specific state, so a single instance can be shared by many engines, e.g.,
+// by the engines of many users served from one process.  Each engine still
+// owns its learning components such as the user dictionary, the user history
+// predictor and the history rewriters.  See Engine::CreateDesktopEngine() and
+// Engine::CreateMobileEngine() that take an instance of this class.
+//
+// The learning state is not swapped in and out of one engine per request;
+// instead, each user has an engine on the shared data, created with the
+// user's profile directory, and a server sends the requests of a user to the
+// user's engine.  The rewriter tables built from the data set are shared as
+// well: most of them refer to the data set directly, and UsageRewriter shares
+// its table among the instances built from the same data set.
+class SharedEngineData {
+ public:
+  // Builds all the components from |data_manager|.  The ownership of data
+  // manager is passed to the returned instance.  With --fast_engine_startup,
+  // the system dictionary is built in parallel with the other components.
+  static std::shared_ptr<const SharedEngineData> Create(
+      std::unique_ptr<const DataManagerInterface> data_manager);
+
+  ~SharedEngineData();
+
+  const DataManagerInterface &data_manager() const { return *data_manager_; }
+  const dictionary::POSMatcher &pos_matcher() const { return *pos_matcher_; }
+  const dictionary::SystemDictionary &system_dictionary() const {
+    return *system_dictionary_;
+  }
+  const dictionary::DictionaryInterface &value_dictionary() const {
+    return *value_dictionary_;
+  }
+  const dictionary::DictionaryInterface &suffix_dictionary() const {
+    return *suffix_dictionary_;
+  }
+  const Connector &connector() const { return *connector_; }
+  const Segmenter &segmenter() const { return *segmenter_; }
+  const dictionary::PosGroup &pos_group() const { return *pos_group_; }
+  const SuggestionFilter &suggestion_filter() const {
+    return *suggestion_filter_;
+  }
+
+  // Time spent on building each component.
+  const StartupProfile &startup_profile() const { return startup_profile_; }
+
+ private:
+  SharedEngineData();
+
+  std::unique_ptr<const DataManagerInterface> data_manager_;
+  std::unique_ptr<const dictionary::POSMatcher> pos_matcher_;
+  std::unique_ptr<const dictionary::SystemDictionary> system_dictionary_;
+  std::unique_ptr<const dictionary::DictionaryInterface> value_dictionary_;
+  std::unique_ptr<const dictionary::DictionaryInterface> suffix_dictionary_;
+  std::unique_ptr<const Connector> connector_;
+  std::unique_ptr<const Segmenter> segmenter_;
+  std::unique_ptr<const dictionary::PosGroup> pos_group_;
+  std::unique_ptr<const SuggestionFilter> suggestion_filter_;
+  StartupProfile startup_profile_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedEngineData);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_SHARED_ENGINE_DATA_H_
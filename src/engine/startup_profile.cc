@@ -0,0 +1,78 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/startup_profile.h"
+
+#include "base/logging.h"
+#include "base/util.h"
+
+namespace mozc {
+
+StartupProfile::ScopedTimer::ScopedTimer(StartupProfile *profile,
+                                         const char *name)
+    : profile_(profile),
+      name_(name),
+      begin_usec_(Trace::GetCurrentTimeUsec()),
+      span_(name) {
+  DCHECK(profile_);
+}
+
+StartupProfile::ScopedTimer::~ScopedTimer() {
+  profile_->Add(name_, Trace::GetCurrentTimeUsec() - begin_usec_);
+}
+
+StartupProfile::StartupProfile() = default;
+StartupProfile::~StartupProfile() = default;
+
+void StartupProfile::Add(const string &name, uint64 duration_usec) {
+  scoped_lock l(&mutex_);
+  components_.push_back(Component{name, duration_usec});
+}
+
+void StartupProfile::Append(const StartupProfile &other) {
+  const std::vector<Component> components = other.GetComponents();
+  scoped_lock l(&mutex_);
+  components_.insert(components_.end(), components.begin(), components.end());
+}
+
+std::vector<StartupProfile::Component> StartupProfile::GetComponents() const {
+  scoped_lock l(&mutex_);
+  return components_;
+}
+
+string StartupProfile::GetReport() const {
+  string report;
+  for (const Component &component : GetComponents()) {
+    report.append(Util::StringPrintf("%s: %.3f ms\n", component.name.c_str(),
+                                     component.duration_usec / 1000.0));
+  }
+  return report;
+}
+
+}  // namespace mozc
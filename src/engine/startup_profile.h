@@ -0,0 +1,95 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Time spent on building each component of the engine at startup.  The
+// profile is logged when an engine is initialized so that a regression of
+// the startup time can be attributed to a component.
+
+#ifndef MOZC_ENGINE_STARTUP_PROFILE_H_
+#define MOZC_ENGINE_STARTUP_PROFILE_H_
+
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/trace.h"
+
+namespace mozc {
+
+class StartupProfile {
+ public:
+  struct Component {
+    string name;
+    uint64 duration_usec;
+  };
+
+  // Records the time from the construction to the destruction as the
+  // component |name|.  It is also recorded as a trace span when tracing is
+  // enabled, so |name| must be a string literal.
+  class ScopedTimer {
+   public:
+    ScopedTimer(StartupProfile *profile, const char *name);
+    ~ScopedTimer();
+
+   private:
+    StartupProfile *profile_;
+    const char *name_;
+    const uint64 begin_usec_;
+    ScopedTraceSpan span_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTimer);
+  };
+
+  StartupProfile();
+  ~StartupProfile();
+
+  // Adds a component.  Thread-safe, so components built in parallel can be
+  // recorded to the same profile.
+  void Add(const string &name, uint64 duration_usec);
+
+  // Adds all the components of |other|.
+  void Append(const StartupProfile &other);
+
+  // Returns the components in the order they are completed.
+  std::vector<Component> GetComponents() const;
+
+  // Returns a human readable report with one line per component.
+  string GetReport() const;
+
+ private:
+  mutable Mutex mutex_;
+  std::vector<Component> components_;
+
+  DISALLOW_COPY_AND_ASSIGN(StartupProfile);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_STARTUP_PROFILE_H_
@@ -0,0 +1,118 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/startup_profile.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/thread.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class AddThread : public Thread {
+ public:
+  AddThread(StartupProfile *profile, int num_components)
+      : profile_(profile), num_components_(num_components) {}
+
+  void Run() override {
+    for (int i = 0; i < num_components_; ++i) {
+      profile_->Add("Component", 1);
+    }
+  }
+
+ private:
+  StartupProfile *profile_;
+  const int num_components_;
+
+  DISALLOW_COPY_AND_ASSIGN(AddThread);
+};
+
+TEST(StartupProfileTest, AddAndAppend) {
+  StartupProfile profile;
+  EXPECT_TRUE(profile.GetComponents().empty());
+  EXPECT_EQ("", profile.GetReport());
+
+  profile.Add("Connector", 1500);
+  profile.Add("Segmenter", 20);
+
+  StartupProfile other;
+  other.Add("Rewriter", 3000);
+  profile.Append(other);
+
+  const std::vector<StartupProfile::Component> components =
+      profile.GetComponents();
+  ASSERT_EQ(3, components.size());
+  EXPECT_EQ("Connector", components[0].name);
+  EXPECT_EQ(1500, components[0].duration_usec);
+  EXPECT_EQ("Segmenter", components[1].name);
+  EXPECT_EQ(20, components[1].duration_usec);
+  EXPECT_EQ("Rewriter", components[2].name);
+  EXPECT_EQ(3000, components[2].duration_usec);
+
+  EXPECT_EQ("Connector: 1.500 ms\n"
+            "Segmenter: 0.020 ms\n"
+            "Rewriter: 3.000 ms\n",
+            profile.GetReport());
+}
+
+TEST(StartupProfileTest, ScopedTimer) {
+  StartupProfile profile;
+  {
+    StartupProfile::ScopedTimer timer(&profile, "Dictionary");
+    EXPECT_TRUE(profile.GetComponents().empty());
+  }
+  const std::vector<StartupProfile::Component> components =
+      profile.GetComponents();
+  ASSERT_EQ(1, components.size());
+  EXPECT_EQ("Dictionary", components[0].name);
+}
+
+TEST(StartupProfileTest, AddInParallel) {
+  const int kNumThreads = 4;
+  const int kNumComponents = 1000;
+  StartupProfile profile;
+  std::vector<std::unique_ptr<AddThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back(new AddThread(&profile, kNumComponents));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("AddThread");
+  }
+  for (const auto &thread : threads) {
+    thread->Join();
+  }
+  EXPECT_EQ(kNumThreads * kNumComponents, profile.GetComponents().size());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -35,6 +35,7 @@
 #include <cmath>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -43,6 +44,7 @@
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/connector.h"
@@ -250,6 +252,43 @@ class DictionaryPredictor::PredictiveBigramLookupCallback :
   DISALLOW_COPY_AND_ASSIGN(PredictiveBigramLookupCallback);
 };
 
+// Lookup callback for one key of a batched lookup.  The callbacks of all the
+// keys share |remaining|, so that the batch collects at most the limit in
+// total, as consecutive lookups appending to one result vector do.
+class DictionaryPredictor::SharedLimitLookupCallback :
+      public PredictiveLookupCallback {
+ public:
+  SharedLimitLookupCallback(
+      DictionaryPredictor::PredictionTypes types, size_t *remaining,
+      size_t original_key_len, const std::set<string> *subsequent_chars,
+      std::vector<DictionaryPredictor::Result> *results)
+      : PredictiveLookupCallback(types, *remaining, original_key_len,
+                                 subsequent_chars, false, results),
+        remaining_(remaining) {}
+
+  ResultType OnKey(StringPiece key) override {
+    if (*remaining_ == 0) {
+      return TRAVERSE_DONE;
+    }
+    return PredictiveLookupCallback::OnKey(key);
+  }
+
+  ResultType OnToken(StringPiece key, StringPiece expanded_key,
+                     const Token &token) override {
+    if (*remaining_ == 0) {
+      return TRAVERSE_DONE;
+    }
+    PredictiveLookupCallback::OnToken(key, expanded_key, token);
+    --*remaining_;
+    return (*remaining_ > 0) ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
+  }
+
+ private:
+  size_t *remaining_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedLimitLookupCallback);
+};
+
 // Comparator for sorting prediction candidates.
 // If we have words A and AB, for example "六本木" and "六本木ヒルズ",
 // assume that cost(A) < cost(AB).
@@ -368,12 +407,14 @@ void DictionaryPredictor::MaybeRecordUsageStats(
 
 bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                             Segments *segments) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::PredictForRequest");
   if (segments == NULL) {
     return false;
   }
 
   std::vector<Result> results;
-  if (!AggregatePrediction(request, segments, &results)) {
+  if (!AggregatePrediction(request, segments, &results) ||
+      request.IsCanceled()) {
     return false;
   }
 
@@ -387,6 +428,7 @@ bool DictionaryPredictor::AggregatePrediction(
     const ConversionRequest &request,
     Segments *segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregatePrediction");
   DCHECK(segments);
   DCHECK(results);
 
@@ -405,12 +447,31 @@ bool DictionaryPredictor::AggregatePrediction(
     AggregateRealtimeConversion(prediction_types, request, segments, results);
   } else {
     AggregateRealtimeConversion(prediction_types, request, segments, results);
-    AggregateUnigramPrediction(prediction_types, request, *segments, results);
-    AggregateBigramPrediction(prediction_types, request, *segments, results);
-    AggregateSuffixPrediction(prediction_types, request, *segments, results);
-    AggregateEnglishPrediction(prediction_types, request, *segments, results);
-    AggregateTypeCorrectingPrediction(prediction_types, request, *segments,
-                                      results);
+    // Realtime conversion is the most expensive.  Abandon the rest if the
+    // request has become outdated meanwhile.
+    if (request.IsCanceled()) {
+      VLOG(2) << "Prediction is canceled";
+      return false;
+    }
+    // The rest are run in the order of importance.  Once the deadline passes,
+    // the remaining ones are skipped and the results so far are used.
+    typedef void (DictionaryPredictor::*Aggregator)(
+        PredictionTypes, const ConversionRequest &, const Segments &,
+        std::vector<Result> *) const;
+    const Aggregator kAggregators[] = {
+      &DictionaryPredictor::AggregateUnigramPrediction,
+      &DictionaryPredictor::AggregateBigramPrediction,
+      &DictionaryPredictor::AggregateSuffixPrediction,
+      &DictionaryPredictor::AggregateEnglishPrediction,
+      &DictionaryPredictor::AggregateTypeCorrectingPrediction,
+    };
+    for (size_t i = 0; i < arraysize(kAggregators); ++i) {
+      if (request.IsDeadlineExceeded()) {
+        VLOG(2) << "Deadline exceeded before aggregator " << i;
+        break;
+      }
+      (this->*kAggregators[i])(prediction_types, request, *segments, results);
+    }
   }
 
   if (results->empty()) {
@@ -1743,21 +1804,36 @@ void DictionaryPredictor::GetPredictiveResultsUsingTypingCorrection(
 
   std::vector<composer::TypeCorrectedQuery> queries;
   request.composer().GetTypeCorrectedQueriesForPrediction(&queries);
+  if (queries.empty()) {
+    return;
+  }
+
+  // Corrected queries mostly share long prefixes, so they are looked up at
+  // once.  Each query collects its results separately to add its own cost,
+  // and all the queries share |lookup_limit|.
+  size_t remaining = lookup_limit;
+  std::vector<string> input_keys;
+  std::vector<std::vector<Result>> query_results(queries.size());
+  std::vector<std::unique_ptr<SharedLimitLookupCallback>> callbacks;
+  std::vector<DictionaryInterface::Callback *> callback_ptrs;
+  input_keys.reserve(queries.size());
+  callbacks.reserve(queries.size());
+  callback_ptrs.reserve(queries.size());
   for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
     const composer::TypeCorrectedQuery &query = queries[query_index];
-    const string input_key = history_key + query.base;
-    const size_t previous_results_size = results->size();
-    PredictiveLookupCallback callback(
-        types, lookup_limit, input_key.size(),
-        query.expanded.empty() ? NULL : &query.expanded, false, results);
-    dictionary.LookupPredictive(input_key, request, &callback);
+    input_keys.push_back(history_key + query.base);
+    callbacks.emplace_back(new SharedLimitLookupCallback(
+        types, &remaining, input_keys.back().size(),
+        query.expanded.empty() ? NULL : &query.expanded,
+        &query_results[query_index]));
+    callback_ptrs.push_back(callbacks.back().get());
+  }
+  dictionary.LookupPredictiveBatch(input_keys, request, callback_ptrs);
 
-    for (size_t i = previous_results_size; i < results->size(); ++i) {
-      results->at(i).wcost += query.cost;
-    }
-    lookup_limit -= results->size() - previous_results_size;
-    if (lookup_limit <= 0) {
-      break;
+  for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
+    for (const Result &result : query_results[query_index]) {
+      results->push_back(result);
+      results->back().wcost += queries[query_index].cost;
     }
   }
 }
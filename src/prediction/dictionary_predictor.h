@@ -156,6 +156,7 @@ class DictionaryPredictor : public PredictorInterface {
 
   class PredictiveLookupCallback;
   class PredictiveBigramLookupCallback;
+  class SharedLimitLookupCallback;
   class ResultWCostLess;
   class ResultCostLess;
 
@@ -209,6 +210,7 @@ class DictionaryPredictor : public PredictorInterface {
               GetRealtimeCandidateMaxSizeWithActualConverter);
   FRIEND_TEST(DictionaryPredictorTest, GetCandidateCutoffThreshold);
   FRIEND_TEST(DictionaryPredictorTest, AggregateUnigramPrediction);
+  FRIEND_TEST(DictionaryPredictorTest, AggregatePredictionAfterDeadline);
   FRIEND_TEST(DictionaryPredictorTest, AggregateBigramPrediction);
   FRIEND_TEST(DictionaryPredictorTest, AggregateZeroQueryBigramPrediction);
   FRIEND_TEST(DictionaryPredictorTest, AggregateSuffixPrediction);
@@ -30,12 +30,15 @@
 #include "prediction/dictionary_predictor.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -45,6 +48,7 @@
 #include "composer/composer.h"
 #include "composer/internal/typing_model.h"
 #include "composer/table.h"
+#include "composer/type_corrected_query.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
 #include "converter/converter_interface.h"
@@ -194,6 +198,84 @@ class TestableDictionaryPredictor : public DictionaryPredictor {
   using DictionaryPredictor::AggregateTypeCorrectingPrediction;
 };
 
+// Cancels the request at the first prefix lookup, which the realtime
+// conversion makes, as if a newer command arrived meanwhile.  Counts the
+// predictive lookups made by the aggregators after it.
+class CancelingDictionaryMock : public DictionaryMock {
+ public:
+  explicit CancelingDictionaryMock(std::atomic<bool> *cancel_flag)
+      : cancel_flag_(cancel_flag), num_lookup_predictive_(0) {}
+
+  void LookupPredictive(StringPiece key,
+                        const ConversionRequest &conversion_request,
+                        Callback *callback) const override {
+    ++num_lookup_predictive_;
+    DictionaryMock::LookupPredictive(key, conversion_request, callback);
+  }
+
+  void LookupPrefix(StringPiece key,
+                    const ConversionRequest &conversion_request,
+                    Callback *callback) const override {
+    if (cancel_flag_ != nullptr) {
+      cancel_flag_->store(true);
+    }
+    DictionaryMock::LookupPrefix(key, conversion_request, callback);
+  }
+
+  void set_cancel_flag(std::atomic<bool> *cancel_flag) {
+    cancel_flag_ = cancel_flag;
+  }
+  int num_lookup_predictive() const { return num_lookup_predictive_; }
+
+ private:
+  std::atomic<bool> *cancel_flag_;
+  mutable int num_lookup_predictive_;
+};
+
+// Counts the tokens that the predictive lookups pass to the callbacks.
+class TokenCountingDictionaryMock : public DictionaryMock {
+ public:
+  TokenCountingDictionaryMock() : num_tokens_(0) {}
+
+  void LookupPredictive(StringPiece key,
+                        const ConversionRequest &conversion_request,
+                        Callback *callback) const override {
+    CountingCallback counting_callback(callback, &num_tokens_);
+    DictionaryMock::LookupPredictive(key, conversion_request,
+                                     &counting_callback);
+  }
+
+  int num_tokens() const { return num_tokens_; }
+
+ private:
+  class CountingCallback : public Callback {
+   public:
+    CountingCallback(Callback *callback, int *num_tokens)
+        : callback_(callback), num_tokens_(num_tokens) {}
+
+    ResultType OnKey(StringPiece key) override {
+      return callback_->OnKey(key);
+    }
+
+    ResultType OnActualKey(StringPiece key, StringPiece actual_key,
+                           bool is_expanded) override {
+      return callback_->OnActualKey(key, actual_key, is_expanded);
+    }
+
+    ResultType OnToken(StringPiece key, StringPiece actual_key,
+                       const Token &token) override {
+      ++*num_tokens_;
+      return callback_->OnToken(key, actual_key, token);
+    }
+
+   private:
+    Callback *callback_;
+    int *num_tokens_;
+  };
+
+  mutable int num_tokens_;
+};
+
 // Helper class to hold dictionary data and predictor objects.
 class MockDataAndPredictor {
  public:
@@ -739,23 +821,27 @@ class DictionaryPredictorTest : public ::testing::Test {
     }
   }
 
+  void InsertTypeCorrectingInput(const char *key,
+                                 const uint32 *corrected_key_codes) {
+    request_->set_special_romanji_table(
+        commands::Request::QWERTY_MOBILE_TO_HIRAGANA);
+    table_->LoadFromFile("system://qwerty_mobile-hiragana.tsv");
+    table_->typing_model_.reset(new MockTypingModel());
+    InsertInputSequenceForProbableKeyEvent(
+        key, corrected_key_codes, composer_.get());
+  }
+
   void AggregateTypeCorrectingTestHelper(
       const char *key,
       const uint32 *corrected_key_codes,
       const char *expected_values[],
       size_t expected_values_size) {
-    request_->set_special_romanji_table(
-        commands::Request::QWERTY_MOBILE_TO_HIRAGANA);
-
     unique_ptr<MockDataAndPredictor> data_and_predictor(
         CreateDictionaryPredictorWithMockData());
     const TestableDictionaryPredictor *predictor =
         data_and_predictor->dictionary_predictor();
 
-    table_->LoadFromFile("system://qwerty_mobile-hiragana.tsv");
-    table_->typing_model_.reset(new MockTypingModel());
-    InsertInputSequenceForProbableKeyEvent(
-        key, corrected_key_codes, composer_.get());
+    InsertTypeCorrectingInput(key, corrected_key_codes);
 
     Segments segments;
     MakeSegmentsForPrediction(key, &segments);
@@ -1246,6 +1332,77 @@ TEST_F(DictionaryPredictorTest, AggregateUnigramPrediction) {
   EXPECT_EQ(1, segments.conversion_segments_size());
 }
 
+TEST_F(DictionaryPredictorTest, AggregatePredictionAfterDeadline) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const DictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+  ClockMock clock_mock(0, 0);
+  clock_mock.SetFrequency(1000000uLL);
+  clock_mock.SetTicks(1000);
+  Clock::SetClockForUnitTest(&clock_mock);
+
+  Segments segments;
+  MakeSegmentsForPrediction("ぐーぐるあ", &segments);
+  std::vector<DictionaryPredictor::Result> results;
+
+  // The mock clock does not advance, so all the aggregators run.
+  convreq_->set_time_budget_usec(1000);
+  predictor->AggregatePrediction(*convreq_, &segments, &results);
+  EXPECT_FALSE(convreq_->degraded());
+  int num_unigram = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i].types & DictionaryPredictor::UNIGRAM) {
+      ++num_unigram;
+    }
+  }
+  EXPECT_LT(0, num_unigram);
+
+  // Past the deadline, the aggregators after the realtime conversion are
+  // skipped.
+  results.clear();
+  convreq_->set_time_budget_usec(1000);
+  clock_mock.PutClockForwardByTicks(1000);
+  predictor->AggregatePrediction(*convreq_, &segments, &results);
+  EXPECT_TRUE(convreq_->degraded());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_FALSE(results[i].types & DictionaryPredictor::UNIGRAM);
+    EXPECT_FALSE(results[i].types & DictionaryPredictor::BIGRAM);
+    EXPECT_FALSE(results[i].types & DictionaryPredictor::SUFFIX);
+  }
+
+  convreq_->set_time_budget_usec(0);
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST_F(DictionaryPredictorTest, PredictionIsAbandonedWhenCanceled) {
+  std::atomic<bool> canceled(false);
+  CancelingDictionaryMock *dictionary = new CancelingDictionaryMock(nullptr);
+  MockDataAndPredictor data_and_predictor;
+  data_and_predictor.Init(dictionary);
+  AddWordsToMockDic(dictionary);
+  const DictionaryPredictor *predictor =
+      data_and_predictor.dictionary_predictor();
+
+  Segments segments;
+  MakeSegmentsForPrediction("ぐーぐるあ", &segments);
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_LT(0, dictionary->num_lookup_predictive());
+
+  // Canceled during the realtime conversion, the rest of the aggregators are
+  // not run and no candidates are added.
+  const int num_lookup_predictive = dictionary->num_lookup_predictive();
+  dictionary->set_cancel_flag(&canceled);
+  convreq_->set_cancel_flag(&canceled);
+  MakeSegmentsForPrediction("ぐーぐるあ", &segments);
+  EXPECT_FALSE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_TRUE(canceled);
+  EXPECT_EQ(num_lookup_predictive, dictionary->num_lookup_predictive());
+  EXPECT_EQ(0, segments.conversion_segment(0).candidates_size());
+
+  convreq_->set_cancel_flag(nullptr);
+}
+
 TEST_F(DictionaryPredictorTest, AggregateUnigramCandidateForMixedConversion) {
   const char kHiraganaA[] = "あ";
 
@@ -1889,6 +2046,79 @@ TEST_F(DictionaryPredictorTest, AggregateTypeCorrectingPrediction) {
                                     arraysize(kExpectedValues));
 }
 
+TEST_F(DictionaryPredictorTest, AggregateTypeCorrectingPredictionMerge) {
+  config_->set_use_typing_correction(true);
+  const char kInputText[] = "hu-huru";
+  const uint32 kCorrectedKeyCodes[] = {'g', 'u', '-', 'g', 'u', 'r', 'u'};
+  InsertTypeCorrectingInput(kInputText, kCorrectedKeyCodes);
+
+  std::vector<composer::TypeCorrectedQuery> queries;
+  composer_->GetTypeCorrectedQueriesForPrediction(&queries);
+  ASSERT_LE(2, queries.size());
+
+  Segments segments;
+  MakeSegmentsForSuggestion(kInputText, &segments);
+
+  {
+    // The results of each query are appended in the order of the queries
+    // with the cost of the query.
+    TokenCountingDictionaryMock *dictionary = new TokenCountingDictionaryMock;
+    std::vector<string> expected_values;
+    std::vector<int> expected_costs;
+    for (size_t i = 0; i < queries.size(); ++i) {
+      ASSERT_TRUE(queries[i].expanded.empty());
+      for (size_t j = 0; j < 3; ++j) {
+        const string value = Util::StringPrintf(
+            "%d-%d", static_cast<int>(i), static_cast<int>(j));
+        dictionary->AddLookupPredictive(
+            queries[i].base, queries[i].base, value, Token::NONE);
+        expected_values.push_back(value);
+        expected_costs.push_back(queries[i].cost);
+      }
+    }
+    unique_ptr<MockDataAndPredictor> data_and_predictor(
+        new MockDataAndPredictor);
+    data_and_predictor->Init(dictionary);
+
+    std::vector<TestableDictionaryPredictor::Result> results;
+    data_and_predictor->dictionary_predictor()
+        ->AggregateTypeCorrectingPrediction(
+            TestableDictionaryPredictor::TYPING_CORRECTION,
+            *convreq_, segments, &results);
+    ASSERT_EQ(expected_values.size(), results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(expected_values[i], results[i].value);
+      EXPECT_EQ(expected_costs[i], results[i].wcost);
+    }
+  }
+  {
+    // The queries share the lookup limit, which is 256 for suggestion, so the
+    // lookups stop once they have found that many words in total.  Too many
+    // results are discarded as before.
+    TokenCountingDictionaryMock *dictionary = new TokenCountingDictionaryMock;
+    for (size_t i = 0; i < queries.size(); ++i) {
+      for (size_t j = 0; j < 200; ++j) {
+        dictionary->AddLookupPredictive(
+            queries[i].base, queries[i].base,
+            Util::StringPrintf("%d-%d", static_cast<int>(i),
+                               static_cast<int>(j)),
+            Token::NONE);
+      }
+    }
+    unique_ptr<MockDataAndPredictor> data_and_predictor(
+        new MockDataAndPredictor);
+    data_and_predictor->Init(dictionary);
+
+    std::vector<TestableDictionaryPredictor::Result> results;
+    data_and_predictor->dictionary_predictor()
+        ->AggregateTypeCorrectingPrediction(
+            TestableDictionaryPredictor::TYPING_CORRECTION,
+            *convreq_, segments, &results);
+    EXPECT_EQ(256, dictionary->num_tokens());
+    EXPECT_TRUE(results.empty());
+  }
+}
+
 TEST_F(DictionaryPredictorTest, ZeroQuerySuggestionAfterNumbers) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
@@ -42,6 +42,7 @@
         'predictor_test.cc',
       ],
       'dependencies': [
+        '../base/base_test.gyp:clock_mock',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:config_handler',
         '../converter/converter_base.gyp:connector',
@@ -169,8 +169,8 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
   remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
 
   // Do not call dictionary_predictor if the size of candidates get
-  // >= suggestions_size.
-  if (remained_size <= 0) {
+  // >= suggestions_size or the request is canceled.
+  if (remained_size <= 0 || request.IsCanceled()) {
     return result;
   }
 
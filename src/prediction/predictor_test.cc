@@ -29,6 +29,7 @@
 
 #include "prediction/predictor.h"
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -115,6 +116,27 @@ class NullPredictor : public PredictorInterface {
   const string predictor_name_;
 };
 
+// Cancels the request as if a newer command arrived during the prediction.
+class CancelingPredictor : public PredictorInterface {
+ public:
+  explicit CancelingPredictor(std::atomic<bool> *cancel_flag)
+      : cancel_flag_(cancel_flag), predictor_name_("CancelingPredictor") {}
+
+  bool PredictForRequest(const ConversionRequest &request,
+                         Segments *segments) const override {
+    cancel_flag_->store(true);
+    return true;
+  }
+
+  const string &GetPredictorName() const override {
+    return predictor_name_;
+  }
+
+ private:
+  std::atomic<bool> *cancel_flag_;
+  const string predictor_name_;
+};
+
 class MockPredictor : public PredictorInterface {
  public:
   MockPredictor() = default;
@@ -348,6 +370,31 @@ TEST_F(PredictorTest, CallPredictForRequet) {
   EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
 }
 
+TEST_F(PredictorTest, DictionaryPredictorIsSkippedWhenCanceled) {
+  std::atomic<bool> canceled(false);
+  convreq_->set_cancel_flag(&canceled);
+  // To be owned by DefaultPredictor
+  NullPredictor *dictionary_predictor = new NullPredictor(true);
+  unique_ptr<DefaultPredictor> predictor(
+      new DefaultPredictor(dictionary_predictor,
+                           new CancelingPredictor(&canceled)));
+  Segments segments;
+  {
+    segments.set_request_type(Segments::SUGGESTION);
+    Segment *segment;
+    segment = segments.add_segment();
+    CHECK(segment);
+  }
+  // The request is canceled in the user history predictor.
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_FALSE(dictionary_predictor->predict_called());
+
+  // Without cancellation, the dictionary predictor is called.
+  canceled = false;
+  convreq_->set_cancel_flag(nullptr);
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_TRUE(dictionary_predictor->predict_called());
+}
 
 TEST_F(PredictorTest, DisableAllSuggestion) {
   NullPredictor *predictor1 = new NullPredictor(true);
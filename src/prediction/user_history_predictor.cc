@@ -42,6 +42,7 @@
 #include "base/logging.h"
 #include "base/mozc_hash_set.h"
 #include "base/thread.h"
+#include "base/trace.h"
 #include "base/trie.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -394,10 +395,20 @@ UserHistoryPredictor::UserHistoryPredictor(
     const POSMatcher *pos_matcher,
     const SuppressionDictionary *suppression_dictionary,
     bool enable_content_word_learning)
+    : UserHistoryPredictor(dictionary, pos_matcher, suppression_dictionary,
+                           enable_content_word_learning, "") {}
+
+UserHistoryPredictor::UserHistoryPredictor(
+    const DictionaryInterface *dictionary,
+    const POSMatcher *pos_matcher,
+    const SuppressionDictionary *suppression_dictionary,
+    bool enable_content_word_learning,
+    const string &user_profile_directory)
     : dictionary_(dictionary),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
       predictor_name_("UserHistoryPredictor"),
+      user_profile_directory_(user_profile_directory),
       content_word_learning_enabled_(enable_content_word_learning),
       updated_(false),
       dic_(new DicCache(UserHistoryPredictor::cache_size())) {
@@ -415,6 +426,11 @@ string UserHistoryPredictor::GetUserHistoryFileName() {
   return ConfigFileStream::GetFileName(kFileName);
 }
 
+string UserHistoryPredictor::GetUserHistoryFileName(
+    const string &user_profile_directory) {
+  return ConfigFileStream::GetFileName(kFileName, user_profile_directory);
+}
+
 // Returns revert id
 // static
 uint16 UserHistoryPredictor::revert_id() {
@@ -486,7 +502,7 @@ bool UserHistoryPredictor::AsyncSave() {
 }
 
 bool UserHistoryPredictor::Load() {
-  const string filename = GetUserHistoryFileName();
+  const string filename = GetUserHistoryFileName(user_profile_directory_);
 
   UserHistoryStorage history(filename);
   if (!history.Load()) {
@@ -517,7 +533,7 @@ bool UserHistoryPredictor::Save() {
     return true;
   }
 
-  const string filename = GetUserHistoryFileName();
+  const string filename = GetUserHistoryFileName(user_profile_directory_);
 
   UserHistoryStorage history(filename);
   for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
@@ -1181,6 +1197,7 @@ bool UserHistoryPredictor::Predict(Segments *segments) const {
 
 bool UserHistoryPredictor::PredictForRequest(const ConversionRequest &request,
                                              Segments *segments) const {
+  MOZC_TRACE_SPAN("UserHistoryPredictor::PredictForRequest");
   if (!CheckSyncerAndDelete()) {
     LOG(WARNING) << "Syncer is running";
     return false;
@@ -88,6 +88,16 @@ class UserHistoryPredictor : public PredictorInterface {
       const dictionary::POSMatcher *pos_matcher,
       const dictionary::SuppressionDictionary *suppression_dictionary,
       bool enable_content_word_learning);
+
+  // The same as above, but the history is stored under
+  // |user_profile_directory| instead of the user profile directory of the
+  // process.
+  UserHistoryPredictor(
+      const dictionary::DictionaryInterface *dictionary,
+      const dictionary::POSMatcher *pos_matcher,
+      const dictionary::SuppressionDictionary *suppression_dictionary,
+      bool enable_content_word_learning,
+      const string &user_profile_directory);
   ~UserHistoryPredictor() override;
 
   void set_content_word_learning_enabled(bool value) {
@@ -126,6 +136,7 @@ class UserHistoryPredictor : public PredictorInterface {
 
   // Gets user history filename.
   static string GetUserHistoryFileName();
+  static string GetUserHistoryFileName(const string &user_profile_directory);
 
   const string &GetPredictorName() const override { return predictor_name_; }
 
@@ -530,6 +541,7 @@ class UserHistoryPredictor : public PredictorInterface {
   const dictionary::POSMatcher *pos_matcher_;
   const dictionary::SuppressionDictionary *suppression_dictionary_;
   const string predictor_name_;
+  const string user_profile_directory_;
 
   bool content_word_learning_enabled_;
   bool updated_;
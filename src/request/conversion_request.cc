@@ -29,6 +29,9 @@
 
 #include "request/conversion_request.h"
 
+#include <limits>
+
+#include "base/clock.h"
 #include "base/logging.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -42,7 +45,9 @@ ConversionRequest::ConversionRequest()
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
-      create_partial_candidates_(false) {}
+      create_partial_candidates_(false),
+      cancel_flag_(NULL),
+      deadline_ticks_(0) {}
 
 ConversionRequest::ConversionRequest(const composer::Composer *c,
                                      const commands::Request *request,
@@ -53,7 +58,9 @@ ConversionRequest::ConversionRequest(const composer::Composer *c,
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
-      create_partial_candidates_(false) {}
+      create_partial_candidates_(false),
+      cancel_flag_(NULL),
+      deadline_ticks_(0) {}
 
 ConversionRequest::~ConversionRequest() {}
 
@@ -128,6 +135,51 @@ bool ConversionRequest::IsKanaModifierInsensitiveConversion() const {
          config_->use_kana_modifier_insensitive_conversion();
 }
 
+void ConversionRequest::set_cancel_flag(
+    const std::atomic<bool> *cancel_flag) {
+  cancel_flag_ = cancel_flag;
+}
+
+void ConversionRequest::set_time_budget_usec(uint64 budget_usec) {
+  if (budget_usec == 0) {
+    deadline_ticks_ = 0;
+    degraded_.reset();
+    return;
+  }
+  // Converts seconds and the remainder separately so that a large budget
+  // doesn't overflow, and saturates to "no practical deadline" beyond that.
+  const uint64 kMaxTicks = std::numeric_limits<uint64>::max();
+  const uint64 frequency = Clock::GetFrequency();
+  const uint64 budget_sec = budget_usec / 1000000;
+  const uint64 now = Clock::GetTicks();
+  uint64 budget_ticks = kMaxTicks;
+  if (frequency == 0 || budget_sec <= kMaxTicks / frequency) {
+    const uint64 sec_ticks = budget_sec * frequency;
+    const uint64 usec_ticks = (budget_usec % 1000000) * frequency / 1000000;
+    if (usec_ticks <= kMaxTicks - sec_ticks) {
+      budget_ticks = sec_ticks + usec_ticks;
+    }
+  }
+  deadline_ticks_ = budget_ticks <= kMaxTicks - now ? now + budget_ticks
+                                                    : kMaxTicks;
+  degraded_.reset(new bool(false));
+}
+
+bool ConversionRequest::IsDeadlineExceeded() const {
+  if (IsCanceled()) {
+    return true;
+  }
+  if (deadline_ticks_ == 0 || Clock::GetTicks() < deadline_ticks_) {
+    return false;
+  }
+  *degraded_ = true;
+  return true;
+}
+
+bool ConversionRequest::degraded() const {
+  return degraded_ != nullptr && *degraded_;
+}
+
 void ConversionRequest::CopyFrom(const ConversionRequest &request) {
   composer_ = request.composer_;
   request_ = request.request_;
@@ -137,6 +189,9 @@ void ConversionRequest::CopyFrom(const ConversionRequest &request) {
   composer_key_selection_ = request.composer_key_selection_;
   skip_slow_rewriters_ = request.skip_slow_rewriters_;
   create_partial_candidates_ = request.create_partial_candidates_;
+  cancel_flag_ = request.cancel_flag_;
+  deadline_ticks_ = request.deadline_ticks_;
+  degraded_ = request.degraded_;
 }
 
 }  // namespace mozc
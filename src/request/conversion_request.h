@@ -30,6 +30,8 @@
 #ifndef MOZC_REQUEST_CONVERSION_REQUEST_H_
 #define MOZC_REQUEST_CONVERSION_REQUEST_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 #include "base/port.h"
@@ -107,6 +109,29 @@ class ConversionRequest {
 
   bool IsKanaModifierInsensitiveConversion() const;
 
+  // Cancellation token of the request.  Background computations, e.g.,
+  // asynchronous suggestion, set a flag which becomes true when the result is
+  // no longer needed.  Predictors and the converter check IsCanceled() at
+  // their checkpoints and return early.  The flag must outlive the request.
+  void set_cancel_flag(const std::atomic<bool> *cancel_flag);
+  bool IsCanceled() const {
+    return cancel_flag_ != nullptr &&
+           cancel_flag_->load(std::memory_order_relaxed);
+  }
+
+  // Time budget of the request in microseconds, counted from this call.  Once
+  // the deadline passes, the converter and the predictors stop refining their
+  // results and return the best ones found so far.  0 means no deadline.
+  void set_time_budget_usec(uint64 budget_usec);
+
+  // Returns true if the deadline has passed or the request is canceled.  When
+  // this returns true because of the deadline, the request and all its copies
+  // are marked as degraded.
+  bool IsDeadlineExceeded() const;
+
+  // Returns true if some result for the request was cut short by the deadline.
+  bool degraded() const;
+
  private:
   // Required fields
   // Input composer to generate a key for conversion, suggestion, etc.
@@ -137,6 +162,16 @@ class ConversionRequest {
   // For example, "私の" is created from composition "わたしのなまえ".
   bool create_partial_candidates_;
 
+  // Not owned.  NULL if the request cannot be canceled.
+  const std::atomic<bool> *cancel_flag_;
+
+  // Deadline in Clock::GetTicks().  0 if the request has no deadline.
+  uint64 deadline_ticks_;
+
+  // Shared with the copies made by CopyFrom() so that the degradation of
+  // internal requests is visible from the original one.
+  std::shared_ptr<bool> degraded_;
+
   // TODO(noriyukit): Moves all the members of Segments that are irrelevant to
   // this structure, e.g., Segments::user_history_enabled_ and
   // Segments::request_type_. Also, a key for conversion is eligible to live in
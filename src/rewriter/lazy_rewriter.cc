@@ -0,0 +1,110 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "base/stopwatch.h"
+
+namespace mozc {
+
+LazyRewriter::LazyRewriter(const char *name, Factory factory)
+    : name_(name), factory_(std::move(factory)), rewriter_(nullptr) {
+  DCHECK(name_);
+  DCHECK(factory_);
+}
+
+LazyRewriter::~LazyRewriter() {
+  delete rewriter_.load(std::memory_order_acquire);
+}
+
+RewriterInterface *LazyRewriter::GetRewriter() const {
+  RewriterInterface *rewriter = rewriter_.load(std::memory_order_acquire);
+  if (rewriter != nullptr) {
+    return rewriter;
+  }
+
+  scoped_lock l(&mutex_);
+  rewriter = rewriter_.load(std::memory_order_relaxed);
+  if (rewriter == nullptr) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    rewriter = factory_();
+    CHECK(rewriter) << name_;
+    factory_ = nullptr;
+    rewriter_.store(rewriter, std::memory_order_release);
+    VLOG(1) << name_ << " is constructed in "
+            << stopwatch.GetElapsedMicroseconds() << " usec";
+  }
+  return rewriter;
+}
+
+bool LazyRewriter::IsInitialized() const {
+  return rewriter_.load(std::memory_order_acquire) != nullptr;
+}
+
+int LazyRewriter::capability(const ConversionRequest &request) const {
+  return GetRewriter()->capability(request);
+}
+
+bool LazyRewriter::Rewrite(const ConversionRequest &request,
+                           Segments *segments) const {
+  return GetRewriter()->Rewrite(request, segments);
+}
+
+bool LazyRewriter::Focus(Segments *segments,
+                         size_t segment_index,
+                         int candidate_index) const {
+  return GetRewriter()->Focus(segments, segment_index, candidate_index);
+}
+
+void LazyRewriter::Finish(const ConversionRequest &request,
+                          Segments *segments) {
+  GetRewriter()->Finish(request, segments);
+}
+
+bool LazyRewriter::Sync() {
+  RewriterInterface *rewriter = rewriter_.load(std::memory_order_acquire);
+  return rewriter == nullptr ? true : rewriter->Sync();
+}
+
+bool LazyRewriter::Reload() {
+  RewriterInterface *rewriter = rewriter_.load(std::memory_order_acquire);
+  return rewriter == nullptr ? true : rewriter->Reload();
+}
+
+void LazyRewriter::Clear() {
+  RewriterInterface *rewriter = rewriter_.load(std::memory_order_acquire);
+  if (rewriter != nullptr) {
+    rewriter->Clear();
+  }
+}
+
+}  // namespace mozc
@@ -0,0 +1,86 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// A rewriter which defers the construction of another rewriter until it is
+// used for the first time.  Some rewriters build tables from the data set in
+// their constructors, which delays the startup of the server although most
+// of them are needed only for some of the conversions.
+
+#ifndef MOZC_REWRITER_LAZY_REWRITER_H_
+#define MOZC_REWRITER_LAZY_REWRITER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "rewriter/rewriter_interface.h"
+
+namespace mozc {
+
+class LazyRewriter : public RewriterInterface {
+ public:
+  typedef std::function<RewriterInterface *()> Factory;
+
+  // |factory| is called at most once, on the first call of any method other
+  // than Sync(), Reload() and Clear(), which have nothing to do before the
+  // construction.  |name| is used for logging and must outlive this object.
+  LazyRewriter(const char *name, Factory factory);
+  ~LazyRewriter() override;
+
+  int capability(const ConversionRequest &request) const override;
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override;
+  bool Focus(Segments *segments,
+             size_t segment_index,
+             int candidate_index) const override;
+  void Finish(const ConversionRequest &request, Segments *segments) override;
+  bool Sync() override;
+  bool Reload() override;
+  void Clear() override;
+
+  // Returns true if the wrapped rewriter has been constructed.
+  bool IsInitialized() const;
+
+ private:
+  // Returns the wrapped rewriter, constructing it if necessary.  Thread-safe.
+  RewriterInterface *GetRewriter() const;
+
+  const char *name_;
+  mutable Factory factory_;
+  mutable Mutex mutex_;
+  mutable std::atomic<RewriterInterface *> rewriter_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyRewriter);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_LAZY_REWRITER_H_
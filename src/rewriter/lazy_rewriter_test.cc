@@ -0,0 +1,102 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <string>
+
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class CountingRewriter : public RewriterInterface {
+ public:
+  explicit CountingRewriter(string *log) : log_(log) {}
+
+  int capability(const ConversionRequest &request) const override {
+    log_->append("capability;");
+    return RewriterInterface::ALL;
+  }
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    log_->append("Rewrite;");
+    return true;
+  }
+
+  bool Sync() override {
+    log_->append("Sync;");
+    return false;
+  }
+
+  void Clear() override {
+    log_->append("Clear;");
+  }
+
+ private:
+  string *log_;
+};
+
+TEST(LazyRewriterTest, ConstructOnFirstUse) {
+  string log;
+  int num_created = 0;
+  LazyRewriter rewriter("CountingRewriter",
+                        [&log, &num_created]() -> RewriterInterface * {
+                          ++num_created;
+                          return new CountingRewriter(&log);
+                        });
+  EXPECT_FALSE(rewriter.IsInitialized());
+
+  // Nothing to sync or clear before the construction.
+  EXPECT_TRUE(rewriter.Sync());
+  EXPECT_TRUE(rewriter.Reload());
+  rewriter.Clear();
+  EXPECT_FALSE(rewriter.IsInitialized());
+  EXPECT_EQ(0, num_created);
+  EXPECT_TRUE(log.empty());
+
+  const ConversionRequest request;
+  Segments segments;
+  EXPECT_EQ(RewriterInterface::ALL, rewriter.capability(request));
+  EXPECT_TRUE(rewriter.IsInitialized());
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(rewriter.Focus(&segments, 0, 0));
+  rewriter.Finish(request, &segments);
+  EXPECT_FALSE(rewriter.Sync());
+  EXPECT_TRUE(rewriter.Reload());
+  rewriter.Clear();
+  EXPECT_EQ(1, num_created);
+  EXPECT_EQ("capability;Rewrite;Sync;Clear;", log);
+}
+
+}  // namespace
+}  // namespace mozc
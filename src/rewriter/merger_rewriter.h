@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "base/stl_util.h"
+#include "base/trace.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
@@ -78,14 +79,23 @@ class MergerRewriter : public RewriterInterface {
 
   // This instance owns the rewriter.
   void AddRewriter(RewriterInterface *rewriter) {
+    AddRewriter(rewriter, nullptr);
+  }
+
+  // |trace_name| is the name of the trace span of Rewrite() of |rewriter|,
+  // and must be a string literal.  Not traced if nullptr.
+  void AddRewriter(RewriterInterface *rewriter, const char *trace_name) {
     rewriters_.push_back(rewriter);
+    trace_names_.push_back(trace_name);
   }
 
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const {
+    MOZC_TRACE_SPAN("MergerRewriter::Rewrite");
     bool result = false;
     for (size_t i = 0; i < rewriters_.size(); ++i) {
       if (CheckCapablity(request, segments, rewriters_[i])) {
+        MOZC_TRACE_SPAN(trace_names_[i]);
         result |= rewriters_[i]->Rewrite(request, segments);
       }
     }
@@ -155,6 +165,7 @@ class MergerRewriter : public RewriterInterface {
 
  private:
   std::vector<RewriterInterface *> rewriters_;
+  std::vector<const char *> trace_names_;
 
   DISALLOW_COPY_AND_ASSIGN(MergerRewriter);
 };
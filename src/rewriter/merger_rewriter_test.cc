@@ -30,8 +30,10 @@
 #include "rewriter/merger_rewriter.h"
 
 #include <string>
+#include <vector>
 
 #include "base/system_util.h"
+#include "base/trace.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/config.pb.h"
@@ -133,6 +135,27 @@ TEST_F(MergerRewriterTest, Rewrite) {
             call_result);
 }
 
+TEST_F(MergerRewriterTest, TraceEachRewriter) {
+  string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+  segments.set_request_type(Segments::CONVERSION);
+  merger.AddRewriter(new TestRewriter(&call_result, "a", false),
+                     "TestRewriter::a");
+  merger.AddRewriter(new TestRewriter(&call_result, "b", false));
+
+  std::vector<Trace::Event> events;
+  Trace::TakeEvents(&events);
+  Trace::SetEnabled(true);
+  merger.Rewrite(request, &segments);
+  Trace::TakeEvents(&events);
+  Trace::SetEnabled(false);
+  ASSERT_EQ(2, events.size());
+  EXPECT_STREQ("TestRewriter::a", events[0].name);
+  EXPECT_STREQ("MergerRewriter::Rewrite", events[1].name);
+}
+
 TEST_F(MergerRewriterTest, RewriteSuggestion) {
   string call_result;
   MergerRewriter merger;
@@ -29,6 +29,8 @@
 
 #include "rewriter/rewriter.h"
 
+#include <utility>
+
 #include "base/flags.h"
 #include "base/logging.h"
 #include "converter/converter_interface.h"
@@ -48,6 +50,7 @@
 #include "rewriter/fortune_rewriter.h"
 #include "rewriter/katakana_promotion_rewriter.h"
 #include "rewriter/language_aware_rewriter.h"
+#include "rewriter/lazy_rewriter.h"
 #include "rewriter/merger_rewriter.h"
 #include "rewriter/normalization_rewriter.h"
 #include "rewriter/number_rewriter.h"
@@ -75,56 +78,133 @@ namespace {
 using dictionary::DictionaryInterface;
 using dictionary::PosGroup;
 
+// Wraps the rewriter created by |factory| with LazyRewriter if
+// |lazy_initialization| is true.
+RewriterInterface *MaybeCreateLazily(const char *name,
+                                     LazyRewriter::Factory factory,
+                                     bool lazy_initialization) {
+  if (lazy_initialization) {
+    return new LazyRewriter(name, std::move(factory));
+  }
+  return factory();
+}
+
 }  // namespace
 
 RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
                            const DataManagerInterface *data_manager,
                            const PosGroup *pos_group,
                            const DictionaryInterface *dictionary)
+    : RewriterImpl(parent_converter, data_manager, pos_group, dictionary,
+                   false, "") {}
+
+RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
+                           const DataManagerInterface *data_manager,
+                           const PosGroup *pos_group,
+                           const DictionaryInterface *dictionary,
+                           bool lazy_initialization,
+                           const string &user_profile_directory)
     : pos_matcher_(data_manager->GetPOSMatcherData()) {
   DCHECK(parent_converter);
   DCHECK(data_manager);
   DCHECK(pos_group);
   // |dictionary| can be NULL
 
-  AddRewriter(new UserDictionaryRewriter);
-  AddRewriter(new FocusCandidateRewriter(data_manager));
-  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary));
-  AddRewriter(new TransliterationRewriter(pos_matcher_));
-  AddRewriter(new EnglishVariantsRewriter);
-  AddRewriter(new NumberRewriter(data_manager));
-  AddRewriter(new CollocationRewriter(data_manager));
-  AddRewriter(new SingleKanjiRewriter(*data_manager));
-  AddRewriter(new EmojiRewriter(*data_manager));
-  AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager).release());
-  AddRewriter(new CalculatorRewriter(parent_converter));
-  AddRewriter(new SymbolRewriter(parent_converter, data_manager));
-  AddRewriter(new UnicodeRewriter(parent_converter));
-  AddRewriter(new VariantsRewriter(pos_matcher_));
-  AddRewriter(new ZipcodeRewriter(&pos_matcher_));
-  AddRewriter(new DiceRewriter);
+  AddRewriter(new UserDictionaryRewriter, "UserDictionaryRewriter::Rewrite");
+  AddRewriter(new FocusCandidateRewriter(data_manager),
+              "FocusCandidateRewriter::Rewrite");
+  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary),
+              "LanguageAwareRewriter::Rewrite");
+  AddRewriter(new TransliterationRewriter(pos_matcher_),
+              "TransliterationRewriter::Rewrite");
+  AddRewriter(new EnglishVariantsRewriter, "EnglishVariantsRewriter::Rewrite");
+  AddRewriter(new NumberRewriter(data_manager), "NumberRewriter::Rewrite");
+  // The rewriters built from the data set are stateless, so they can be
+  // constructed on their first use.
+  AddRewriter(MaybeCreateLazily(
+      "CollocationRewriter",
+      [data_manager]() -> RewriterInterface * {
+        return new CollocationRewriter(data_manager);
+      },
+      lazy_initialization),
+      "CollocationRewriter::Rewrite");
+  AddRewriter(MaybeCreateLazily(
+      "SingleKanjiRewriter",
+      [data_manager]() -> RewriterInterface * {
+        return new SingleKanjiRewriter(*data_manager);
+      },
+      lazy_initialization),
+      "SingleKanjiRewriter::Rewrite");
+  AddRewriter(MaybeCreateLazily(
+      "EmojiRewriter",
+      [data_manager]() -> RewriterInterface * {
+        return new EmojiRewriter(*data_manager);
+      },
+      lazy_initialization),
+      "EmojiRewriter::Rewrite");
+  AddRewriter(MaybeCreateLazily(
+      "EmoticonRewriter",
+      [data_manager]() -> RewriterInterface * {
+        return EmoticonRewriter::CreateFromDataManager(*data_manager)
+            .release();
+      },
+      lazy_initialization),
+      "EmoticonRewriter::Rewrite");
+  AddRewriter(new CalculatorRewriter(parent_converter),
+              "CalculatorRewriter::Rewrite");
+  AddRewriter(MaybeCreateLazily(
+      "SymbolRewriter",
+      [parent_converter, data_manager]() -> RewriterInterface * {
+        return new SymbolRewriter(parent_converter, data_manager);
+      },
+      lazy_initialization),
+      "SymbolRewriter::Rewrite");
+  AddRewriter(new UnicodeRewriter(parent_converter),
+              "UnicodeRewriter::Rewrite");
+  AddRewriter(new VariantsRewriter(pos_matcher_), "VariantsRewriter::Rewrite");
+  AddRewriter(new ZipcodeRewriter(&pos_matcher_), "ZipcodeRewriter::Rewrite");
+  AddRewriter(new DiceRewriter, "DiceRewriter::Rewrite");
 
   if (FLAGS_use_history_rewriter) {
-    AddRewriter(new UserBoundaryHistoryRewriter(parent_converter));
-    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group));
+    AddRewriter(new UserBoundaryHistoryRewriter(parent_converter,
+                                                user_profile_directory),
+                "UserBoundaryHistoryRewriter::Rewrite");
+    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group,
+                                               user_profile_directory),
+                "UserSegmentHistoryRewriter::Rewrite");
   }
 
-  AddRewriter(new DateRewriter);
-  AddRewriter(new FortuneRewriter);
+  AddRewriter(new DateRewriter, "DateRewriter::Rewrite");
+  AddRewriter(new FortuneRewriter, "FortuneRewriter::Rewrite");
 #ifndef OS_ANDROID
   // CommandRewriter is not tested well on Android.
   // So we temporarily disable it.
   // TODO(yukawa, team): Enable CommandRewriter on Android if necessary.
-  AddRewriter(new CommandRewriter);
+  AddRewriter(new CommandRewriter, "CommandRewriter::Rewrite");
 #endif  // !OS_ANDROID
 #ifndef NO_USAGE_REWRITER
-  AddRewriter(new UsageRewriter(data_manager, dictionary));
+  AddRewriter(MaybeCreateLazily(
+      "UsageRewriter",
+      [data_manager, dictionary]() -> RewriterInterface * {
+        return new UsageRewriter(data_manager, dictionary);
+      },
+      lazy_initialization),
+      "UsageRewriter::Rewrite");
 #endif  // NO_USAGE_REWRITER
-  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()));
-  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager));
-  AddRewriter(new KatakanaPromotionRewriter);
-  AddRewriter(new NormalizationRewriter);
-  AddRewriter(new RemoveRedundantCandidateRewriter);
+  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()),
+              "VersionRewriter::Rewrite");
+  AddRewriter(MaybeCreateLazily(
+      "CorrectionRewriter",
+      [data_manager]() -> RewriterInterface * {
+        return CorrectionRewriter::CreateCorrectionRewriter(data_manager);
+      },
+      lazy_initialization),
+      "CorrectionRewriter::Rewrite");
+  AddRewriter(new KatakanaPromotionRewriter,
+              "KatakanaPromotionRewriter::Rewrite");
+  AddRewriter(new NormalizationRewriter, "NormalizationRewriter::Rewrite");
+  AddRewriter(new RemoveRedundantCandidateRewriter,
+              "RemoveRedundantCandidateRewriter::Rewrite");
 }
 
 }  // namespace mozc
@@ -58,6 +58,7 @@
         'fortune_rewriter.cc',
         'katakana_promotion_rewriter.cc',
         'language_aware_rewriter.cc',
+        'lazy_rewriter.cc',
         'normalization_rewriter.cc',
         'number_compound_util.cc',
         'number_rewriter.cc',
@@ -30,6 +30,8 @@
 #ifndef MOZC_REWRITER_REWRITER_H_
 #define MOZC_REWRITER_REWRITER_H_
 
+#include <string>
+
 #include "base/port.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
@@ -48,6 +50,17 @@ class RewriterImpl : public MergerRewriter {
                const dictionary::PosGroup *pos_group,
                const dictionary::DictionaryInterface *dictionary);
 
+  // If |lazy_initialization| is true, the rewriters building tables from the
+  // data set are constructed on their first use to shorten the startup.
+  // The learning rewriters store their history under |user_profile_directory|
+  // unless it is empty.
+  RewriterImpl(const ConverterInterface *parent_converter,
+               const DataManagerInterface *data_manager,
+               const dictionary::PosGroup *pos_group,
+               const dictionary::DictionaryInterface *dictionary,
+               bool lazy_initialization,
+               const string &user_profile_directory);
+
  private:
   const dictionary::POSMatcher pos_matcher_;
   DISALLOW_COPY_AND_ASSIGN(RewriterImpl);
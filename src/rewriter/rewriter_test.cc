@@ -148,4 +148,33 @@ TEST_F(RewriterTest, EmoticonsAboveSymbols) {
   EXPECT_LT(emoticon_index, symbol_index);
 }
 
+TEST_F(RewriterTest, LazyInitialization) {
+  // The data manager must outlive the lazily constructed rewriters.
+  const testing::MockDataManager data_manager;
+  const DictionaryInterface *kNullDictionary = nullptr;
+  RewriterImpl lazy_rewriter(converter_mock_.get(), &data_manager,
+                             pos_group_.get(), kNullDictionary, true, "");
+  EXPECT_TRUE(lazy_rewriter.Sync());
+  EXPECT_TRUE(lazy_rewriter.Reload());
+
+  const char *kKeys[] = {"かおもじ", "こまんど", "きごう", "ひらがな"};
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    const ConversionRequest request;
+    Segments expected, actual;
+    Segment *seg = expected.push_back_segment();
+    seg->set_key(kKeys[i]);
+    seg->add_candidate()->value = kKeys[i];
+    actual.CopyFrom(expected);
+
+    EXPECT_EQ(GetRewriter()->Rewrite(request, &expected),
+              lazy_rewriter.Rewrite(request, &actual));
+    ASSERT_EQ(expected.segment(0).candidates_size(),
+              actual.segment(0).candidates_size());
+    for (size_t j = 0; j < expected.segment(0).candidates_size(); ++j) {
+      EXPECT_EQ(expected.segment(0).candidate(j).value,
+                actual.segment(0).candidate(j).value);
+    }
+  }
+}
+
 }  // namespace mozc
@@ -31,10 +31,13 @@
 
 #include "rewriter/usage_rewriter.h"
 
+#include <map>
 #include <string>
 
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/serialized_string_array.h"
+#include "base/singleton.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
@@ -49,6 +52,32 @@ using mozc::dictionary::POSMatcher;
 
 namespace mozc {
 
+// The tables built in the process, keyed by the usage items they are built
+// from.  A table is freed with the last rewriter using it.
+class UsageRewriter::UsageItemMapCache {
+ public:
+  std::shared_ptr<const UsageItemMap> Get(
+      StringPiece usage_items_data,
+      const uint32 *conjugation_suffix,
+      const uint32 *conjugation_suffix_data_index,
+      const SerializedStringArray &string_array) {
+    scoped_lock l(&mutex_);
+    std::weak_ptr<const UsageItemMap> &entry =
+        tables_[usage_items_data.data()];
+    std::shared_ptr<const UsageItemMap> table = entry.lock();
+    if (!table) {
+      table = BuildUsageItemMap(usage_items_data, conjugation_suffix,
+                                conjugation_suffix_data_index, string_array);
+      entry = table;
+    }
+    return table;
+  }
+
+ private:
+  Mutex mutex_;
+  std::map<const char *, std::weak_ptr<const UsageItemMap>> tables_;
+};
+
 UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                              const DictionaryInterface *dictionary)
     : pos_matcher_(data_manager->GetPOSMatcherData()),
@@ -66,14 +95,24 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                                      &string_array_data);
   base_conjugation_suffix_ =
       reinterpret_cast<const uint32 *>(base_conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix_data_index =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_index_data.data());
 
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
 
+  key_value_usageitem_map_ = Singleton<UsageItemMapCache>::get()->Get(
+      usage_items_data,
+      reinterpret_cast<const uint32 *>(conjugation_suffix_data.data()),
+      reinterpret_cast<const uint32 *>(conjugation_suffix_index_data.data()),
+      string_array_);
+}
+
+// static
+std::unique_ptr<UsageRewriter::UsageItemMap>
+UsageRewriter::BuildUsageItemMap(StringPiece usage_items_data,
+                                 const uint32 *conjugation_suffix,
+                                 const uint32 *conjugation_suffix_data_index,
+                                 const SerializedStringArray &string_array) {
+  std::unique_ptr<UsageItemMap> table(new UsageItemMap);
   UsageDictItemIterator begin(usage_items_data.data());
   UsageDictItemIterator end(usage_items_data.data() + usage_items_data.size());
 
@@ -83,21 +122,22 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
     for (size_t i = conjugation_suffix_data_index[begin.conjugation_id()];
          i < conjugation_suffix_data_index[begin.conjugation_id() + 1];
          ++i) {
-      const StringPiece key = string_array_[begin.key_index()];
-      const StringPiece value = string_array_[begin.value_index()];
+      const StringPiece key = string_array[begin.key_index()];
+      const StringPiece value = string_array[begin.value_index()];
       const StringPiece key_suffix =
-          string_array_[conjugation_suffix[2 * i + 1]];
+          string_array[conjugation_suffix[2 * i + 1]];
       const StringPiece value_suffix =
-          string_array_[conjugation_suffix[2 * i]];
+          string_array[conjugation_suffix[2 * i]];
       StrPair key_value1;
       Util::ConcatStrings(key, key_suffix, &key_value1.first);
       Util::ConcatStrings(value, value_suffix, &key_value1.second);
-      key_value_usageitem_map_[key_value1] = begin;
+      (*table)[key_value1] = begin;
 
       StrPair key_value2("", key_value1.second);
-      key_value_usageitem_map_[key_value2] = begin;
+      (*table)[key_value2] = begin;
     }
   }
+  return table;
 }
 
 UsageRewriter::~UsageRewriter() {
@@ -155,8 +195,8 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
 
   // key is empty;
   StrPair key_value("", value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr == key_value_usageitem_map_.end()) {
+  const auto itr = key_value_usageitem_map_->find(key_value);
+  if (itr == key_value_usageitem_map_->end()) {
     return UsageDictItemIterator();
   }
   // Check result key part is a prefix of the content_key.
@@ -173,8 +213,8 @@ UsageRewriter::UsageDictItemIterator UsageRewriter::LookupUsage(
   const string &key = candidate.content_key;
   const string &value = candidate.content_value;
   StrPair key_value(key, value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr != key_value_usageitem_map_.end()) {
+  const auto itr = key_value_usageitem_map_->find(key_value);
+  if (itr != key_value_usageitem_map_->end()) {
     return itr->second;
   }
 
@@ -202,7 +242,7 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
   // dictionary.  Since just the uniqueness in one Segments is sufficient, for
   // usage from the user dictionary, we simply assign sequential numbers larger
   // than the maximum ID of the embedded usage dictionary.
-  int32 usage_id_for_user_comment = key_value_usageitem_map_.size();
+  int32 usage_id_for_user_comment = key_value_usageitem_map_->size();
   string comment;
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     Segment *segment = segments->mutable_conversion_segment(i);
@@ -33,11 +33,13 @@
 #ifndef NO_USAGE_REWRITER
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 
 #include "base/port.h"
 #include "base/serialized_string_array.h"
+#include "base/string_piece.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -63,6 +65,7 @@ class UsageRewriter : public RewriterInterface  {
 
  private:
   FRIEND_TEST(UsageRewriterTest, GetKanjiPrefixAndOneHiragana);
+  FRIEND_TEST(UsageRewriterTest, SharesUsageTableAmongInstances);
 
   static const size_t kUsageItemByteLength = 20;
 
@@ -105,14 +108,26 @@ class UsageRewriter : public RewriterInterface  {
   };
 
   using StrPair = std::pair<string, string>;
+  using UsageItemMap = std::map<StrPair, UsageDictItemIterator>;
+  class UsageItemMapCache;
+
   static string GetKanjiPrefixAndOneHiragana(const string &word);
 
+  // Builds the table from the usage items of a data set.
+  static std::unique_ptr<UsageItemMap> BuildUsageItemMap(
+      StringPiece usage_items_data,
+      const uint32 *conjugation_suffix,
+      const uint32 *conjugation_suffix_data_index,
+      const SerializedStringArray &string_array);
+
   UsageDictItemIterator LookupUnmatchedUsageHeuristically(
       const Segment::Candidate &candidate) const;
   UsageDictItemIterator LookupUsage(
       const Segment::Candidate &candidate) const;
 
-  std::map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
+  // Shared by the instances built from the same data set, e.g., by the
+  // engines of many users on one SharedEngineData.
+  std::shared_ptr<const UsageItemMap> key_value_usageitem_map_;
   const dictionary::POSMatcher pos_matcher_;
   const dictionary::DictionaryInterface *dictionary_;
   const uint32 *base_conjugation_suffix_;
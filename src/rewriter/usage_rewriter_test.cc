@@ -308,6 +308,20 @@ TEST_F(UsageRewriterTest, GetKanjiPrefixAndOneHiragana) {
   EXPECT_EQ("", UsageRewriter::GetKanjiPrefixAndOneHiragana("あ合わせる"));
 }
 
+TEST_F(UsageRewriterTest, SharesUsageTableAmongInstances) {
+  std::unique_ptr<UsageRewriter> rewriter1(CreateUsageRewriter());
+  std::unique_ptr<UsageRewriter> rewriter2(CreateUsageRewriter());
+  EXPECT_EQ(rewriter1->key_value_usageitem_map_.get(),
+            rewriter2->key_value_usageitem_map_.get());
+
+  // The table is rebuilt after all the rewriters using it are destroyed.
+  const size_t table_size = rewriter1->key_value_usageitem_map_->size();
+  rewriter1.reset();
+  rewriter2.reset();
+  std::unique_ptr<UsageRewriter> rewriter3(CreateUsageRewriter());
+  EXPECT_EQ(table_size, rewriter3->key_value_usageitem_map_->size());
+}
+
 TEST_F(UsageRewriterTest, CommentFromUserDictionary) {
   // Load mock data
   {
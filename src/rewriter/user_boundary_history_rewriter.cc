@@ -110,7 +110,13 @@ class LengthArray {
 
 UserBoundaryHistoryRewriter::UserBoundaryHistoryRewriter(
     const ConverterInterface *parent_converter)
+    : UserBoundaryHistoryRewriter(parent_converter, "") {}
+
+UserBoundaryHistoryRewriter::UserBoundaryHistoryRewriter(
+    const ConverterInterface *parent_converter,
+    const string &user_profile_directory)
     : parent_converter_(parent_converter),
+      user_profile_directory_(user_profile_directory),
       storage_(new LRUStorage) {
   DCHECK(parent_converter_);
   Reload();
@@ -197,7 +203,8 @@ bool UserBoundaryHistoryRewriter::Rewrite(
 }
 
 bool UserBoundaryHistoryRewriter::Reload() {
-  const string filename = ConfigFileStream::GetFileName(kFileName);
+  const string filename =
+      ConfigFileStream::GetFileName(kFileName, user_profile_directory_);
   if (!storage_->OpenOrCreate(filename.c_str(),
                               kValueSize, kLRUSize, kSeedValue)) {
     LOG(WARNING) << "cannot initialize UserBoundaryHistoryRewriter";
@@ -52,6 +52,10 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
  public:
   explicit UserBoundaryHistoryRewriter(
       const ConverterInterface *parent_converter);
+  // The history is stored under |user_profile_directory| when it is not
+  // empty.
+  UserBoundaryHistoryRewriter(const ConverterInterface *parent_converter,
+                              const string &user_profile_directory);
   virtual ~UserBoundaryHistoryRewriter();
 
   virtual bool Rewrite(const ConversionRequest &request,
@@ -68,6 +72,7 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
                       int type) const;
 
   const ConverterInterface *parent_converter_;
+  const string user_profile_directory_;
   std::unique_ptr<mozc::storage::LRUStorage> storage_;
 };
 
@@ -517,9 +517,16 @@ bool UserSegmentHistoryRewriter::SortCandidates(
 UserSegmentHistoryRewriter::UserSegmentHistoryRewriter(
     const POSMatcher *pos_matcher,
     const PosGroup *pos_group)
+    : UserSegmentHistoryRewriter(pos_matcher, pos_group, "") {}
+
+UserSegmentHistoryRewriter::UserSegmentHistoryRewriter(
+    const POSMatcher *pos_matcher,
+    const PosGroup *pos_group,
+    const string &user_profile_directory)
     : storage_(new LRUStorage),
       pos_matcher_(pos_matcher),
-      pos_group_(pos_group) {
+      pos_group_(pos_group),
+      user_profile_directory_(user_profile_directory) {
   Reload();
 
   CHECK_EQ(sizeof(uint32), sizeof(FeatureValue));
@@ -821,7 +828,8 @@ void UserSegmentHistoryRewriter::Finish(const ConversionRequest &request,
 }
 
 bool UserSegmentHistoryRewriter::Reload() {
-  const string filename = ConfigFileStream::GetFileName(kFileName);
+  const string filename =
+      ConfigFileStream::GetFileName(kFileName, user_profile_directory_);
   if (!storage_->OpenOrCreate(filename.c_str(),
                               kValueSize, kLRUSize, kSeedValue)) {
     LOG(WARNING) << "cannot initialize UserSegmentHistoryRewriter";
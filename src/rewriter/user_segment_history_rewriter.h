@@ -54,6 +54,11 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   UserSegmentHistoryRewriter(const dictionary::POSMatcher *pos_matcher,
                              const dictionary::PosGroup *pos_group);
+  // The history is stored under |user_profile_directory| when it is not
+  // empty.
+  UserSegmentHistoryRewriter(const dictionary::POSMatcher *pos_matcher,
+                             const dictionary::PosGroup *pos_group,
+                             const string &user_profile_directory);
   virtual ~UserSegmentHistoryRewriter();
 
   virtual bool Rewrite(const ConversionRequest &request,
@@ -101,6 +106,7 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
   std::unique_ptr<storage::LRUStorage> storage_;
   const dictionary::POSMatcher *pos_matcher_;
   const dictionary::PosGroup *pos_group_;
+  const string user_profile_directory_;
 };
 
 }  // namespace mozc
@@ -0,0 +1,241 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/async_suggestion.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+#include "base/thread.h"
+#include "base/trace.h"
+#include "base/unnamed_event.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+// Runs AsyncSuggestion one at a time on a dedicated thread.  A posted
+// suggestion waits in |pending_| while the previous one, which is canceled,
+// winds down.
+class AsyncSuggestionRunner : public Thread {
+ public:
+  AsyncSuggestionRunner() : stopping_(false) {
+    SetJoinable(true);
+    Start("AsyncSuggestion");
+  }
+
+  ~AsyncSuggestionRunner() override {
+    {
+      scoped_lock lock(&mutex_);
+      stopping_ = true;
+      CancelLocked();
+    }
+    posted_event_.Notify();
+    Join();
+  }
+
+  void Run() override {
+    while (true) {
+      std::shared_ptr<AsyncSuggestion> suggestion;
+      {
+        scoped_lock lock(&mutex_);
+        if (stopping_) {
+          break;
+        }
+        if (pending_) {
+          running_ = std::move(pending_);
+          suggestion = running_;
+        }
+      }
+      if (!suggestion) {
+        posted_event_.Wait(-1);
+        continue;
+      }
+      suggestion->Run();
+      {
+        scoped_lock lock(&mutex_);
+        running_.reset();
+      }
+      done_event_.Notify();
+    }
+    done_event_.Notify();
+  }
+
+  void Post(std::shared_ptr<AsyncSuggestion> suggestion) {
+    {
+      scoped_lock lock(&mutex_);
+      // A replaced pending suggestion is never run.
+      CancelLocked();
+      pending_ = std::move(suggestion);
+    }
+    posted_event_.Notify();
+  }
+
+  void Cancel() {
+    scoped_lock lock(&mutex_);
+    CancelLocked();
+  }
+
+  void Wait(bool cancel) {
+    while (true) {
+      {
+        scoped_lock lock(&mutex_);
+        if (cancel) {
+          CancelLocked();
+        }
+        if (stopping_ || (!running_ && !pending_)) {
+          return;
+        }
+      }
+      done_event_.Wait(-1);
+    }
+  }
+
+ private:
+  void CancelLocked() {
+    if (running_) {
+      running_->Cancel();
+    }
+    if (pending_) {
+      pending_->Cancel();
+    }
+  }
+
+  Mutex mutex_;
+  // Notified when a suggestion is posted or the runner is stopping.
+  UnnamedEvent posted_event_;
+  // Notified when a suggestion completes.
+  UnnamedEvent done_event_;
+  std::shared_ptr<AsyncSuggestion> running_;
+  std::shared_ptr<AsyncSuggestion> pending_;
+  bool stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncSuggestionRunner);
+};
+
+// True once the runner is created.  Wait() is called for every command, so it
+// must not create the thread unless asynchronous suggestion is used.
+std::atomic<bool> g_runner_created(false);
+
+}  // namespace
+
+AsyncSuggestion::AsyncSuggestion(
+    const ConverterInterface *converter,
+    const composer::Composer &composer,
+    const commands::Request &request,
+    const config::Config &config,
+    const Segments &segments,
+    bool partial,
+    bool use_actual_converter_for_realtime_conversion)
+    : converter_(converter),
+      request_(request),
+      config_(config),
+      composer_(nullptr, &request_, &config_),
+      segments_(new Segments),
+      partial_(partial),
+      use_actual_converter_for_realtime_conversion_(
+          use_actual_converter_for_realtime_conversion),
+      canceled_(false),
+      succeeded_(false),
+      degraded_(false),
+      trace_command_id_(Trace::GetCurrentCommandId()) {
+  DCHECK(converter_);
+  composer_.CopyFrom(composer);
+  segments_->CopyFrom(segments);
+}
+
+AsyncSuggestion::~AsyncSuggestion() {}
+
+void AsyncSuggestion::Run() {
+  // The spans on the background thread belong to the command that started
+  // this suggestion.
+  const ScopedTraceCommand trace_command(trace_command_id_);
+  MOZC_TRACE_SPAN("AsyncSuggestion::Run");
+  if (canceled()) {
+    return;
+  }
+  ConversionRequest conversion_request(&composer_, &request_, &config_);
+  conversion_request.set_cancel_flag(&canceled_);
+  if (request_.conversion_time_budget_msec() > 0) {
+    conversion_request.set_time_budget_usec(
+        static_cast<uint64>(request_.conversion_time_budget_msec()) * 1000);
+  }
+  bool result = false;
+  if (!partial_) {
+    conversion_request.set_create_partial_candidates(
+        request_.auto_partial_suggestion());
+    conversion_request.set_use_actual_converter_for_realtime_conversion(
+        use_actual_converter_for_realtime_conversion_);
+    result = converter_->StartSuggestionForRequest(conversion_request,
+                                                   segments_.get());
+  } else {
+    result = converter_->StartPartialSuggestionForRequest(conversion_request,
+                                                          segments_.get());
+  }
+  succeeded_ = result && !canceled();
+  degraded_ = conversion_request.degraded();
+}
+
+void AsyncSuggestion::Cancel() {
+  canceled_.store(true, std::memory_order_relaxed);
+}
+
+std::unique_ptr<Segments> AsyncSuggestion::TakeSegments() {
+  return std::move(segments_);
+}
+
+// static
+void AsyncSuggestion::Start(std::shared_ptr<AsyncSuggestion> suggestion) {
+  g_runner_created.store(true, std::memory_order_release);
+  Singleton<AsyncSuggestionRunner>::get()->Post(std::move(suggestion));
+}
+
+// static
+void AsyncSuggestion::CancelAll() {
+  if (!g_runner_created.load(std::memory_order_acquire)) {
+    return;
+  }
+  Singleton<AsyncSuggestionRunner>::get()->Cancel();
+}
+
+// static
+void AsyncSuggestion::Wait(bool cancel) {
+  if (!g_runner_created.load(std::memory_order_acquire)) {
+    return;
+  }
+  Singleton<AsyncSuggestionRunner>::get()->Wait(cancel);
+}
+
+}  // namespace session
+}  // namespace mozc
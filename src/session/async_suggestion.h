@@ -0,0 +1,132 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Suggestion computed on a background thread.
+//
+// With Request.async_suggestion, Session returns the preedit of a key event
+// at once and computes the suggestion on the background thread while the
+// server is idle.  The client takes the result with the GET_ASYNC_RESULT
+// callback.  When a newer command arrives first, SessionHandler cancels the
+// computation, which is abandoned at the next checkpoint of the predictors
+// (see ConversionRequest::IsCanceled()).
+//
+// At most one suggestion runs at a time.  A newer command cancels it without
+// waiting, so the command can update the composition while the suggestion
+// winds down.  Before any other use of the engine, SessionConverter and
+// SessionHandler wait for it, so the background computation never runs
+// concurrently with other uses of the engine.
+
+#ifndef MOZC_SESSION_ASYNC_SUGGESTION_H_
+#define MOZC_SESSION_ASYNC_SUGGESTION_H_
+
+#include <atomic>
+#include <memory>
+
+#include "base/port.h"
+#include "composer/composer.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+
+namespace mozc {
+
+class ConverterInterface;
+class Segments;
+
+namespace session {
+
+class AsyncSuggestion {
+ public:
+  // Copies |composer|, |request|, |config| and |segments| so that the caller
+  // can go on editing them and doesn't have to wait for the suggestion before
+  // destroying them.  |converter| is not owned.  |partial| selects partial
+  // suggestion for the composition before the cursor.
+  AsyncSuggestion(const ConverterInterface *converter,
+                  const composer::Composer &composer,
+                  const commands::Request &request,
+                  const config::Config &config,
+                  const Segments &segments,
+                  bool partial,
+                  bool use_actual_converter_for_realtime_conversion);
+  ~AsyncSuggestion();
+
+  // Computes the suggestion.  Called on the background thread.
+  void Run();
+
+  // Requests the computation to be abandoned.  Can be called from any thread.
+  void Cancel();
+  bool canceled() const {
+    return canceled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns true if Run() has completed without being canceled and found
+  // suggestions.  Must be called after Wait().
+  bool succeeded() const { return succeeded_; }
+
+  // Returns true if the suggestion was cut short by the time budget.  Must be
+  // called after Wait().
+  bool degraded() const { return degraded_; }
+
+  // Takes the computed segments.  Must be called after Wait().
+  std::unique_ptr<Segments> TakeSegments();
+
+  // Runs |suggestion| on the background thread after the running suggestion,
+  // if any.  Returns without waiting; the running and pending suggestions are
+  // canceled.
+  static void Start(std::shared_ptr<AsyncSuggestion> suggestion);
+
+  // Requests the running and pending suggestions to be abandoned without
+  // waiting for them.
+  static void CancelAll();
+
+  // Blocks until the running and pending suggestions, if any, complete.
+  // Cancels them first if |cancel| is true.
+  static void Wait(bool cancel);
+
+ private:
+  const ConverterInterface *converter_;
+  const commands::Request request_;
+  const config::Config config_;
+  composer::Composer composer_;
+  std::unique_ptr<Segments> segments_;
+  const bool partial_;
+  const bool use_actual_converter_for_realtime_conversion_;
+
+  std::atomic<bool> canceled_;
+  bool succeeded_;
+  bool degraded_;
+  // The command that created this suggestion.  See ScopedTraceCommand.
+  const uint64 trace_command_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncSuggestion);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_ASYNC_SUGGESTION_H_
@@ -0,0 +1,203 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/candidates_delta.h"
+
+#include "base/logging.h"
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace {
+
+// Serializes |message| as if its focused_index were not set.  Candidates and
+// CandidateList share the accessors of focused_index.
+template <typename T>
+void SerializeWithoutFocus(T *message, string *output) {
+  if (!message->has_focused_index()) {
+    message->AppendPartialToString(output);
+    return;
+  }
+  const uint32 focused_index = message->focused_index();
+  message->clear_focused_index();
+  message->AppendPartialToString(output);
+  message->set_focused_index(focused_index);
+}
+
+// Restores |message| from |cache| with the focused index of the delta.
+template <typename T>
+void Restore(const T &cache, bool has_focused_index, uint32 focused_index,
+             T *message) {
+  message->CopyFrom(cache);
+  if (has_focused_index) {
+    message->set_focused_index(focused_index);
+  } else {
+    message->clear_focused_index();
+  }
+}
+
+// Keeps the field of the output in |cache|, or resets |cache| if the field is
+// not set.
+template <typename T>
+void UpdateCache(bool has_field, const T &field, std::unique_ptr<T> *cache) {
+  if (!has_field) {
+    cache->reset();
+    return;
+  }
+  if (*cache == nullptr) {
+    cache->reset(new T);
+  }
+  (*cache)->CopyFrom(field);
+}
+
+}  // namespace
+
+CandidatesDeltaEncoder::CandidatesDeltaEncoder()
+    : version_(0),
+      has_candidates_(false),
+      has_all_candidate_words_(false) {}
+
+CandidatesDeltaEncoder::~CandidatesDeltaEncoder() {}
+
+void CandidatesDeltaEncoder::Encode(const commands::Input &input,
+                                    commands::Output *output) {
+  DCHECK(output);
+  // The client has the fields of the previous output.
+  const bool client_has_previous = input.has_candidates_version() &&
+                                   input.candidates_version() == version_;
+
+  const bool has_candidates = output->has_candidates();
+  string candidates;
+  if (has_candidates) {
+    SerializeWithoutFocus(output->mutable_candidates(), &candidates);
+  }
+  const bool has_all_candidate_words = output->has_all_candidate_words();
+  string all_candidate_words;
+  if (has_all_candidate_words) {
+    SerializeWithoutFocus(output->mutable_all_candidate_words(),
+                          &all_candidate_words);
+  }
+
+  const bool candidates_unchanged =
+      has_candidates && has_candidates_ && candidates == candidates_;
+  const bool all_candidate_words_unchanged =
+      has_all_candidate_words && has_all_candidate_words_ &&
+      all_candidate_words == all_candidate_words_;
+  // A new version is assigned whenever the content the client keeps changes.
+  if (has_candidates != has_candidates_ || candidates != candidates_ ||
+      has_all_candidate_words != has_all_candidate_words_ ||
+      all_candidate_words != all_candidate_words_) {
+    ++version_;
+  }
+  has_candidates_ = has_candidates;
+  candidates_.swap(candidates);
+  has_all_candidate_words_ = has_all_candidate_words;
+  all_candidate_words_.swap(all_candidate_words);
+
+  commands::CandidatesDelta *delta = output->mutable_candidates_delta();
+  delta->set_version(version_);
+  if (!client_has_previous) {
+    return;
+  }
+  if (candidates_unchanged) {
+    delta->set_candidates_unchanged(true);
+    if (output->candidates().has_focused_index()) {
+      delta->set_candidates_focused_index(
+          output->candidates().focused_index());
+    }
+    output->clear_candidates();
+  }
+  if (all_candidate_words_unchanged) {
+    delta->set_all_candidate_words_unchanged(true);
+    if (output->all_candidate_words().has_focused_index()) {
+      delta->set_all_candidate_words_focused_index(
+          output->all_candidate_words().focused_index());
+    }
+    output->clear_all_candidate_words();
+  }
+}
+
+CandidatesDeltaDecoder::CandidatesDeltaDecoder()
+    : has_version_(false), version_(0) {}
+
+CandidatesDeltaDecoder::~CandidatesDeltaDecoder() {}
+
+void CandidatesDeltaDecoder::FillInput(commands::Input *input) const {
+  DCHECK(input);
+  if (has_version_) {
+    input->set_candidates_version(version_);
+  } else {
+    input->clear_candidates_version();
+  }
+}
+
+bool CandidatesDeltaDecoder::Decode(commands::Output *output) {
+  DCHECK(output);
+  if (!output->has_candidates_delta()) {
+    // The server did not encode the output.
+    Reset();
+    return true;
+  }
+
+  const commands::CandidatesDelta &delta = output->candidates_delta();
+  if ((delta.candidates_unchanged() && candidates_ == nullptr) ||
+      (delta.all_candidate_words_unchanged() &&
+       all_candidate_words_ == nullptr)) {
+    LOG(ERROR) << "The delta refers to the fields the decoder does not have.";
+    Reset();
+    return false;
+  }
+  if (delta.candidates_unchanged()) {
+    Restore(*candidates_, delta.has_candidates_focused_index(),
+            delta.candidates_focused_index(), output->mutable_candidates());
+  }
+  if (delta.all_candidate_words_unchanged()) {
+    Restore(*all_candidate_words_,
+            delta.has_all_candidate_words_focused_index(),
+            delta.all_candidate_words_focused_index(),
+            output->mutable_all_candidate_words());
+  }
+
+  UpdateCache(output->has_candidates(), output->candidates(), &candidates_);
+  UpdateCache(output->has_all_candidate_words(),
+              output->all_candidate_words(), &all_candidate_words_);
+  has_version_ = true;
+  version_ = delta.version();
+  output->clear_candidates_delta();
+  return true;
+}
+
+void CandidatesDeltaDecoder::Reset() {
+  has_version_ = false;
+  version_ = 0;
+  candidates_.reset();
+  all_candidate_words_.reset();
+}
+
+}  // namespace mozc
@@ -0,0 +1,103 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Delta encoding of the candidate fields of commands::Output between
+// consecutive outputs of a session.  The server side of a session owns a
+// CandidatesDeltaEncoder and the client owns a CandidatesDeltaDecoder.  See
+// commands::CandidatesDelta for the protocol.
+
+#ifndef MOZC_SESSION_CANDIDATES_DELTA_H_
+#define MOZC_SESSION_CANDIDATES_DELTA_H_
+
+#include <memory>
+#include <string>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace commands {
+class Candidates;
+class CandidateList;
+class Input;
+class Output;
+}  // namespace commands
+
+class CandidatesDeltaEncoder {
+ public:
+  CandidatesDeltaEncoder();
+  ~CandidatesDeltaEncoder();
+
+  // Replaces the candidate fields of |output| which are unchanged since the
+  // previous output with commands::CandidatesDelta.  The fields are omitted
+  // only when Input::candidates_version of |input| shows that the client has
+  // the previous output.
+  void Encode(const commands::Input &input, commands::Output *output);
+
+ private:
+  uint64 version_;
+
+  // The candidate fields of the previous output serialized without their
+  // focused indices.
+  bool has_candidates_;
+  string candidates_;
+  bool has_all_candidate_words_;
+  string all_candidate_words_;
+
+  DISALLOW_COPY_AND_ASSIGN(CandidatesDeltaEncoder);
+};
+
+class CandidatesDeltaDecoder {
+ public:
+  CandidatesDeltaDecoder();
+  ~CandidatesDeltaDecoder();
+
+  // Sets Input::candidates_version of the fields this decoder has.
+  void FillInput(commands::Input *input) const;
+
+  // Restores the candidate fields of |output| omitted by the encoder, and
+  // keeps them for the next output.  Returns false if the fields cannot be
+  // restored, which resets the decoder.
+  bool Decode(commands::Output *output);
+
+  // Forgets the fields, e.g., when the session is recreated or an output is
+  // lost.  The server then sends the full fields.
+  void Reset();
+
+ private:
+  bool has_version_;
+  uint64 version_;
+  std::unique_ptr<commands::Candidates> candidates_;
+  std::unique_ptr<commands::CandidateList> all_candidate_words_;
+
+  DISALLOW_COPY_AND_ASSIGN(CandidatesDeltaDecoder);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_CANDIDATES_DELTA_H_
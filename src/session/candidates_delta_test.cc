@@ -0,0 +1,182 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/candidates_delta.h"
+
+#include <string>
+
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+void SetCandidates(const string &prefix, int focused_index,
+                   commands::Output *output) {
+  commands::Candidates *candidates = output->mutable_candidates();
+  commands::CandidateList *all_words = output->mutable_all_candidate_words();
+  candidates->set_size(3);
+  candidates->set_position(0);
+  for (int i = 0; i < 3; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value(prefix + static_cast<char>('0' + i));
+    candidate->set_id(i);
+    commands::CandidateWord *word = all_words->add_candidates();
+    word->set_id(i);
+    word->set_index(i);
+    word->set_value(prefix + static_cast<char>('0' + i));
+  }
+  if (focused_index >= 0) {
+    candidates->set_focused_index(focused_index);
+    all_words->set_focused_index(focused_index);
+  }
+}
+
+class CandidatesDeltaTest : public ::testing::Test {
+ protected:
+  // Encodes |output| as the server does, sends it over the wire, and decodes
+  // it as the client does.  Returns the size of the serialized output.
+  size_t Transfer(const commands::Output &output, commands::Output *decoded) {
+    commands::Input input;
+    decoder_.FillInput(&input);
+    commands::Output encoded = output;
+    encoder_.Encode(input, &encoded);
+    const string wire = encoded.SerializeAsString();
+    EXPECT_TRUE(decoded->ParseFromString(wire));
+    EXPECT_TRUE(decoder_.Decode(decoded));
+    return wire.size();
+  }
+
+  CandidatesDeltaEncoder encoder_;
+  CandidatesDeltaDecoder decoder_;
+};
+
+TEST_F(CandidatesDeltaTest, FocusChangeIsSentAsDelta) {
+  commands::Output first;
+  SetCandidates("a", 0, &first);
+  commands::Output decoded;
+  const size_t full_size = Transfer(first, &decoded);
+  EXPECT_EQ(first.SerializeAsString(), decoded.SerializeAsString());
+
+  commands::Output second;
+  SetCandidates("a", 2, &second);
+  const size_t delta_size = Transfer(second, &decoded);
+  EXPECT_EQ(second.SerializeAsString(), decoded.SerializeAsString());
+  EXPECT_LT(delta_size, full_size);
+
+  // The focused index can be cleared, e.g., for suggestion.
+  commands::Output third;
+  SetCandidates("a", -1, &third);
+  Transfer(third, &decoded);
+  EXPECT_EQ(third.SerializeAsString(), decoded.SerializeAsString());
+  EXPECT_FALSE(decoded.candidates().has_focused_index());
+}
+
+TEST_F(CandidatesDeltaTest, ChangedCandidatesAreSentInFull) {
+  commands::Output first;
+  SetCandidates("a", 0, &first);
+  commands::Output decoded;
+  Transfer(first, &decoded);
+
+  commands::Output second;
+  SetCandidates("b", 0, &second);
+  commands::Input input;
+  decoder_.FillInput(&input);
+  commands::Output encoded = second;
+  encoder_.Encode(input, &encoded);
+  EXPECT_TRUE(encoded.has_candidates());
+  EXPECT_TRUE(encoded.has_all_candidate_words());
+  EXPECT_FALSE(encoded.candidates_delta().candidates_unchanged());
+  EXPECT_NE(input.candidates_version(), encoded.candidates_delta().version());
+
+  // Without candidates, the decoder forgets the previous ones.
+  commands::Output empty;
+  Transfer(empty, &decoded);
+  EXPECT_FALSE(decoded.has_candidates());
+  Transfer(second, &decoded);
+  EXPECT_EQ(second.SerializeAsString(), decoded.SerializeAsString());
+}
+
+TEST_F(CandidatesDeltaTest, LostOutput) {
+  commands::Output first;
+  SetCandidates("a", 0, &first);
+  commands::Output decoded;
+  Transfer(first, &decoded);
+
+  // The client loses the output of a command and resets the decoder.
+  commands::Input input;
+  decoder_.FillInput(&input);
+  commands::Output lost;
+  SetCandidates("b", 0, &lost);
+  encoder_.Encode(input, &lost);
+  decoder_.Reset();
+
+  // Then the server sends the full fields even though they are unchanged.
+  commands::Output second;
+  SetCandidates("b", 1, &second);
+  decoder_.FillInput(&input);
+  EXPECT_FALSE(input.has_candidates_version());
+  commands::Output encoded = second;
+  encoder_.Encode(input, &encoded);
+  EXPECT_TRUE(encoded.has_candidates());
+  EXPECT_TRUE(decoder_.Decode(&encoded));
+  EXPECT_EQ(second.SerializeAsString(), encoded.SerializeAsString());
+}
+
+TEST_F(CandidatesDeltaTest, DecodeWithoutPreviousCandidates) {
+  commands::Output output;
+  output.mutable_candidates_delta()->set_version(1);
+  output.mutable_candidates_delta()->set_candidates_unchanged(true);
+  EXPECT_FALSE(decoder_.Decode(&output));
+
+  commands::Input input;
+  decoder_.FillInput(&input);
+  EXPECT_FALSE(input.has_candidates_version());
+}
+
+TEST_F(CandidatesDeltaTest, OutputWithoutDelta) {
+  commands::Output first;
+  SetCandidates("a", 0, &first);
+  commands::Output decoded;
+  Transfer(first, &decoded);
+
+  // The server does not support the delta.
+  commands::Output second;
+  SetCandidates("a", 1, &second);
+  EXPECT_TRUE(decoder_.Decode(&second));
+  EXPECT_TRUE(second.has_candidates());
+  commands::Input input;
+  decoder_.FillInput(&input);
+  EXPECT_FALSE(input.has_candidates_version());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,62 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/command_arena.h"
+
+#include "base/logging.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+
+CommandArena::CommandArena() : CommandArena(kDefaultBlockSize) {}
+
+CommandArena::CommandArena(size_t block_size)
+    : block_size_(block_size),
+      block_(new char[block_size]),
+      last_space_used_(0) {
+  protobuf::ArenaOptions options;
+  options.initial_block = block_.get();
+  options.initial_block_size = block_size_;
+  arena_.reset(new protobuf::Arena(options));
+}
+
+CommandArena::~CommandArena() {
+  // The arena must be destroyed before the block it uses.
+  arena_.reset();
+}
+
+commands::Command *CommandArena::NewCommand() {
+  // Reset() frees the blocks allocated in addition to the initial one.
+  last_space_used_ = arena_->Reset();
+  VLOG_IF(1, last_space_used_ > block_size_)
+      << "The command used " << last_space_used_ << " bytes of the arena.";
+  return protobuf::Arena::CreateMessage<commands::Command>(arena_.get());
+}
+
+}  // namespace mozc
@@ -0,0 +1,81 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_SESSION_COMMAND_ARENA_H_
+#define MOZC_SESSION_COMMAND_ARENA_H_
+
+#include <memory>
+
+#include "base/port.h"
+#include "base/protobuf/arena.h"
+
+namespace mozc {
+namespace commands {
+class Command;
+}  // namespace commands
+
+// Allocates commands::Command of each request and all its sub messages from
+// an arena.  The first block of the arena is kept across the requests, so the
+// messages of a typical command are allocated without touching the heap, and
+// freed at once when the next command is created.
+//
+// Usage:
+//   CommandArena arena;
+//   while (...) {
+//     commands::Command *command = arena.NewCommand();
+//     ...
+//   }
+class CommandArena {
+ public:
+  // Large enough for the output with a full candidate window.
+  static const size_t kDefaultBlockSize = 64 * 1024;
+
+  CommandArena();
+  explicit CommandArena(size_t block_size);
+  ~CommandArena();
+
+  // Returns an empty command owned by the arena.  It is valid until the next
+  // call.  The messages of the previous command must not be used any more.
+  commands::Command *NewCommand();
+
+  // Bytes allocated for the previous command, including the reused block.
+  uint64 last_space_used() const { return last_space_used_; }
+
+ private:
+  const size_t block_size_;
+  std::unique_ptr<char[]> block_;
+  std::unique_ptr<protobuf::Arena> arena_;
+  uint64 last_space_used_;
+
+  DISALLOW_COPY_AND_ASSIGN(CommandArena);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_COMMAND_ARENA_H_
@@ -0,0 +1,80 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/command_arena.h"
+
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+void FillCandidates(int size, commands::Output *output) {
+  commands::Candidates *candidates = output->mutable_candidates();
+  candidates->set_size(size);
+  candidates->set_position(0);
+  for (int i = 0; i < size; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value("candidate value long enough to need a buffer");
+    candidate->mutable_annotation()->set_description("description");
+  }
+}
+
+TEST(CommandArenaTest, NewCommand) {
+  CommandArena arena;
+  commands::Command *command = arena.NewCommand();
+  ASSERT_NE(nullptr, command);
+  EXPECT_NE(nullptr, command->GetArena());
+  command->mutable_input()->set_type(commands::Input::SEND_KEY);
+  FillCandidates(9, command->mutable_output());
+
+  // The next command is empty and the previous one is freed.
+  command = arena.NewCommand();
+  ASSERT_NE(nullptr, command);
+  EXPECT_FALSE(command->has_input());
+  EXPECT_FALSE(command->has_output());
+  EXPECT_LT(0, arena.last_space_used());
+}
+
+TEST(CommandArenaTest, CommandLargerThanBlock) {
+  CommandArena arena(1024);
+  commands::Command *command = arena.NewCommand();
+  FillCandidates(200, command->mutable_output());
+  const string serialized = command->output().SerializeAsString();
+
+  command = arena.NewCommand();
+  EXPECT_LT(1024, arena.last_space_used());
+  EXPECT_TRUE(command->mutable_output()->ParseFromString(serialized));
+  EXPECT_EQ(200, command->output().candidates().candidate_size());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -47,9 +47,7 @@ namespace {
 class ImeSwitchUtilImpl {
  public:
   ImeSwitchUtilImpl() {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    ReloadConfig(config);
+    ReloadConfig(*config::ConfigHandler::GetSharedConfig());
   }
 
   bool IsDirectModeCommand(const commands::KeyEvent &key) const {
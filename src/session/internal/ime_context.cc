@@ -50,7 +50,8 @@ ImeContext::ImeContext()
       state_(NONE),
       request_(&Request::default_instance()),
       config_(&config::ConfigHandler::DefaultConfig()),
-      keymap_(config::ConfigHandler::GetDefaultKeyMap()) {
+      keymap_(config::ConfigHandler::GetDefaultKeyMap()),
+      output_(new commands::Output) {
 }
 ImeContext::~ImeContext() {}
 
@@ -60,6 +61,11 @@ const composer::Composer &ImeContext::composer() const {
 }
 composer::Composer *ImeContext::mutable_composer() {
   DCHECK(composer_.get());
+  if (composer_.use_count() > 1) {
+    composer::Composer *composer = new composer::Composer(NULL, NULL, NULL);
+    composer->CopyFrom(*composer_);
+    composer_.reset(composer);
+  }
   return composer_.get();
 }
 void ImeContext::set_composer(composer::Composer *composer) {
@@ -71,16 +77,34 @@ const SessionConverterInterface &ImeContext::converter() const {
   return *converter_;
 }
 SessionConverterInterface *ImeContext::mutable_converter() {
+  if (converter_.use_count() > 1) {
+    converter_.reset(converter_->Clone());
+  }
   return converter_.get();
 }
 void ImeContext::set_converter(SessionConverterInterface *converter) {
   converter_.reset(converter);
 }
 
+commands::Output *ImeContext::mutable_output() {
+  if (output_.use_count() > 1) {
+    output_.reset(new commands::Output(*output_));
+  }
+  return output_.get();
+}
+
+void ImeContext::set_output(const commands::Output &output) {
+  if (output_.use_count() > 1) {
+    output_.reset(new commands::Output(output));
+  } else {
+    output_->CopyFrom(output);
+  }
+}
+
 void ImeContext::SetRequest(const commands::Request *request) {
   request_ = request;
-  converter_->SetRequest(request_);
-  composer_->SetRequest(request_);
+  mutable_converter()->SetRequest(request_);
+  mutable_composer()->SetRequest(request_);
 }
 
 const commands::Request &ImeContext::GetRequest() const {
@@ -92,12 +116,15 @@ void ImeContext::SetConfig(const config::Config *config) {
   config_ = config;
 
   DCHECK(converter_.get());
-  converter_->SetConfig(config_);
+  mutable_converter()->SetConfig(config_);
 
   DCHECK(composer_.get());
-  composer_->SetConfig(config_);
+  mutable_composer()->SetConfig(config_);
 
   DCHECK(key_event_transformer_.get());
+  if (key_event_transformer_.use_count() > 1) {
+    key_event_transformer_.reset(new KeyEventTransformer);
+  }
   key_event_transformer_->ReloadConfig(*config_);
 
   keymap_ = config->session_keymap();
@@ -117,18 +144,21 @@ void ImeContext::CopyContext(const ImeContext &src, ImeContext *dest) {
   dest->set_create_time(src.create_time());
   dest->set_last_command_time(src.last_command_time());
 
-  dest->mutable_composer()->CopyFrom(src.composer());
-  dest->converter_.reset(src.converter().Clone());
-  dest->key_event_transformer_->CopyFrom(*src.key_event_transformer_);
+  // The shared composer and converter already refer to |src.request_| and
+  // |src.config_|, so they are not set via SetRequest() and SetConfig().
+  dest->composer_ = src.composer_;
+  dest->converter_ = src.converter_;
+  dest->key_event_transformer_ = src.key_event_transformer_;
 
   dest->set_state(src.state());
 
-  dest->SetRequest(src.request_);
-  dest->SetConfig(src.config_);
+  dest->request_ = src.request_;
+  dest->config_ = src.config_;
+  dest->keymap_ = src.config_->session_keymap();
 
   dest->mutable_client_capability()->CopyFrom(src.client_capability());
   dest->mutable_application_info()->CopyFrom(src.application_info());
-  dest->mutable_output()->CopyFrom(src.output());
+  dest->output_ = src.output_;
 }
 
 }  // namespace session
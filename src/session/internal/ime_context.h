@@ -49,6 +49,10 @@ class Composer;
 namespace session {
 class SessionConverterInterface;
 
+// The composer, the converter, the key event transformer and the last output
+// are shared between contexts copied by CopyContext() and are duplicated only
+// when either side calls a mutable accessor (copy-on-write).  Hence a snapshot
+// of a context, e.g. for undo, costs only the parts modified afterwards.
 class ImeContext {
  public:
   ImeContext();
@@ -136,13 +140,16 @@ class ImeContext {
   }
 
   const commands::Output &output() const {
-    return output_;
-  }
-  commands::Output *mutable_output() {
-    return &output_;
+    return *output_;
   }
+  commands::Output *mutable_output();
+  // Replaces the output.  Unlike mutable_output()->CopyFrom(output), this
+  // doesn't duplicate the current output when it is shared.
+  void set_output(const commands::Output &output);
 
-  // Copy |source| context to |destination| context.
+  // Copy |source| context to |destination| context.  The copy is shallow and
+  // takes O(1) for the composer, the converter and the output.  See the class
+  // comment.
   // TODO(hsumita): Renames it as CopyFrom and make it non-static to keep
   // consistency with other classes.
   static void CopyContext(const ImeContext &src, ImeContext *dest);
@@ -155,11 +162,11 @@ class ImeContext {
   uint64 create_time_;
   uint64 last_command_time_;
 
-  std::unique_ptr<composer::Composer> composer_;
+  std::shared_ptr<composer::Composer> composer_;
 
-  std::unique_ptr<SessionConverterInterface> converter_;
+  std::shared_ptr<SessionConverterInterface> converter_;
 
-  std::unique_ptr<KeyEventTransformer> key_event_transformer_;
+  std::shared_ptr<KeyEventTransformer> key_event_transformer_;
 
   State state_;
 
@@ -176,7 +183,7 @@ class ImeContext {
 
   // Storing the last output consisting of the last result and the
   // last performed command.
-  commands::Output output_;
+  std::shared_ptr<commands::Output> output_;
 
   DISALLOW_COPY_AND_ASSIGN(ImeContext);
 };
@@ -214,6 +214,59 @@ TEST(ImeContextTest, CopyContext) {
   }
 }
 
+TEST(ImeContextTest, CopyContextIsCopyOnWrite) {
+  composer::Table table;
+  table.AddRule("a", "あ", "");
+  table.AddRule("i", "い", "");
+  const commands::Request request;
+  const config::Config config;
+  std::unique_ptr<MockConverterEngine> engine(new MockConverterEngine);
+
+  ImeContext source;
+  source.set_composer(new composer::Composer(&table, &request, &config));
+  source.set_converter(new SessionConverter(
+      engine->GetConverter(), &request, &config));
+  source.mutable_composer()->InsertCharacter("a");
+  commands::Output output;
+  output.mutable_result()->set_value("あ");
+  source.set_output(output);
+
+  ImeContext destination;
+  ImeContext::CopyContext(source, &destination);
+
+  // Nothing is duplicated until either side is modified.
+  EXPECT_EQ(&source.composer(), &destination.composer());
+  EXPECT_EQ(&source.converter(), &destination.converter());
+  EXPECT_EQ(&source.output(), &destination.output());
+  EXPECT_EQ(&source.key_event_transformer(),
+            &destination.key_event_transformer());
+
+  // Modifying the source duplicates only the modified composer.
+  source.mutable_composer()->InsertCharacter("i");
+  EXPECT_NE(&source.composer(), &destination.composer());
+  EXPECT_EQ(&source.converter(), &destination.converter());
+  string composition;
+  source.composer().GetStringForPreedit(&composition);
+  EXPECT_EQ("あい", composition);
+  composition.clear();
+  destination.composer().GetStringForPreedit(&composition);
+  EXPECT_EQ("あ", composition);
+
+  // Replacing the output doesn't affect the copy.
+  output.mutable_result()->set_value("い");
+  source.set_output(output);
+  EXPECT_EQ("い", source.output().result().value());
+  EXPECT_EQ("あ", destination.output().result().value());
+
+  // Once unshared, the objects are modified in place.
+  const composer::Composer *composer = &source.composer();
+  source.mutable_composer()->Reset();
+  EXPECT_EQ(composer, &source.composer());
+
+  destination.mutable_converter()->set_use_cascading_window(false);
+  EXPECT_NE(&source.converter(), &destination.converter());
+}
+
 TEST(ImeContextTest, CustomKeymap) {
   ImeContext context;
 
@@ -39,6 +39,7 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "base/trace.h"
 #include "base/url.h"
 #include "base/util.h"
 #include "base/version.h"
@@ -50,6 +51,7 @@
 #include "engine/user_data_manager_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/async_suggestion.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/key_event_transformer.h"
 #include "session/internal/keymap.h"
@@ -75,31 +77,44 @@ void SwitchInputMode(const transliteration::TransliterationType mode,
   composer->SetNewInput();
 }
 
-// Set input mode to the |composer| if the the input mode of |composer| is not
-// the given |mode|.
-void ApplyInputMode(const commands::CompositionMode mode,
-                    composer::Composer *composer) {
+// Converts |mode| to the corresponding input mode of the composer.  Returns
+// false if |mode| has no corresponding input mode.
+bool GetInputModeFromCompositionMode(
+    const commands::CompositionMode mode,
+    transliteration::TransliterationType *input_mode) {
   switch (mode) {
     case commands::HIRAGANA:
-      SwitchInputMode(transliteration::HIRAGANA, composer);
-      break;
+      *input_mode = transliteration::HIRAGANA;
+      return true;
     case commands::FULL_KATAKANA:
-      SwitchInputMode(transliteration::FULL_KATAKANA, composer);
-      break;
+      *input_mode = transliteration::FULL_KATAKANA;
+      return true;
     case commands::HALF_KATAKANA:
-      SwitchInputMode(transliteration::HALF_KATAKANA, composer);
-      break;
+      *input_mode = transliteration::HALF_KATAKANA;
+      return true;
     case commands::FULL_ASCII:
-      SwitchInputMode(transliteration::FULL_ASCII, composer);
-      break;
+      *input_mode = transliteration::FULL_ASCII;
+      return true;
     case commands::HALF_ASCII:
-      SwitchInputMode(transliteration::HALF_ASCII, composer);
-      break;
+      *input_mode = transliteration::HALF_ASCII;
+      return true;
     default:
-      LOG(DFATAL) << "ime on with invalid mode";
+      return false;
   }
 }
 
+// Set input mode to the |composer| if the the input mode of |composer| is not
+// the given |mode|.
+void ApplyInputMode(const commands::CompositionMode mode,
+                    composer::Composer *composer) {
+  transliteration::TransliterationType input_mode;
+  if (!GetInputModeFromCompositionMode(mode, &input_mode)) {
+    LOG(DFATAL) << "ime on with invalid mode";
+    return;
+  }
+  SwitchInputMode(input_mode, composer);
+}
+
 // Return true if the specified key event consists of any modifier key only.
 bool IsPureModifierKeyEvent(const commands::KeyEvent &key) {
   if (key.has_key_code()) {
@@ -239,8 +254,9 @@ void Session::InitContext(ImeContext *context) const {
 
 void Session::PushUndoContext() {
   // TODO(komatsu): Support multiple undo.
+  // CopyContext() shares the composer, the converter and the output with
+  // |context_|, and they are duplicated only when modified later.
   prev_context_.reset(new ImeContext);
-  InitContext(prev_context_.get());
   ImeContext::CopyContext(*context_, prev_context_.get());
 }
 
@@ -264,6 +280,7 @@ void Session::EnsureIMEIsOn() {
 }
 
 bool Session::SendCommand(commands::Command *command) {
+  MOZC_TRACE_SPAN("Session::SendCommand");
   UpdateTime();
   UpdatePreferences(command);
   if (!command->input().has_command()) {
@@ -274,6 +291,9 @@ bool Session::SendCommand(commands::Command *command) {
   SessionUsageStatsUtil::AddSendCommandInputStats(command->input());
 
   const commands::SessionCommand &session_command = command->input().command();
+  if (session_command.type() != commands::SessionCommand::GET_ASYNC_RESULT) {
+    context_->mutable_converter()->CancelAsyncSuggest();
+  }
   bool result = false;
   if (session_command.type() == commands::SessionCommand::SWITCH_INPUT_MODE) {
     if (!session_command.has_composition_mode()) {
@@ -331,6 +351,9 @@ bool Session::SendCommand(commands::Command *command) {
     case commands::SessionCommand::UNDO:
       result = Undo(command);
       break;
+    case commands::SessionCommand::GET_ASYNC_RESULT:
+      result = GetAsyncResult(command);
+      break;
     case commands::SessionCommand::RESET_CONTEXT:
       result = ResetContext(command);
       break;
@@ -475,9 +498,12 @@ bool Session::TestSendKey(commands::Command *command) {
 }
 
 bool Session::SendKey(commands::Command *command) {
+  MOZC_TRACE_SPAN("Session::SendKey");
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
+  // The pending suggestion is outdated by this key.
+  context_->mutable_converter()->CancelAsyncSuggest();
   // To support indirect IME on/off by using KeyEvent::activated, use effective
   // state instead of directly using context_->state().
   HandleIndirectImeOnOff(command);
@@ -1128,6 +1154,13 @@ void Session::SetTable(const composer::Table *table) {
   context_->mutable_composer()->SetTable(table);
 }
 
+void Session::SetEngine(EngineInterface *engine) {
+  // The undo context still refers to the previous converter.
+  ClearUndoContext();
+  engine_ = engine;
+  context_->mutable_converter()->SetConverter(engine_->GetConverter());
+}
+
 void Session::SetConfig(config::Config *config) {
   context_->SetConfig(config);
 }
@@ -1188,6 +1221,22 @@ bool Session::ConvertReverse(commands::Command *command) {
   return true;
 }
 
+bool Session::GetAsyncResult(commands::Command *command) {
+  if (context_->state() != ImeContext::COMPOSITION ||
+      !context_->converter().HasAsyncSuggestion()) {
+    // The suggestion has been discarded by a newer command.
+    return DoNothing(command);
+  }
+  command->mutable_output()->set_consumed(true);
+  if (context_->mutable_converter()->FinishAsyncSuggest(
+          context_->composer())) {
+    Output(command);
+  } else {
+    OutputComposition(command);
+  }
+  return true;
+}
+
 bool Session::RequestUndo(commands::Command *command) {
   if (!(context_->state() & (ImeContext::PRECOMPOSITION |
                              ImeContext::CONVERSION |
@@ -1325,7 +1374,7 @@ bool Session::CommitCandidate(commands::Command *command) {
         context_->mutable_composer()->DeleteRange(0, consumed_key_size);
         MoveCursorToEnd(command);
         // Copy the previous output for Undo.
-        context_->mutable_output()->CopyFrom(command->output());
+        context_->set_output(command->output());
         return true;
       }
     }
@@ -1345,7 +1394,7 @@ bool Session::CommitCandidate(commands::Command *command) {
   }
   Output(command);
   // Copy the previous output for Undo.
-  context_->mutable_output()->CopyFrom(command->output());
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1377,6 +1426,13 @@ bool Session::MaybeSelectCandidate(commands::Command *command) {
   return context_->mutable_converter()->CandidateMoveToShortcut(shortcut);
 }
 
+void Session::EncodeCandidatesDelta(commands::Command *command) {
+  if (context_->client_capability().delta_candidates()) {
+    candidates_delta_encoder_.Encode(command->input(),
+                                     command->mutable_output());
+  }
+}
+
 void Session::set_client_capability(const commands::Capability &capability) {
   context_->mutable_client_capability()->CopyFrom(capability);
 }
@@ -1483,6 +1539,17 @@ bool Session::InsertCharacter(commands::Command *command) {
     return Convert(command);
   }
 
+  if (context_->GetRequest().async_suggestion()) {
+    // Return the preedit at once and let the client take the suggestion by
+    // the callback.
+    OutputComposition(command);
+    if (StartAsyncSuggest(command->input())) {
+      command->mutable_output()->mutable_callback()->mutable_session_command()
+          ->set_type(commands::SessionCommand::GET_ASYNC_RESULT);
+    }
+    return true;
+  }
+
   if (Suggest(command->input())) {
     Output(command);
     return true;
@@ -1508,26 +1575,19 @@ bool Session::IsFullWidthInsertSpace(const commands::Input &input) const {
   // the current input mode was HALF_KATAKANA in the following situation.
   //   composer's input mode: HIRAGANA
   //   input.key().mode()   : HALF_KATAKANA
-  // To achieve this, we create a temporary composer object to which the
-  // new input mode will be stored when |input| has a new input mode.
-  const composer::Composer* target_composer = &context_->composer();
-  std::unique_ptr<composer::Composer> temporary_composer;
-  if (input.has_key() && input.key().has_mode()) {
-    // Allocate an object only when it is necessary.
-    temporary_composer.reset(new composer::Composer(NULL, NULL, NULL));
-    // Copy the current composer state just in case.
-    temporary_composer->CopyFrom(context_->composer());
-    ApplyInputMode(input.key().mode(), temporary_composer.get());
-    // Refer to this temporary composer in this method.
-    target_composer = temporary_composer.get();
+  // To achieve this, we use the input mode which would be applied to the
+  // composer instead of copying the composer.
+  transliteration::TransliterationType input_mode =
+      context_->composer().GetInputMode();
+  if (input.has_key() && input.key().has_mode() &&
+      !GetInputModeFromCompositionMode(input.key().mode(), &input_mode)) {
+    LOG(DFATAL) << "ime on with invalid mode";
   }
 
   // Check the current config and the current input status.
   bool is_full_width = false;
   switch (context_->GetConfig().space_character_form()) {
     case config::Config::FUNDAMENTAL_INPUT_MODE: {
-      const transliteration::TransliterationType input_mode =
-          target_composer->GetInputMode();
       if (transliteration::T13n::IsInHalfAsciiTypes(input_mode) ||
           transliteration::T13n::IsInHalfKatakanaTypes(input_mode)) {
         is_full_width = false;
@@ -1731,7 +1791,7 @@ bool Session::CommitInternal(commands::Command *command,
 
   Output(command);
   // Copy the previous output for Undo.
-  context_->mutable_output()->CopyFrom(command->output());
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1790,7 +1850,7 @@ bool Session::CommitFirstSuggestion(commands::Command *command) {
 
   Output(command);
   // Copy the previous output for Undo.
-  context_->mutable_output()->CopyFrom(command->output());
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1817,7 +1877,7 @@ bool Session::CommitSegment(commands::Command *command) {
   }
   Output(command);
   // Copy the previous output for Undo.
-  context_->mutable_output()->CopyFrom(command->output());
+  context_->set_output(command->output());
   return true;
 }
 
@@ -1936,6 +1996,22 @@ bool Session::Suggest(const commands::Input &input) {
   return context_->mutable_converter()->Suggest(context_->composer());
 }
 
+bool Session::StartAsyncSuggest(const commands::Input &input) {
+  if (SuppressSuggestion(input)) {
+    return false;
+  }
+
+  // See the comment in Suggest() about |request_suggestion|.
+  ConversionPreferences conversion_preferences =
+      context_->converter().conversion_preferences();
+  if (input.has_request_suggestion() &&
+      input.type() == commands::Input::SEND_KEY) {
+    conversion_preferences.request_suggestion = input.request_suggestion();
+  }
+  return context_->mutable_converter()->StartAsyncSuggestWithPreferences(
+      context_->composer(), conversion_preferences);
+}
+
 
 bool Session::ConvertToTransliteration(
     commands::Command *command,
@@ -2251,6 +2327,8 @@ bool Session::DeleteSelectedCandidateFromHistory(commands::Command *command) {
     LOG(WARNING) << "No candidate is selected.";
     return DoNothing(command);
   }
+  // The suggestion running on the background thread may use the user data.
+  AsyncSuggestion::Wait(false);
   UserDataManagerInterface *manager = engine_->GetUserDataManager();
   if (!manager->ClearUserPredictionEntry(cand->key, cand->value)) {
     DLOG(WARNING) << "Cannot delete non-history candidate or deletion failed: "
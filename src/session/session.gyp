@@ -37,6 +37,7 @@
       'target_name': 'session',
       'type': 'static_library',
       'sources': [
+        'async_suggestion.cc',
         'session.cc',
         'session_converter.cc',
       ],
@@ -50,6 +51,7 @@
         '../request/request.gyp:conversion_request',
         '../transliteration/transliteration.gyp:transliteration',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
+        'session_base.gyp:candidates_delta',
         'session_base.gyp:keymap',
         'session_base.gyp:keymap_factory',
         'session_base.gyp:session_usage_stats_util',
@@ -143,6 +145,7 @@
         '../base/base.gyp:base',
         '../usage_stats/usage_stats.gyp:usage_stats_uploader',
         '../protocol/protocol.gyp:commands_proto',
+        'session_base.gyp:command_arena',
         'session_handler',
         'session_usage_observer',
       ],
@@ -171,6 +174,26 @@
         'session_server',
       ],
     },
+    {
+      # Keystroke replay benchmark of SessionHandler with the OSS engine.
+      'target_name': 'session_handler_benchmark',
+      'type': 'executable',
+      'sources': [
+        'session_handler_benchmark.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../composer/composer.gyp:key_parser',
+        '../engine/engine.gyp:engine_factory',
+        '../protocol/protocol.gyp:commands_proto',
+        'random_keyevents_generator',
+        'session_base.gyp:candidates_delta',
+        'session_base.gyp:command_arena',
+        'session_base.gyp:request_test_util',
+        '../testing/testing.gyp:googletest_lib',
+        'session_handler',
+      ],
+    },
     {
       'target_name': 'gen_session_stress_test_data',
       'type': 'none',
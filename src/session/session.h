@@ -37,6 +37,7 @@
 
 #include "base/port.h"
 #include "composer/composer.h"
+#include "session/candidates_delta.h"
 #include "session/session_interface.h"
 // for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
@@ -132,6 +133,10 @@ class Session : public SessionInterface {
   // UNDO SessionCommand is called.
   bool Undo(mozc::commands::Command *command);
 
+  // Outputs the suggestion computed in background.  This function is called
+  // when the GET_ASYNC_RESULT SessionCommand is called.
+  bool GetAsyncResult(mozc::commands::Command *command);
+
   bool InsertSpace(mozc::commands::Command *command);
   bool InsertSpaceToggled(mozc::commands::Command *command);
   bool InsertSpaceHalfWidth(mozc::commands::Command *command);
@@ -243,6 +248,10 @@ class Session : public SessionInterface {
 
   virtual void SetTable(const mozc::composer::Table *table);
 
+  virtual void SetEngine(mozc::EngineInterface *engine);
+
+  virtual void EncodeCandidatesDelta(mozc::commands::Command *command);
+
   // Set client capability for this session.  Used by unittest.
   virtual void set_client_capability(
       const mozc::commands::Capability &capability);
@@ -280,6 +289,9 @@ class Session : public SessionInterface {
   std::unique_ptr<ImeContext> context_;
   std::unique_ptr<ImeContext> prev_context_;
 
+  // Not a part of ImeContext as undo must not restore it.
+  CandidatesDeltaEncoder candidates_delta_encoder_;
+
   void InitContext(ImeContext *context) const;
 
   void PushUndoContext();
@@ -325,6 +337,10 @@ class Session : public SessionInterface {
   // SessionConverter::Suggest is not called or no results exist.
   bool Suggest(const mozc::commands::Input &input);
 
+  // Asynchronous version of Suggest.  True is returned when the suggestion
+  // has started in background.
+  bool StartAsyncSuggest(const mozc::commands::Input &input);
+
   // Commands like EditCancel should restore the original string used for
   // the reverse conversion without any modification.
   // Returns true if the |source_text| is committed to cancel reconversion.
@@ -106,6 +106,29 @@
         'keymap',
       ],
     },
+    {
+      'target_name': 'candidates_delta',
+      'type': 'static_library',
+      'sources': [
+        'candidates_delta.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../protocol/protocol.gyp:commands_proto',
+      ],
+    },
+    {
+      'target_name': 'command_arena',
+      'type': 'static_library',
+      'sources': [
+        'command_arena.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../protobuf/protobuf.gyp:protobuf',
+        '../protocol/protocol.gyp:commands_proto',
+      ],
+    },
     {
       'target_name': 'output_util',
       'type': 'static_library',
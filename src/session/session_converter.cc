@@ -33,12 +33,14 @@
 
 #include <algorithm>
 #include <limits>
+#include <memory>
 #include <string>
 
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/text_normalizer.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "config/config_handler.h"
@@ -48,12 +50,14 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "session/async_suggestion.h"
 #include "session/internal/candidate_list.h"
 #include "session/internal/session_output.h"
 #include "session/session_usage_stats_util.h"
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
 
+using mozc::usage_stats::StatsId;
 using mozc::usage_stats::UsageStats;
 
 #ifdef OS_ANDROID
@@ -102,6 +106,24 @@ const char *GetCandidateShortcuts(
   return shortcut;
 }
 
+// Applies the time budget of |request| to |conversion_request|.
+void SetTimeBudget(const Request &request,
+                   ConversionRequest *conversion_request) {
+  if (request.conversion_time_budget_msec() > 0) {
+    conversion_request->set_time_budget_usec(
+        static_cast<uint64>(request.conversion_time_budget_msec()) * 1000);
+  }
+}
+
+// Counts the request as |stats_name| if its result was cut short by the time
+// budget.
+void RecordDegradation(const ConversionRequest &conversion_request,
+                       const char *stats_name) {
+  if (conversion_request.degraded()) {
+    UsageStats::IncrementCount(stats_name);
+  }
+}
+
 }  // namespace
 
 const size_t SessionConverter::kConsumedAllCharacters =
@@ -127,7 +149,9 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
   SetConfig(config);
 }
 
-SessionConverter::~SessionConverter() {}
+SessionConverter::~SessionConverter() {
+  CancelAsyncSuggest();
+}
 
 bool SessionConverter::CheckState(
     SessionConverterInterface::States states) const {
@@ -149,18 +173,21 @@ bool SessionConverter::Convert(const composer::Composer &composer) {
 bool SessionConverter::ConvertWithPreferences(
     const composer::Composer &composer,
     const ConversionPreferences &preferences) {
+  MOZC_TRACE_SPAN("SessionConverter::Convert");
   DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION));
 
   segments_->set_request_type(Segments::CONVERSION);
   SetConversionPreferences(preferences, segments_.get());
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->StartConversionForRequest(conversion_request,
-                                             segments_.get())) {
+  ConversionRequest conversion_request(&composer, request_, config_);
+  SetTimeBudget(*request_, &conversion_request);
+  if (!converter()->StartConversionForRequest(conversion_request,
+                                              segments_.get())) {
     LOG(WARNING) << "StartConversionForRequest() failed";
     ResetState();
     return false;
   }
+  RecordDegradation(conversion_request, "ConversionDegraded");
 
   segment_index_ = 0;
   state_ = CONVERSION;
@@ -175,7 +202,7 @@ bool SessionConverter::GetReadingText(const string &source_text,
   DCHECK(reading);
   reading->clear();
   Segments reverse_segments;
-  if (!converter_->StartReverseConversion(&reverse_segments, source_text)) {
+  if (!converter()->StartReverseConversion(&reverse_segments, source_text)) {
     return false;
   }
   if (reverse_segments.segments_size() == 0) {
@@ -343,9 +370,9 @@ bool SessionConverter::SwitchKanaType(const composer::Composer &composer) {
       string composition;
       GetPreedit(0, segments_->conversion_segments_size(), &composition);
       const ConversionRequest conversion_request(&composer, request_, config_);
-      converter_->ResizeSegment(segments_.get(),
-                                conversion_request,
-                                0, Util::CharsLen(composition));
+      converter()->ResizeSegment(segments_.get(),
+                                 conversion_request,
+                                 0, Util::CharsLen(composition));
       UpdateCandidateList();
     }
 
@@ -410,6 +437,7 @@ bool SessionConverter::Suggest(const composer::Composer &composer) {
 bool SessionConverter::SuggestWithPreferences(
     const composer::Composer &composer,
     const ConversionPreferences &preferences) {
+  MOZC_TRACE_SPAN("SessionConverter::Suggest");
   DCHECK(CheckState(COMPOSITION | SUGGESTION));
   candidate_list_visible_ = false;
 
@@ -426,6 +454,7 @@ bool SessionConverter::SuggestWithPreferences(
   SetConversionPreferences(preferences, segments_.get());
 
   ConversionRequest conversion_request(&composer, request_, config_);
+  SetTimeBudget(*request_, &conversion_request);
   const size_t cursor = composer.GetCursor();
   if (cursor == composer.GetLength() || cursor == 0 ||
       !request_->mixed_conversion()) {
@@ -433,14 +462,14 @@ bool SessionConverter::SuggestWithPreferences(
         request_->auto_partial_suggestion());
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
-    if (!converter_->StartSuggestionForRequest(conversion_request,
-                                               segments_.get())) {
+    if (!converter()->StartSuggestionForRequest(conversion_request,
+                                                segments_.get())) {
       // TODO(komatsu): Because suggestion is a prefix search, once
       // StartSuggestion returns false, this GetSuggestion always
       // returns false.  Refactor it.
       VLOG(1) << "StartSuggestionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter()->CancelConversion(segments_.get());
       return false;
     }
   } else {
@@ -451,14 +480,20 @@ bool SessionConverter::SuggestWithPreferences(
     // implementation reason. If the flag is true, all the composition
     // characters will be used in the below process, which conflicts
     // with *partial* prediction.
-    if (!converter_->StartPartialSuggestionForRequest(conversion_request,
-                                                      segments_.get())) {
+    if (!converter()->StartPartialSuggestionForRequest(conversion_request,
+                                                       segments_.get())) {
       VLOG(1) << "StartPartialSuggestionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter()->CancelConversion(segments_.get());
       return false;
     }
   }
+  RecordDegradation(conversion_request, "SuggestionDegraded");
+  OnSuggestionReady();
+  return true;
+}
+
+void SessionConverter::OnSuggestionReady() {
   DCHECK_EQ(1, segments_->conversion_segments_size());
 
   // Copy current suggestions so that we can merge
@@ -471,9 +506,78 @@ bool SessionConverter::SuggestWithPreferences(
   UpdateCandidateList();
   candidate_list_visible_ = true;
   InitializeSelectedCandidateIndices();
+}
+
+bool SessionConverter::StartAsyncSuggestWithPreferences(
+    const composer::Composer &composer,
+    const ConversionPreferences &preferences) {
+  DCHECK(CheckState(COMPOSITION | SUGGESTION));
+  CancelAsyncSuggest();
+  candidate_list_visible_ = false;
+  ResetState();
+
+  // Same conditions as SuggestWithPreferences().
+  if (!preferences.request_suggestion ||
+      composer.GetInputFieldType() == commands::Context::PASSWORD) {
+    return false;
+  }
+  SetConversionPreferences(preferences, segments_.get());
+
+  const size_t cursor = composer.GetCursor();
+  const bool partial = !(cursor == composer.GetLength() || cursor == 0 ||
+                         !request_->mixed_conversion());
+  async_suggestion_ = std::make_shared<AsyncSuggestion>(
+      converter_, composer, *request_, *config_, *segments_, partial,
+      FLAGS_use_actual_converter_for_realtime_conversion);
+  AsyncSuggestion::Start(async_suggestion_);
+  return true;
+}
+
+bool SessionConverter::FinishAsyncSuggest(const composer::Composer &composer) {
+  if (!async_suggestion_) {
+    return false;
+  }
+  DCHECK(CheckState(COMPOSITION));
+  AsyncSuggestion::Wait(false);
+  std::shared_ptr<AsyncSuggestion> suggestion;
+  suggestion.swap(async_suggestion_);
+
+  if (suggestion->canceled()) {
+    // Outdated by a newer command which didn't change the composition.
+    return Suggest(composer);
+  }
+  if (!suggestion->succeeded()) {
+    VLOG(1) << "Asynchronous suggestion returns no suggestions.";
+    converter()->CancelConversion(segments_.get());
+    return false;
+  }
+  if (suggestion->degraded()) {
+    UsageStats::IncrementCount("SuggestionDegraded");
+  }
+  segments_ = suggestion->TakeSegments();
+  OnSuggestionReady();
   return true;
 }
 
+bool SessionConverter::HasAsyncSuggestion() const {
+  return async_suggestion_ != nullptr;
+}
+
+void SessionConverter::CancelAsyncSuggest() {
+  if (async_suggestion_) {
+    // The suggestion has its own copies of the inputs, so it can be left to
+    // wind down on the background thread.
+    async_suggestion_->Cancel();
+    async_suggestion_.reset();
+  }
+}
+
+const ConverterInterface *SessionConverter::converter() const {
+  // The suggestion running on the background thread may use the same engine.
+  AsyncSuggestion::Wait(false);
+  return converter_;
+}
+
 
 bool SessionConverter::Predict(const composer::Composer &composer) {
   return PredictWithPreferences(composer, conversion_preferences_);
@@ -487,6 +591,7 @@ bool SessionConverter::IsEmptySegment(const Segment &segment) const {
 bool SessionConverter::PredictWithPreferences(
     const composer::Composer &composer,
     const ConversionPreferences &preferences) {
+  MOZC_TRACE_SPAN("SessionConverter::Predict");
   // TODO(komatsu): DCHECK should be
   // DCHECK(CheckState(COMPOSITION | SUGGESTION | PREDICTION));
   DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION | PREDICTION));
@@ -510,10 +615,11 @@ bool SessionConverter::PredictWithPreferences(
 
   if (predict_expand || predict_first) {
     ConversionRequest conversion_request(&composer, request_, config_);
+    SetTimeBudget(*request_, &conversion_request);
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
-    if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+    if (!converter()->StartPredictionForRequest(conversion_request,
+                                                segments_.get())) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
 
       // TODO(komatsu): Perform refactoring after checking the stability test.
@@ -525,6 +631,7 @@ bool SessionConverter::PredictWithPreferences(
         return false;
       }
     }
+    RecordDegradation(conversion_request, "PredictionDegraded");
   }
 
   // Merge suggestions and prediction
@@ -576,6 +683,7 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
   // existing segments.
 
   ConversionRequest conversion_request(&composer, request_, config_);
+  SetTimeBudget(*request_, &conversion_request);
 
   const size_t cursor = composer.GetCursor();
   if (cursor == composer.GetLength() || cursor == 0 ||
@@ -587,20 +695,21 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
     // This is abuse of StartPrediction().
     // TODO(matsuzakit or yamaguchi): Add ExpandSuggestion method
     //    to Converter class.
-    if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+    if (!converter()->StartPredictionForRequest(conversion_request,
+                                                segments_.get())) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
     }
   } else {
     // c.f. SuggestWithPreferences for ConversionRequest flags.
-    if (!converter_->StartPartialPredictionForRequest(conversion_request,
-                                                      segments_.get())) {
+    if (!converter()->StartPartialPredictionForRequest(conversion_request,
+                                                       segments_.get())) {
       VLOG(1) << "StartPartialPredictionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter()->CancelConversion(segments_.get());
       return false;
     }
   }
+  RecordDegradation(conversion_request, "PredictionDegraded");
   // Overwrite the request type to SUGGESTION.
   // Without this logic, a candidate gets focused that is unexpected behavior.
   segments_->set_request_type(Segments::SUGGESTION);
@@ -648,7 +757,7 @@ void SessionConverter::Cancel() {
   ResetResult();
 
   // Clear segments and keep the context
-  converter_->CancelConversion(segments_.get());
+  converter()->CancelConversion(segments_.get());
   ResetState();
 }
 
@@ -657,7 +766,7 @@ void SessionConverter::Reset() {
 
   // Even if composition mode, call ResetConversion
   // in order to clear history segments.
-  converter_->ResetConversion(segments_.get());
+  converter()->ResetConversion(segments_.get());
 
   if (CheckState(COMPOSITION)) {
     return;
@@ -680,13 +789,13 @@ void SessionConverter::Commit(const composer::Composer &composer,
   }
 
   for (size_t i = 0; i < segments_->conversion_segments_size(); ++i) {
-    converter_->CommitSegmentValue(segments_.get(),
-                                   i,
-                                   GetCandidateIndexForConverter(i));
+    converter()->CommitSegmentValue(segments_.get(),
+                                    i,
+                                    GetCandidateIndexForConverter(i));
   }
   CommitUsageStats(state_, context);
   ConversionRequest conversion_request(&composer, request_, config_);
-  converter_->FinishConversion(conversion_request, segments_.get());
+  converter()->FinishConversion(conversion_request, segments_.get());
   ResetState();
 }
 
@@ -715,7 +824,7 @@ bool SessionConverter::CommitSuggestionInternal(
   if (request_->zero_query_suggestion() &&
       *consumed_key_size < composer.GetLength()) {
     // A candidate was chosen from partial suggestion.
-    converter_->CommitPartialSuggestionSegmentValue(
+    converter()->CommitPartialSuggestionSegmentValue(
         segments_.get(),
         0,
         GetCandidateIndexForConverter(0),
@@ -730,12 +839,12 @@ bool SessionConverter::CommitSuggestionInternal(
     DCHECK_GT(segments_->conversion_segments_size(), 0);
   } else {
     // Not partial suggestion so let's reset the state.
-    converter_->CommitSegmentValue(segments_.get(),
-                                   0,
-                                   GetCandidateIndexForConverter(0));
+    converter()->CommitSegmentValue(segments_.get(),
+                                    0,
+                                    GetCandidateIndexForConverter(0));
     CommitUsageStats(SessionConverterInterface::SUGGESTION, context);
     ConversionRequest conversion_request(&composer, request_, config_);
-    converter_->FinishConversion(conversion_request, segments_.get());
+    converter()->FinishConversion(conversion_request, segments_.get());
     DCHECK_EQ(0, segments_->conversion_segments_size());
     ResetState();
   }
@@ -830,7 +939,7 @@ void SessionConverter::CommitSegmentsInternal(
     // Collect candidate's id for each segment.
     candidate_ids.push_back(GetCandidateIndexForConverter(i));
   }
-  converter_->CommitSegments(segments_.get(), candidate_ids);
+  converter()->CommitSegments(segments_.get(), candidate_ids);
 
   // Commit the [0, segments_to_commit - 1] conversion segment.
   CommitUsageStatsWithSegmentsSize(state_, context, segments_to_commit);
@@ -856,7 +965,7 @@ void SessionConverter::CommitPreedit(const composer::Composer &composer,
 
   CommitUsageStats(SessionConverterInterface::COMPOSITION, context);
   ConversionRequest conversion_request(&composer, request_, config_);
-  converter_->FinishConversion(conversion_request, segments_.get());
+  converter()->FinishConversion(conversion_request, segments_.get());
   ResetState();
 }
 
@@ -877,7 +986,7 @@ void SessionConverter::CommitHead(
 }
 
 void SessionConverter::Revert() {
-  converter_->RevertConversion(segments_.get());
+  converter()->RevertConversion(segments_.get());
 }
 
 void SessionConverter::SegmentFocusInternal(size_t index) {
@@ -936,9 +1045,9 @@ void SessionConverter::ResizeSegmentWidth(const composer::Composer &composer,
   ResetResult();
 
   const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->ResizeSegment(segments_.get(),
-                                 conversion_request,
-                                 segment_index_, delta)) {
+  if (!converter()->ResizeSegment(segments_.get(),
+                                  conversion_request,
+                                  segment_index_, delta)) {
     return;
   }
 
@@ -1214,16 +1323,16 @@ void SessionConverter::ResetState() {
 
 void SessionConverter::SegmentFocus() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  converter_->FocusSegmentValue(segments_.get(),
-                                segment_index_,
-                                GetCandidateIndexForConverter(segment_index_));
+  converter()->FocusSegmentValue(segments_.get(),
+                                 segment_index_,
+                                 GetCandidateIndexForConverter(segment_index_));
 }
 
 void SessionConverter::SegmentFix() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  converter_->CommitSegmentValue(segments_.get(),
-                                 segment_index_,
-                                 GetCandidateIndexForConverter(segment_index_));
+  converter()->CommitSegmentValue(
+      segments_.get(), segment_index_,
+      GetCandidateIndexForConverter(segment_index_));
 }
 
 void SessionConverter::GetPreedit(const size_t index,
@@ -1590,6 +1699,13 @@ void SessionConverter::SetConfig(const config::Config *config) {
   use_cascading_window_ = config->use_cascading_window();
 }
 
+void SessionConverter::SetConverter(const ConverterInterface *converter) {
+  CancelAsyncSuggest();
+  // Nothing may be running on the previous converter after the switch.
+  AsyncSuggestion::Wait(false);
+  converter_ = converter;
+}
+
 void SessionConverter::OnStartComposition(const commands::Context &context) {
   bool revision_changed = false;
   if (context.has_revision()) {
@@ -1599,7 +1715,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
   if (!context.has_preceding_text()) {
     // In this case, reset history segments when the revision is mismatched.
     if (revision_changed) {
-      converter_->ResetConversion(segments_.get());
+      converter()->ResetConversion(segments_.get());
     }
     return;
   }
@@ -1608,7 +1724,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
   // If preceding text is empty, it is OK to reset the history segments by
   // calling ResetConversion.
   if (preceding_text.empty()) {
-    converter_->ResetConversion(segments_.get());
+    converter()->ResetConversion(segments_.get());
     return;
   }
 
@@ -1646,7 +1762,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
 
   // Here we reconstruct history segments from |preceding_text| regardless
   // of revision mismatch. If it fails the history segments is cleared anyway.
-  converter_->ReconstructHistory(segments_.get(), preceding_text);
+  converter()->ReconstructHistory(segments_.get(), preceding_text);
 }
 
 void SessionConverter::UpdateSelectedCandidateIndex() {
@@ -1737,7 +1853,7 @@ void SessionConverter::CommitUsageStatsWithSegmentsSize(
       stats_str = "Unknown";
   }
 
-  UsageStats::IncrementCount("Commit");
+  UsageStats::IncrementCount(StatsId::kCommit);
   UsageStats::IncrementCount("CommitFrom" + stats_str);
 
   if (stats_str != "Unknown") {
@@ -55,6 +55,7 @@ class Config;
 }  // namespace config
 
 namespace session {
+class AsyncSuggestion;
 class CandidateList;
 
 // Class handling ConverterInterface with a session state.  This class
@@ -108,6 +109,14 @@ class SessionConverter : public SessionConverterInterface {
   virtual bool SuggestWithPreferences(const composer::Composer &composer,
                                       const ConversionPreferences &preferences);
 
+  // Sends a suggestion request to the converter on the background thread.
+  virtual bool StartAsyncSuggestWithPreferences(
+      const composer::Composer &composer,
+      const ConversionPreferences &preferences);
+  virtual bool FinishAsyncSuggest(const composer::Composer &composer);
+  virtual bool HasAsyncSuggestion() const;
+  virtual void CancelAsyncSuggest();
+
   // Sends a prediction request to the converter.
   virtual bool Predict(const composer::Composer &composer);
   virtual bool PredictWithPreferences(const composer::Composer &composer,
@@ -245,6 +254,9 @@ class SessionConverter : public SessionConverterInterface {
   // Sets setting by the config;
   virtual void SetConfig(const config::Config *config);
 
+  // Switches the converter.
+  virtual void SetConverter(const ConverterInterface *converter);
+
   // Set setting by the context.
   virtual void OnStartComposition(const commands::Context &context);
 
@@ -283,6 +295,10 @@ class SessionConverter : public SessionConverterInterface {
   // Resets the session state variables.
   void ResetState();
 
+  // Makes the state SUGGESTION after the converter has filled |segments_|
+  // with suggestions.
+  void OnSuggestionReady();
+
   // Notifies the converter that the current segment is focused.
   void SegmentFocus();
 
@@ -350,6 +366,10 @@ class SessionConverter : public SessionConverterInterface {
 
   bool IsEmptySegment(const Segment &segment) const;
 
+  // Returns |converter_| after waiting for the suggestion running on the
+  // background thread.  Use it instead of |converter_| to call the converter.
+  const ConverterInterface *converter() const;
+
   // Handles selected_indices for usage stats.
   void InitializeSelectedCandidateIndices();
   void UpdateSelectedCandidateIndex();
@@ -393,6 +413,9 @@ class SessionConverter : public SessionConverterInterface {
   // Selected index data of each segments for usage stats.
   std::vector<int> selected_candidate_indices_;
 
+  // Suggestion running on the background thread.  Not copied by Clone().
+  std::shared_ptr<AsyncSuggestion> async_suggestion_;
+
   // Revision number of client context with which the converter determines when
   // the history segments should be invalidated. See the implemenation of
   // OnStartComposition for details.
@@ -132,6 +132,25 @@ class SessionConverterInterface {
       const composer::Composer &composer,
       const ConversionPreferences &preferences) = 0;
 
+  // Send a suggestion request to the converter on the background thread.
+  // The state stays COMPOSITION until FinishAsyncSuggest() is called.
+  // Returns false if suggestion is not requested.
+  virtual bool StartAsyncSuggestWithPreferences(
+      const composer::Composer &composer,
+      const ConversionPreferences &preferences) = 0;
+
+  // Take the result of StartAsyncSuggestWithPreferences().  If the
+  // background computation has been canceled, suggest synchronously instead.
+  // Returns true if the state becomes SUGGESTION.
+  virtual bool FinishAsyncSuggest(const composer::Composer &composer) = 0;
+
+  // Return true if an asynchronous suggestion is waiting for
+  // FinishAsyncSuggest().
+  virtual bool HasAsyncSuggestion() const = 0;
+
+  // Discard the pending asynchronous suggestion, if any.
+  virtual void CancelAsyncSuggest() = 0;
+
   // Send a prediction request to the converter.
   virtual bool Predict(const composer::Composer &composer) = 0;
   virtual bool PredictWithPreferences(
@@ -245,6 +264,10 @@ class SessionConverterInterface {
   // Currently this is especially for SessionConverter.
   virtual void SetConfig(const config::Config *config) = 0;
 
+  // Switch the converter, e.g. after the engine is reloaded.  A pending
+  // async suggestion of the previous converter is canceled.
+  virtual void SetConverter(const ConverterInterface *converter) = 0;
+
   // Update the internal state by the context.
   virtual void OnStartComposition(const commands::Context &context) = 0;
 
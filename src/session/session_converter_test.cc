@@ -1577,6 +1577,55 @@ TEST_F(SessionConverterTest, CommitSuggestionByIndex) {
   EXPECT_COUNT_STATS("PredictionCandidates1", 1);
 }
 
+TEST_F(SessionConverterTest, AsyncSuggest) {
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  Segments segments;
+  {  // Initialize mock segments for suggestion
+    segments.set_request_type(Segments::SUGGESTION);
+    Segment *segment = segments.add_segment();
+    Segment::Candidate *candidate;
+    segment->set_key(kChars_Mo);
+    candidate = segment->add_candidate();
+    candidate->value = kChars_Mozukusu;
+    candidate->key = kChars_Mozukusu;
+    candidate->content_key = kChars_Mozukusu;
+    candidate = segment->add_candidate();
+    candidate->value = kChars_Momonga;
+    candidate->key = kChars_Momonga;
+    candidate->content_key = kChars_Momonga;
+  }
+  composer_->InsertCharacterPreedit(kChars_Mo);
+  convertermock_->SetStartSuggestionForRequest(&segments, true);
+
+  // The state stays COMPOSITION until the result is taken.
+  EXPECT_TRUE(converter.StartAsyncSuggestWithPreferences(
+      *composer_, converter.conversion_preferences()));
+  EXPECT_TRUE(converter.HasAsyncSuggestion());
+  EXPECT_FALSE(converter.IsActive());
+  EXPECT_FALSE(IsCandidateListVisible(converter));
+
+  EXPECT_TRUE(converter.FinishAsyncSuggest(*composer_));
+  EXPECT_FALSE(converter.HasAsyncSuggestion());
+  EXPECT_TRUE(converter.IsActive());
+  EXPECT_TRUE(IsCandidateListVisible(converter));
+  {
+    commands::Output output;
+    converter.FillOutput(*composer_, &output);
+    EXPECT_TRUE(output.has_candidates());
+    EXPECT_EQ(2, output.candidates().size());
+    EXPECT_EQ(kChars_Mozukusu, output.candidates().candidate(0).value());
+  }
+
+  // A canceled suggestion is discarded.
+  EXPECT_TRUE(converter.StartAsyncSuggestWithPreferences(
+      *composer_, converter.conversion_preferences()));
+  converter.CancelAsyncSuggest();
+  EXPECT_FALSE(converter.HasAsyncSuggestion());
+  EXPECT_FALSE(converter.FinishAsyncSuggest(*composer_));
+  EXPECT_FALSE(converter.IsActive());
+}
+
 TEST_F(SessionConverterTest, CommitSuggestionById) {
   SessionConverter converter(
       convertermock_.get(), request_.get(), config_.get());
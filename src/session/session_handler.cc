@@ -33,11 +33,13 @@
 #include "session/session_handler.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/clock.h"
+#include "base/file_util.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -46,6 +48,9 @@
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 #include "base/singleton.h"
 #include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/trace.h"
+#include "base/trace_file_writer.h"
 #include "base/util.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
@@ -56,6 +61,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "protocol/user_dictionary_storage.pb.h"
+#include "session/async_suggestion.h"
 #include "session/generic_storage_manager.h"
 #include "session/session.h"
 #include "session/session_observer_handler.h"
@@ -68,6 +74,7 @@
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 #include "usage_stats/usage_stats.h"
 
+using mozc::usage_stats::StatsId;
 using mozc::usage_stats::UsageStats;
 
 DEFINE_int32(timeout, -1,
@@ -101,6 +108,13 @@ DEFINE_bool(restricted, false,
 namespace mozc {
 
 namespace {
+
+// The spans of the traced commands are written to this file in the user
+// profile directory, which is rotated when it exceeds the size.
+const char kTraceFileName[] = "trace.json";
+const size_t kMaxTraceFileSize = 8 * 1024 * 1024;
+const uint32 kTraceFlushIntervalMsec = 1000;
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   const commands::ApplicationInfo &info = session->application_info();
@@ -161,13 +175,14 @@ void SessionHandler::Init(
   last_session_empty_time_ = Clock::GetTime();
   last_cleanup_time_ = 0;
   last_create_session_time_ = 0;
-  engine_ = std::move(engine);
+  generation_ = std::make_shared<EngineGeneration>();
+  generation_->engine = std::move(engine);
+  generation_->table_manager.reset(new composer::TableManager);
   engine_builder_ = std::move(engine_builder);
   observer_handler_.reset(new session::SessionObserverHandler());
   stopwatch_.reset(new Stopwatch);
   user_dictionary_session_handler_.reset(
       new user_dictionary::UserDictionarySessionHandler);
-  table_manager_.reset(new composer::TableManager);
   request_.reset(new commands::Request);
   config_.reset(new config::Config);
 
@@ -199,7 +214,7 @@ void SessionHandler::Init(
   max_session_size_ = std::max(2, std::min(FLAGS_max_session_size, 128));
   session_map_.reset(new SessionMap(max_session_size_));
 
-  if (!engine_) {
+  if (!generation_->engine) {
     return;
   }
 
@@ -208,6 +223,9 @@ void SessionHandler::Init(
 }
 
 SessionHandler::~SessionHandler() {
+  // Stop the background suggestion before deleting the sessions and engines
+  // which it refers to.
+  session::AsyncSuggestion::Wait(true);
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != nullptr; element = element->next) {
@@ -246,12 +264,15 @@ bool SessionHandler::StartWatchDog() {
 
 void SessionHandler::SetConfig(const config::Config &config) {
   *config_ = config;
-  const composer::Table *table = table_manager_->GetTable(
-      *request_, *config_, *engine_->GetDataManager());
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != NULL; element = element->next) {
     if (element->value != NULL) {
+      // The table is rebuilt from the current generation, so the session no
+      // longer refers to the generation it was created on.
+      const composer::Table *table = generation_->table_manager->GetTable(
+          *request_, *config_, *generation_->engine->GetDataManager());
+      session_generations_[element->key] = generation_;
       element->value->SetConfig(config_.get());
       element->value->SetRequest(request_.get());
       element->value->SetTable(table);
@@ -262,7 +283,8 @@ void SessionHandler::SetConfig(const config::Config &config) {
 
 bool SessionHandler::SyncData(commands::Command *command) {
   VLOG(1) << "Syncing user data";
-  engine_->GetUserDataManager()->Sync();
+  // All sessions learn with the current generation; see MaybeReloadEngine().
+  generation_->engine->GetUserDataManager()->Sync();
   return true;
 }
 
@@ -276,32 +298,28 @@ bool SessionHandler::Shutdown(commands::Command *command) {
 
 bool SessionHandler::Reload(commands::Command *command) {
   VLOG(1) << "Reloading server";
-  {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    SetConfig(config);
-  }
-  engine_->Reload();
+  SetConfig(*config::ConfigHandler::GetSharedConfig());
+  generation_->engine->Reload();
   return true;
 }
 
 bool SessionHandler::ClearUserHistory(commands::Command *command) {
   VLOG(1) << "Clearing user history";
-  engine_->GetUserDataManager()->ClearUserHistory();
+  generation_->engine->GetUserDataManager()->ClearUserHistory();
   UsageStats::IncrementCount("ClearUserHistory");
   return true;
 }
 
 bool SessionHandler::ClearUserPrediction(commands::Command *command) {
   VLOG(1) << "Clearing user prediction";
-  engine_->GetUserDataManager()->ClearUserPrediction();
+  generation_->engine->GetUserDataManager()->ClearUserPrediction();
   UsageStats::IncrementCount("ClearUserPrediction");
   return true;
 }
 
 bool SessionHandler::ClearUnusedUserPrediction(commands::Command *command) {
   VLOG(1) << "Clearing unused user prediction";
-  engine_->GetUserDataManager()->ClearUnusedUserPrediction();
+  generation_->engine->GetUserDataManager()->ClearUnusedUserPrediction();
   UsageStats::IncrementCount("ClearUnusedUserPrediction");
   return true;
 }
@@ -361,6 +379,7 @@ bool SessionHandler::SetRequest(commands::Command *command) {
   }
 
   request_->CopyFrom(command->input().request());
+  Trace::SetEnabled(request_->enable_trace());
 
   Reload(command);
 
@@ -470,6 +489,31 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   bool eval_succeeded = false;
   stopwatch_->Reset();
   stopwatch_->Start();
+  // The root span of the command is recorded manually in FlushTrace().
+  const bool trace_enabled = Trace::IsEnabled();
+  const uint64 trace_begin_usec =
+      trace_enabled ? Trace::GetCurrentTimeUsec() : 0;
+  const ScopedTraceCommand trace_command(
+      trace_enabled ? ++trace_command_id_ : 0);
+
+  // The background suggestion is no longer needed unless the command takes
+  // its result.  The session commands don't wait for it to wind down, as
+  // SessionConverter waits before using the engine; the other commands use
+  // the engine directly, so the suggestion must stop first.
+  const commands::Input::CommandType type = command->input().type();
+  const bool takes_async_result =
+      type == commands::Input::SEND_COMMAND &&
+      command->input().command().type() ==
+          commands::SessionCommand::GET_ASYNC_RESULT;
+  if (type == commands::Input::SEND_KEY ||
+      type == commands::Input::TEST_SEND_KEY ||
+      type == commands::Input::SEND_COMMAND) {
+    if (!takes_async_result) {
+      session::AsyncSuggestion::CancelAll();
+    }
+  } else {
+    session::AsyncSuggestion::Wait(true);
+  }
 
   switch (command->input().type()) {
     case commands::Input::CREATE_SESSION:
@@ -543,7 +587,7 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   }
 
   if (eval_succeeded) {
-    UsageStats::IncrementCount("SessionAllEvent");
+    UsageStats::IncrementCount(StatsId::kSessionAllEvent);
     if (command->input().type() != commands::Input::CREATE_SESSION) {
       // Fill a session ID even if command->input() doesn't have a id to ensure
       // that response size should not be 0, which causes disconnection of IPC.
@@ -558,18 +602,66 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   if (eval_succeeded) {
     // TODO(komatsu): Make sre if checking eval_succeeded is necessary or not.
     observer_handler_->EvalCommandHandler(*command);
+    EncodeCandidatesDelta(command);
   }
 
   stopwatch_->Stop();
-  UsageStats::UpdateTiming("ElapsedTimeUSec",
+  UsageStats::UpdateTiming(StatsId::kElapsedTimeUSec,
                            stopwatch_->GetElapsedMicroseconds());
+  if (trace_enabled) {
+    FlushTrace(trace_begin_usec);
+  }
 
   return is_available_;
 }
 
+void SessionHandler::EncodeCandidatesDelta(commands::Command *command) {
+  const commands::Input::CommandType type = command->input().type();
+  if (type != commands::Input::SEND_KEY &&
+      type != commands::Input::TEST_SEND_KEY &&
+      type != commands::Input::SEND_COMMAND) {
+    return;
+  }
+  session::SessionInterface **session =
+      session_map_->MutableLookup(command->input().id());
+  if (session == NULL || *session == NULL) {
+    return;
+  }
+  (*session)->EncodeCandidatesDelta(command);
+}
+
+void SessionHandler::FlushTrace(uint64 begin_usec) {
+  const uint64 duration_usec = Trace::GetCurrentTimeUsec() - begin_usec;
+  Trace::AddEvent("SessionHandler::EvalCommand", begin_usec, duration_usec);
+  std::vector<Trace::Event> events;
+  Trace::TakeEvents(&events);
+  if (request_->trace_threshold_usec() > 0 &&
+      duration_usec < static_cast<uint64>(request_->trace_threshold_usec())) {
+    // Drops the spans of this command.  The spans of the other commands, e.g.,
+    // of background suggestions completed since the last command, are kept.
+    const uint64 command_id = Trace::GetCurrentCommandId();
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [command_id](const Trace::Event &event) {
+                                  return event.command_id == command_id;
+                                }),
+                 events.end());
+    if (events.empty()) {
+      return;
+    }
+  }
+  const string filename = FileUtil::JoinPath(
+      SystemUtil::GetUserProfileDirectory(), kTraceFileName);
+  if (!trace_writer_ || trace_writer_->filename() != filename) {
+    trace_writer_.reset(new TraceFileWriter(filename, kMaxTraceFileSize,
+                                            kTraceFlushIntervalMsec));
+  }
+  trace_writer_->Add(events);
+}
+
 session::SessionInterface *SessionHandler::NewSession() {
-  // Session doesn't take the ownership of engine.
-  return new session::Session(engine_.get());
+  // Session doesn't take the ownership of engine.  The caller is responsible
+  // for keeping the current generation alive while the session exists.
+  return new session::Session(generation_->engine.get());
 }
 
 void SessionHandler::AddObserver(session::SessionObserverInterface *observer) {
@@ -647,29 +739,13 @@ bool SessionHandler::CreateSession(commands::Command *command) {
     }
     delete oldest_element->value;
     oldest_element->value = NULL;
+    session_generations_.erase(oldest_element->key);
     session_map_->Erase(oldest_element->key);
     VLOG(1) << "Session is FULL, oldest SessionID "
             << oldest_element->key << " is removed";
   }
 
-  if (engine_builder_ &&
-      session_map_->Size() == 0 &&
-      engine_builder_->HasResponse()) {
-    auto *response =
-        command->mutable_output()->mutable_engine_reload_response();
-    engine_builder_->GetResponse(response);
-    if (response->status() == EngineReloadResponse::RELOAD_READY) {
-      if (engine_->GetUserDataManager()) {
-        engine_->GetUserDataManager()->Wait();
-      }
-      engine_.reset();
-      engine_ = engine_builder_->BuildFromPreparedData();
-      LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
-      table_manager_->ClearCaches();
-      response->set_status(EngineReloadResponse::RELOADED);
-    }
-    engine_builder_->Clear();
-  }
+  MaybeReloadEngine(command);
 
   session::SessionInterface *session = NewSession();
   if (session == NULL) {
@@ -680,6 +756,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   const SessionID new_id = CreateNewSessionID();
   SessionElement *element = session_map_->Insert(new_id);
   element->value = session;
+  session_generations_[new_id] = generation_;
   command->mutable_output()->set_id(new_id);
 
   // The oldes item should be reused
@@ -701,11 +778,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
   // Ensure the onmemory config is same as the locally stored one
   // because the local data could be changed by sync.
-  {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    SetConfig(config);
-  }
+  SetConfig(*config::ConfigHandler::GetSharedConfig());
 
   // session is not empty.
   last_session_empty_time_ = 0;
@@ -717,8 +790,8 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
 bool SessionHandler::DeleteSession(commands::Command *command) {
   DeleteSessionID(command->input().id());
-  if (engine_->GetUserDataManager()) {
-    engine_->GetUserDataManager()->Sync();
+  if (generation_->engine->GetUserDataManager()) {
+    generation_->engine->GetUserDataManager()->Sync();
   }
   return true;
 }
@@ -788,7 +861,7 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   }
 
   // Sync all data. This is a regression bug fix http://b/3033708
-  engine_->GetUserDataManager()->Sync();
+  generation_->engine->GetUserDataManager()->Sync();
 
   // timeout is enabled.
   if (FLAGS_timeout > 0 &&
@@ -831,6 +904,56 @@ bool SessionHandler::NoOperation(commands::Command *command) {
   return true;
 }
 
+void SessionHandler::MaybeReloadEngine(commands::Command *command) {
+  if (!engine_builder_ || !engine_builder_->HasResponse()) {
+    return;
+  }
+  auto *response = command->mutable_output()->mutable_engine_reload_response();
+  engine_builder_->GetResponse(response);
+  if (response->status() != EngineReloadResponse::RELOAD_READY) {
+    engine_builder_->Clear();
+    return;
+  }
+
+  // The engine has already been built by the builder's thread, so publishing
+  // it is only a pointer swap.
+  std::shared_ptr<EngineGeneration> generation =
+      std::make_shared<EngineGeneration>();
+  generation->engine = engine_builder_->BuildFromPreparedData();
+  engine_builder_->Clear();
+  LOG_IF(FATAL, !generation->engine) << "Critical failure in engine replace";
+  generation->table_manager.reset(new composer::TableManager);
+
+  // Flush the learning data of the current generation so that the new one
+  // starts from the latest user history.  The user data of the retired
+  // generation is then frozen: both generations load the same files, and the
+  // retired one would otherwise overwrite what the new one saves when it is
+  // destroyed.
+  UserDataManagerInterface *user_data_manager =
+      generation_->engine->GetUserDataManager();
+  if (user_data_manager) {
+    user_data_manager->Sync();
+    user_data_manager->Wait();
+    if (generation->engine->GetUserDataManager()) {
+      generation->engine->GetUserDataManager()->Reload();
+    }
+  }
+  generation_->engine->FreezeUserData();
+  generation_ = std::move(generation);
+
+  // Move the live sessions to the new engine so that they keep learning.
+  // They keep the composition table of their own generation until the next
+  // SetConfig().
+  for (SessionElement *element =
+           const_cast<SessionElement *>(session_map_->Head());
+       element != NULL; element = element->next) {
+    if (element->value != NULL) {
+      element->value->SetEngine(generation_->engine.get());
+    }
+  }
+  response->set_status(EngineReloadResponse::RELOADED);
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   SessionID id = 0;
@@ -857,6 +980,9 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
   delete *session;
 
   session_map_->Erase(id);   // remove from LRU
+  // The engine generation of the session is destroyed here if it has been
+  // retired by an engine reload and this is its last session.
+  session_generations_.erase(id);
 
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == 0 &&
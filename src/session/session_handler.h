@@ -62,6 +62,7 @@ class SessionWatchDog;
 // enabling session watch dog for android.
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 class Stopwatch;
+class TraceFileWriter;
 
 namespace commands {
 class Command;
@@ -99,10 +100,10 @@ class SessionHandler : public SessionHandlerInterface {
 
   void AddObserver(session::SessionObserverInterface *observer) override;
   StringPiece GetDataVersion() const override {
-    return engine_->GetDataVersion();
+    return generation_->engine->GetDataVersion();
   }
 
-  const EngineInterface &engine() const { return *engine_; }
+  const EngineInterface &engine() const { return *generation_->engine; }
 
  private:
   FRIEND_TEST(SessionHandlerTest, StorageTest);
@@ -111,6 +112,18 @@ class SessionHandler : public SessionHandlerInterface {
       mozc::storage::LRUCache<SessionID, session::SessionInterface *>;
   using SessionElement = SessionMap::Element;
 
+  // An engine together with the composition tables built from its data.  A
+  // generation is published to new sessions by swapping |generation_|, while
+  // existing sessions keep a reference to the generation they were created
+  // with.  Hence an engine reload never blocks nor invalidates in-flight
+  // sessions, and a retired generation is destroyed when its last session is
+  // deleted.  The user data of a retired generation is frozen, so learning
+  // from its sessions after the reload is not kept.
+  struct EngineGeneration {
+    std::unique_ptr<EngineInterface> engine;
+    std::unique_ptr<composer::TableManager> table_manager;
+  };
+
   void Init(std::unique_ptr<EngineInterface> engine,
             std::unique_ptr<EngineBuilderInterface> engine_builder);
 
@@ -144,6 +157,19 @@ class SessionHandler : public SessionHandlerInterface {
   bool SendEngineReloadRequest(commands::Command *command);
   bool NoOperation(commands::Command *command);
 
+  // Publishes the engine prepared by |engine_builder_|, if any, as the
+  // generation used by new sessions.
+  void MaybeReloadEngine(commands::Command *command);
+
+  // Lets the session omit the candidate fields of the output which the client
+  // already has.  Called after the observers have seen the full output.
+  void EncodeCandidatesDelta(commands::Command *command);
+
+  // Records the root span of the current command started at |begin_usec|
+  // and queues the recorded spans to be written to the trace file in
+  // background.
+  void FlushTrace(uint64 begin_usec);
+
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
@@ -160,16 +186,22 @@ class SessionHandler : public SessionHandlerInterface {
   uint64 last_session_empty_time_ = 0;
   uint64 last_cleanup_time_ = 0;
   uint64 last_create_session_time_ = 0;
-
-  std::unique_ptr<EngineInterface> engine_;
+  // The ID of the last traced command.  See ScopedTraceCommand.
+  uint64 trace_command_id_ = 0;
+
+  std::shared_ptr<EngineGeneration> generation_;
+  // The generation whose composition table each session uses.  All sessions
+  // convert and learn with |generation_|, but a session created before a
+  // reload refers to the old table until the next SetConfig().
+  std::map<SessionID, std::shared_ptr<EngineGeneration>> session_generations_;
   std::unique_ptr<EngineBuilderInterface> engine_builder_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<Stopwatch> stopwatch_;
   std::unique_ptr<user_dictionary::UserDictionarySessionHandler>
       user_dictionary_session_handler_;
-  std::unique_ptr<composer::TableManager> table_manager_;
   std::unique_ptr<commands::Request> request_;
   std::unique_ptr<config::Config> config_;
+  std::unique_ptr<TraceFileWriter> trace_writer_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionHandler);
 };
@@ -0,0 +1,560 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Keystroke replay benchmark of SessionHandler with the OSS engine.
+//
+// Replays the key sequences of session scenario files and randomly generated
+// sentences against a real SessionHandler, and reports the latency
+// percentiles for each command type and the number of heap allocations per
+// command, and the CPU time.  The first pass right after the engine creation
+// is reported as "cold" and the following passes as "warm".  Compare the runs
+// with and without --async_suggestion for the echo latency of SEND_KEY and the
+// CPU saved by abandoning outdated suggestions.  Each command is processed as
+// SessionServer::Process does, i.e., the latency includes the parsing of the
+// input and the serialization of the output.  The serialized bytes, and the
+// latency and the heap allocations of the parsing on the client are also
+// reported.  Compare the runs with and without --delta_candidates for the
+// effect of the delta encoded candidates, with --nocommand_arena for the
+// allocations saved by the arena on the server, and with
+// --reuse_client_output for the ones saved by reusing the output on the
+// client.  Commands with a special key are reported separately, e.g.,
+// "SEND_KEY/ENTER", so that --commit_sequences shows the cost of a commit,
+// which also takes an undo snapshot of the session.
+//
+// Usage:
+//   session_handler_benchmark
+//       --scenario_files=data/test/session/scenario/conversion.txt,...
+//       --random_sequences=100 --warm_iterations=3
+//   session_handler_benchmark --random_sequences=0 --commit_sequences=20
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/singleton.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/util.h"
+#include "composer/key_parser.h"
+#include "engine/engine_factory.h"
+#include "protocol/commands.pb.h"
+#include "session/candidates_delta.h"
+#include "session/command_arena.h"
+#include "session/random_keyevents_generator.h"
+#include "session/request_test_util.h"
+#include "session/session_handler.h"
+#include "testing/base/public/googletest.h"
+
+DEFINE_string(scenario_files, "",
+              "Comma separated list of session scenario files to replay.");
+DEFINE_int32(random_sequences, 100,
+             "Number of randomly generated key sequences to replay.");
+DEFINE_int32(random_seed, 0, "Random seed for the key sequence generator.");
+DEFINE_int32(commit_sequences, 0,
+             "Number of commit heavy key sequences to replay.  Each sequence "
+             "converts and commits 20 random words.");
+DEFINE_int32(warm_iterations, 3,
+             "Number of replays after the first (cold) replay.");
+DEFINE_bool(async_suggestion, false,
+            "Enables Request.async_suggestion.  Simulates a fast typist: the "
+            "GET_ASYNC_RESULT callback is sent only when the typing pauses.");
+DEFINE_bool(delta_candidates, false,
+            "Enables Capability::delta_candidates, which omits the candidates "
+            "unchanged since the previous output.");
+DEFINE_bool(command_arena, true,
+            "Allocates the commands from CommandArena as SessionServer does.");
+DEFINE_bool(reuse_client_output, false,
+            "Parses the output on the client into the same message for all "
+            "the commands of a session.  By default, a new message is used "
+            "for each command as the client frontends do.");
+DEFINE_string(profile_dir, "",
+              "User profile directory.  By default, a new directory is created "
+              "under --test_tmpdir for each run so that the learning data of "
+              "the user is never touched.");
+
+namespace {
+
+// Number of heap allocations made by this process.
+std::atomic<uint64> g_allocation_count(0);
+
+}  // namespace
+
+// Counts the heap allocations.  Only this benchmark binary replaces the global
+// allocation functions.
+void *operator new(size_t size) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+namespace mozc {
+namespace {
+
+using commands::Input;
+using commands::SessionCommand;
+
+// A sequence of inputs sent to one session.  Session IDs are filled at replay.
+typedef std::vector<Input> Script;
+
+void AddKeyInput(Input::CommandType type, const commands::KeyEvent &key,
+                 Script *script) {
+  Input input;
+  input.set_type(type);
+  *input.mutable_key() = key;
+  script->push_back(input);
+}
+
+void AddSessionCommandInput(SessionCommand::CommandType type, int32 id,
+                            Script *script) {
+  Input input;
+  input.set_type(Input::SEND_COMMAND);
+  input.mutable_command()->set_type(type);
+  if (id >= 0) {
+    input.mutable_command()->set_id(id);
+  }
+  script->push_back(input);
+}
+
+// Converts a scenario file of session_handler_scenario_test into a script.
+// Only the commands sent to the session handler are replayed, and
+// expectations are ignored.
+bool LoadScenario(const string &filename, Script *script) {
+  InputFileStream ifs(filename.c_str());
+  if (!ifs) {
+    LOG(ERROR) << "Cannot open: " << filename;
+    return false;
+  }
+  string line;
+  std::vector<string> columns;
+  while (std::getline(ifs, line)) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    columns.clear();
+    Util::SplitStringUsing(line, "\t", &columns);
+    if (columns.empty()) {
+      continue;
+    }
+    const string &command = columns[0];
+    if (command == "SEND_KEYS" && columns.size() >= 2) {
+      for (size_t i = 0; i < columns[1].size(); ++i) {
+        commands::KeyEvent key;
+        key.set_key_code(columns[1][i]);
+        AddKeyInput(Input::SEND_KEY, key, script);
+      }
+    } else if (command == "SEND_KANA_KEYS" && columns.size() >= 3 &&
+               columns[1].size() == Util::CharsLen(columns[2])) {
+      for (size_t i = 0; i < columns[1].size(); ++i) {
+        commands::KeyEvent key;
+        key.set_key_code(columns[1][i]);
+        key.set_key_string(Util::SubString(columns[2], i, 1));
+        AddKeyInput(Input::SEND_KEY, key, script);
+      }
+    } else if ((command == "SEND_KEY" || command == "TEST_SEND_KEY") &&
+               columns.size() >= 2) {
+      commands::KeyEvent key;
+      if (!KeyParser::ParseKey(columns[1], &key)) {
+        LOG(WARNING) << "Cannot parse key: " << line;
+        continue;
+      }
+      AddKeyInput(command == "SEND_KEY" ? Input::SEND_KEY
+                                        : Input::TEST_SEND_KEY,
+                  key, script);
+    } else if (command == "SELECT_CANDIDATE" && columns.size() >= 2) {
+      AddSessionCommandInput(SessionCommand::SELECT_CANDIDATE,
+                             NumberUtil::SimpleAtoi(columns[1]), script);
+    } else if (command == "SUBMIT_CANDIDATE" && columns.size() >= 2) {
+      AddSessionCommandInput(SessionCommand::SUBMIT_CANDIDATE,
+                             NumberUtil::SimpleAtoi(columns[1]), script);
+    } else if (command == "RESET_CONTEXT") {
+      AddSessionCommandInput(SessionCommand::RESET_CONTEXT, -1, script);
+    } else if (command == "UNDO_OR_REWIND") {
+      AddSessionCommandInput(SessionCommand::UNDO_OR_REWIND, -1, script);
+    } else if (command == "SWITCH_INPUT_MODE" && columns.size() >= 2) {
+      commands::CompositionMode mode;
+      if (!commands::CompositionMode_Parse(columns[1], &mode)) {
+        continue;
+      }
+      AddSessionCommandInput(SessionCommand::SWITCH_INPUT_MODE, -1, script);
+      script->back().mutable_command()->set_composition_mode(mode);
+    } else if (command == "SET_DEFAULT_REQUEST" ||
+               command == "SET_MOBILE_REQUEST") {
+      Input input;
+      input.set_type(Input::SET_REQUEST);
+      if (command == "SET_MOBILE_REQUEST") {
+        commands::RequestForUnitTest::FillMobileRequest(
+            input.mutable_request());
+      }
+      script->push_back(input);
+    }
+  }
+  return true;
+}
+
+void GenerateRandomScripts(int num_sequences, std::vector<Script> *scripts) {
+  session::RandomKeyEventsGenerator::InitSeed(
+      static_cast<uint32>(FLAGS_random_seed));
+  std::vector<commands::KeyEvent> keys;
+  for (int i = 0; i < num_sequences; ++i) {
+    keys.clear();
+    session::RandomKeyEventsGenerator::GenerateSequence(&keys);
+    Script script;
+    for (size_t j = 0; j < keys.size(); ++j) {
+      AddKeyInput(Input::TEST_SEND_KEY, keys[j], &script);
+      AddKeyInput(Input::SEND_KEY, keys[j], &script);
+    }
+    scripts->push_back(script);
+  }
+}
+
+// Generates scripts which type a word in romaji, convert it with SPACE and
+// commit it with ENTER, over and over.  Each commit pushes an undo context.
+void GenerateCommitScripts(int num_sequences, std::vector<Script> *scripts) {
+  const char *kSyllables[] = {
+    "ka", "ki", "ku", "ke", "ko", "sa", "si", "su", "se", "so",
+    "ta", "ti", "tu", "te", "to", "na", "ni", "nu", "ne", "no",
+    "ha", "hi", "hu", "he", "ho", "ma", "mi", "mu", "me", "mo",
+  };
+  const int kWordsPerSequence = 20;
+  Util::SetRandomSeed(static_cast<uint32>(FLAGS_random_seed));
+  commands::KeyEvent on, space, enter;
+  on.set_special_key(commands::KeyEvent::ON);
+  space.set_special_key(commands::KeyEvent::SPACE);
+  enter.set_special_key(commands::KeyEvent::ENTER);
+  for (int i = 0; i < num_sequences; ++i) {
+    Script script;
+    AddKeyInput(Input::SEND_KEY, on, &script);
+    for (int j = 0; j < kWordsPerSequence; ++j) {
+      const int length = 2 + Util::Random(4);
+      for (int k = 0; k < length; ++k) {
+        const char *syllable = kSyllables[Util::Random(arraysize(kSyllables))];
+        for (const char *c = syllable; *c != '\0'; ++c) {
+          commands::KeyEvent key;
+          key.set_key_code(*c);
+          AddKeyInput(Input::SEND_KEY, key, &script);
+        }
+      }
+      AddKeyInput(Input::SEND_KEY, space, &script);
+      AddKeyInput(Input::SEND_KEY, enter, &script);
+    }
+    scripts->push_back(script);
+  }
+}
+
+string GetCommandName(const Input &input) {
+  if (input.type() == Input::SEND_COMMAND) {
+    return "SEND_COMMAND/" +
+           SessionCommand::CommandType_Name(input.command().type());
+  }
+  if (input.has_key() && input.key().has_special_key()) {
+    return Input::CommandType_Name(input.type()) + "/" +
+           commands::KeyEvent::SpecialKey_Name(input.key().special_key());
+  }
+  return Input::CommandType_Name(input.type());
+}
+
+// Latency samples, allocation counts and output sizes per command type, on
+// the server and on the client.
+class ReplayStats {
+ public:
+  void Add(const string &name, double latency_usec, uint64 allocations,
+           size_t output_bytes, double client_usec,
+           uint64 client_allocations) {
+    Entry &entry = entries_[name];
+    entry.latencies_usec.push_back(latency_usec);
+    entry.allocations += allocations;
+    entry.output_bytes += output_bytes;
+    entry.client_latencies_usec.push_back(client_usec);
+    entry.client_allocations += client_allocations;
+  }
+
+  void Print(const string &title, std::ostream *os) {
+    *os << "== " << title << std::endl;
+    *os << Util::StringPrintf(
+        "%-40s %8s %9s %9s %9s %9s %9s %9s %10s %10s\n", "command", "count",
+        "p50(us)", "p90(us)", "p99(us)", "max(us)", "alloc/cmd", "bytes/cmd",
+        "client-p99", "client-alc");
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      std::vector<double> &latencies = it->second.latencies_usec;
+      std::vector<double> &client_latencies =
+          it->second.client_latencies_usec;
+      std::sort(latencies.begin(), latencies.end());
+      std::sort(client_latencies.begin(), client_latencies.end());
+      const double count = latencies.size();
+      *os << Util::StringPrintf(
+          "%-40s %8d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f %10.1f\n",
+          it->first.c_str(), static_cast<int>(latencies.size()),
+          Percentile(latencies, 50), Percentile(latencies, 90),
+          Percentile(latencies, 99), latencies.back(),
+          it->second.allocations / count, it->second.output_bytes / count,
+          Percentile(client_latencies, 99),
+          it->second.client_allocations / count);
+    }
+  }
+
+ private:
+  struct Entry {
+    Entry() : allocations(0), output_bytes(0), client_allocations(0) {}
+    std::vector<double> latencies_usec;
+    uint64 allocations;
+    uint64 output_bytes;
+    std::vector<double> client_latencies_usec;
+    uint64 client_allocations;
+  };
+
+  // |sorted| must not be empty.
+  static double Percentile(const std::vector<double> &sorted, int percent) {
+    const size_t index = (sorted.size() - 1) * percent / 100;
+    return sorted[index];
+  }
+
+  std::map<string, Entry> entries_;
+};
+
+// Sends |input| to |handler| and receives the output into |output| through
+// |decoder| as the client library does.  |stats| can be NULL.
+bool EvalCommand(SessionHandler *handler, const Input &input,
+                 CandidatesDeltaDecoder *decoder, ReplayStats *stats,
+                 commands::Output *output) {
+  Input sent = input;
+  decoder->FillInput(&sent);
+  const string request = sent.SerializeAsString();
+  string wire;
+  wire.reserve(CommandArena::kDefaultBlockSize);
+
+  const uint64 allocations_before =
+      g_allocation_count.load(std::memory_order_relaxed);
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  // Same as SessionServer::Process().
+  commands::Command heap_command;
+  commands::Command *command =
+      FLAGS_command_arena ? Singleton<CommandArena>::get()->NewCommand()
+                          : &heap_command;
+  command->mutable_input()->ParseFromString(request);
+  const bool result = handler->EvalCommand(command);
+  command->output().SerializeToString(&wire);
+  stopwatch.Stop();
+  const uint64 allocations =
+      g_allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+  // The parsing of the output on the client.
+  const uint64 client_allocations_before =
+      g_allocation_count.load(std::memory_order_relaxed);
+  Stopwatch client_stopwatch = Stopwatch::StartNew();
+  commands::Output new_output;
+  commands::Output *received =
+      FLAGS_reuse_client_output ? output : &new_output;
+  received->ParseFromString(wire);
+  if (!decoder->Decode(received)) {
+    LOG(ERROR) << "Cannot decode the output";
+  }
+  client_stopwatch.Stop();
+  const uint64 client_allocations =
+      g_allocation_count.load(std::memory_order_relaxed) -
+      client_allocations_before;
+
+  if (stats != nullptr) {
+    stats->Add(GetCommandName(input), stopwatch.GetElapsedMicroseconds(),
+               allocations, wire.size(),
+               client_stopwatch.GetElapsedMicroseconds(), client_allocations);
+  }
+  if (received != output) {
+    output->Swap(received);
+  }
+  return result && output->error_code() == commands::Output::SESSION_SUCCESS;
+}
+
+void Replay(const std::vector<Script> &scripts, SessionHandler *handler,
+            ReplayStats *stats) {
+  for (size_t i = 0; i < scripts.size(); ++i) {
+    Input input;
+    input.set_type(Input::CREATE_SESSION);
+    input.mutable_capability()->set_delta_candidates(FLAGS_delta_candidates);
+    commands::Command command;
+    *command.mutable_input() = input;
+    if (!handler->EvalCommand(&command)) {
+      LOG(ERROR) << "CREATE_SESSION failed";
+      return;
+    }
+    const uint64 id = command.output().id();
+    CandidatesDeltaDecoder decoder;
+
+    // Each script starts with the default request.
+    input.Clear();
+    input.set_type(Input::SET_REQUEST);
+    input.mutable_request()->set_async_suggestion(FLAGS_async_suggestion);
+    commands::Output output;
+    EvalCommand(handler, input, &decoder, nullptr, &output);
+
+    const Script &script = scripts[i];
+    for (size_t j = 0; j < script.size(); ++j) {
+      input = script[j];
+      input.set_id(id);
+      if (input.type() == Input::SET_REQUEST) {
+        input.mutable_request()->set_async_suggestion(FLAGS_async_suggestion);
+      }
+      EvalCommand(handler, input, &decoder, stats, &output);
+
+      // Takes the asynchronous suggestion only when the typing pauses.
+      const bool typing_continues =
+          j + 1 < script.size() && (script[j + 1].type() == Input::SEND_KEY ||
+                                    script[j + 1].type() ==
+                                        Input::TEST_SEND_KEY);
+      if (!typing_continues && output.has_callback() &&
+          output.callback().session_command().type() ==
+              SessionCommand::GET_ASYNC_RESULT) {
+        Input callback;
+        callback.set_type(Input::SEND_COMMAND);
+        callback.set_id(id);
+        *callback.mutable_command() = output.callback().session_command();
+        EvalCommand(handler, callback, &decoder, stats, &output);
+      }
+    }
+
+    input.Clear();
+    input.set_type(Input::DELETE_SESSION);
+    input.set_id(id);
+    EvalCommand(handler, input, &decoder, nullptr, &output);
+  }
+}
+
+// Prints the CPU time of this process, including the background threads,
+// since |begin|.
+void PrintCpuTime(std::clock_t begin, std::ostream *os) {
+  const double cpu_msec =
+      1000.0 * (std::clock() - begin) / CLOCKS_PER_SEC;
+  *os << Util::StringPrintf("CPU time: %.1f ms\n", cpu_msec);
+}
+
+int Run() {
+  std::vector<Script> scripts;
+  std::vector<string> files;
+  Util::SplitStringUsing(FLAGS_scenario_files, ",", &files);
+  for (size_t i = 0; i < files.size(); ++i) {
+    Script script;
+    if (!LoadScenario(files[i], &script)) {
+      return 1;
+    }
+    scripts.push_back(script);
+  }
+  GenerateRandomScripts(FLAGS_random_sequences, &scripts);
+  GenerateCommitScripts(FLAGS_commit_sequences, &scripts);
+
+  size_t num_commands = 0;
+  for (size_t i = 0; i < scripts.size(); ++i) {
+    num_commands += scripts[i].size();
+  }
+  std::cout << "Scripts: " << scripts.size()
+            << ", commands per replay: " << num_commands << std::endl;
+
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  std::unique_ptr<EngineInterface> engine(EngineFactory::Create());
+  SessionHandler handler(std::move(engine));
+  stopwatch.Stop();
+  std::cout << "Engine creation: " << stopwatch.GetElapsedMilliseconds()
+            << " ms" << std::endl;
+
+  ReplayStats cold_stats;
+  std::clock_t cpu_begin = std::clock();
+  Replay(scripts, &handler, &cold_stats);
+  cold_stats.Print("Cold (first replay)", &std::cout);
+  PrintCpuTime(cpu_begin, &std::cout);
+
+  if (FLAGS_warm_iterations > 0) {
+    ReplayStats warm_stats;
+    cpu_begin = std::clock();
+    for (int i = 0; i < FLAGS_warm_iterations; ++i) {
+      Replay(scripts, &handler, &warm_stats);
+    }
+    warm_stats.Print(
+        Util::StringPrintf("Warm (%d replays)", FLAGS_warm_iterations),
+        &std::cout);
+    PrintCpuTime(cpu_begin, &std::cout);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  mozc::InitTestFlags();
+  string profile_dir = FLAGS_profile_dir;
+  if (profile_dir.empty()) {
+    // Every run starts without the learning data of the previous runs.
+    uint64 sec = 0;
+    uint32 usec = 0;
+    mozc::Clock::GetTimeOfDay(&sec, &usec);
+    profile_dir = mozc::FileUtil::JoinPath(
+        FLAGS_test_tmpdir,
+        "profile." + std::to_string(sec) + "." + std::to_string(usec));
+  }
+  if (!mozc::FileUtil::DirectoryExists(profile_dir) &&
+      !mozc::FileUtil::CreateDirectory(profile_dir)) {
+    // Never fall back to the user profile directory of the user.
+    LOG(ERROR) << "Cannot create the profile directory: " << profile_dir;
+    return 1;
+  }
+  std::cout << "Profile directory: " << profile_dir << std::endl;
+  mozc::SystemUtil::SetUserProfileDirectory(profile_dir);
+  return mozc::Run();
+}
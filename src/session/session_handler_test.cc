@@ -36,20 +36,25 @@
 
 #include "base/clock_mock.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/converter_mock.h"
+#include "engine/engine_builder.h"
 #include "engine/engine_builder_interface.h"
 #include "engine/engine_stub.h"
 #include "engine/mock_converter_engine.h"
 #include "engine/mock_data_engine_factory.h"
+#include "engine/user_data_manager_interface.h"
 #include "engine/user_data_manager_mock.h"
+#include "prediction/user_history_predictor.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/generic_storage_manager.h"
 #include "session/session_handler_test_util.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
+#include "testing/base/public/mozctest.h"
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
 
@@ -141,6 +146,36 @@ EngineReloadResponse::Status SendDummyEngineCommand(SessionHandler *handler) {
   return command.output().engine_reload_response().status();
 }
 
+bool SendKeys(SessionHandler *handler, uint64 id, const string &keys,
+              commands::Command *command) {
+  for (size_t i = 0; i < keys.size(); ++i) {
+    command->Clear();
+    command->mutable_input()->set_type(commands::Input::SEND_KEY);
+    command->mutable_input()->set_id(id);
+    command->mutable_input()->mutable_key()->set_key_code(keys[i]);
+    if (!handler->EvalCommand(command)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SendSessionCommand(SessionHandler *handler, uint64 id,
+                        commands::SessionCommand::CommandType type,
+                        commands::Command *command) {
+  command->Clear();
+  command->mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command->mutable_input()->set_id(id);
+  command->mutable_input()->mutable_command()->set_type(type);
+  return handler->EvalCommand(command);
+}
+
+bool HasAsyncResultCallback(const commands::Output &output) {
+  return output.has_callback() &&
+         output.callback().session_command().type() ==
+             commands::SessionCommand::GET_ASYNC_RESULT;
+}
+
 }  // namespace
 
 class SessionHandlerTest : public SessionHandlerTestBase {
@@ -348,6 +383,64 @@ TEST_F(SessionHandlerTest, ClearHistoryTest) {
   EXPECT_COUNT_STATS("SessionAllEvent", 4);
 }
 
+TEST_F(SessionHandlerTest, AsyncSuggestion) {
+  SessionHandler handler(CreateMockDataEngine());
+  {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SET_REQUEST);
+    command.mutable_input()->mutable_request()->set_async_suggestion(true);
+    ASSERT_TRUE(handler.EvalCommand(&command));
+  }
+  uint64 id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id));
+
+  // The key returns the preedit at once and asks for the callback.
+  commands::Command command;
+  ASSERT_TRUE(SendKeys(&handler, id, "kanji", &command));
+  EXPECT_TRUE(command.output().has_preedit());
+  EXPECT_FALSE(command.output().has_candidates());
+  EXPECT_TRUE(HasAsyncResultCallback(command.output()));
+
+  // The callback takes the suggestion for the latest composition.  The
+  // suggestions started by the former keys have been canceled by the next
+  // keys.
+  ASSERT_TRUE(SendSessionCommand(
+      &handler, id, commands::SessionCommand::GET_ASYNC_RESULT, &command));
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_EQ("かんじ", command.output().preedit().segment(0).value());
+  EXPECT_TRUE(command.output().has_candidates());
+  EXPECT_LT(0, command.output().candidates().candidate_size());
+  EXPECT_FALSE(command.output().has_callback());
+
+  // A command which keeps the composition cancels the suggestion, which is
+  // computed again when the callback arrives.
+  ASSERT_TRUE(SendKeys(&handler, id, "a", &command));
+  EXPECT_TRUE(HasAsyncResultCallback(command.output()));
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::TEST_SEND_KEY);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->mutable_key()->set_key_code('i');
+  ASSERT_TRUE(handler.EvalCommand(&command));
+  ASSERT_TRUE(SendSessionCommand(
+      &handler, id, commands::SessionCommand::GET_ASYNC_RESULT, &command));
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_EQ("かんじあ", command.output().preedit().segment(0).value());
+  EXPECT_TRUE(command.output().has_candidates());
+
+  // The callback after the composition is committed does nothing.
+  ASSERT_TRUE(SendKeys(&handler, id, "i", &command));
+  EXPECT_TRUE(HasAsyncResultCallback(command.output()));
+  ASSERT_TRUE(SendSessionCommand(
+      &handler, id, commands::SessionCommand::SUBMIT, &command));
+  EXPECT_TRUE(command.output().has_result());
+  ASSERT_TRUE(SendSessionCommand(
+      &handler, id, commands::SessionCommand::GET_ASYNC_RESULT, &command));
+  EXPECT_FALSE(command.output().has_preedit());
+  EXPECT_FALSE(command.output().has_candidates());
+
+  EXPECT_TRUE(DeleteSession(&handler, id));
+}
+
 TEST_F(SessionHandlerTest, ElapsedTimeTest) {
   SessionHandler handler(CreateMockDataEngine());
 
@@ -647,6 +740,7 @@ TEST_F(SessionHandlerTest, EngineReload_SessionExists) {
   SessionHandler handler(
       std::unique_ptr<EngineStub>(new EngineStub()),
       std::unique_ptr<MockEngineBuilder>(engine_builder));
+  const EngineInterface *old_engine = &handler.engine();
 
   // A session is created before data is loaded.
   engine_builder->set_state(MockEngineBuilder::State::STOP);
@@ -658,23 +752,199 @@ TEST_F(SessionHandlerTest, EngineReload_SessionExists) {
   // Emulate the state where async data load is complete.
   engine_builder->set_state(MockEngineBuilder::State::RELOAD_READY);
 
-  // Another session is created.  Since the handler already holds one session
-  // (id1), engine reload should not happen.
+  // Another session is created.  The new engine is published to the new
+  // session even though the handler already holds one session (id1).
   uint64 id2 = 0;
   ASSERT_TRUE(CreateSession(&handler, &id2));
-  EXPECT_EQ(0, engine_builder->num_build_from_prepared_data_called());
-  EXPECT_EQ(0, engine_builder->num_clear_called());
+  EXPECT_EQ(1, engine_builder->num_build_from_prepared_data_called());
+  EXPECT_EQ(1, engine_builder->num_clear_called());
+  EXPECT_NE(old_engine, &handler.engine());
 
-  // All the sessions were deleted.
+  // The session created before the reload is still alive on the new engine.
   ASSERT_TRUE(DeleteSession(&handler, id1));
   ASSERT_TRUE(DeleteSession(&handler, id2));
 
-  // A new session is created.  Since the handler holds no session, engine is
-  // reloaded at this timing.
+  // No more reload happens as the prepared data has been consumed.
   uint64 id3 = 0;
   ASSERT_TRUE(CreateSession(&handler, &id3));
   EXPECT_EQ(1, engine_builder->num_build_from_prepared_data_called());
   EXPECT_EQ(1, engine_builder->num_clear_called());
 }
 
+#ifndef OS_NACL
+namespace {
+
+// Waits until |engine_builder| has the response of the reload request.
+// Returns false if it does not in a minute.
+bool WaitForEngineBuilder(const EngineBuilder &engine_builder) {
+  const int kTimeoutMsec = 60 * 1000;
+  const int kIntervalMsec = 10;
+  for (int elapsed = 0; elapsed < kTimeoutMsec; elapsed += kIntervalMsec) {
+    if (engine_builder.HasResponse()) {
+      return true;
+    }
+    Util::Sleep(kIntervalMsec);
+  }
+  return engine_builder.HasResponse();
+}
+
+// Sends a reload request for the mock data set and waits until the new engine
+// is ready to be published.
+bool ReloadMockDataEngine(SessionHandler *handler,
+                          const EngineBuilder &engine_builder) {
+  commands::Command command;
+  command.mutable_input()->set_type(
+      commands::Input::SEND_ENGINE_RELOAD_REQUEST);
+  auto *request = command.mutable_input()->mutable_engine_reload_request();
+  request->set_engine_type(EngineReloadRequest::DESKTOP);
+  request->set_file_path(testing::GetSourcePath(
+      {"data_manager", "testing", "mock_mozc.data"}));
+  request->set_magic_number("MOCK");
+  if (!handler->EvalCommand(&command) ||
+      command.output().engine_reload_response().status() !=
+          EngineReloadResponse::ACCEPTED) {
+    return false;
+  }
+  return WaitForEngineBuilder(engine_builder);
+}
+
+// Types |keys| in the session |id| and commits the composition.
+bool TypeAndSubmit(SessionHandler *handler, uint64 id, const string &keys) {
+  for (const char key : keys) {
+    commands::Command command;
+    command.mutable_input()->set_id(id);
+    command.mutable_input()->set_type(commands::Input::SEND_KEY);
+    command.mutable_input()->mutable_key()->set_key_code(key);
+    if (!handler->EvalCommand(&command)) {
+      return false;
+    }
+  }
+  commands::Command command;
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command.mutable_input()->mutable_command()->set_type(
+      commands::SessionCommand::SUBMIT);
+  return handler->EvalCommand(&command) && command.output().has_result();
+}
+
+// Saves the user history of the current engine.
+void SyncUserData(SessionHandler *handler) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SYNC_DATA);
+  handler->EvalCommand(&command);
+  // The engine is not modified but the syncer thread has to be waited for.
+  const_cast<EngineInterface &>(handler->engine())
+      .GetUserDataManager()->Wait();
+}
+
+bool HistoryFileHasValue(const string &value) {
+  UserHistoryStorage storage(UserHistoryPredictor::GetUserHistoryFileName());
+  if (!storage.Load()) {
+    return false;
+  }
+  for (const auto &entry : storage.entries()) {
+    if (entry.value() == value) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+// A session created before a reload is moved to the new engine, so it keeps
+// learning and does not overwrite the user history saved by the new engine.
+TEST_F(SessionHandlerTest, EngineReload_SessionMovesToNewEngine) {
+  EngineBuilder *engine_builder = new EngineBuilder();
+  SessionHandler handler(CreateMockDataEngine(),
+                         std::unique_ptr<EngineBuilder>(engine_builder));
+
+  uint64 old_id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &old_id));
+  // Start a composition on the old engine and publish the new one.
+  commands::Command command;
+  ASSERT_TRUE(SendKeys(&handler, old_id, "sasisu", &command));
+  ASSERT_TRUE(ReloadMockDataEngine(&handler, *engine_builder));
+  uint64 new_id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &new_id));
+
+  ASSERT_TRUE(TypeAndSubmit(&handler, new_id, "kakiku"));
+  SyncUserData(&handler);
+  ASSERT_TRUE(HistoryFileHasValue("かきく"));
+
+  // The composition started before the reload is learned by the new engine,
+  // and deleting the last session of the old engine keeps the history.
+  ASSERT_TRUE(TypeAndSubmit(&handler, old_id, ""));
+  ASSERT_TRUE(DeleteSession(&handler, old_id));
+  SyncUserData(&handler);
+  EXPECT_TRUE(HistoryFileHasValue("かきく"));
+  EXPECT_TRUE(HistoryFileHasValue("さしす"));
+  EXPECT_TRUE(DeleteSession(&handler, new_id));
+}
+
+// Measures the latency of requests while a new engine is being built in
+// background.  Requests must be served by the current engine during the reload,
+// and publishing the new engine must not rebuild it on the command path.
+TEST_F(SessionHandlerTest, EngineReload_LatencyDuringReload) {
+  EngineBuilder *engine_builder = new EngineBuilder();
+  SessionHandler handler(CreateMockDataEngine(),
+                         std::unique_ptr<EngineBuilder>(engine_builder));
+  const EngineInterface *old_engine = &handler.engine();
+
+  uint64 id1 = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id1));
+
+  Stopwatch reload_stopwatch = Stopwatch::StartNew();
+  {
+    commands::Command command;
+    command.mutable_input()->set_type(
+        commands::Input::SEND_ENGINE_RELOAD_REQUEST);
+    auto *request = command.mutable_input()->mutable_engine_reload_request();
+    request->set_engine_type(EngineReloadRequest::DESKTOP);
+    request->set_file_path(testing::GetSourcePath(
+        {"data_manager", "testing", "mock_mozc.data"}));
+    request->set_magic_number("MOCK");
+    ASSERT_TRUE(handler.EvalCommand(&command));
+    ASSERT_EQ(EngineReloadResponse::ACCEPTED,
+              command.output().engine_reload_response().status());
+  }
+
+  // Keep typing while the engine is being built.
+  int num_requests = 0;
+  double max_latency_usec = 0.0;
+  bool reload_ready = false;
+  while (!reload_ready) {
+    reload_ready = engine_builder->HasResponse();
+    ASSERT_LT(reload_stopwatch.GetElapsedMilliseconds(), 60 * 1000)
+        << "The engine is not built in a minute";
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    ASSERT_TRUE(IsGoodSession(&handler, id1));
+    max_latency_usec =
+        std::max(max_latency_usec, stopwatch.GetElapsedMicroseconds());
+    ++num_requests;
+  }
+  const double reload_usec = reload_stopwatch.GetElapsedMicroseconds();
+
+  // The new engine is published on the next create session event.
+  Stopwatch publish_stopwatch = Stopwatch::StartNew();
+  uint64 id2 = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id2));
+  const double publish_usec = publish_stopwatch.GetElapsedMicroseconds();
+  EXPECT_NE(old_engine, &handler.engine());
+
+  LOG(INFO) << "Reload took " << reload_usec << " usec; "
+            << num_requests << " requests served during reload, "
+            << "max latency " << max_latency_usec << " usec; "
+            << "publish took " << publish_usec << " usec";
+  EXPECT_LT(publish_usec, reload_usec);
+
+  // Both the sessions created before and after the reload are available.
+  EXPECT_TRUE(IsGoodSession(&handler, id1));
+  EXPECT_TRUE(IsGoodSession(&handler, id2));
+  EXPECT_TRUE(DeleteSession(&handler, id1));
+  EXPECT_TRUE(IsGoodSession(&handler, id2));
+  EXPECT_TRUE(DeleteSession(&handler, id2));
+}
+#endif  // !OS_NACL
+
 }  // namespace mozc
@@ -37,6 +37,8 @@
 
 namespace mozc {
 
+class EngineInterface;
+
 namespace commands {
 class ApplicationInfo;
 class Capability;
@@ -69,6 +71,15 @@ class SessionInterface {
   // Set composition Table. Currently, this is especial for session::Session.
   virtual void SetTable(const composer::Table *table) {}
 
+  // Switch the engine used for conversion and learning, e.g. after the
+  // engine is reloaded.  Currently, this is especial for session::Session.
+  virtual void SetEngine(EngineInterface *engine) {}
+
+  // Omits the candidate fields of the output of |command| which the client
+  // already has, if the client supports it.  Called when the output is
+  // complete.  Currently, this is especial for session::Session.
+  virtual void EncodeCandidatesDelta(commands::Command *command) {}
+
   // Set client capability for this session.  Used by unittest.
   virtual void set_client_capability(
       const commands::Capability &capability) = 0;
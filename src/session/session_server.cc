@@ -41,6 +41,7 @@
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "protocol/commands.pb.h"
+#include "session/command_arena.h"
 #include "session/session_handler.h"
 #include "session/session_usage_observer.h"
 #include "usage_stats/usage_stats_uploader.h"
@@ -68,7 +69,8 @@ SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
       usage_observer_(new session::SessionUsageObserver()),
       session_handler_(new SessionHandler(
-      std::unique_ptr<Engine>(EngineFactory::Create()))) {
+      std::unique_ptr<Engine>(EngineFactory::Create()))),
+      command_arena_(new CommandArena) {
   using usage_stats::UsageStatsUploader;
   // start session watch dog timer
   session_handler_->StartWatchDog();
@@ -109,39 +111,35 @@ bool SessionServer::Process(const char *request,
     return false;   // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;   // can define as a private member?
-  if (!command.mutable_input()->ParseFromArray(request, request_size)) {
+  // The command and its sub messages are allocated from the arena, which is
+  // reused across the requests.
+  commands::Command *command = command_arena_->NewCommand();
+  if (!command->mutable_input()->ParseFromArray(request, request_size)) {
     LOG(WARNING) << "Invalid request";
     *response_size = 0;
     return true;
   }
 
-  if (!session_handler_->EvalCommand(&command)) {
+  if (!session_handler_->EvalCommand(command)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
     *response_size = 0;
     return false;
   }
 
-  string output;
-  if (!command.output().SerializeToString(&output)) {
-    LOG(WARNING) << "SerializeToString() failed";
-    *response_size = 0;
-    return true;
-  }
-
+  // Serializes the output directly into the response buffer.
   // TODO(taku) automatically increase the buffer.
   // Needs to fix IPCServer as well
-  if (*response_size < output.size()) {
-    LOG(WARNING) << "response size < output.size";
+  const commands::Output &output = command->output();
+  if (!output.SerializeToArray(response, static_cast<int>(*response_size))) {
+    LOG(WARNING) << "SerializeToArray() failed. response size: "
+                 << *response_size << ", output size: " << output.ByteSize();
     *response_size = 0;
     return true;
   }
-
-  ::memcpy(response, output.data(), output.size());
-  *response_size = output.size();
+  *response_size = output.GetCachedSize();
 
   // debug message
-  VLOG(2) << command.DebugString();
+  VLOG(2) << command->DebugString();
 
   return true;
 }
@@ -38,6 +38,7 @@
 #include "ipc/ipc.h"
 
 namespace mozc {
+class CommandArena;
 class EngineInterface;
 class SessionHandlerInterface;
 
@@ -70,6 +71,7 @@ class SessionServer: public IPCServer {
  private:
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
+  std::unique_ptr<CommandArena> command_arena_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionServer);
 };
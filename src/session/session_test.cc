@@ -29,6 +29,7 @@
 
 #include "session/session.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -516,6 +517,96 @@ class MockConverterEngineForRevert : public EngineInterface {
   std::unique_ptr<ConverterMockForRevert> converter_mock_;
 };
 
+// Blocks the next suggestion until it is canceled, so that the test can send
+// a command while the suggestion is running in background.
+class ConverterMockForAsyncSuggestion : public ConverterMock {
+ public:
+  ConverterMockForAsyncSuggestion()
+      : block_next_suggestion_(false), held_(false), blocking_(false),
+        num_canceled_(0) {}
+
+  bool StartSuggestionForRequest(const ConversionRequest &request,
+                                 Segments *segments) const override {
+    if (!block_next_suggestion_.exchange(false)) {
+      return ConverterMock::StartSuggestionForRequest(request, segments);
+    }
+    blocking_ = true;
+    // Gives up after 10 seconds not to hang the test.
+    for (int i = 0; i < 10000 && (held_ || !request.IsCanceled()); ++i) {
+      Util::Sleep(1);
+    }
+    if (request.IsCanceled()) {
+      ++num_canceled_;
+    }
+    blocking_ = false;
+    return false;
+  }
+
+  void BlockNextSuggestion() { block_next_suggestion_ = true; }
+
+  // While held, the blocked suggestion doesn't respond to the cancellation.
+  void Hold() { held_ = true; }
+  void Release() { held_ = false; }
+  bool blocking() const { return blocking_; }
+
+  // Waits for the blocked suggestion to start in background.  Otherwise a
+  // command may cancel it before it reaches the converter.
+  bool WaitForBlockedSuggestion() const {
+    for (int i = 0; i < 10000 && !blocking_; ++i) {
+      Util::Sleep(1);
+    }
+    return blocking_;
+  }
+
+  int num_canceled() const { return num_canceled_; }
+
+ private:
+  mutable std::atomic<bool> block_next_suggestion_;
+  std::atomic<bool> held_;
+  mutable std::atomic<bool> blocking_;
+  mutable std::atomic<int> num_canceled_;
+};
+
+class MockConverterEngineForAsyncSuggestion : public EngineInterface {
+ public:
+  MockConverterEngineForAsyncSuggestion()
+      : converter_mock_(new ConverterMockForAsyncSuggestion) {}
+  ~MockConverterEngineForAsyncSuggestion() override = default;
+
+  ConverterInterface *GetConverter() const override {
+    return converter_mock_.get();
+  }
+
+  PredictorInterface *GetPredictor() const override {
+    return nullptr;
+  }
+
+  dictionary::SuppressionDictionary *GetSuppressionDictionary() override {
+    return nullptr;
+  }
+
+  bool Reload() override {
+    return true;
+  }
+
+  UserDataManagerInterface *GetUserDataManager() override {
+    return nullptr;
+  }
+
+  const DataManagerInterface *GetDataManager() const override {
+    return nullptr;
+  }
+
+  StringPiece GetDataVersion() const override { return StringPiece(); }
+
+  ConverterMockForAsyncSuggestion *mutable_converter_mock() {
+    return converter_mock_.get();
+  }
+
+ private:
+  std::unique_ptr<ConverterMockForAsyncSuggestion> converter_mock_;
+};
+
 }  // namespace
 
 class SessionTest : public ::testing::Test {
@@ -9239,5 +9330,104 @@ TEST_F(SessionTest, MakeSureIMEOff) {
   }
 }
 
+TEST_F(SessionTest, AsyncSuggestion) {
+  std::unique_ptr<MockConverterEngineForAsyncSuggestion> engine(
+      new MockConverterEngineForAsyncSuggestion);
+  ConverterMockForAsyncSuggestion *convertermock =
+      engine->mutable_converter_mock();
+  commands::Request request;
+  request.set_async_suggestion(true);
+  std::unique_ptr<Session> session(new Session(engine.get()));
+  InitSessionToPrecomposition(session.get(), request);
+
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("あい");
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->value = "愛";
+  candidate->key = "あい";
+  candidate->content_key = "あい";
+  convertermock->SetStartSuggestionForRequest(&segments, true);
+
+  // The suggestion for "a" is running when the next key arrives, which
+  // cancels it and starts the suggestion for "ai".
+  commands::Command command;
+  convertermock->BlockNextSuggestion();
+  InsertCharacterChars("a", session.get(), &command);
+  ASSERT_TRUE(convertermock->WaitForBlockedSuggestion());
+  EXPECT_EQ(ImeContext::COMPOSITION, session->context().state());
+  EXPECT_FALSE(command.output().has_candidates());
+  EXPECT_EQ(commands::SessionCommand::GET_ASYNC_RESULT,
+            command.output().callback().session_command().type());
+  InsertCharacterChars("i", session.get(), &command);
+  EXPECT_FALSE(command.output().has_candidates());
+  EXPECT_EQ(commands::SessionCommand::GET_ASYNC_RESULT,
+            command.output().callback().session_command().type());
+
+  ASSERT_TRUE(SendCommand(commands::SessionCommand::GET_ASYNC_RESULT,
+                          session.get(), &command));
+  EXPECT_EQ(1, convertermock->num_canceled());
+  EXPECT_TRUE(command.output().consumed());
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ("愛", command.output().candidates().candidate(0).value());
+
+  // A command which ends the composition cancels the running suggestion, and
+  // the callback does nothing after that.
+  convertermock->BlockNextSuggestion();
+  InsertCharacterChars("u", session.get(), &command);
+  ASSERT_TRUE(convertermock->WaitForBlockedSuggestion());
+  ASSERT_TRUE(SendCommand(commands::SessionCommand::SUBMIT, session.get(),
+                          &command));
+  EXPECT_EQ(2, convertermock->num_canceled());
+  EXPECT_TRUE(command.output().has_result());
+
+  ASSERT_TRUE(SendCommand(commands::SessionCommand::GET_ASYNC_RESULT,
+                          session.get(), &command));
+  EXPECT_FALSE(command.output().has_preedit());
+  EXPECT_FALSE(command.output().has_candidates());
+}
+
+TEST_F(SessionTest, AsyncSuggestionDoesNotWaitForCanceledSuggestion) {
+  std::unique_ptr<MockConverterEngineForAsyncSuggestion> engine(
+      new MockConverterEngineForAsyncSuggestion);
+  ConverterMockForAsyncSuggestion *convertermock =
+      engine->mutable_converter_mock();
+  commands::Request request;
+  request.set_async_suggestion(true);
+  std::unique_ptr<Session> session(new Session(engine.get()));
+  InitSessionToPrecomposition(session.get(), request);
+
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("あい");
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->value = "愛";
+  candidate->key = "あい";
+  candidate->content_key = "あい";
+  convertermock->SetStartSuggestionForRequest(&segments, true);
+
+  // The next key updates the composition while the canceled suggestion for
+  // "a" is still running.
+  commands::Command command;
+  convertermock->BlockNextSuggestion();
+  convertermock->Hold();
+  InsertCharacterChars("a", session.get(), &command);
+  ASSERT_TRUE(convertermock->WaitForBlockedSuggestion());
+  InsertCharacterChars("i", session.get(), &command);
+  EXPECT_TRUE(convertermock->blocking());
+  EXPECT_EQ(commands::SessionCommand::GET_ASYNC_RESULT,
+            command.output().callback().session_command().type());
+  EXPECT_EQ(0, convertermock->num_canceled());
+  convertermock->Release();
+
+  // The result is taken after the canceled suggestion winds down.
+  ASSERT_TRUE(SendCommand(commands::SessionCommand::GET_ASYNC_RESULT,
+                          session.get(), &command));
+  EXPECT_EQ(1, convertermock->num_canceled());
+  EXPECT_FALSE(convertermock->blocking());
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ("愛", command.output().candidates().candidate(0).value());
+}
+
 }  // namespace session
 }  // namespace mozc
@@ -47,6 +47,7 @@
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../testing/testing.gyp:testing',
+        '../usage_stats/usage_stats_base.gyp:usage_stats',
         '../usage_stats/usage_stats_test.gyp:usage_stats_testing_util',
         'session.gyp:session',
         'session.gyp:session_handler',
@@ -116,8 +117,11 @@
       'dependencies': [
         '../base/base_test.gyp:clock_mock',
         '../converter/converter_base.gyp:converter_mock',
+        '../engine/engine.gyp:engine_builder',
         '../engine/engine.gyp:mock_converter_engine',
+        '../prediction/prediction.gyp:prediction',
         '../testing/testing.gyp:gtest_main',
+        '../testing/testing.gyp:mozctest',
         '../usage_stats/usage_stats_test.gyp:usage_stats_testing_util',
         'session.gyp:session',
         'session.gyp:session_server',
@@ -154,6 +158,8 @@
       'target_name': 'session_module_test',
       'type': 'executable',
       'sources': [
+        'candidates_delta_test.cc',
+        'command_arena_test.cc',
         'output_util_test.cc',
         'session_observer_handler_test.cc',
         'session_usage_observer_test.cc',
@@ -172,6 +178,8 @@
         '../usage_stats/usage_stats_test.gyp:usage_stats_testing_util',
         'session.gyp:session_handler',
         'session.gyp:session_usage_observer',
+        'session_base.gyp:candidates_delta',
+        'session_base.gyp:command_arena',
         'session_base.gyp:keymap',
         'session_base.gyp:keymap_factory',
         'session_base.gyp:output_util',
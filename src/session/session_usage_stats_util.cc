@@ -45,6 +45,7 @@ using mozc::commands::Output;
 using mozc::protobuf::EnumValueDescriptor;
 using mozc::protobuf::FieldDescriptor;
 using mozc::protobuf::Message;
+using mozc::usage_stats::StatsId;
 using mozc::usage_stats::UsageStats;
 
 namespace mozc {
@@ -91,9 +92,9 @@ void SessionUsageStatsUtil::AddSendKeyInputStats(const Input &input) {
   CHECK(input.has_key() && input.type() == commands::Input::SEND_KEY);
 
   if (input.key().has_key_code()) {
-    UsageStats::IncrementCount("ASCIITyping");
+    UsageStats::IncrementCount(StatsId::kASCIITyping);
   } else if (input.key().has_special_key()) {
-    UsageStats::IncrementCount("NonASCIITyping");
+    UsageStats::IncrementCount(StatsId::kNonASCIITyping);
     const char kEnumTypeName[] = "special_key";
     string name;
     if (GetEnumValueName(input.key(), kEnumTypeName, &name)) {
@@ -104,9 +105,9 @@ void SessionUsageStatsUtil::AddSendKeyInputStats(const Input &input) {
 
 void SessionUsageStatsUtil::AddSendKeyOutputStats(const Output &output) {
   if (output.has_consumed() && output.consumed()) {
-    UsageStats::IncrementCount("ConsumedSendKey");
+    UsageStats::IncrementCount(StatsId::kConsumedSendKey);
   } else {
-    UsageStats::IncrementCount("UnconsumedSendKey");
+    UsageStats::IncrementCount(StatsId::kUnconsumedSendKey);
   }
 }
 
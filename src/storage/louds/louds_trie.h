@@ -90,6 +90,9 @@ class LoudsTrie {
     return edge_character_[node.node_id() - 1];
   }
 
+  // Returns the number of keys, which is one more than the largest key ID.
+  int GetNumKeys() const { return terminal_bit_vector_.GetNum1Bits(); }
+
   // Computes the ID of key that reaches to |node|.
   // REQUIRES: |node| is a terminal node.
   int GetKeyIdOfTerminalNode(const Node &node) const {
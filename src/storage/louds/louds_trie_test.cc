@@ -159,6 +159,8 @@ TEST_P(LoudsTrieTest, NodeBasedApis) {
             param.louds_select1_cache_size,
             param.termvec_lb1_cache_size);
 
+  EXPECT_EQ(6, trie.GetNumKeys());
+
   char buf[LoudsTrie::kMaxDepth + 1];  // for RestoreKeyString().
 
   // Walk the trie in BFS order and check properties at each node.
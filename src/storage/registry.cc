@@ -54,7 +54,7 @@ const char kRegistryFileName[] = ".registry.db";   // hidden file
 class StorageInitializer {
  public:
   StorageInitializer() :
-      default_storage_(TinyStorage::New()), current_storage_(NULL) {
+      default_storage_(TinyStorage::NewWithJournal()), current_storage_(NULL) {
     if (!default_storage_->Open(FileUtil::JoinPath(
             SystemUtil::GetUserProfileDirectory(), kRegistryFileName))) {
       LOG(ERROR) << "cannot open registry";
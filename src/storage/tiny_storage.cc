@@ -33,16 +33,21 @@
 #include <Windows.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
+#include "base/process_mutex.h"
+#include "base/util.h"
 
 namespace mozc {
 namespace storage {
@@ -57,6 +62,32 @@ const size_t kMaxValueSize   = 4096;        // 4k for key/value
 // so 10Mbyte data is reasonable upper bound for file size
 const size_t kMaxFileSize     = 1024 * 1024 * 10;  // 10Mbyte
 
+const uint32 kJournalVersion = 0;
+const uint32 kJournalMagicId = 0x6a5c01d3;  // random seed
+const char kJournalSuffix[] = ".journal";
+// The journal is compacted into the snapshot when it would grow beyond
+// max(kMinJournalSizeToCompact, the snapshot size).
+const size_t kMinJournalSizeToCompact = 64 * 1024;
+// Sync() is serialized among processes by a lock file "<filename>.lock".
+const char kLockSuffix[] = ".lock";
+const int kLockRetryCount = 20;
+const int kLockRetryIntervalMsec = 10;
+
+enum JournalRecordType {
+  JOURNAL_INSERT = 1,
+  JOURNAL_ERASE = 2,
+};
+
+template<typename T>
+void AppendData(const T &value, string *output) {
+  output->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void AppendString(const string &str, string *output) {
+  AppendData(static_cast<uint32>(str.size()), output);
+  output->append(str);
+}
+
 template<typename T>
 bool ReadData(char **begin, const char *end, T *value) {
   if (*begin + sizeof(*value) > end) {
@@ -84,9 +115,18 @@ bool IsInvalid(const string &key, const string &value, size_t size) {
   return false;
 }
 
+// When |use_journal| is true, Sync() appends the entries changed since the
+// last sync to "<filename>.journal" instead of rewriting the whole file, and
+// Open() replays the journal on top of the file.  The file itself (the
+// snapshot) keeps the same format, and the journal is merged into it once the
+// journal gets larger than the snapshot.
+// Other processes may sync the same file.  Sync() holds a lock file, and
+// appends to the journal only when the snapshot and the journal are the ones
+// this instance read or wrote last time.  Otherwise it rewrites the snapshot,
+// i.e., the last writer wins as without the journal.
 class TinyStorageImpl : public StorageInterface {
  public:
-  TinyStorageImpl();
+  explicit TinyStorageImpl(bool use_journal);
   virtual ~TinyStorageImpl();
 
   virtual bool Open(const string &filename);
@@ -100,14 +140,43 @@ class TinyStorageImpl : public StorageInterface {
   }
 
  private:
+  bool OpenSnapshot();
+  bool WriteSnapshot();
+  void ReplayJournal();
+  // Returns true if the files on disk haven't been changed by others since
+  // this instance read or wrote them.
+  bool IsJournalUpToDate() const;
+  bool AppendJournal();
+  bool SyncWithJournal();
+  string GetJournalFileName() const {
+    return filename_ + kJournalSuffix;
+  }
+
   string filename_;
   bool should_sync_;
   std::map<string, string> dic_;
 
+  const bool use_journal_;
+  // True if the journal cannot be appended, e.g., after Clear() or when the
+  // journal is broken.  The next Sync() rewrites the snapshot.
+  bool should_compact_;
+  // Keys inserted or erased since the last Sync().
+  std::set<string> dirty_keys_;
+  // The journal is valid only for the snapshot of this fingerprint.
+  uint64 snapshot_fingerprint_;
+  size_t snapshot_size_;
+  size_t journal_size_;
+
   DISALLOW_COPY_AND_ASSIGN(TinyStorageImpl);
 };
 
-TinyStorageImpl::TinyStorageImpl() : should_sync_(true) {
+TinyStorageImpl::TinyStorageImpl(bool use_journal)
+    : should_sync_(true),
+      use_journal_(use_journal),
+      should_compact_(false),
+      snapshot_fingerprint_(Hash::Fingerprint("")),
+      snapshot_size_(0),
+      journal_size_(0) {
   // the each entry consumes at most
   // sizeof(uint32) * 2 (key/value length) +
   // kMaxKeySize + kMaxValueSize
@@ -123,9 +192,25 @@ TinyStorageImpl::~TinyStorageImpl() {
 }
 
 bool TinyStorageImpl::Open(const string &filename) {
-  Mmap mmap;
   dic_.clear();
+  dirty_keys_.clear();
   filename_ = filename;
+  should_compact_ = false;
+  snapshot_fingerprint_ = Hash::Fingerprint("");
+  snapshot_size_ = 0;
+  journal_size_ = 0;
+  if (!OpenSnapshot()) {
+    return false;
+  }
+  if (use_journal_) {
+    ReplayJournal();
+  }
+  return true;
+}
+
+bool TinyStorageImpl::OpenSnapshot() {
+  Mmap mmap;
+  const string &filename = filename_;
   if (!mmap.Open(filename.c_str(), "r")) {
     LOG(WARNING) << "cannot open:" << filename;
     // here we return true if we cannot open the file.
@@ -214,65 +299,295 @@ bool TinyStorageImpl::Open(const string &filename) {
     return false;
   }
 
+  snapshot_fingerprint_ =
+      Hash::Fingerprint(StringPiece(mmap.begin(), mmap.size()));
+  snapshot_size_ = mmap.size();
   return true;
 }
 
-// Format of storage:
-// |magic(uint32 file_size ^ kStorageVersion)|version(uint32)|size(uint32)|
-// |key_size(uint32)|key(variable length)|
-// |value_size(uint32)|value(variable length)| ...
+// Format of journal:
+// |magic(uint32 kJournalMagicId)|version(uint32)|
+// |snapshot fingerprint(uint64)| followed by records:
+// |payload_size(uint32)|payload checksum(uint32)|payload(variable length)|
+// where payload is |type(uint8)|key_size(uint32)|key(variable length)| and,
+// for JOURNAL_INSERT, |value_size(uint32)|value(variable length)|.
+// Replay stops at the first incomplete or corrupted record, which a crash in
+// the middle of an append may leave.
+void TinyStorageImpl::ReplayJournal() {
+  const string journal_filename = GetJournalFileName();
+  if (!FileUtil::FileExists(journal_filename)) {
+    return;
+  }
+  Mmap mmap;
+  if (!mmap.Open(journal_filename.c_str(), "r") ||
+      mmap.size() > kMaxFileSize) {
+    LOG(ERROR) << "cannot open journal: " << journal_filename;
+    should_compact_ = true;
+    return;
+  }
+
+  char *begin = mmap.begin();
+  const char *end = mmap.end();
+  uint32 magic = 0;
+  uint32 version = 0;
+  uint64 fingerprint = 0;
+  if (!ReadData<uint32>(&begin, end, &magic) ||
+      !ReadData<uint32>(&begin, end, &version) ||
+      !ReadData<uint64>(&begin, end, &fingerprint) ||
+      magic != kJournalMagicId || version != kJournalVersion) {
+    LOG(ERROR) << "journal header is broken: " << journal_filename;
+    should_compact_ = true;
+    return;
+  }
+  if (fingerprint != snapshot_fingerprint_) {
+    // The snapshot was rewritten after this journal, so the snapshot already
+    // contains all the changes in it.
+    LOG(WARNING) << "ignoring stale journal: " << journal_filename;
+    should_compact_ = true;
+    return;
+  }
+  journal_size_ = begin - mmap.begin();
+
+  while (begin < end) {
+    uint32 payload_size = 0;
+    uint32 checksum = 0;
+    if (!ReadData<uint32>(&begin, end, &payload_size) ||
+        !ReadData<uint32>(&begin, end, &checksum) ||
+        payload_size > static_cast<size_t>(end - begin) ||
+        Hash::Fingerprint32(StringPiece(begin, payload_size)) != checksum) {
+      LOG(WARNING) << "journal is truncated: " << journal_filename;
+      should_compact_ = true;
+      break;
+    }
+    const char *payload_end = begin + payload_size;
+    uint8 type = 0;
+    uint32 key_size = 0;
+    uint32 value_size = 0;
+    if (!ReadData<uint8>(&begin, payload_end, &type) ||
+        !ReadData<uint32>(&begin, payload_end, &key_size) ||
+        key_size > static_cast<size_t>(payload_end - begin)) {
+      LOG(ERROR) << "journal record is broken: " << journal_filename;
+      should_compact_ = true;
+      break;
+    }
+    const string key(begin, key_size);
+    begin += key_size;
+    if (type == JOURNAL_INSERT) {
+      if (!ReadData<uint32>(&begin, payload_end, &value_size) ||
+          value_size != static_cast<size_t>(payload_end - begin)) {
+        LOG(ERROR) << "journal record is broken: " << journal_filename;
+        should_compact_ = true;
+        break;
+      }
+      const string value(begin, value_size);
+      if (dic_.find(key) == dic_.end() &&
+          IsInvalid(key, value, dic_.size())) {
+        should_compact_ = true;
+        break;
+      }
+      dic_[key] = value;
+    } else if (type == JOURNAL_ERASE) {
+      dic_.erase(key);
+    } else {
+      LOG(ERROR) << "unknown journal record type: " << static_cast<int>(type);
+      should_compact_ = true;
+      break;
+    }
+    begin = const_cast<char *>(payload_end);
+    journal_size_ = begin - mmap.begin();
+  }
+}
+
+bool TinyStorageImpl::AppendJournal() {
+  DCHECK(use_journal_);
+  if (should_compact_) {
+    return false;
+  }
+
+  string records;
+  if (journal_size_ == 0) {
+    AppendData(kJournalMagicId, &records);
+    AppendData(kJournalVersion, &records);
+    AppendData(snapshot_fingerprint_, &records);
+  }
+  string payload;
+  for (std::set<string>::const_iterator it = dirty_keys_.begin();
+       it != dirty_keys_.end(); ++it) {
+    payload.clear();
+    std::map<string, string>::const_iterator entry = dic_.find(*it);
+    if (entry != dic_.end()) {
+      AppendData(static_cast<uint8>(JOURNAL_INSERT), &payload);
+      AppendString(entry->first, &payload);
+      AppendString(entry->second, &payload);
+    } else {
+      AppendData(static_cast<uint8>(JOURNAL_ERASE), &payload);
+      AppendString(*it, &payload);
+    }
+    AppendData(static_cast<uint32>(payload.size()), &records);
+    AppendData(Hash::Fingerprint32(payload), &records);
+    records.append(payload);
+  }
+
+  if (journal_size_ + records.size() >
+      std::max(kMinJournalSizeToCompact, snapshot_size_)) {
+    return false;
+  }
+
+  const string journal_filename = GetJournalFileName();
+  OutputFileStream ofs(journal_filename.c_str(),
+                       std::ios::binary | std::ios::out | std::ios::app);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << journal_filename;
+    return false;
+  }
+  ofs.write(records.data(), records.size());
+  ofs.close();
+  if (!ofs) {
+    LOG(ERROR) << "cannot write " << journal_filename;
+    // The journal may have a partial record, which is ignored on replay, but
+    // records cannot be appended after it.
+    should_compact_ = true;
+    return false;
+  }
+
+#ifdef OS_WIN
+  if (journal_size_ == 0 && !FileUtil::HideFile(journal_filename)) {
+    LOG(ERROR) << "Cannot make hidden: " << journal_filename
+               << " " << ::GetLastError();
+  }
+#endif
+
+  journal_size_ += records.size();
+  return true;
+}
+
+bool TinyStorageImpl::IsJournalUpToDate() const {
+  const string journal_filename = GetJournalFileName();
+  if (journal_size_ == 0) {
+    // A new journal is started on the snapshot this instance has.
+    if (FileUtil::FileExists(journal_filename)) {
+      return false;
+    }
+    Mmap mmap;
+    if (!mmap.Open(filename_.c_str(), "r")) {
+      return snapshot_fingerprint_ == Hash::Fingerprint("");
+    }
+    return snapshot_fingerprint_ ==
+           Hash::Fingerprint(StringPiece(mmap.begin(), mmap.size()));
+  }
+
+  // The journal header has the fingerprint of the snapshot, which is rewritten
+  // only together with the journal.
+  Mmap mmap;
+  if (!mmap.Open(journal_filename.c_str(), "r") ||
+      mmap.size() != journal_size_) {
+    return false;
+  }
+  char *begin = mmap.begin();
+  const char *end = mmap.end();
+  uint32 magic = 0;
+  uint32 version = 0;
+  uint64 fingerprint = 0;
+  return ReadData<uint32>(&begin, end, &magic) &&
+         ReadData<uint32>(&begin, end, &version) &&
+         ReadData<uint64>(&begin, end, &fingerprint) &&
+         magic == kJournalMagicId && version == kJournalVersion &&
+         fingerprint == snapshot_fingerprint_;
+}
+
 bool TinyStorageImpl::Sync() {
   if (!should_sync_) {
     VLOG(2) << "Already synced";
     return true;
   }
 
-  const string output_filename = filename_ + ".tmp";
+  if (!use_journal_) {
+    if (!WriteSnapshot()) {
+      return false;
+    }
+    should_sync_ = false;
+    return true;
+  }
 
-  OutputFileStream ofs(output_filename.c_str(),
-                       std::ios::binary | std::ios::out);
-  if (!ofs) {
-    LOG(ERROR) << "cannot open " << output_filename;
+  ProcessMutex mutex(FileUtil::Basename(filename_).c_str());
+  mutex.set_lock_filename(filename_ + kLockSuffix);
+  for (int i = 0; !mutex.Lock(); ++i) {
+    if (i == kLockRetryCount) {
+      // The changes are kept and synced next time.
+      LOG(ERROR) << "cannot lock " << mutex.lock_filename();
+      return false;
+    }
+    Util::Sleep(kLockRetryIntervalMsec);
+  }
+  const bool result = SyncWithJournal();
+  mutex.UnLock();
+  return result;
+}
+
+bool TinyStorageImpl::SyncWithJournal() {
+  if (!should_compact_ && !IsJournalUpToDate()) {
+    LOG(WARNING) << filename_ << " has been synced by another process";
+    should_compact_ = true;
+  }
+
+  if (AppendJournal()) {
+    dirty_keys_.clear();
+    should_sync_ = false;
+    return true;
+  }
+
+  if (!WriteSnapshot()) {
     return false;
   }
 
-  uint32 magic = 0;
+  // The new snapshot contains all the changes.  Even if the journal is left
+  // by a crash here, it is ignored as its fingerprint doesn't match.
+  const string journal_filename = GetJournalFileName();
+  if (FileUtil::FileExists(journal_filename) &&
+      !FileUtil::Unlink(journal_filename)) {
+    LOG(ERROR) << "cannot remove " << journal_filename;
+  }
+  journal_size_ = 0;
+  should_compact_ = false;
+  dirty_keys_.clear();
+  should_sync_ = false;
+  return true;
+}
+
+// Format of storage:
+// |magic(uint32 file_size ^ kStorageVersion)|version(uint32)|size(uint32)|
+// |key_size(uint32)|key(variable length)|
+// |value_size(uint32)|value(variable length)| ...
+bool TinyStorageImpl::WriteSnapshot() {
   uint32 size = 0;
-  ofs.write(reinterpret_cast<const char *>(&magic),
-            sizeof(magic));
-  ofs.write(reinterpret_cast<const char *>(&kStorageVersion),
-            sizeof(kStorageVersion));
-  ofs.write(reinterpret_cast<const char *>(&size),
-            sizeof(size));
+  string image;
+  AppendData(static_cast<uint32>(0), &image);  // magic
+  AppendData(kStorageVersion, &image);
+  AppendData(size, &image);
 
   for (std::map<string, string>::const_iterator it = dic_.begin();
        it != dic_.end(); ++it) {
     if (it->first.empty()) {
       continue;
     }
-    const string &key = it->first;
-    const string &value = it->second;
-    const uint32 key_size = static_cast<uint32>(key.size());
-    const uint32 value_size = static_cast<uint32>(value.size());
-    ofs.write(reinterpret_cast<const char *>(&key_size),
-              sizeof(key_size));
-    ofs.write(key.data(), key_size);
-    ofs.write(reinterpret_cast<const char *>(&value_size),
-              sizeof(value_size));
-    ofs.write(value.data(), value_size);
+    AppendString(it->first, &image);
+    AppendString(it->second, &image);
     ++size;
   }
 
-  magic = static_cast<uint32>(ofs.tellp());
-  ofs.seekp(0);
-  magic ^= kStorageMagicId;
+  const uint32 magic = static_cast<uint32>(image.size()) ^ kStorageMagicId;
+  memcpy(&image[0], &magic, sizeof(magic));
+  memcpy(&image[sizeof(magic) + sizeof(kStorageVersion)], &size,
+         sizeof(size));
 
-  ofs.write(reinterpret_cast<const char *>(&magic),
-            sizeof(magic));
-  ofs.write(reinterpret_cast<const char *>(&kStorageVersion),
-            sizeof(kStorageVersion));
-  ofs.write(reinterpret_cast<const char *>(&size),
-            sizeof(size));
+  const string output_filename = filename_ + ".tmp";
+  OutputFileStream ofs(output_filename.c_str(),
+                       std::ios::binary | std::ios::out);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << output_filename;
+    return false;
+  }
+  ofs.write(image.data(), image.size());
 
   // should call close(). Othrwise AtomicRename will be failed.
   ofs.close();
@@ -289,8 +604,8 @@ bool TinyStorageImpl::Sync() {
   }
 #endif
 
-  should_sync_ = false;
-
+  snapshot_fingerprint_ = Hash::Fingerprint(image);
+  snapshot_size_ = image.size();
   return true;
 }
 
@@ -300,6 +615,9 @@ bool TinyStorageImpl::Insert(const string &key, const string &value) {
     return false;
   }
   dic_[key] = value;
+  if (use_journal_) {
+    dirty_keys_.insert(key);
+  }
   should_sync_ = true;
   return true;
 }
@@ -311,6 +629,9 @@ bool TinyStorageImpl::Erase(const string &key) {
     return false;
   }
   dic_.erase(it);
+  if (use_journal_) {
+    dirty_keys_.insert(key);
+  }
   should_sync_ = true;
   return true;
 }
@@ -327,6 +648,7 @@ bool TinyStorageImpl::Lookup(const string &key, string *value) const {
 
 bool TinyStorageImpl::Clear() {
   dic_.clear();
+  should_compact_ = true;
   should_sync_ = true;
   return Sync();
 }
@@ -334,7 +656,7 @@ bool TinyStorageImpl::Clear() {
 }  // namespace
 
 StorageInterface *TinyStorage::Create(const char *filename) {
-  std::unique_ptr<TinyStorageImpl> storage(new TinyStorageImpl);
+  std::unique_ptr<TinyStorageImpl> storage(new TinyStorageImpl(false));
   if (!storage->Open(filename)) {
     LOG(ERROR) << "cannot open " << filename;
     return NULL;
@@ -343,7 +665,16 @@ StorageInterface *TinyStorage::Create(const char *filename) {
 }
 
 StorageInterface *TinyStorage::New() {
-  return new TinyStorageImpl;
+  return new TinyStorageImpl(false);
+}
+
+StorageInterface *TinyStorage::NewWithJournal() {
+#ifdef MOZC_USE_PEPPER_FILE_IO
+  // Pepper file IO doesn't support appending to a file.
+  return New();
+#else  // MOZC_USE_PEPPER_FILE_IO
+  return new TinyStorageImpl(true);
+#endif  // MOZC_USE_PEPPER_FILE_IO
 }
 
 }  // namespace storage
@@ -48,6 +48,11 @@ class TinyStorage {
   static StorageInterface *New();
   static StorageInterface *Create(const char *filename);
 
+  // Same as New() but Sync() appends only the changed entries to a journal
+  // file next to the storage file, which is merged into the storage file
+  // when it gets large.  Use this for storages synced frequently.
+  static StorageInterface *NewWithJournal();
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(TinyStorage);
 };
@@ -36,8 +36,10 @@
 #include <utility>
 #include <vector>
 
+#include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/port.h"
+#include "base/process_mutex.h"
 #include "storage/storage_interface.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
@@ -76,6 +78,10 @@ class TinyStorageTest : public testing::Test {
     if (FileUtil::FileExists(path)) {
       FileUtil::Unlink(path);
     }
+    const string journal_path = GetJournalFilePath();
+    if (FileUtil::FileExists(journal_path)) {
+      FileUtil::Unlink(journal_path);
+    }
   }
 
   static StorageInterface *CreateStorage() {
@@ -87,6 +93,17 @@ class TinyStorageTest : public testing::Test {
     return FileUtil::JoinPath(FLAGS_test_tmpdir, "TinyStorageTest_test.db");
   }
 
+  static string GetJournalFilePath() {
+    return GetTemporaryFilePath() + ".journal";
+  }
+
+  static void ExpectStorageHasValue(const string &key, const string &expected,
+                                    StorageInterface *storage) {
+    string value;
+    EXPECT_TRUE(storage->Lookup(key, &value)) << key;
+    EXPECT_EQ(expected, value) << key;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(TinyStorageTest);
 };
@@ -172,5 +189,189 @@ TEST_F(TinyStorageTest, TinyStorageTest) {
   }
 }
 
+TEST_F(TinyStorageTest, JournaledStorageTest) {
+  const string filename = GetTemporaryFilePath();
+  std::map<string, string> target;
+  CreateKeyValue(&target, 100);
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+    EXPECT_TRUE(storage->Open(filename));
+    for (std::map<string, string>::const_iterator it = target.begin();
+         it != target.end(); ++it) {
+      EXPECT_TRUE(storage->Insert(it->first, it->second));
+    }
+    EXPECT_TRUE(storage->Sync());
+    // Small changes are only appended to the journal.
+    EXPECT_FALSE(FileUtil::FileExists(filename));
+    EXPECT_TRUE(FileUtil::FileExists(GetJournalFilePath()));
+
+    EXPECT_TRUE(storage->Insert("key0", "updated"));
+    EXPECT_TRUE(storage->Erase("key1"));
+    EXPECT_TRUE(storage->Sync());
+  }
+
+  std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_EQ(target.size() - 1, storage->Size());
+  ExpectStorageHasValue("key0", "updated", storage.get());
+  string value;
+  EXPECT_FALSE(storage->Lookup("key1", &value));
+  for (std::map<string, string>::const_iterator it = target.begin();
+       it != target.end(); ++it) {
+    if (it->first != "key0" && it->first != "key1") {
+      ExpectStorageHasValue(it->first, it->second, storage.get());
+    }
+  }
+}
+
+TEST_F(TinyStorageTest, JournalCompactionTest) {
+  const string filename = GetTemporaryFilePath();
+  const string large_value(4000, 'x');
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+    EXPECT_TRUE(storage->Open(filename));
+    for (int i = 0; i < 20; ++i) {
+      EXPECT_TRUE(storage->Insert("key" + std::to_string(i), large_value));
+      EXPECT_TRUE(storage->Sync());
+    }
+    // The journal has been merged into the storage file.
+    EXPECT_TRUE(FileUtil::FileExists(filename));
+  }
+
+  // The storage file can be read without the journal.
+  std::unique_ptr<StorageInterface> storage(TinyStorage::New());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_LT(0, storage->Size());
+  std::unique_ptr<StorageInterface> journaled(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(journaled->Open(filename));
+  EXPECT_EQ(20, journaled->Size());
+  for (int i = 0; i < 20; ++i) {
+    ExpectStorageHasValue("key" + std::to_string(i), large_value,
+                          journaled.get());
+  }
+}
+
+TEST_F(TinyStorageTest, TruncatedJournalTest) {
+  const string filename = GetTemporaryFilePath();
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key", "value"));
+    EXPECT_TRUE(storage->Sync());
+  }
+  {
+    // Emulates a crash in the middle of appending a record.
+    OutputFileStream ofs(GetJournalFilePath().c_str(),
+                         std::ios::binary | std::ios::out | std::ios::app);
+    const char kBrokenRecord[] = "\x20\x00\x00\x00" "broken";
+    ofs.write(kBrokenRecord, sizeof(kBrokenRecord) - 1);
+  }
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_EQ(1, storage->Size());
+    ExpectStorageHasValue("key", "value", storage.get());
+    EXPECT_TRUE(storage->Insert("key2", "value2"));
+    EXPECT_TRUE(storage->Sync());
+  }
+
+  std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_EQ(2, storage->Size());
+  ExpectStorageHasValue("key", "value", storage.get());
+  ExpectStorageHasValue("key2", "value2", storage.get());
+}
+
+TEST_F(TinyStorageTest, StaleJournalTest) {
+  const string filename = GetTemporaryFilePath();
+  const string journal_backup = GetJournalFilePath() + ".backup";
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key", "old"));
+    EXPECT_TRUE(storage->Sync());
+    EXPECT_TRUE(FileUtil::CopyFile(GetJournalFilePath(), journal_backup));
+
+    // Large changes rewrite the storage file.
+    EXPECT_TRUE(storage->Insert("key", "new"));
+    for (int i = 0; i < 20; ++i) {
+      EXPECT_TRUE(storage->Insert("filler" + std::to_string(i),
+                                  string(4000, 'x')));
+    }
+    EXPECT_TRUE(storage->Sync());
+    EXPECT_FALSE(FileUtil::FileExists(GetJournalFilePath()));
+  }
+  // Emulates a crash after rewriting the storage file but before removing
+  // the journal.
+  EXPECT_TRUE(FileUtil::AtomicRename(journal_backup, GetJournalFilePath()));
+
+  std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(storage->Open(filename));
+  ExpectStorageHasValue("key", "new", storage.get());
+}
+
+// Another instance, e.g., in another process, compacts the journal and
+// removes it.  The changes synced later must not be appended to a journal
+// without the header, which would be dropped on replay.
+TEST_F(TinyStorageTest, JournalSyncedByTwoInstancesTest) {
+  const string filename = GetTemporaryFilePath();
+  std::unique_ptr<StorageInterface> storage1(TinyStorage::NewWithJournal());
+  std::unique_ptr<StorageInterface> storage2(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(storage1->Open(filename));
+  EXPECT_TRUE(storage2->Open(filename));
+
+  EXPECT_TRUE(storage1->Insert("key1", "value1"));
+  EXPECT_TRUE(storage1->Sync());
+  EXPECT_TRUE(FileUtil::FileExists(GetJournalFilePath()));
+
+  // |storage2| doesn't know the journal of |storage1|, so it rewrites the
+  // storage file and removes the journal.
+  EXPECT_TRUE(storage2->Insert("key2", "value2"));
+  EXPECT_TRUE(storage2->Sync());
+  EXPECT_TRUE(FileUtil::FileExists(filename));
+  EXPECT_FALSE(FileUtil::FileExists(GetJournalFilePath()));
+
+  EXPECT_TRUE(storage1->Insert("key3", "value3"));
+  EXPECT_TRUE(storage1->Sync());
+  {
+    std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+    EXPECT_TRUE(storage->Open(filename));
+    ExpectStorageHasValue("key1", "value1", storage.get());
+    ExpectStorageHasValue("key3", "value3", storage.get());
+  }
+
+  // The journal started by |storage2| on the latest storage file is not
+  // appended by |storage1|, whose journal doesn't exist anymore.
+  EXPECT_TRUE(storage2->Open(filename));
+  EXPECT_TRUE(storage2->Insert("key4", "value4"));
+  EXPECT_TRUE(storage2->Sync());
+  EXPECT_TRUE(FileUtil::FileExists(GetJournalFilePath()));
+  EXPECT_TRUE(storage1->Insert("key5", "value5"));
+  EXPECT_TRUE(storage1->Sync());
+  std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(storage->Open(filename));
+  ExpectStorageHasValue("key1", "value1", storage.get());
+  ExpectStorageHasValue("key5", "value5", storage.get());
+}
+
+TEST_F(TinyStorageTest, SyncWhileLockedTest) {
+  const string filename = GetTemporaryFilePath();
+  std::unique_ptr<StorageInterface> storage(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_TRUE(storage->Insert("key", "value"));
+  {
+    ProcessMutex mutex("TinyStorageTest");
+    mutex.set_lock_filename(filename + ".lock");
+    ASSERT_TRUE(mutex.Lock());
+    EXPECT_FALSE(storage->Sync());
+    mutex.UnLock();
+  }
+  // The changes are kept until the next sync.
+  EXPECT_TRUE(storage->Sync());
+  std::unique_ptr<StorageInterface> reopened(TinyStorage::NewWithJournal());
+  EXPECT_TRUE(reopened->Open(filename));
+  ExpectStorageHasValue("key", "value", reopened.get());
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -0,0 +1,160 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "unix/emacs/async_dispatcher.h"
+
+#include <utility>
+
+#include "base/logging.h"
+
+namespace mozc {
+namespace emacs {
+
+class AsyncDispatcher::Worker : public Thread {
+ public:
+  explicit Worker(AsyncDispatcher *dispatcher) : dispatcher_(dispatcher) {}
+
+  void Run() override {
+    dispatcher_->RunWorker();
+  }
+
+ private:
+  AsyncDispatcher *dispatcher_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+AsyncDispatcher::AsyncDispatcher(Handler *handler, int num_threads)
+    : handler_(handler), num_pending_requests_(0), stopping_(false) {
+  DCHECK(handler_);
+  DCHECK_GT(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    std::unique_ptr<Worker> worker(new Worker(this));
+    worker->SetJoinable(true);
+    worker->Start("AsyncDispatcher");
+    workers_.push_back(std::move(worker));
+  }
+}
+
+AsyncDispatcher::~AsyncDispatcher() {
+  Wait();
+  {
+    scoped_lock lock(&mutex_);
+    stopping_ = true;
+  }
+  // Each worker wakes up the next one when it stops.
+  ready_event_.Notify();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->Join();
+  }
+}
+
+void AsyncDispatcher::Dispatch(std::unique_ptr<Request> request) {
+  const uint32 session_id = request->session_id;
+  {
+    scoped_lock lock(&mutex_);
+    RequestQueue &queue = session_queues_[session_id];
+    queue.push_back(std::move(request));
+    ++num_pending_requests_;
+    if (queue.size() > 1) {
+      // The session is already scheduled.
+      return;
+    }
+    ready_sessions_.push_back(session_id);
+  }
+  ready_event_.Notify();
+}
+
+void AsyncDispatcher::Wait() {
+  while (true) {
+    {
+      scoped_lock lock(&mutex_);
+      if (num_pending_requests_ == 0) {
+        return;
+      }
+    }
+    idle_event_.Wait(-1);
+  }
+}
+
+void AsyncDispatcher::RunWorker() {
+  while (true) {
+    uint32 session_id = 0;
+    Request *request = nullptr;
+    bool has_more_sessions = false;
+    {
+      scoped_lock lock(&mutex_);
+      if (ready_sessions_.empty()) {
+        if (stopping_) {
+          break;
+        }
+      } else {
+        session_id = ready_sessions_.front();
+        ready_sessions_.pop_front();
+        request = session_queues_[session_id].front().get();
+        has_more_sessions = !ready_sessions_.empty();
+      }
+    }
+    if (request == nullptr) {
+      ready_event_.Wait(-1);
+      continue;
+    }
+    // The event wakes up one worker per notification.  Passes the remaining
+    // sessions on to another worker.
+    if (has_more_sessions) {
+      ready_event_.Notify();
+    }
+
+    handler_->Process(request);
+    {
+      scoped_lock lock(&respond_mutex_);
+      handler_->Respond(*request);
+    }
+
+    bool idle = false;
+    {
+      scoped_lock lock(&mutex_);
+      RequestQueue &queue = session_queues_[session_id];
+      queue.pop_front();
+      if (queue.empty()) {
+        session_queues_.erase(session_id);
+      } else {
+        ready_sessions_.push_back(session_id);
+      }
+      idle = (--num_pending_requests_ == 0);
+    }
+    if (idle) {
+      idle_event_.Notify();
+    }
+  }
+  ready_event_.Notify();
+}
+
+}  // namespace emacs
+}  // namespace mozc
@@ -0,0 +1,126 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Dispatcher of mozc_emacs_helper requests to worker threads.
+//
+// Requests of different sessions are processed concurrently so that a slow
+// conversion in a session does not stall the input in the other sessions.
+// Requests of the same session are processed one by one in the order of
+// arrival.  Responses are written in the order of completion, and the client
+// matches them with requests by emacs-event-id.
+
+#ifndef MOZC_UNIX_EMACS_ASYNC_DISPATCHER_H_
+#define MOZC_UNIX_EMACS_ASYNC_DISPATCHER_H_
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/thread.h"
+#include "base/unnamed_event.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace emacs {
+
+class AsyncDispatcher {
+ public:
+  struct Request {
+    Request() : event_id(0), session_id(0) {}
+
+    uint32 event_id;
+    uint32 session_id;
+    commands::Command command;
+    // Set by Handler::Process() if the request failed.  Worker threads must
+    // not terminate the process; Handler::Respond() reports the error to the
+    // thread reading the requests instead.
+    string error;
+    string error_message;
+  };
+
+  class Handler {
+   public:
+    virtual ~Handler() {}
+
+    // Processes |request| and fills its output.  Called on worker threads.
+    // Requests of the same session are never processed concurrently.
+    virtual void Process(Request *request) = 0;
+
+    // Writes the response of |request|.  Calls are serialized.
+    virtual void Respond(const Request &request) = 0;
+  };
+
+  // Doesn't take the ownership of |handler|.
+  AsyncDispatcher(Handler *handler, int num_threads);
+  // Processes all the dispatched requests and stops the worker threads.
+  ~AsyncDispatcher();
+
+  // Queues |request| to the queue of its session.
+  void Dispatch(std::unique_ptr<Request> request);
+
+  // Blocks until all the dispatched requests are responded.
+  void Wait();
+
+ private:
+  class Worker;
+  typedef std::deque<std::unique_ptr<Request>> RequestQueue;
+
+  // Main loop of worker threads.
+  void RunWorker();
+
+  Handler *handler_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  Mutex mutex_;
+  // Notified when a session gets ready or the dispatcher is stopping.
+  UnnamedEvent ready_event_;
+  // Notified when all the dispatched requests are responded.
+  UnnamedEvent idle_event_;
+  // Pending requests for each session.  The front request of a queue stays
+  // there while being processed, so that a session is scheduled only once.
+  std::map<uint32, RequestQueue> session_queues_;
+  // Sessions whose front request is ready to be processed.
+  std::deque<uint32> ready_sessions_;
+  size_t num_pending_requests_;
+  bool stopping_;
+
+  // Serializes Handler::Respond().
+  Mutex respond_mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncDispatcher);
+};
+
+}  // namespace emacs
+}  // namespace mozc
+
+#endif  // MOZC_UNIX_EMACS_ASYNC_DISPATCHER_H_
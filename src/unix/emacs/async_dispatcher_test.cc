@@ -0,0 +1,179 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "unix/emacs/async_dispatcher.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/unnamed_event.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace emacs {
+namespace {
+
+const int kNumThreads = 8;
+
+// Simulates sessions whose requests take |process_msec| each.
+class SimulatedSessionsHandler : public AsyncDispatcher::Handler {
+ public:
+  SimulatedSessionsHandler(int num_sessions, uint32 process_msec)
+      : process_msec_(process_msec),
+        busy_(num_sessions),
+        concurrent_access_(false) {}
+
+  void Process(AsyncDispatcher::Request *request) override {
+    std::atomic<bool> &busy = busy_[request->session_id];
+    if (busy.exchange(true)) {
+      concurrent_access_ = true;
+    }
+    if (process_msec_ > 0) {
+      Util::Sleep(process_msec_);
+    }
+    request->command.mutable_output()->set_id(request->session_id);
+    busy = false;
+  }
+
+  void Respond(const AsyncDispatcher::Request &request) override {
+    EXPECT_EQ(request.session_id, request.command.output().id());
+    responded_event_ids_[request.session_id].push_back(request.event_id);
+  }
+
+  const std::map<uint32, std::vector<uint32>> &responded_event_ids() const {
+    return responded_event_ids_;
+  }
+
+  bool concurrent_access() const { return concurrent_access_; }
+
+ private:
+  const uint32 process_msec_;
+  std::vector<std::atomic<bool>> busy_;
+  std::atomic<bool> concurrent_access_;
+  // Respond() is serialized by the dispatcher.
+  std::map<uint32, std::vector<uint32>> responded_event_ids_;
+};
+
+// Dispatches |num_requests_per_session| requests to each session in
+// round-robin order.  Event IDs are sequence numbers.
+void DispatchRoundRobin(int num_sessions, int num_requests_per_session,
+                        AsyncDispatcher *dispatcher) {
+  uint32 event_id = 0;
+  for (int i = 0; i < num_requests_per_session; ++i) {
+    for (int session_id = 0; session_id < num_sessions; ++session_id) {
+      std::unique_ptr<AsyncDispatcher::Request> request(
+          new AsyncDispatcher::Request);
+      request->event_id = event_id++;
+      request->session_id = session_id;
+      request->command.mutable_input()->set_type(
+          commands::Input::SEND_KEY);
+      dispatcher->Dispatch(std::move(request));
+    }
+  }
+}
+
+TEST(AsyncDispatcherTest, RequestsOfSessionAreProcessedInOrder) {
+  const int kNumSessions = 16;
+  const int kNumRequestsPerSession = 200;
+  SimulatedSessionsHandler handler(kNumSessions, 0);
+  {
+    AsyncDispatcher dispatcher(&handler, kNumThreads);
+    DispatchRoundRobin(kNumSessions, kNumRequestsPerSession, &dispatcher);
+    dispatcher.Wait();
+  }
+
+  EXPECT_FALSE(handler.concurrent_access());
+  ASSERT_EQ(kNumSessions, handler.responded_event_ids().size());
+  for (auto it = handler.responded_event_ids().begin();
+       it != handler.responded_event_ids().end(); ++it) {
+    const std::vector<uint32> &event_ids = it->second;
+    ASSERT_EQ(kNumRequestsPerSession, event_ids.size());
+    for (int i = 0; i < kNumRequestsPerSession; ++i) {
+      EXPECT_EQ(i * kNumSessions + it->first, event_ids[i]);
+    }
+  }
+}
+
+TEST(AsyncDispatcherTest, DestructorProcessesPendingRequests) {
+  const int kNumSessions = 4;
+  const int kNumRequestsPerSession = 10;
+  SimulatedSessionsHandler handler(kNumSessions, 1);
+  {
+    AsyncDispatcher dispatcher(&handler, 2);
+    DispatchRoundRobin(kNumSessions, kNumRequestsPerSession, &dispatcher);
+  }
+  ASSERT_EQ(kNumSessions, handler.responded_event_ids().size());
+  for (auto it = handler.responded_event_ids().begin();
+       it != handler.responded_event_ids().end(); ++it) {
+    EXPECT_EQ(kNumRequestsPerSession, it->second.size());
+  }
+}
+
+// Blocks the request of session 0 until a request of another session is
+// processed.
+class BlockingSessionHandler : public AsyncDispatcher::Handler {
+ public:
+  BlockingSessionHandler() : unblocked_(false) {}
+
+  void Process(AsyncDispatcher::Request *request) override {
+    if (request->session_id == 0) {
+      // Long enough not to time out on loaded machines.
+      unblocked_ = other_session_processed_.Wait(60 * 1000);
+    } else {
+      other_session_processed_.Notify();
+    }
+  }
+
+  void Respond(const AsyncDispatcher::Request &request) override {}
+
+  bool unblocked() const { return unblocked_; }
+
+ private:
+  UnnamedEvent other_session_processed_;
+  std::atomic<bool> unblocked_;
+};
+
+// A slow session must not stall the others.  Processing the sessions one by
+// one would keep session 0 blocked until the timeout.
+TEST(AsyncDispatcherTest, SlowSessionDoesNotStallOthers) {
+  BlockingSessionHandler handler;
+  {
+    AsyncDispatcher dispatcher(&handler, 2);
+    DispatchRoundRobin(2, 1, &dispatcher);
+    dispatcher.Wait();
+  }
+  EXPECT_TRUE(handler.unblocked());
+}
+
+}  // namespace
+}  // namespace emacs
+}  // namespace mozc
@@ -51,6 +51,7 @@
       'target_name': 'mozc_emacs_helper_lib',
       'type': 'static_library',
       'sources': [
+        'async_dispatcher.cc',
         'mozc_emacs_helper_lib.cc',
         'client_pool.cc',
       ],
@@ -77,11 +78,26 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'async_dispatcher_test',
+      'type': 'executable',
+      'sources': [
+        'async_dispatcher_test.cc',
+      ],
+      'dependencies': [
+        '../../testing/testing.gyp:gtest_main',
+        'mozc_emacs_helper_lib',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'emacs_all_test',
       'type': 'none',
       'dependencies': [
+        'async_dispatcher_test',
         'mozc_emacs_helper_lib_test',
       ],
     },
@@ -27,12 +27,18 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include "base/flags.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/protobuf/descriptor.h"
 #include "base/protobuf/message.h"
 #include "base/util.h"
@@ -40,11 +46,18 @@
 #include "client/client.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
+#include "unix/emacs/async_dispatcher.h"
 #include "unix/emacs/client_pool.h"
 #include "unix/emacs/mozc_emacs_helper_lib.h"
 
 DEFINE_bool(suppress_stderr, false,
             "Discards all the output to stderr.");
+DEFINE_bool(async, false,
+            "Processes the requests of different sessions concurrently. "
+            "Responses may be out of order and are identified by "
+            "emacs-event-id.");
+DEFINE_int32(async_threads, 8,
+             "Number of worker threads in the asynchronous mode.");
 
 namespace {
 
@@ -70,11 +83,47 @@ void PrintGreetingMessage() {
   fflush(stdout);
 }
 
+// Sends a command of an existing session and fills the output.  Returns false
+// and sets the error symbol and message if it fails.
+bool SendCommand(mozc::client::Client *client,
+                 mozc::commands::Command *command,
+                 string *error, string *error_message) {
+  switch (command->input().type()) {
+    case mozc::commands::Input::SEND_KEY: {
+      CHECK(client);
+      if (!client->SendKey(command->input().key(),
+                           command->mutable_output())) {
+        *error = mozc::emacs::kErrSessionError;
+        *error_message = "Session failed";
+        return false;
+      }
+      return true;
+    }
+    default:
+      *error = mozc::emacs::kErrVoidFunction;
+      *error_message = "Unknown function";
+      return false;
+  }
+}
+
+// Prints a result returned by Mozc server in S-expression.
+void PrintResponse(uint32 event_id, uint32 session_id,
+                   mozc::commands::Output *output) {
+  mozc::emacs::RemoveUsageData(output);
+
+  std::vector<string> buffer;
+  mozc::emacs::PrintMessage(*output, &buffer);
+  string output_str;
+  mozc::Util::JoinStrings(buffer, "", &output_str);
+  fprintf(stdout,
+          "((emacs-event-id . %u)(emacs-session-id . %u)(output . %s))\n",
+          event_id, session_id, output_str.c_str());
+  fflush(stdout);
+}
+
 // Main loop, which takes an input line as a command and print a corresponding
 // result returned by Mozc server in S-expression.
 void ProcessLoop() {
-  using mozc::emacs::ErrorExit;
-
   mozc::emacs::ClientPool client_pool;
   mozc::commands::Command command;
   string line;
@@ -96,31 +145,106 @@ void ProcessLoop() {
       case mozc::commands::Input::DELETE_SESSION:
         client_pool.DeleteClient(session_id);
         break;
-      case mozc::commands::Input::SEND_KEY: {
-        std::shared_ptr<mozc::client::Client> client =
-            client_pool.GetClient(session_id);
-        CHECK(client.get());
-        if (!client->SendKey(command.input().key(),
-                              command.mutable_output())) {
-          ErrorExit(mozc::emacs::kErrSessionError, "Session failed");
+      default: {
+        string error, error_message;
+        if (!SendCommand(client_pool.GetClient(session_id).get(), &command,
+                         &error, &error_message)) {
+          mozc::emacs::ErrorExit(error, error_message);
         }
         break;
       }
-      default:
-        ErrorExit(mozc::emacs::kErrVoidFunction, "Unknown function");
     }
 
-    mozc::emacs::RemoveUsageData(command.mutable_output());
-
     // Output results.
-    std::vector<string> buffer;
-    mozc::emacs::PrintMessage(command.output(), &buffer);
-    string output;
-    mozc::Util::JoinStrings(buffer, "", &output);
-    fprintf(stdout,
-            "((emacs-event-id . %u)(emacs-session-id . %u)(output . %s))\n",
-            event_id, session_id, output.c_str());
-    fflush(stdout);
+    PrintResponse(event_id, session_id, command.mutable_output());
+  }
+}
+
+// Processes requests of mozc_emacs_helper on worker threads.
+class AsyncHandler : public mozc::emacs::AsyncDispatcher::Handler {
+ public:
+  AsyncHandler() : failed_(false) {}
+
+  // Assigns a session ID to CREATE_SESSION in the order of arrival.
+  uint32 CreateSession() {
+    mozc::scoped_lock lock(&mutex_);
+    return client_pool_.CreateClient();
+  }
+
+  void Process(mozc::emacs::AsyncDispatcher::Request *request) override {
+    mozc::commands::Command *command = &request->command;
+    switch (command->input().type()) {
+      case mozc::commands::Input::CREATE_SESSION:
+        break;
+      case mozc::commands::Input::DELETE_SESSION: {
+        mozc::scoped_lock lock(&mutex_);
+        client_pool_.DeleteClient(request->session_id);
+        break;
+      }
+      default: {
+        // Holds the client while sending the command even if it is evicted
+        // from the pool by another thread.
+        std::shared_ptr<mozc::client::Client> client;
+        {
+          mozc::scoped_lock lock(&mutex_);
+          client = client_pool_.GetClient(request->session_id);
+        }
+        SendCommand(client.get(), command, &request->error,
+                    &request->error_message);
+        break;
+      }
+    }
+  }
+
+  void Respond(const mozc::emacs::AsyncDispatcher::Request &request) override {
+    if (!request.error.empty()) {
+      // Prints the error as ErrorExit() does, but terminating the process is
+      // left to the main loop.
+      mozc::emacs::PrintErrorMessage(request.error, request.error_message);
+      fflush(stdout);
+      failed_ = true;
+      return;
+    }
+    mozc::commands::Output output = request.command.output();
+    PrintResponse(request.event_id, request.session_id, &output);
+  }
+
+  // Returns true if a request has failed.
+  bool failed() const { return failed_; }
+
+ private:
+  mozc::Mutex mutex_;
+  mozc::emacs::ClientPool client_pool_;
+  std::atomic<bool> failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncHandler);
+};
+
+// Asynchronous version of ProcessLoop().  Requests of different sessions are
+// processed concurrently and their responses are printed in the order of
+// completion.
+void AsyncProcessLoop() {
+  AsyncHandler handler;
+  {
+    mozc::emacs::AsyncDispatcher dispatcher(&handler, FLAGS_async_threads);
+    string line;
+    // Stops reading at the first failure as ProcessLoop() does.
+    while (!handler.failed() && getline(std::cin, line)) {
+      std::unique_ptr<mozc::emacs::AsyncDispatcher::Request> request(
+          new mozc::emacs::AsyncDispatcher::Request);
+      mozc::emacs::ParseInputLine(line, &request->event_id,
+                                  &request->session_id,
+                                  request->command.mutable_input());
+      if (request->command.input().type() ==
+          mozc::commands::Input::CREATE_SESSION) {
+        request->session_id = handler.CreateSession();
+      }
+      dispatcher.Dispatch(std::move(request));
+    }
+    // The dispatcher responds to the pending requests before the destruction.
+  }
+  if (handler.failed()) {
+    exit(1);
   }
 }
 
@@ -143,7 +267,11 @@ int main(int argc, char **argv) {
 
   PrintGreetingMessage();
 
-  ProcessLoop();
+  if (FLAGS_async) {
+    AsyncProcessLoop();
+  } else {
+    ProcessLoop();
+  }
 
   return 0;
 }
@@ -349,10 +349,15 @@ bool TokenizeSExpr(const string &input, std::vector<string> *output) {
   return true;
 }
 
-// Prints an error message in S-expression and terminates with status code 1.
-void ErrorExit(const string &error, const string &message) {
+// Prints an error message in S-expression.
+void PrintErrorMessage(const string &error, const string &message) {
   fprintf(stdout, "((error . %s)(message . %s))\n",
           error.c_str(), QuoteString(message).c_str());
+}
+
+// Prints an error message in S-expression and terminates with status code 1.
+void ErrorExit(const string &error, const string &message) {
+  PrintErrorMessage(error, message);
   exit(1);
 }
 
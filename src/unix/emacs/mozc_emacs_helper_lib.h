@@ -108,6 +108,9 @@ bool UnquoteString(const string &input, string *output);
 // an error for the input "\'".
 bool TokenizeSExpr(const string &input, std::vector<string> *output);
 
+// Prints an error message in S-expression.
+void PrintErrorMessage(const string &error, const string &message);
+
 // Prints an error message in S-expression and terminates with status code 1.
 void ErrorExit(const string &error, const string &message);
 
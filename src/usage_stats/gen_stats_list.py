@@ -45,8 +45,7 @@ def GetStatsNameList(filename):
   return stats
 
 
-def main():
-  stats_list = GetStatsNameList(sys.argv[1])
+def PrintStatsList(stats_list):
   print '// This header file is generated by gen_stats_list.py'
   for stats in stats_list:
     print 'const char k%s[] = "%s";' % (stats, stats)
@@ -56,5 +55,34 @@ def main():
   print '};'
 
 
+def PrintStatsIds(stats_list):
+  print '// This header file is generated by gen_stats_list.py'
+  print '#ifndef MOZC_USAGE_STATS_USAGE_STATS_ID_H_'
+  print '#define MOZC_USAGE_STATS_USAGE_STATS_ID_H_'
+  print ''
+  print 'namespace mozc {'
+  print 'namespace usage_stats {'
+  print ''
+  print '// Index of each stats in kStatsList.'
+  print 'enum class StatsId {'
+  for stats in stats_list:
+    print '  k%s,' % (stats)
+  print '};'
+  print 'const int kNumStats = %d;' % len(stats_list)
+  print ''
+  print '}  // namespace usage_stats'
+  print '}  // namespace mozc'
+  print ''
+  print '#endif  // MOZC_USAGE_STATS_USAGE_STATS_ID_H_'
+
+
+def main():
+  stats_list = GetStatsNameList(sys.argv[1])
+  if len(sys.argv) > 2 and sys.argv[2] == '--ids':
+    PrintStatsIds(stats_list)
+  else:
+    PrintStatsList(stats_list)
+
+
 if __name__ == '__main__':
   main()
@@ -30,9 +30,15 @@
 #include "usage_stats/usage_stats.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <numeric>
+#include <vector>
 
 #include "base/logging.h"
+#include "base/mozc_hash_map.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
 #include "config/stats_config_util.h"
 #include "storage/registry.h"
 #include "usage_stats/usage_stats.pb.h"
@@ -45,6 +51,9 @@ const char kRegistryPrefix[] = "usage_stats.";
 
 #include "usage_stats/usage_stats_list.h"
 
+static_assert(arraysize(kStatsList) == kNumStats,
+              "usage_stats_id.h is out of date");
+
 void AddDoubleValueStats(
     const Stats::DoubleValueStats &src,
     Stats::DoubleValueStats *dest) {
@@ -105,6 +114,168 @@ bool SetterInternal(const string &name, const Stats &stats) {
   }
   return true;
 }
+
+void IncrementCountInRegistry(const string &name, uint32 val) {
+  Stats stats;
+  if (GetterInternal(name, Stats::COUNT, &stats)) {
+    stats.set_count(stats.count() + val);
+  } else {
+    stats.set_name(name);
+    stats.set_type(Stats::COUNT);
+    stats.set_count(val);
+  }
+
+  SetterInternal(name, stats);
+}
+
+// Bucket of |val| in Stats::timing_histogram, which is the number of bits.
+int GetTimingBucket(uint32 val) {
+  int bucket = 0;
+  for (; val > 0; val >>= 1) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+struct TimingValue {
+  // One bucket for zero and one for each bit length of uint32.
+  static const int kNumBuckets = 33;
+
+  TimingValue()
+      : num_timings(0), total_time(0), min_time(kuint32max), max_time(0),
+        histogram() {}
+
+  void Add(uint32 val) {
+    ++num_timings;
+    total_time += val;
+    min_time = std::min(min_time, val);
+    max_time = std::max(max_time, val);
+    ++histogram[GetTimingBucket(val)];
+  }
+
+  uint32 num_timings;
+  uint64 total_time;
+  uint32 min_time;
+  uint32 max_time;
+  uint32 histogram[kNumBuckets];
+};
+
+void AddTimingHistogram(const TimingValue &value, Stats *stats) {
+  int size = TimingValue::kNumBuckets;
+  while (size > 0 && value.histogram[size - 1] == 0) {
+    --size;
+  }
+  while (stats->timing_histogram_size() < size) {
+    stats->add_timing_histogram(0);
+  }
+  for (int i = 0; i < size; ++i) {
+    stats->set_timing_histogram(
+        i, stats->timing_histogram(i) + value.histogram[i]);
+  }
+}
+
+void UpdateTimingInRegistry(const string &name, const TimingValue &value) {
+  DCHECK_GT(value.num_timings, 0);
+  Stats stats;
+  if (GetterInternal(name, Stats::TIMING, &stats)) {
+    stats.set_num_timings(stats.num_timings() + value.num_timings);
+    stats.set_total_time(stats.total_time() + value.total_time);
+    stats.set_avg_time(stats.total_time() / stats.num_timings());
+    stats.set_min_time(std::min(stats.min_time(), value.min_time));
+    stats.set_max_time(std::max(stats.max_time(), value.max_time));
+  } else {
+    stats.set_name(name);
+    stats.set_type(Stats::TIMING);
+    stats.set_num_timings(value.num_timings);
+    stats.set_total_time(value.total_time);
+    stats.set_avg_time(value.total_time / value.num_timings);
+    stats.set_min_time(value.min_time);
+    stats.set_max_time(value.max_time);
+  }
+  AddTimingHistogram(value, &stats);
+
+  SetterInternal(name, stats);
+}
+
+// Accumulates count and timing stats in memory, one slot per entry of
+// kStatsList, so that updating a stats on the command path does not need to
+// parse and serialize the registry entry.  The slots are indexed by StatsId.
+// The accumulated values are merged into the registry by Flush().
+class StatsCache {
+ public:
+  static const size_t kInvalidIndex = static_cast<size_t>(-1);
+
+  StatsCache()
+      : counts_(new std::atomic<uint32>[arraysize(kStatsList)]),
+        timings_(arraysize(kStatsList)) {
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      index_[kStatsList[i]] = i;
+      counts_[i] = 0;
+    }
+  }
+
+  // Returns kInvalidIndex if |name| is not in kStatsList.  Names built at
+  // runtime need this lookup; the others are passed as StatsId.
+  size_t GetIndex(const string &name) const {
+    const mozc_hash_map<string, size_t>::const_iterator it = index_.find(name);
+    return it == index_.end() ? kInvalidIndex : it->second;
+  }
+
+  void IncrementCount(size_t index, uint32 val) {
+    DCHECK_LT(index, arraysize(kStatsList));
+    counts_[index].fetch_add(val, std::memory_order_relaxed);
+  }
+
+  void UpdateTiming(size_t index, uint32 val) {
+    DCHECK_LT(index, arraysize(kStatsList));
+    scoped_lock l(&timing_mutex_);
+    timings_[index].Add(val);
+  }
+
+  void Flush() {
+    scoped_lock flush_lock(&flush_mutex_);
+    std::vector<TimingValue> timings(arraysize(kStatsList));
+    {
+      scoped_lock l(&timing_mutex_);
+      timings.swap(timings_);
+    }
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      const uint32 count = counts_[i].exchange(0, std::memory_order_relaxed);
+      if (count > 0) {
+        IncrementCountInRegistry(kStatsList[i], count);
+      }
+      if (timings[i].num_timings > 0) {
+        UpdateTimingInRegistry(kStatsList[i], timings[i]);
+      }
+    }
+  }
+
+  // Drops the values which are not flushed yet.
+  void Clear() {
+    scoped_lock flush_lock(&flush_mutex_);
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      counts_[i] = 0;
+    }
+    scoped_lock l(&timing_mutex_);
+    timings_.assign(arraysize(kStatsList), TimingValue());
+  }
+
+ private:
+  mozc_hash_map<string, size_t> index_;
+  std::unique_ptr<std::atomic<uint32>[]> counts_;
+  // Timing values have several fields to be updated together, so they are
+  // guarded by a mutex instead of atomics.
+  Mutex timing_mutex_;
+  std::vector<TimingValue> timings_;
+  // Serializes read-modify-write of the registry entries.
+  Mutex flush_mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatsCache);
+};
+
+StatsCache *GetStatsCache() {
+  return Singleton<StatsCache>::get();
+}
 }  // namespace
 
 bool UsageStats::IsListed(const string &name) {
@@ -117,6 +288,7 @@ bool UsageStats::IsListed(const string &name) {
 }
 
 void UsageStats::ClearStats() {
+  GetStatsCache()->Clear();
   string stats_str;
   Stats stats;
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
@@ -139,6 +311,7 @@ void UsageStats::ClearStats() {
 }
 
 void UsageStats::ClearAllStatsForTest() {
+  GetStatsCache()->Clear();
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
     const string key = string(kRegistryPrefix) + kStatsList[i];
     storage::Registry::Erase(key);
@@ -151,16 +324,19 @@ void UsageStats::IncrementCountBy(const string &name, uint32 val) {
     return;
   }
 
-  Stats stats;
-  if (GetterInternal(name, Stats::COUNT, &stats)) {
-    stats.set_count(stats.count() + val);
-  } else {
-    stats.set_name(name);
-    stats.set_type(Stats::COUNT);
-    stats.set_count(val);
+  const size_t index = GetStatsCache()->GetIndex(name);
+  if (index == StatsCache::kInvalidIndex) {
+    IncrementCountInRegistry(name, val);
+    return;
   }
+  GetStatsCache()->IncrementCount(index, val);
+}
 
-  SetterInternal(name, stats);
+void UsageStats::IncrementCountBy(StatsId id, uint32 val) {
+  if (!config::StatsConfigUtil::IsEnabled()) {
+    return;
+  }
+  GetStatsCache()->IncrementCount(static_cast<size_t>(id), val);
 }
 
 void UsageStats::UpdateTiming(const string &name, uint32 val) {
@@ -169,24 +345,21 @@ void UsageStats::UpdateTiming(const string &name, uint32 val) {
     return;
   }
 
-  Stats stats;
-  if (GetterInternal(name, Stats::TIMING, &stats)) {
-    stats.set_num_timings(stats.num_timings() + 1);
-    stats.set_total_time(stats.total_time() + val);
-    stats.set_avg_time(stats.total_time() / stats.num_timings());
-    stats.set_min_time(std::min(stats.min_time(), val));
-    stats.set_max_time(std::max(stats.max_time(), val));
-  } else {
-    stats.set_name(name);
-    stats.set_type(Stats::TIMING);
-    stats.set_num_timings(1);
-    stats.set_total_time(val);
-    stats.set_avg_time(val);
-    stats.set_min_time(val);
-    stats.set_max_time(val);
+  const size_t index = GetStatsCache()->GetIndex(name);
+  if (index == StatsCache::kInvalidIndex) {
+    TimingValue value;
+    value.Add(val);
+    UpdateTimingInRegistry(name, value);
+    return;
   }
+  GetStatsCache()->UpdateTiming(index, val);
+}
 
-  SetterInternal(name, stats);
+void UsageStats::UpdateTiming(StatsId id, uint32 val) {
+  if (!config::StatsConfigUtil::IsEnabled()) {
+    return;
+  }
+  GetStatsCache()->UpdateTiming(static_cast<size_t>(id), val);
 }
 
 void UsageStats::SetInteger(const string &name, int val) {
@@ -219,6 +392,7 @@ void UsageStats::SetBoolean(const string &name, bool val) {
 
 bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::COUNT, &stats)) {
     return false;
@@ -234,6 +408,7 @@ bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
 
 bool UsageStats::GetIntegerForTest(const string &name, int32 *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::INTEGER, &stats)) {
     return false;
@@ -249,6 +424,7 @@ bool UsageStats::GetIntegerForTest(const string &name, int32 *value) {
 
 bool UsageStats::GetBooleanForTest(const string &name, bool *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::BOOLEAN, &stats)) {
     return false;
@@ -268,6 +444,7 @@ bool UsageStats::GetTimingForTest(const string &name,
                                   uint32 *avg_time,
                                   uint32 *min_time,
                                   uint32 *max_time) {
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::TIMING, &stats)) {
     return false;
@@ -302,6 +479,7 @@ bool UsageStats::GetTimingForTest(const string &name,
 }
 
 bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
+  Flush();
   if (!GetterInternal(name, Stats::VIRTUAL_KEYBOARD, stats)) {
     return false;
   }
@@ -316,6 +494,7 @@ bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
 }
 
 bool UsageStats::GetStatsForTest(const string &name, Stats *stats) {
+  Flush();
   return LoadStats(name, stats);
 }
 
@@ -367,7 +546,12 @@ void UsageStats::StoreTouchEventStats(
   SetterInternal(name, stats);
 }
 
+void UsageStats::Flush() {
+  GetStatsCache()->Flush();
+}
+
 bool UsageStats::Sync() {
+  Flush();
   if (!storage::Registry::Sync()) {
     LOG(ERROR) << "sync failed";
     return false;
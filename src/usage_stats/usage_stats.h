@@ -35,6 +35,7 @@
 #include <vector>
 #include "base/port.h"
 #include "usage_stats/usage_stats.pb.h"
+#include "usage_stats/usage_stats_id.h"
 
 namespace mozc {
 namespace usage_stats {
@@ -53,6 +54,14 @@ class UsageStats {
   // Updates current value using given val
   static void UpdateTiming(const string &name, uint32 val);
 
+  // Same as above, but takes the stats by its index generated from stats.def,
+  // which saves looking up the name.  Use these on the command path.
+  static void IncrementCountBy(StatsId id, uint32 val);
+  static void IncrementCount(StatsId id) {
+    IncrementCountBy(id, 1);
+  }
+  static void UpdateTiming(StatsId id, uint32 val);
+
   // Sets integer value
   // Replaces old value with val
   static void SetInteger(const string &name, int val);
@@ -77,7 +86,13 @@ class UsageStats {
       const string &name,
       const std::map<string, TouchEventStatsMap> &touch_stats);
 
+  // Writes count and timing stats accumulated in memory into the registry.
+  // IncrementCountBy() and UpdateTiming() only update the in-memory values,
+  // so call this (or Sync()) before reading the stats from the registry.
+  static void Flush();
+
   // Synchronizes (writes) usage data into disk. Returns false on failure.
+  // Stats accumulated in memory are flushed first.
   static bool Sync();
 
   // Clears existing data exept for Integer and Boolean stats.
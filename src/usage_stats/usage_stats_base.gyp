@@ -47,6 +47,9 @@
         'gen_usage_stats_list#host',
         'usage_stats_protocol',
       ],
+      'export_dependent_settings': [
+        'gen_usage_stats_list#host',
+      ],
     },
     {
       'target_name': 'gen_usage_stats_list',
@@ -74,6 +77,28 @@
             '<@(input_files)',
           ],
         },
+        {
+          'action_name': 'gen_usage_stats_id',
+          'variables': {
+            'input_files': [
+              '../data/usage_stats/stats.def',
+            ],
+          },
+          'inputs': [
+            'gen_stats_list.py',
+            '<@(input_files)',
+          ],
+          'outputs': [
+            '<(gen_out_dir)/usage_stats_id.h',
+          ],
+          'action': [
+            'python', '../build_tools/redirect.py',
+            '<(gen_out_dir)/usage_stats_id.h',
+            'gen_stats_list.py',
+            '<@(input_files)',
+            '--ids',
+          ],
+        },
       ],
     },
     {
@@ -0,0 +1,146 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Update benchmark of UsageStats.
+//
+// Reports the cost of the usage stats updates which SessionHandler makes for
+// every command: SessionAllEvent, Commit and ElapsedTimeUSec.  They are
+// measured by name, by StatsId, and by updating the registry entries
+// directly, which is what every update did before the values were
+// accumulated in memory.
+//
+// Usage:
+//   usage_stats_benchmark --commands=1000000
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "config/stats_config_util.h"
+#include "config/stats_config_util_mock.h"
+#include "storage/registry.h"
+#include "testing/base/public/googletest.h"
+#include "usage_stats/usage_stats.h"
+#include "usage_stats/usage_stats.pb.h"
+
+DEFINE_int32(commands, 1000000, "Number of commands for each method.");
+DEFINE_int32(registry_commands, 100000,
+             "Number of commands when updating the registry directly.");
+
+namespace mozc {
+namespace {
+
+using usage_stats::Stats;
+using usage_stats::StatsId;
+using usage_stats::UsageStats;
+
+// Parses, updates and writes back the registry entry of |name|.
+void UpdateRegistry(const string &name, Stats::Type type, uint32 val) {
+  const string key = "usage_stats." + name;
+  string stats_str;
+  Stats stats;
+  if (!storage::Registry::Lookup(key, &stats_str) ||
+      !stats.ParseFromString(stats_str)) {
+    stats.set_name(name);
+    stats.set_type(type);
+    stats.set_min_time(kuint32max);
+  }
+  if (type == Stats::COUNT) {
+    stats.set_count(stats.count() + val);
+  } else {
+    stats.set_num_timings(stats.num_timings() + 1);
+    stats.set_total_time(stats.total_time() + val);
+    stats.set_avg_time(stats.total_time() / stats.num_timings());
+    stats.set_min_time(std::min(stats.min_time(), val));
+    stats.set_max_time(std::max(stats.max_time(), val));
+  }
+  storage::Registry::Insert(key, stats.SerializeAsString());
+}
+
+void UpdateByName(uint32 elapsed_usec) {
+  UsageStats::IncrementCount("SessionAllEvent");
+  UsageStats::IncrementCount("Commit");
+  UsageStats::UpdateTiming("ElapsedTimeUSec", elapsed_usec);
+}
+
+void UpdateById(uint32 elapsed_usec) {
+  UsageStats::IncrementCount(StatsId::kSessionAllEvent);
+  UsageStats::IncrementCount(StatsId::kCommit);
+  UsageStats::UpdateTiming(StatsId::kElapsedTimeUSec, elapsed_usec);
+}
+
+void UpdateByRegistry(uint32 elapsed_usec) {
+  UpdateRegistry("SessionAllEvent", Stats::COUNT, 1);
+  UpdateRegistry("Commit", Stats::COUNT, 1);
+  UpdateRegistry("ElapsedTimeUSec", Stats::TIMING, elapsed_usec);
+}
+
+void RunBenchmark(const char *name, int num_commands,
+                  void (*update)(uint32)) {
+  UsageStats::ClearAllStatsForTest();
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < num_commands; ++i) {
+    update(i % 1000);
+  }
+  stopwatch.Stop();
+  UsageStats::Flush();
+  std::cout << name << "\t"
+            << static_cast<double>(stopwatch.GetElapsedMicroseconds()) /
+                   num_commands
+            << " us/command" << std::endl;
+}
+
+int Run() {
+  config::StatsConfigUtilMock stats_config_util;
+  config::StatsConfigUtil::SetHandler(&stats_config_util);
+
+  RunBenchmark("by name", FLAGS_commands, &UpdateByName);
+  RunBenchmark("by StatsId", FLAGS_commands, &UpdateById);
+  RunBenchmark("registry", FLAGS_registry_commands, &UpdateByRegistry);
+
+  UsageStats::ClearAllStatsForTest();
+  config::StatsConfigUtil::SetHandler(NULL);
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  mozc::InitTestFlags();
+  // Never touches the registry of the user.
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  return mozc::Run();
+}
@@ -177,6 +177,98 @@ TEST_F(UsageStatsTest, GetterTest) {
   EXPECT_EQ(2, stats_val.count());
 }
 
+TEST_F(UsageStatsTest, FlushTest) {
+  const char kCountKey[] = "ShutDown";
+  const char kTimingKey[] = "ElapsedTimeUSec";
+  const string count_registry_key = string("usage_stats.") + kCountKey;
+  const string timing_registry_key = string("usage_stats.") + kTimingKey;
+  string stats_str;
+
+  // Counts and timings are kept in memory until flushed.
+  UsageStats::IncrementCountBy(kCountKey, 2);
+  UsageStats::UpdateTiming(kTimingKey, 5);
+  EXPECT_FALSE(storage::Registry::Lookup(count_registry_key, &stats_str));
+  EXPECT_FALSE(storage::Registry::Lookup(timing_registry_key, &stats_str));
+
+  UsageStats::Flush();
+  Stats stats;
+  EXPECT_TRUE(storage::Registry::Lookup(count_registry_key, &stats_str));
+  EXPECT_TRUE(stats.ParseFromString(stats_str));
+  EXPECT_EQ(2, stats.count());
+  EXPECT_TRUE(storage::Registry::Lookup(timing_registry_key, &stats_str));
+  EXPECT_TRUE(stats.ParseFromString(stats_str));
+  EXPECT_EQ(1, stats.num_timings());
+
+  // Values flushed later are merged into the registry.
+  UsageStats::IncrementCount(kCountKey);
+  UsageStats::UpdateTiming(kTimingKey, 1);
+  UsageStats::UpdateTiming(kTimingKey, 9);
+  uint32 count_val = 0;
+  uint64 total_time = 0;
+  uint32 num_timings = 0, avg_time = 0, min_time = 0, max_time = 0;
+  EXPECT_TRUE(UsageStats::GetCountForTest(kCountKey, &count_val));
+  EXPECT_TRUE(UsageStats::GetTimingForTest(kTimingKey, &total_time,
+                                           &num_timings, &avg_time,
+                                           &min_time, &max_time));
+  EXPECT_EQ(3, count_val);
+  EXPECT_EQ(15, total_time);
+  EXPECT_EQ(3, num_timings);
+  EXPECT_EQ(5, avg_time);
+  EXPECT_EQ(1, min_time);
+  EXPECT_EQ(9, max_time);
+
+  // Clearing stats also drops the values which are not flushed yet.
+  UsageStats::IncrementCount(kCountKey);
+  UsageStats::UpdateTiming(kTimingKey, 1);
+  UsageStats::ClearStats();
+  UsageStats::Flush();
+  EXPECT_FALSE(storage::Registry::Lookup(count_registry_key, &stats_str));
+  EXPECT_FALSE(storage::Registry::Lookup(timing_registry_key, &stats_str));
+}
+
+TEST_F(UsageStatsTest, StatsIdTest) {
+  // Updates by StatsId go to the same stats as the ones by name.
+  UsageStats::IncrementCount("ShutDown");
+  UsageStats::IncrementCountBy(StatsId::kShutDown, 2);
+  UsageStats::UpdateTiming("ElapsedTimeUSec", 5);
+  UsageStats::UpdateTiming(StatsId::kElapsedTimeUSec, 7);
+
+  uint32 count_val = 0;
+  uint64 total_time = 0;
+  uint32 num_timings = 0;
+  EXPECT_TRUE(UsageStats::GetCountForTest("ShutDown", &count_val));
+  EXPECT_TRUE(UsageStats::GetTimingForTest("ElapsedTimeUSec", &total_time,
+                                           &num_timings, NULL, NULL, NULL));
+  EXPECT_EQ(3, count_val);
+  EXPECT_EQ(12, total_time);
+  EXPECT_EQ(2, num_timings);
+}
+
+TEST_F(UsageStatsTest, TimingHistogramTest) {
+  const char kTimingKey[] = "ElapsedTimeUSec";
+  UsageStats::UpdateTiming(kTimingKey, 0);
+  UsageStats::UpdateTiming(kTimingKey, 1);
+  UsageStats::UpdateTiming(kTimingKey, 5);
+  UsageStats::UpdateTiming(kTimingKey, 7);
+  Stats stats;
+  EXPECT_TRUE(UsageStats::GetStatsForTest(kTimingKey, &stats));
+  // Buckets of 0, 1, [2, 4) and [4, 8).
+  ASSERT_EQ(4, stats.timing_histogram_size());
+  EXPECT_EQ(1, stats.timing_histogram(0));
+  EXPECT_EQ(1, stats.timing_histogram(1));
+  EXPECT_EQ(0, stats.timing_histogram(2));
+  EXPECT_EQ(2, stats.timing_histogram(3));
+
+  // Histograms flushed later are added bucket by bucket.
+  UsageStats::UpdateTiming(kTimingKey, 1);
+  UsageStats::UpdateTiming(kTimingKey, 1000);
+  EXPECT_TRUE(UsageStats::GetStatsForTest(kTimingKey, &stats));
+  ASSERT_EQ(11, stats.timing_histogram_size());
+  EXPECT_EQ(2, stats.timing_histogram(1));
+  EXPECT_EQ(2, stats.timing_histogram(3));
+  EXPECT_EQ(1, stats.timing_histogram(10));
+}
+
 namespace {
 void SetDoubleValueStats(
     uint32 num, double total, double square_total,
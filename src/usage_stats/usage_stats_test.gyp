@@ -84,6 +84,22 @@
         'test_size': 'small',
       },
     },
+    {
+      # Update benchmark of UsageStats.  Not run as a test.
+      'target_name': 'usage_stats_benchmark',
+      'type': 'executable',
+      'sources': [
+        'usage_stats_benchmark.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../config/config.gyp:stats_config_util',
+        '../storage/storage.gyp:storage',
+        '../testing/testing.gyp:googletest_lib',
+        'usage_stats_base.gyp:usage_stats',
+        'usage_stats_base.gyp:usage_stats_protocol',
+      ],
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'usage_stats_all_test',
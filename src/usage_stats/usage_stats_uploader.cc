@@ -248,6 +248,7 @@ void UsageStatsUploader::SetClientIdHandler(
 
 void UsageStatsUploader::LoadStats(UploadUtil *uploader) {
   DCHECK(uploader);
+  UsageStats::Flush();
   string stats_str;
   Stats stats;
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
@@ -357,11 +358,7 @@ bool UsageStatsUploader::Send(void *data) {
                     AndroidUtil::kSystemPropertyModel, "Unknown")));
 #endif  // OS_ANDROID
 
-  {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    UsageStatsUpdater::UpdateStats(config);
-  }
+  UsageStatsUpdater::UpdateStats(*config::ConfigHandler::GetSharedConfig());
 
   UploadUtil uploader;
   uploader.SetHeader("Daily", elapsed_sec, params);